@@ -14,6 +14,48 @@
 #define DIR_C
 #endif // ARCHIVE_C
 
+// entry lookups for zip/tar/pak readers: open addressing table of entry numbers, built on first find.
+// entries are inserted in order and duplicates take over their slot, so last coincidence wins.
+#if (defined ZIP_C || defined TAR_C || defined PAK_C) && !defined ARCHIVE_LUT_C
+#define ARCHIVE_LUT_C
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef REALLOC
+#define REALLOC realloc
+#endif
+
+typedef char *(*archive__namefn)(void *archive, unsigned index);
+
+static unsigned archive__hash(const char *s) { // fnv1a
+    unsigned h = 2166136261u;
+    while( *s ) h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
+static unsigned *archive__lut(void *archive, archive__namefn name, unsigned count, unsigned *mask) { // slots hold index+1; 0 if empty
+    unsigned cap = 16; while( cap < count * 2 ) cap *= 2;
+    unsigned *slots = REALLOC(0, cap * sizeof(unsigned));
+    memset(slots, 0, cap * sizeof(unsigned));
+    for( unsigned i = 0; i < count; ++i ) {
+        const char *key = name(archive, i);
+        unsigned h = archive__hash(key) & (cap - 1);
+        while( slots[h] && strcmp(name(archive, slots[h] - 1), key) ) h = (h + 1) & (cap - 1);
+        slots[h] = i + 1;
+    }
+    *mask = cap - 1;
+    return slots;
+}
+
+static int archive__find(void *archive, archive__namefn name, const unsigned *slots, unsigned mask, const char *key) {
+    for( unsigned h = archive__hash(key) & mask; slots[h]; h = (h + 1) & mask ) {
+        if( !strcmp(name(archive, slots[h] - 1), key) ) return slots[h] - 1;
+    }
+    return -1;
+}
+#endif // ARCHIVE_LUT_C
+
 //#line 1 "src/zip.c"
 // zip un/packer. based on JUnzip library by Joonas Pihlajamaa (UNLICENSE)
 // - rlyeh, public domain.
@@ -37,9 +79,9 @@ zip* zip_open(const char *file, const char *mode /*r,w,a*/);
 
     // only for (w)rite or (a)ppend mode
     bool zip_append_file(zip*, const char *entryname, const char *comment, FILE *in, unsigned compr_level);
+    int zip_find(zip*, const char *entryname); // convert entry to index. returns <0 if not found. any mode: sees appended entries too
 
     // only for (r)ead mode
-    int zip_find(zip*, const char *entryname); // convert entry to index. returns <0 if not found.
     unsigned zip_count(zip*);
         char*    zip_name(zip*, unsigned index);
         char*    zip_modt(zip*, unsigned index);
@@ -51,6 +93,7 @@ zip* zip_open(const char *file, const char *mode /*r,w,a*/);
         unsigned zip_codec(zip*, unsigned index);
         unsigned zip_offset(zip*, unsigned index);
         void*    zip_extract(zip*, unsigned index); // must free() after use
+        void*    zip_extract_mem(zip*, unsigned index, const void *archive); // same, but decodes from whole archive in memory (mmap). must free() after use
         bool     zip_extract_file(zip*, unsigned index, FILE *out);
         unsigned zip_extract_data(zip*, unsigned index, void *out, unsigned outlen);
 
@@ -381,6 +424,7 @@ struct zip {
     char *comment;
     } *entries;
     unsigned count;
+    unsigned *lut, lut_mask; // entry lookups
 };
 
 uint32_t zip__crc32(uint32_t crc, const void *data, size_t n_bytes) {
@@ -425,14 +469,16 @@ int zip__callback(FILE *fp, int idx, JZGlobalFileHeader *header, char *filename,
 
 int ZIP_DEBUG = 0;
 
+static char *zip__name(zip *z, unsigned index) { // entry names are in memory in every mode
+    return z->entries[index].filename;
+}
+
 int zip_find(zip *z, const char *entryname) {
     int zip_debug = ZIP_DEBUG; ZIP_DEBUG = 0;
     if(zip_debug) FPRINTF(stdout, "zip_find(%s)\n", entryname);
-    if( z->in ) for( int i = z->count; --i >= 0; ) { // in case of several copies, grab most recent file (last coincidence)
-        if(zip_debug) FPRINTF(stdout, "\t%d) %s\n", i, z->entries[i].filename);
-        if( 0 == strcmp(entryname, z->entries[i].filename)) return i;
-    }
-    return -1;
+    if(zip_debug) for( int i = z->count; --i >= 0; ) FPRINTF(stdout, "\t%d) %s\n", i, z->entries[i].filename);
+    if( !z->lut ) z->lut = archive__lut(z, (archive__namefn)zip__name, z->count, &z->lut_mask);
+    return archive__find(z, (archive__namefn)zip__name, z->lut, z->lut_mask, entryname); // in case of several copies, grab most recent file (last coincidence)
 }
 
 bool zip_file(zip *z, unsigned index) { // is_file? (dir if attrib&15 or name ends with '/'; file otherwise)
@@ -504,6 +550,23 @@ void *zip_extract(zip *z, unsigned index) { // must free()
     return NULL;
 }
 
+void *zip_extract_mem(zip *z, unsigned index, const void *archive) { // must free()
+    if( z->in && index < z->count ) {
+        JZGlobalFileHeader *header = &(z->entries[index].header);
+        unsigned level = header->compressionMethod;
+        unsigned flags = level >> 8;
+
+        const char *in = (const char*)archive + z->entries[index].offset;
+        unsigned outlen = (unsigned)header->uncompressedSize, ret = 0;
+        char *out = (char*)REALLOC(0, outlen + 1 + EXCESS(flags));
+        if( level == 0 ) ret = outlen, memcpy(out, in, outlen);
+        else if( (level & 255) == 8 ) ret = DECOMPRESS(in, header->compressedSize, out, outlen, flags) ? outlen : 0;
+        if(ret) out[outlen] = '\0';
+        return ret ? out : (REALLOC(out, 0), out = 0);
+    }
+    return NULL;
+}
+
 bool zip_extract_file(zip* z, unsigned index, FILE *out) {
     void *data = zip_extract(z, index);
     if( !data ) return false;
@@ -528,7 +591,7 @@ bool zip_append_file(zip *z, const char *entryname, const char *comment, FILE *i
 
     struct stat st;
     struct tm *timeinfo;
-    stat(entryname, &st);
+    if( stat(entryname, &st) != 0 ) st.st_mtime = time(0); // entry may not exist on disk
     timeinfo = localtime(&st.st_mtime);
 
     uint32_t crc = 0;
@@ -536,6 +599,7 @@ bool zip_append_file(zip *z, const char *entryname, const char *comment, FILE *i
     while(!feof(in) && !ferror(in)) crc = zip__crc32(crc, buf, fread(buf, 1, sizeof(buf), in));
     if(ferror(in)) return ERR(false, "Error while calculating CRC, skipping store.");
 
+    if(z->lut) REALLOC(z->lut, 0), z->lut = 0; // stale: rebuilt by next zip_find()
     unsigned index = z->count;
     z->entries = REALLOC(z->entries, (++z->count) * sizeof(struct zip_entry));
     if(z->entries == NULL) return ERR(false, "Failed to allocate new entry!");
@@ -704,6 +768,7 @@ void zip_close(zip* z) {
         if(z->entries[i].comment) REALLOC(z->entries[i].comment, 0);
     }
     if(z->entries) REALLOC(z->entries, 0);
+    if(z->lut) REALLOC(z->lut, 0);
     zip zero = {0}; *z = zero; REALLOC(z, 0);
 }
 
@@ -760,6 +825,7 @@ struct tar {
     unsigned size;
     size_t offset;
     } *entries;
+    unsigned *lut, lut_mask; // entry lookups
 };
 
 // equivalent to sscanf(buf, 8, "%.7o", &size); or (12, "%.11o", &modtime)
@@ -849,15 +915,17 @@ tar *tar_open(const char *filename, const char *mode) {
 
     *t = zero;
     t->in = in;
-    tar__parse(in, tar__push_entry, t);
+    if( !tar__parse(in, tar__push_entry, t) && !t->count ) { // keep entries of truncated tars
+        tar_close(t);
+        return ERR(NULL, "cant read '%s' as tar", filename);
+    }
     return t;
 }
 
 int tar_find(tar *t, const char *entryname) {
-    if( t->in ) for( int i = t->count; --i >= 0; ) { // in case of several copies, grab most recent file (last coincidence)
-        if( 0 == strcmp(entryname, t->entries[i].filename)) return i;
-    }
-    return -1;
+    if( !t->in ) return -1;
+    if( !t->lut ) t->lut = archive__lut(t, (archive__namefn)tar_name, t->count, &t->lut_mask);
+    return archive__find(t, (archive__namefn)tar_name, t->lut, t->lut_mask, entryname); // in case of several copies, grab most recent file (last coincidence)
 }
 
 unsigned tar_count(tar *t) {
@@ -880,8 +948,8 @@ void *tar_extract(tar *t, unsigned index) {
     if( t && index < t->count ) {
         fseek(t->in, t->entries[index].offset, SEEK_SET);
         size_t len = t->entries[index].size;
-        void *data = REALLOC(0, t->entries[index].size);
-        fread(data, 1, len, t->in);
+        char *data = REALLOC(0, t->entries[index].size + 1);
+        fread(data, 1, len, t->in); data[len] = '\0';
         return data;
     }
     return 0;
@@ -892,6 +960,8 @@ void tar_close(tar *t) {
     for( int i = 0; i < t->count; ++i) {
         REALLOC(t->entries[i].filename, 0);
     }
+    REALLOC(t->entries, 0);
+    REALLOC(t->lut, 0);
     tar zero = {0};
     *t = zero;
     REALLOC(t, 0);
@@ -942,9 +1012,9 @@ pak* pak_open(const char *fname, const char *mode /*a,r,w*/);
     // (w)rite or (a)ppend modes only
     int pak_append_file(pak*, const char *filename, FILE *in);
     int pak_append_data(pak*, const char *filename, const void *in, unsigned inlen);
+    int pak_find(pak*,const char *fname); // return <0 if error; index otherwise. any mode: sees appended entries too
 
     // (r)ead only mode
-    int pak_find(pak*,const char *fname); // return <0 if error; index otherwise.
     unsigned pak_count(pak*);
         unsigned pak_size(pak*,unsigned index);
         unsigned pak_offset(pak*, unsigned index);
@@ -1011,6 +1081,7 @@ typedef struct pak {
     int dummy;
     pak_file *entries;
     unsigned count;
+    unsigned *lut, lut_mask; // entry lookups
 } pak;
 
 pak *pak_open(const char *fname, const char *mode) {
@@ -1105,6 +1176,7 @@ int pak_append_data(pak *p, const char *filename, const void *in, unsigned inlen
     if(!p->out) return ERR(0, "read-only pak file");
 
     // index meta
+    if(p->lut) REALLOC(p->lut, 0), p->lut = 0; // stale: rebuilt by next pak_find()
     unsigned index = p->count++;
     p->entries = REALLOC(p->entries, p->count * sizeof(pak_file));
     pak_file *e = &p->entries[index], zero = {0};
@@ -1121,6 +1193,7 @@ int pak_append_data(pak *p, const char *filename, const void *in, unsigned inlen
 
 int pak_append_file(pak *p, const char *filename, FILE *in) {
     // index meta
+    if(p->lut) REALLOC(p->lut, 0), p->lut = 0; // stale: rebuilt by next pak_find()
     unsigned index = p->count++;
     p->entries = REALLOC(p->entries, p->count * sizeof(pak_file));
     pak_file *e = &p->entries[index], zero = {0};
@@ -1173,6 +1246,7 @@ void pak_close(pak *p) {
         pak_file *e = &p->entries[i];
     }
     REALLOC(p->entries, 0);
+    REALLOC(p->lut, 0);
 
     // delete
     pak zero = {0};
@@ -1180,13 +1254,13 @@ void pak_close(pak *p) {
     REALLOC(p, 0);
 }
 
+static char *pak__name(pak *p, unsigned index) { // entry names are in memory in every mode
+    return p->entries[index].name;
+}
+
 int pak_find(pak *p, const char *filename) {
-    if( p->in ) {
-        for( int i = p->count; --i >= 0; ) {
-            if(!strcmp(p->entries[i].name, filename)) return i;
-        }
-    }
-    return -1;
+    if( !p->lut ) p->lut = archive__lut(p, (archive__namefn)pak__name, p->count, &p->lut_mask);
+    return archive__find(p, (archive__namefn)pak__name, p->lut, p->lut_mask, filename); // in case of several copies, grab most recent file (last coincidence)
 }
 
 unsigned pak_count(pak *p) {
@@ -1211,7 +1285,7 @@ void *pak_extract(pak *p, unsigned index) {
         if( fseek(p->in, e->offset, SEEK_SET) != 0 ) {
             return ERR(NULL, "cant seek");
         }
-        void *buffer = REALLOC(0, e->size);
+        char *buffer = REALLOC(0, e->size + 1);
         if( !buffer ) {
             return ERR(NULL, "out of mem");
         }
@@ -1219,6 +1293,7 @@ void *pak_extract(pak *p, unsigned index) {
             REALLOC(buffer, 0);
             return ERR(NULL, "cant read");
         }
+        buffer[e->size] = '\0';
         return buffer;
     }
     return NULL;
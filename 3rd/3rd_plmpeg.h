@@ -266,6 +266,14 @@ typedef void(*plm_audio_decode_callback)
 typedef void(*plm_buffer_load_callback)(plm_buffer_t *self, void *user);
 
 
+// Callback functions for plm_buffer reading from a custom file source. read
+// returns the number of bytes read, 0 at the end; seek goes to an absolute
+// position.
+
+typedef size_t(*plm_buffer_read_callback)(uint8_t *bytes, size_t length, void *user);
+typedef void(*plm_buffer_seek_callback)(size_t pos, void *user);
+
+
 
 // -----------------------------------------------------------------------------
 // plm_* public API
@@ -480,6 +488,13 @@ plm_buffer_t *plm_buffer_create_with_filename(const char *filename);
 plm_buffer_t *plm_buffer_create_with_file(FILE *fh, int close_when_done);
 
 
+// Create a buffer instance reading through callbacks, like a file handle
+// (eg, a stream from a virtual filesystem). size is the total byte size of the
+// source, needed for seeking and duration.
+
+plm_buffer_t *plm_buffer_create_with_callbacks(plm_buffer_read_callback read_callback, plm_buffer_seek_callback seek_callback, size_t size, void *user);
+
+
 // Create a buffer instance with a pointer to memory as source. This assumes
 // the whole file is in memory. The bytes are not copied. Pass 1 to
 // free_when_done to let plmpeg call free() on the pointer when plm_destroy()
@@ -1326,6 +1341,10 @@ typedef struct plm_buffer_t {
 	int free_when_done;
 	int close_when_done;
 	FILE *fh;
+	plm_buffer_read_callback read_callback; // file mode without fh
+	plm_buffer_seek_callback seek_callback;
+	void *io_user_data;
+	size_t io_pos;
 	plm_buffer_load_callback load_callback;
 	void *load_callback_user_data;
 	uint8_t *bytes;
@@ -1382,6 +1401,19 @@ plm_buffer_t *plm_buffer_create_with_file(FILE *fh, int close_when_done) {
 	return self;
 }
 
+plm_buffer_t *plm_buffer_create_with_callbacks(plm_buffer_read_callback read_callback, plm_buffer_seek_callback seek_callback, size_t size, void *user) {
+	plm_buffer_t *self = plm_buffer_create_with_capacity(PLM_BUFFER_DEFAULT_SIZE);
+	self->read_callback = read_callback;
+	self->seek_callback = seek_callback;
+	self->io_user_data = user;
+	self->mode = PLM_BUFFER_MODE_FILE;
+	self->discard_read_bytes = TRUE;
+	self->total_size = size;
+
+	plm_buffer_set_load_callback(self, plm_buffer_load_file_callback, NULL);
+	return self;
+}
+
 plm_buffer_t *plm_buffer_create_with_memory(uint8_t *bytes, size_t length, int free_when_done) {
 	plm_buffer_t *self = (plm_buffer_t *)malloc(sizeof(plm_buffer_t));
 	memset(self, 0, sizeof(plm_buffer_t));
@@ -1483,7 +1515,13 @@ void plm_buffer_seek(plm_buffer_t *self, size_t pos) {
 	self->has_ended = FALSE;
 
 	if (self->mode == PLM_BUFFER_MODE_FILE) {
-		fseek(self->fh, pos, SEEK_SET);
+		if (self->fh) {
+			fseek(self->fh, pos, SEEK_SET);
+		}
+		else {
+			self->seek_callback(pos, self->io_user_data);
+			self->io_pos = pos;
+		}
 		self->bit_index = 0;
 		self->length = 0;
 	}
@@ -1503,7 +1541,7 @@ void plm_buffer_seek(plm_buffer_t *self, size_t pos) {
 
 size_t plm_buffer_tell(plm_buffer_t *self) {
 	return self->mode == PLM_BUFFER_MODE_FILE
-		? ftell(self->fh) + (self->bit_index >> 3) - self->length
+		? (self->fh ? (size_t)ftell(self->fh) : self->io_pos) + (self->bit_index >> 3) - self->length
 		: self->bit_index >> 3;
 }
 
@@ -1528,7 +1566,10 @@ void plm_buffer_load_file_callback(plm_buffer_t *self, void *user) {
 	}
 
 	size_t bytes_available = self->capacity - self->length;
-	size_t bytes_read = fread(self->bytes + self->length, 1, bytes_available, self->fh);
+	size_t bytes_read = self->fh
+		? fread(self->bytes + self->length, 1, bytes_available, self->fh)
+		: self->read_callback(self->bytes + self->length, bytes_available, self->io_user_data);
+	self->io_pos += bytes_read;
 	self->length += bytes_read;
 
 	if (bytes_read == 0) {
@@ -627,11 +627,15 @@ static void fwk_pre_init_subsystems() {
 }
 static int fwk_unlock_pre_swap_events = 0;
 static void fwk_post_init_subsystems() {
-    // mount virtual filesystems
+    // mount virtual filesystems. index snapshot is reused while cooked archives do not change.
+    // only cooking builds rewrite it, next to the .cook[N].zip archives they write; shipped builds just read it
+    static char cooks[16][16]; const char *archives[16];
     for( int i = 0; i < 16; ++i) {
-        if(!vfs_mount(stringf(".cook[%d].zip", i))) {
-            // PANIC("cannot mount fs: .cook[%d].zip", i);
-        }
+        snprintf(cooks[i], 16, ".cook[%d].zip", i);
+        archives[i] = cooks[i];
+    }
+    if(!vfs_mount_snapshot(".cook.idx", archives, 16, WITH_COOKER)) {
+        // PANIC("cannot mount fs: .cook[0..15].zip");
     }
 
     // unlock preswap events
@@ -117,43 +117,53 @@ static void refill_stream(sts_mixer_sample_t* sample, void* userdata) {
     }
 }
 
-// load a (stereo) stream
-static bool load_stream(mystream_t* stream, const char *filename) {
+// jar_mod patches samples in place, so it decodes from its own copy (freed by jar_mod_unload)
+static bool load_mod(jar_mod_context_t *mod, const void *data, int size) {
+    if( !data || size <= 0 || size >= 32*1024*1024 ) return false;
+    mod->modfile = memcpy(malloc(size), data, size);
+    mod->modfilesize = size;
+    if( jar_mod_load(mod, mod->modfile, size) ) return true;
+    free(mod->modfile), mod->modfile = 0, mod->modfilesize = 0;
+    return false;
+}
+
+// load a (stereo) stream. decoders read from `data` while playing, so it must outlive the stream
+static bool load_stream(mystream_t* stream, const void *data, int size) {
     int error;
     int HZ = 44100;
     stream->type = UNK;
-    if( stream->type == UNK && (stream->ogg = stb_vorbis_open_filename(filename, &error, NULL)) ) {
+    if( stream->type == UNK && (stream->ogg = stb_vorbis_open_memory(data, size, &error, NULL)) ) {
         stb_vorbis_info info = stb_vorbis_get_info(stream->ogg);
         if( info.channels != 2 ) { puts("cannot stream ogg file. stereo required."); goto end; }
         stream->type = OGG;
         stream->stream.sample.frequency = info.sample_rate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
-    if( stream->type == UNK && (drwav_init_file(&stream->wav, filename, NULL))) {
+    if( stream->type == UNK && (drwav_init_memory(&stream->wav, data, size, NULL))) {
         if( stream->wav.channels != 2 ) { puts("cannot stream wav file. stereo required."); goto end; }
         stream->type = WAV;
         stream->stream.sample.frequency = stream->wav.sampleRate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
-    if( stream->type == UNK && (stream->flac = drflac_open_file(filename, NULL)) ) {
+    if( stream->type == UNK && (stream->flac = drflac_open_memory(data, size, NULL)) ) {
         if( stream->flac->channels != 2 ) { puts("cannot stream flac file. stereo required."); goto end; }
         stream->type = FLAC;
         stream->stream.sample.frequency = stream->flac->sampleRate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_FLOAT;
     }
-    if( stream->type == UNK && (jar_xm_create_context_from_file(&stream->xm, HZ, filename) == 0)) {
+    if( stream->type == UNK && (jar_xm_create_context_safe(&stream->xm, data, size, HZ) == 0)) {
         stream->type = XM;
         stream->stream.sample.frequency = HZ;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
-    if( stream->type == UNK && ((jar_mod_init(&stream->mod), jar_mod_load_file(&stream->mod, filename)) != 0) ) {
+    if( stream->type == UNK && (jar_mod_init(&stream->mod), load_mod(&stream->mod, data, size)) ) {
         stream->type = MOD;
         jar_mod_setcfg(&stream->mod, HZ, 16/*bits*/, 1/*stereo*/, 1/*stereo_separation*/, 1/*filter*/);
         stream->stream.sample.frequency = HZ;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
     drmp3_config mp3_cfg = { 2, HZ };
-    if( stream->type == UNK && (drmp3_init_file(&stream->mp3_, filename, NULL/*&mp3_cfg*/) != 0) ) {
+    if( stream->type == UNK && (drmp3_init_memory(&stream->mp3_, data, size, NULL/*&mp3_cfg*/) != 0) ) {
         stream->type = MP3;
         stream->stream.sample.frequency = stream->mp3_.sampleRate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_FLOAT;
@@ -174,10 +184,10 @@ static bool load_stream(mystream_t* stream, const char *filename) {
 }
 
 // load a (mono) sample
-static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
+static bool load_sample(sts_mixer_sample_t* sample, const void *data, int size) {
     int error;
     int channels = 0;
-    if( !channels ) for( drwav w = {0}, *wav = &w; wav && drwav_init_file(wav, filename, NULL); wav = 0 ) {
+    if( !channels ) for( drwav w = {0}, *wav = &w; wav && drwav_init_memory(wav, data, size, NULL); wav = 0 ) {
         channels = wav->channels;
         sample->frequency = wav->sampleRate;
         sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
@@ -186,7 +196,7 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
         drwav_read_pcm_frames_s16(wav, sample->length, (short*)sample->data);
         drwav_uninit(wav);
     }
-    if( !channels ) for( stb_vorbis *ogg = stb_vorbis_open_filename(filename, &error, NULL); ogg; ogg = 0 ) {
+    if( !channels ) for( stb_vorbis *ogg = stb_vorbis_open_memory(data, size, &error, NULL); ogg; ogg = 0 ) {
         stb_vorbis_info info = stb_vorbis_get_info(ogg);
         channels = info.channels;
         sample->frequency = info.sample_rate;
@@ -196,10 +206,10 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
 
         short *buffer;
         int sample_rate;
-        stb_vorbis_decode_filename(filename, &channels, &sample_rate, (short **)&buffer);
+        stb_vorbis_decode_memory(data, size, &channels, &sample_rate, (short **)&buffer);
         sample->data = buffer;
     }
-    if( !channels ) for( drflac* flac = drflac_open_file(filename, NULL); flac; flac = 0 ) {
+    if( !channels ) for( drflac* flac = drflac_open_memory(data, size, NULL); flac; flac = 0 ) {
         channels = flac->channels;
         sample->frequency = flac->sampleRate;
         sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
@@ -210,7 +220,7 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
     }
     drmp3_config mp3_cfg = { 2, 44100 };
     drmp3_uint64 mp3_fc;
-    if( !channels ) for( short *fbuf = 0; fbuf = drmp3_open_file_and_read_pcm_frames_s16(filename, &mp3_cfg, &mp3_fc, NULL); ) {
+    if( !channels ) for( short *fbuf = 0; fbuf = drmp3_open_memory_and_read_pcm_frames_s16(data, size, &mp3_cfg, &mp3_fc, NULL); ) {
         channels = mp3_cfg.channels;
         sample->frequency = mp3_cfg.sampleRate;
         sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
@@ -218,22 +228,17 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
         sample->data = fbuf;
         break;
     }
-    if( !channels ) {
-        int inputSize = file_size( filename );
-        void *inputData = file_read( filename );
-        if( inputData ) {
-            short *output = 0;
-            int outputSize, hz, mp1channels;
-            bool ok = jo_read_mp1(inputData, inputSize, &output, &outputSize, &hz, &mp1channels);
-            if( ok ) {
-                channels = mp1channels;
-                sample->frequency = hz;
-                sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
-                sample->length = outputSize / sizeof(int16_t) / channels;
-                sample->data = REALLOC(0, sample->length * sizeof(int16_t) * channels );
-                memcpy( sample->data, output, outputSize );
-            }
-            REALLOC( inputData, 0 );
+    if( !channels && data ) {
+        short *output = 0;
+        int outputSize, hz, mp1channels;
+        bool ok = jo_read_mp1(data, size, &output, &outputSize, &hz, &mp1channels);
+        if( ok ) {
+            channels = mp1channels;
+            sample->frequency = hz;
+            sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
+            sample->length = outputSize / sizeof(int16_t) / channels;
+            sample->data = REALLOC(0, sample->length * sizeof(int16_t) * channels );
+            memcpy( sample->data, output, outputSize );
         }
     }
 
@@ -346,13 +351,17 @@ typedef struct audio_handle {
 audio_t audio_clip( const char *pathfile ) {
     audio_handle *a = REALLOC(0, sizeof(audio_handle) );
     memset(a, 0, sizeof(audio_handle));
-    a->is_clip = load_sample( &a->clip, vfs_find(pathfile) );
+    int size; char *data = vfs_acquire(pathfile, &size); // decoded right away, blob can be evicted afterwards
+    a->is_clip = data && load_sample( &a->clip, data, size );
+    vfs_release(data);
     return a;
 }
 audio_t audio_stream( const char *pathfile ) {
     audio_handle *a = REALLOC(0, sizeof(audio_handle) );
     memset(a, 0, sizeof(audio_handle));
-    a->is_stream = load_stream( &a->stream, vfs_find(pathfile) );
+    int size; char *data = vfs_acquire(pathfile, &size); // decoded while playing, blob stays acquired
+    a->is_stream = data && load_stream( &a->stream, data, size );
+    if( !a->is_stream ) vfs_release(data);
     return a;
 }
 
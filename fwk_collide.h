@@ -108,6 +108,17 @@ int     poly_hit_sphere_transform(struct gjk_result *res, poly p, vec3 pos3, mat
 int     poly_hit_aabb_transform(struct gjk_result *res, poly p, vec3 pos3, mat33 rot33, aabb a);
 int     poly_hit_capsule_transform(struct gjk_result *res, poly p, vec3 pos3, mat33 rot33, capsule c);
 int     poly_hit_poly_transform(struct gjk_result *res, poly a, vec3 at3, mat33 ar33, poly b, vec3 bt3, mat33 br33);
+/* poly: gjk result, cached. pairs keyed by (ida,idb) keep last simplex & separating axis to warm-start gjk.
+   while the cached axis still separates a pair, gjk is skipped: res reports no hit, distance_squared FLT_MAX */
+int     poly_hit_poly_cached(struct gjk_result *res, unsigned ida, poly a, unsigned idb, poly b);
+int     poly_hit_capsule_cached(struct gjk_result *res, unsigned ida, poly p, unsigned idb, capsule c);
+int     poly_hit_poly_transform_cached(struct gjk_result *res, unsigned ida, poly a, vec3 at3, mat33 ar33, unsigned idb, poly b, vec3 bt3, mat33 br33);
+/* poly: persistent contact manifolds, refreshed by the cached calls above */
+typedef struct contact  { vec3 pa, pb; float distance; int aid, bid; vec3 oa, ob; } contact;
+typedef struct manifold { vec3 n; int cnt; contact c[4]; } manifold;
+manifold* poly_manifold(unsigned ida, unsigned idb); // null if pair is not cached
+void    poly_cache_drop(unsigned ida, unsigned idb);
+void    poly_cache_clear();
 
 vec4    plane4(vec3 p, vec3 n);
 
@@ -115,6 +126,46 @@ frustum frustum_build(mat44 projview);
 int     frustum_test_sphere(frustum f, sphere s);
 int     frustum_test_aabb(frustum f, aabb a);
 
+/* sweep: continuous collision. first shape moves by delta over [0..1]; hit t0=t1 is time of impact, p contact point, n obstacle normal */
+hit*    sphere_sweep_sphere(sphere s, vec3 delta, sphere b);
+hit*    sphere_sweep_capsule(sphere s, vec3 delta, capsule c);
+hit*    sphere_sweep_triangle(sphere s, vec3 delta, triangle t);
+hit*    sphere_sweep_aabb(sphere s, vec3 delta, aabb a);
+hit*    sphere_sweep_poly(sphere s, vec3 delta, poly p);
+hit*    capsule_sweep_sphere(capsule c, vec3 delta, sphere s);
+hit*    capsule_sweep_capsule(capsule c, vec3 delta, capsule b);
+hit*    capsule_sweep_triangle(capsule c, vec3 delta, triangle t);
+hit*    capsule_sweep_aabb(capsule c, vec3 delta, aabb a);
+hit*    capsule_sweep_poly(capsule c, vec3 delta, poly p);
+hit*    poly_sweep_poly(poly a, vec3 delta, poly b); // conservative advancement over gjk distance
+/* bvh: static aabb tree over triangle meshes, to accelerate sweeps */
+typedef struct bvh_node { aabb box; int first, count; } bvh_node; // leaf if count > 0, else children at first & first+1
+typedef struct bvh      { bvh_node *nodes; triangle *tris; int *ids; int count, nodes_count; } bvh;
+bvh     bvh_build(const triangle *tris, int count); // bvh_free() required
+void    bvh_free(bvh *b);
+hit*    sphere_sweep_bvh(sphere s, vec3 delta, bvh *b, int *id); // id of first triangle hit (optional)
+hit*    capsule_sweep_bvh(capsule c, vec3 delta, bvh *b, int *id);
+
+/* grid: hashed uniform grid for neighbor queries among many small spheres (crowds, projectiles, particles) */
+typedef struct grid {
+    float cell, inv, maxr;     // cell size, 1/cell size, largest sphere radius
+    vec3 origin;               // min corner of sphere centers
+    int dims[3];               // dense grid cells per axis, or zero if hashed
+    int count, buckets;        // spheres, cells (dense) or buckets (hashed, pow2)
+    int cap, buckets_cap;      // allocated spheres & cells
+    int *start;                // [buckets+1] first sorted sphere per cell (counting sort)
+    int *ids;                  // [count] original sphere index, sorted by cell
+    sphere *spheres;           // [count] spheres, sorted by cell
+    unsigned *keys;            // [count] cell per original sphere
+} grid;
+
+void    grid_build(grid *g, const sphere *s, int count, float cell_size); // cell_size <= 0: fit to largest sphere
+int     grid_query_sphere(grid *g, sphere s, int *ids, int max);   // spheres overlapping s. returns count (may exceed max)
+int     grid_query_radius(grid *g, vec3 p, float r, int *ids, int max); // spheres whose centers are within r of p
+int     grid_neighbors(grid *g, int id, int *ids, int max);        // spheres overlapping sphere #id, excluding itself
+int     grid_pairs(grid *g, int *pairs, hit *hits, int max);       // self collision: pairs[2*i+0] < pairs[2*i+1]; hits optional
+void    grid_free(grid *g);
+
 poly    poly_alloc(int cnt);
 void    poly_free(poly *p);
 
@@ -243,26 +294,26 @@ static float line_closest_line_(float *t1, float *t2, vec3 *c1, vec3 *c2, line l
 
             /* compute closest point on L1/L2 if not parallel else pick any t2 */
             if (denom != 0.0f)
-                *t1 = clampf(0.0f, (b*f - c*e) / denom, 1.0f);
+                *t1 = clampf((b*f - c*e) / denom, 0.0f, 1.0f);
             else *t1 = 0.0f;
 
             /* cmpute point on L2 closest to S1(s) */
             *t2 = (b*(*t1) + f) / e;
             if (*t2 < 0.0f) {
                 *t2 = 0.0f;
-                *t1 = clampf(0.0f, -c/i, 1.0f);
+                *t1 = clampf(-c/i, 0.0f, 1.0f);
             } else if (*t2 > 1.0f) {
                 *t2 = 1.0f;
-                *t1 = clampf(0.0f, (b-c)/i, 1.0f);
+                *t1 = clampf((b-c)/i, 0.0f, 1.0f);
             }
         } else {
             /* second segment degenerates into a point */
-            *t1 = clampf(0.0f, -c/i, 1.0f);
+            *t1 = clampf(-c/i, 0.0f, 1.0f);
             *t2 = 0.0f;
         }
     } else {
         /* first segment degenerates into a point */
-        *t2 = clampf(0.0f, f/e, 1.0f);
+        *t2 = clampf(f/e, 0.0f, 1.0f);
         *t1 = 0.0f;
     }
     /* calculate closest points */
@@ -395,7 +446,7 @@ int ray_test_aabb(float *t0, float *t1, ray r, aabb a) {
 
     *t0 = maxf(*t0, tminz);
     *t1 = minf(*t1, tmaxz);
-    return 1;
+    return *t1 >= 0; /* box behind ray origin */
 }
 vec3 sphere_closest_point(sphere s, vec3 p) {
     vec3 d = norm3(sub3(p, s.c));
@@ -699,7 +750,7 @@ hit *capsule_hit_sphere(capsule c, sphere s) {
 }
 int capsule_test_aabb(capsule c, aabb a) {
     /* calculate aabb center point */
-    vec3 ac = scale3(sub3(a.max, a.min), 0.5f);
+    vec3 ac = add3(a.min, scale3(sub3(a.max, a.min), 0.5f));
 
     /* calculate closest point from aabb to point on capsule and check if inside aabb */
     vec3 p = capsule_closest_point(c, ac);
@@ -956,6 +1007,261 @@ int poly_test_aabb_transform(poly p, vec3 apos3, mat33 arot33, aabb a) {
     return poly_hit_aabb_transform(&res, p, apos3, arot33, a);
 }
 
+/* ----------------------------------------------------------------------------
+ * poly pair cache: objects resting against each other converge in 1-2 gjk
+ * iterations when seeded with last frame's separating axis, and skip gjk
+ * entirely while that axis still separates both shapes.
+ * ------------------------------------------------------------------------- */
+
+#ifndef COLLIDE_MANIFOLD_MARGIN
+#define COLLIDE_MANIFOLD_MARGIN 0.02f // contacts closer than this are kept/merged
+#endif
+
+typedef struct gjk_pair {
+    vec3 axis;               // last separating axis, a->b. zero when unknown or penetrating
+    int cnt, aid[4], bid[4]; // last simplex vertices
+    int clipped;             // contacts produced by the last face clipping
+    manifold m;
+} gjk_pair;
+
+static local map(uint64_t, gjk_pair) gjk_pairs;
+
+static gjk_pair *gjk_pair_find_(unsigned ida, unsigned idb, int add) {
+    if( !gjk_pairs ) map_init(gjk_pairs, less_u64, hash_64);
+    uint64_t key = ((uint64_t)ida << 32) | idb;
+    gjk_pair *pc = map_find(gjk_pairs, key);
+    if( !pc && add ) pc = map_insert(gjk_pairs, key, (gjk_pair){0});
+    return pc;
+}
+manifold* poly_manifold(unsigned ida, unsigned idb) {
+    gjk_pair *pc = gjk_pair_find_(ida, idb, 0);
+    return pc ? &pc->m : 0;
+}
+void poly_cache_drop(unsigned ida, unsigned idb) {
+    if( gjk_pairs ) map_erase(gjk_pairs, ((uint64_t)ida << 32) | idb);
+}
+void poly_cache_clear() {
+    if( gjk_pairs ) map_clear(gjk_pairs);
+}
+
+static vec3 poly_xform_(vec3 v, const vec3 *t3, const float *r33) { // local->world
+    return r33 ? add3(mulv33((float*)r33, v), *t3) : v;
+}
+static vec3 poly_xformT_(vec3 d, const float *r33) { // world->local (direction)
+    return r33 ? vec3(r33[0]*d.x+r33[3]*d.y+r33[6]*d.z, r33[1]*d.x+r33[4]*d.y+r33[7]*d.z, r33[2]*d.x+r33[5]*d.y+r33[8]*d.z) : d;
+}
+static int poly_support_xform_(vec3 *support, vec3 d, poly p, const vec3 *t3, const float *r33) {
+    int id = poly_support(support, poly_xformT_(d, r33), p);
+    *support = poly_xform_(*support, t3, r33);
+    return id;
+}
+
+static void gjk_manifold_add_(manifold *m, contact nc) {
+    /* merge with a nearby contact */
+    for( int i = 0; i < m->cnt; ++i ) {
+        vec3 d = sub3(m->c[i].pa, nc.pa);
+        if( dot3(d,d) <= COLLIDE_MANIFOLD_MARGIN * COLLIDE_MANIFOLD_MARGIN ) { m->c[i] = nc; return; }
+    }
+    if( m->cnt < 4 ) { m->c[m->cnt++] = nc; return; }
+
+    /* manifold full: keep deepest contact, replace the one that maximizes the contact area */
+    int deepest = 0;
+    for( int i = 1; i < 4; ++i ) if( m->c[i].distance < m->c[deepest].distance ) deepest = i;
+    if( nc.distance < m->c[deepest].distance ) { m->c[deepest] = nc; return; }
+    int replace = -1; float best_area = -1;
+    for( int i = 0; i < 4; ++i ) {
+        if( i == deepest ) continue;
+        vec3 p[4]; for( int j = 0; j < 4; ++j ) p[j] = j == i ? nc.pa : m->c[j].pa;
+        float area = len3sq(cross3(sub3(p[0], p[2]), sub3(p[1], p[3])));
+        if( area > best_area ) best_area = area, replace = i;
+    }
+    m->c[replace] = nc;
+}
+
+static int gjk_face_(vec2 *out, int *ids, vec3 *world, poly p, const vec3 *t3, const float *r33, vec3 n, vec3 t, vec3 b, float *extent) {
+    /* gather vertices lying on the support plane of p along n, as 2d points sorted by angle */
+    enum { MAX_FACE = 16 };
+    float dmax = -FLT_MAX;
+    for( int i = 0; i < p.cnt; ++i ) dmax = maxf(dmax, dot3(poly_xform_(p.verts[i], t3, r33), n));
+    int cnt = 0; vec2 c = {0};
+    for( int i = 0; i < p.cnt && cnt < MAX_FACE; ++i ) {
+        vec3 v = poly_xform_(p.verts[i], t3, r33);
+        if( dot3(v, n) < dmax - COLLIDE_MANIFOLD_MARGIN ) continue;
+        world[cnt] = v, ids[cnt] = i, out[cnt] = vec2(dot3(v, t), dot3(v, b));
+        c = add2(c, out[cnt++]);
+    }
+    c = scale2(c, 1.0f / (cnt ? cnt : 1));
+    for( int i = 1; i < cnt; ++i ) { // insertion sort by angle around centroid
+        for( int j = i; j > 0 && atan2f(out[j].y-c.y, out[j].x-c.x) < atan2f(out[j-1].y-c.y, out[j-1].x-c.x); --j ) {
+            vec2 o = out[j]; out[j] = out[j-1]; out[j-1] = o;
+            vec3 w = world[j]; world[j] = world[j-1]; world[j-1] = w;
+            int k = ids[j]; ids[j] = ids[j-1]; ids[j-1] = k;
+        }
+    }
+    *extent = dmax;
+    return cnt;
+}
+static int gjk_face_contains_(const vec2 *face, int cnt, vec2 p) {
+    if( cnt < 3 ) return 0;
+    for( int i = 0; i < cnt; ++i ) {
+        vec2 e = sub2(face[(i+1)%cnt], face[i]), d = sub2(p, face[i]);
+        if( e.x * d.y - e.y * d.x < -COLLIDE_MANIFOLD_MARGIN * len2(e) ) return 0;
+    }
+    return 1;
+}
+
+static void gjk_manifold_update_(manifold *m, int *clipped, const gjk_result *res, const gjk_simplex *gsx, float distance, float radius,
+    poly a, const vec3 *at3, const float *ar33, poly b, const vec3 *bt3, const float *br33) {
+    /* refresh persistent contacts from their features, drop the ones that drifted apart */
+    for( int i = 0; i < m->cnt; ) {
+        contact *c = &m->c[i];
+        int valid = c->aid < a.cnt && c->bid < b.cnt;
+        if( valid ) {
+            c->pa = poly_xform_(add3(a.verts[c->aid], c->oa), at3, ar33);
+            c->pb = sub3(poly_xform_(add3(b.verts[c->bid], c->ob), bt3, br33), scale3(m->n, radius));
+            vec3 d = sub3(c->pb, c->pa);
+            c->distance = dot3(d, m->n);
+            vec3 t = sub3(d, scale3(m->n, c->distance));
+            valid = c->distance <= COLLIDE_MANIFOLD_MARGIN && dot3(t,t) <= COLLIDE_MANIFOLD_MARGIN * COLLIDE_MANIFOLD_MARGIN;
+        }
+        if( valid ) ++i; else m->c[i] = m->c[--m->cnt];
+    }
+
+    /* penetrating shapes have no closest points (no epa), so keep the refreshed manifold as is */
+    if( res && res->hit ) return;
+    if( distance > COLLIDE_MANIFOLD_MARGIN ) { m->cnt = *clipped = 0; return; }
+
+    /* new contact from the dominant simplex vertex */
+    if( gsx ) {
+        int best = 0;
+        for( int i = 1; i < gsx->cnt; ++i ) if( gsx->bc[i] > gsx->bc[best] ) best = i;
+        contact nc = {0};
+        nc.aid = gsx->v[best].aid, nc.bid = gsx->v[best].bid;
+        if( nc.aid < a.cnt && nc.bid < b.cnt ) {
+            nc.pa = res->p0, nc.pb = sub3(res->p1, scale3(m->n, radius));
+            nc.distance = distance;
+            nc.oa = sub3(poly_xformT_(sub3(res->p0, at3 ? *at3 : vec3(0,0,0)), ar33), a.verts[nc.aid]);
+            nc.ob = sub3(poly_xformT_(sub3(res->p1, bt3 ? *bt3 : vec3(0,0,0)), br33), b.verts[nc.bid]);
+            gjk_manifold_add_(m, nc);
+        }
+    }
+
+    /* resting contact: clip touching faces of both shapes against each other. skipped while the contacts
+    from last clipping persist (a full manifold, or the 1-2 contacts a capsule segment can ever give) */
+    if( m->cnt == 4 || (*clipped && m->cnt >= *clipped) ) return;
+    vec2 fa[16], fb[16]; vec3 wa[16], wb[16]; int ia[16], ib[16]; float maxa, minb;
+    vec3 t, bt; ortho3(&t, &bt, m->n);
+    int na = gjk_face_(fa, ia, wa, a, at3, ar33, m->n, t, bt, &maxa);
+    int nb = gjk_face_(fb, ib, wb, b, bt3, br33, scale3(m->n, -1), t, bt, &minb); minb = -minb;
+    for( int i = 0; i < na; ++i ) {
+        if( !gjk_face_contains_(fb, nb, fa[i]) ) continue;
+        contact nc = {0};
+        nc.aid = ia[i], nc.bid = ib[0];
+        nc.pa = wa[i], nc.pb = add3(wa[i], scale3(m->n, minb - dot3(wa[i], m->n) - radius));
+        nc.distance = dot3(sub3(nc.pb, nc.pa), m->n);
+        nc.ob = sub3(poly_xformT_(sub3(add3(nc.pb, scale3(m->n, radius)), bt3 ? *bt3 : vec3(0,0,0)), br33), b.verts[nc.bid]);
+        gjk_manifold_add_(m, nc);
+    }
+    for( int i = 0; i < nb; ++i ) {
+        if( !gjk_face_contains_(fa, na, fb[i]) ) continue;
+        contact nc = {0};
+        nc.aid = ia[0], nc.bid = ib[i];
+        nc.pb = sub3(wb[i], scale3(m->n, radius)), nc.pa = sub3(wb[i], scale3(m->n, dot3(wb[i], m->n) - maxa));
+        nc.distance = dot3(sub3(nc.pb, nc.pa), m->n);
+        nc.oa = sub3(poly_xformT_(sub3(nc.pa, at3 ? *at3 : vec3(0,0,0)), ar33), a.verts[nc.aid]);
+        gjk_manifold_add_(m, nc);
+    }
+    *clipped = m->cnt;
+}
+
+static int poly_hit_poly_cached_(struct gjk_result *res, unsigned ida, unsigned idb, float radius,
+    poly a, const vec3 *at3, const float *ar33, poly b, const vec3 *bt3, const float *br33) {
+    gjk_pair *pc = gjk_pair_find_(ida, idb, 1);
+
+    /* initial guess: last simplex rebuilt at current transforms, else supports along cached axis, else first vertices */
+    vec3 d = {0};
+    gjk_support gs = {0};
+    gjk_simplex gsx = {0};
+    gsx.max_iter = GJK_MAX_ITERATIONS, gsx.D = GJK_FLT_MAX; /* capped here only: warm starts must not cycle */
+    int seeded = 0;
+    if( dot3(pc->axis, pc->axis) > 0 ) {
+        seeded = 1;
+        gs.aid = poly_support_xform_(&gs.a, pc->axis, a, at3, ar33);
+        gs.bid = poly_support_xform_(&gs.b, scale3(pc->axis, -1), b, bt3, br33);
+        d = sub3(gs.b, gs.a);
+
+        /* early out: cached axis still separates both shapes. answers separated only: no closest points nor distance */
+        if( dot3(d, pc->axis) > radius ) {
+            gjk_result r = {0};
+            r.distance_squared = FLT_MAX;
+            *res = r;
+            gjk_manifold_update_(&pc->m, &pc->clipped, 0, 0, dot3(d, pc->axis) - radius, radius, a, at3, ar33, b, bt3, br33);
+            return 0;
+        }
+    }
+    if( pc->cnt ) {
+        int cnt = pc->cnt;
+        for( int i = 0; i < cnt; ++i ) if( pc->aid[i] >= a.cnt || pc->bid[i] >= b.cnt ) cnt = 0;
+        for( int i = 0; i < cnt; ++i ) {
+            gjk_vertex *v = &gsx.v[i];
+            v->aid = pc->aid[i], v->a = poly_xform_(a.verts[v->aid], at3, ar33);
+            v->bid = pc->bid[i], v->b = poly_xform_(b.verts[v->bid], bt3, br33);
+            v->p = sub3(v->b, v->a);
+        }
+        /* shapes moved: drop trailing vertices that became degenerate */
+        for( ; cnt > 1; --cnt ) {
+            vec3 e1 = sub3(gsx.v[1].p, gsx.v[0].p);
+            float size = cnt == 2 ? dot3(e1, e1)
+                : cnt == 3 ? len3sq(cross3(e1, sub3(gsx.v[2].p, gsx.v[0].p)))
+                : fabsf(dot3(cross3(e1, sub3(gsx.v[2].p, gsx.v[0].p)), sub3(gsx.v[3].p, gsx.v[0].p)));
+            if( size > 1e-10f ) break;
+        }
+        /* the last cached vertex is fed through gjk, which re-solves the whole simplex with it */
+        if( cnt ) {
+            gs.aid = gsx.v[cnt-1].aid, gs.a = gsx.v[cnt-1].a;
+            gs.bid = gsx.v[cnt-1].bid, gs.b = gsx.v[cnt-1].b;
+            gsx.cnt = cnt - 1;
+            d = sub3(gs.b, gs.a);
+            seeded = 1;
+        }
+    }
+    if( !seeded ) {
+        gs.a = poly_xform_(a.verts[0], at3, ar33);
+        gs.b = poly_xform_(b.verts[0], bt3, br33);
+        d = sub3(gs.b, gs.a);
+    }
+
+    /* run gjk algorithm */
+    while (gjk(&gsx, &gs, &d)) {
+        ++gsx.iter;
+        gs.aid = poly_support_xform_(&gs.a, scale3(d, -1), a, at3, ar33);
+        gs.bid = poly_support_xform_(&gs.b, d, b, bt3, br33);
+        d = sub3(gs.b, gs.a);
+    }
+    *res = gjk_analyze(&gsx);
+
+    /* store simplex & separating axis for next call */
+    pc->cnt = gsx.cnt;
+    for( int i = 0; i < gsx.cnt; ++i ) pc->aid[i] = gsx.v[i].aid, pc->bid[i] = gsx.v[i].bid;
+    pc->axis = vec3(0,0,0);
+    if( !res->hit && res->distance_squared > C_EPSILON * C_EPSILON ) {
+        pc->axis = pc->m.n = scale3(sub3(res->p1, res->p0), 1.0f / sqrtf(res->distance_squared));
+    }
+    gjk_manifold_update_(&pc->m, &pc->clipped, res, &gsx, sqrtf(res->distance_squared) - radius, radius, a, at3, ar33, b, bt3, br33);
+
+    return res->hit || res->distance_squared <= radius*radius;
+}
+int poly_hit_poly_cached(struct gjk_result *res, unsigned ida, poly a, unsigned idb, poly b) {
+    return poly_hit_poly_cached_(res, ida, idb, 0, a, 0, 0, b, 0, 0);
+}
+int poly_hit_capsule_cached(struct gjk_result *res, unsigned ida, poly p, unsigned idb, capsule c) {
+    vec3 segment[2] = { c.a, c.b };
+    return poly_hit_poly_cached_(res, ida, idb, c.r, p, 0, 0, poly(segment, 2), 0, 0);
+}
+int poly_hit_poly_transform_cached(struct gjk_result *res, unsigned ida, poly a, vec3 at3, mat33 ar33, unsigned idb, poly b, vec3 bt3, mat33 br33) {
+    return poly_hit_poly_cached_(res, ida, idb, 0, a, &at3, ar33, b, &bt3, br33);
+}
+
 /* ============================================================================
  *
  *                              COLLISION VOLUME
@@ -1041,4 +1347,539 @@ int frustum_test_aabb(frustum f, aabb a) {
     return 1;
 }
 
+/* ============================================================================
+ *
+ *                            CONTINUOUS COLLISION
+ *
+ * =========================================================================== */
+
+static float sweep_axis_(vec3 v, int i) {
+    return i == 0 ? v.x : i == 1 ? v.y : v.z;
+}
+static vec3 segment_closest_point_(vec3 a, vec3 b, vec3 p) {
+    vec3 ab = sub3(b, a);
+    float t = dot3(sub3(p, a), ab), l2 = dot3(ab, ab);
+    t = l2 > 0 ? clampf(t / l2, 0, 1) : 0;
+    return add3(a, scale3(ab, t));
+}
+static vec3 triangle_closest_point_(triangle tr, vec3 p) {
+    /* real-time collision detection, ericson 5.1.5 */
+    vec3 a = tr.p0, b = tr.p1, c = tr.p2;
+    vec3 ab = sub3(b, a), ac = sub3(c, a), ap = sub3(p, a);
+    float d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+    if (d1 <= 0 && d2 <= 0) return a;
+    vec3 bp = sub3(p, b);
+    float d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+    if (d3 >= 0 && d4 <= d3) return b;
+    float vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) return add3(a, scale3(ab, d1 / (d1 - d3)));
+    vec3 cp = sub3(p, c);
+    float d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+    if (d6 >= 0 && d5 <= d6) return c;
+    float vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) return add3(a, scale3(ac, d2 / (d2 - d6)));
+    float va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return add3(b, scale3(sub3(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+    float denom = 1.0f / (va + vb + vc);
+    return add3(a, add3(scale3(ab, vb * denom), scale3(ac, vc * denom)));
+}
+
+static int sweep_point_sphere_(float *t, vec3 o, vec3 d, vec3 c, float r) {
+    /* earliest t in [0..1] where o+d*t is within r of c */
+    vec3 oc = sub3(o, c);
+    float cc = dot3(oc, oc) - r*r;
+    if (cc <= 0) return *t = 0, 1;
+    float a = dot3(d, d), b = dot3(oc, d);
+    if (b >= 0 || a <= 0) return 0;
+    float h = b*b - a*cc;
+    if (h < 0) return 0;
+    float tt = (-b - sqrtf(h)) / a;
+    if (tt > 1) return 0;
+    return *t = tt, 1;
+}
+static int sweep_point_capsule_(float *t, vec3 o, vec3 d, vec3 pa, vec3 pb, float r) {
+    /* earliest t in [0..1] where o+d*t is within r of segment pa-pb: cylinder body, then caps */
+    vec3 q = segment_closest_point_(pa, pb, o), oq = sub3(o, q);
+    if (dot3(oq, oq) <= r*r) return *t = 0, 1;
+    vec3 ba = sub3(pb, pa), oa = sub3(o, pa);
+    float baba = dot3(ba, ba), bard = dot3(ba, d), baoa = dot3(ba, oa), rdoa = dot3(d, oa), oaoa = dot3(oa, oa), rdrd = dot3(d, d);
+    float a = baba*rdrd - bard*bard, b = baba*rdoa - baoa*bard, c = baba*oaoa - baoa*baoa - r*r*baba;
+    float best = FLT_MAX, tt;
+    if (a > C_EPSILON) {
+        float h = b*b - a*c;
+        if (h >= 0) {
+            tt = (-b - sqrtf(h)) / a;
+            float y = baoa + tt*bard;
+            if (tt >= 0 && tt <= 1 && y >= 0 && y <= baba) best = tt;
+        }
+    }
+    if (sweep_point_sphere_(&tt, o, d, pa, r) && tt < best) best = tt;
+    if (sweep_point_sphere_(&tt, o, d, pb, r) && tt < best) best = tt;
+    return best <= 1 ? (*t = best, 1) : 0;
+}
+static int sweep_test_aabb_(float *t, vec3 o, vec3 d, aabb a, float tmax) {
+    /* slab test of segment o+d*[0..tmax] against box */
+    float t0 = 0, t1 = tmax;
+    for (int i = 0; i < 3; ++i) {
+        if (fabsf(sweep_axis_(d, i)) < C_EPSILON) {
+            if (sweep_axis_(o, i) < sweep_axis_(a.min, i) || sweep_axis_(o, i) > sweep_axis_(a.max, i)) return 0;
+            continue;
+        }
+        float inv = 1.0f / sweep_axis_(d, i);
+        float n = (sweep_axis_(a.min, i) - sweep_axis_(o, i)) * inv, f = (sweep_axis_(a.max, i) - sweep_axis_(o, i)) * inv;
+        if (n > f) { float x = n; n = f; f = x; }
+        t0 = maxf(t0, n), t1 = minf(t1, f);
+        if (t0 > t1) return 0;
+    }
+    return *t = t0, 1;
+}
+
+static hit *sweep_hit_(float t, vec3 center, vec3 closest, float radius, vec3 delta) {
+    /* builds hit from moving center at time t and closest obstacle point */
+    hit *h = hit_next();
+    vec3 n = sub3(center, closest);
+    float l2 = dot3(n, n);
+    h->t0 = h->t1 = t;
+    h->n = l2 > C_EPSILON * C_EPSILON ? scale3(n, 1.0f / sqrtf(l2)) : norm3(scale3(delta, -1));
+    h->p = add3(closest, scale3(h->n, radius));
+    return h;
+}
+
+hit *sphere_sweep_sphere(sphere s, vec3 delta, sphere b) {
+    float t;
+    if (!sweep_point_sphere_(&t, s.c, delta, b.c, s.r + b.r)) return 0;
+    return sweep_hit_(t, add3(s.c, scale3(delta, t)), b.c, b.r, delta);
+}
+hit *sphere_sweep_capsule(sphere s, vec3 delta, capsule c) {
+    float t;
+    if (!sweep_point_capsule_(&t, s.c, delta, c.a, c.b, s.r + c.r)) return 0;
+    vec3 center = add3(s.c, scale3(delta, t));
+    return sweep_hit_(t, center, segment_closest_point_(c.a, c.b, center), c.r, delta);
+}
+hit *sphere_sweep_triangle(sphere s, vec3 delta, triangle tr) {
+    vec3 q = triangle_closest_point_(tr, s.c), cq = sub3(s.c, q);
+    if (dot3(cq, cq) <= s.r*s.r) return sweep_hit_(0, s.c, q, 0, delta);
+
+    /* face: sphere touches the plane inside the triangle */
+    float best = FLT_MAX, t;
+    vec3 n = norm3(cross3(sub3(tr.p1, tr.p0), sub3(tr.p2, tr.p0)));
+    float dist = dot3(sub3(s.c, tr.p0), n);
+    if (dist < 0) n = scale3(n, -1), dist = -dist;
+    float speed = -dot3(delta, n);
+    if (speed > 0 && (t = (dist - s.r) / speed) >= 0 && t <= 1) {
+        vec3 p = sub3(add3(s.c, scale3(delta, t)), scale3(n, s.r));
+        vec3 e0 = cross3(sub3(tr.p1, tr.p0), sub3(p, tr.p0));
+        vec3 e1 = cross3(sub3(tr.p2, tr.p1), sub3(p, tr.p1));
+        vec3 e2 = cross3(sub3(tr.p0, tr.p2), sub3(p, tr.p2));
+        if (dot3(e0, e1) >= 0 && dot3(e1, e2) >= 0) best = t;
+    }
+    /* edges & vertices */
+    if (best > 1) {
+        if (sweep_point_capsule_(&t, s.c, delta, tr.p0, tr.p1, s.r) && t < best) best = t;
+        if (sweep_point_capsule_(&t, s.c, delta, tr.p1, tr.p2, s.r) && t < best) best = t;
+        if (sweep_point_capsule_(&t, s.c, delta, tr.p2, tr.p0, s.r) && t < best) best = t;
+    }
+    if (best > 1) return 0;
+    vec3 center = add3(s.c, scale3(delta, best));
+    return sweep_hit_(best, center, triangle_closest_point_(tr, center), 0, delta);
+}
+hit *sphere_sweep_aabb(sphere s, vec3 delta, aabb a) {
+    if (aabb_distance2_point(a, s.c) <= s.r*s.r) return sweep_hit_(0, s.c, aabb_closest_point(a, s.c), 0, delta);
+
+    /* face: box grown by radius, valid when entering point is outside the box on one axis only */
+    float best = FLT_MAX, t;
+    aabb grown = aabb(sub3(a.min, vec3(s.r,s.r,s.r)), add3(a.max, vec3(s.r,s.r,s.r)));
+    if (!sweep_test_aabb_(&t, s.c, delta, grown, 1)) return 0;
+    vec3 p = add3(s.c, scale3(delta, t));
+    int outside = 0;
+    for (int i = 0; i < 3; ++i) outside += sweep_axis_(p, i) < sweep_axis_(a.min, i) || sweep_axis_(p, i) > sweep_axis_(a.max, i);
+    if (outside <= 1) best = t;
+    /* edges & corners */
+    else for (int i = 0; i < 12; ++i) {
+        static const int edges[12][2] = {{0,1},{2,3},{4,5},{6,7},{0,2},{1,3},{4,6},{5,7},{0,4},{1,5},{2,6},{3,7}};
+        vec3 e0 = vec3(edges[i][0]&4 ? a.max.x : a.min.x, edges[i][0]&2 ? a.max.y : a.min.y, edges[i][0]&1 ? a.max.z : a.min.z);
+        vec3 e1 = vec3(edges[i][1]&4 ? a.max.x : a.min.x, edges[i][1]&2 ? a.max.y : a.min.y, edges[i][1]&1 ? a.max.z : a.min.z);
+        if (sweep_point_capsule_(&t, s.c, delta, e0, e1, s.r) && t < best) best = t;
+    }
+    if (best > 1) return 0;
+    vec3 center = add3(s.c, scale3(delta, best));
+    return sweep_hit_(best, center, aabb_closest_point(a, center), 0, delta);
+}
+
+static gjk_result sweep_distance_(poly a, vec3 at, poly b) {
+    /* gjk distance between a translated by at, and b */
+    vec3 d = {0};
+    gjk_support gs = {0};
+    gs.a = add3(*a.verts, at);
+    gs.b = *b.verts;
+    d = sub3(gs.b, gs.a);
+    gjk_simplex gsx = {0};
+    while (gjk(&gsx, &gs, &d)) {
+        gs.aid = poly_support(&gs.a, scale3(d, -1), a);
+        gs.bid = poly_support(&gs.b, d, b);
+        gs.a = add3(gs.a, at);
+        d = sub3(gs.b, gs.a);
+    }
+    return gjk_analyze(&gsx);
+}
+static hit *sweep_conservative_(poly a, float ra, vec3 delta, poly b, float rb) {
+    /* conservative advancement: step along delta by distance / closing speed until within tolerance */
+    enum { MAX_STEPS = 32 };
+    const float tolerance = 1e-3f;
+    float t = 0, radius = ra + rb;
+    for (int i = 0; i < MAX_STEPS; ++i) {
+        vec3 at = scale3(delta, t);
+        gjk_result res = sweep_distance_(a, at, b);
+        float dist = sqrtf(res.distance_squared);
+        if (res.hit || dist - radius <= tolerance) {
+            return sweep_hit_(t, res.p0, res.p1, rb, delta); // p0 is already translated by at
+
+        }
+        vec3 n = scale3(sub3(res.p1, res.p0), 1.0f / dist);
+        float closing = dot3(delta, n);
+        if (closing <= 0) return 0;
+        t += (dist - radius) / closing;
+        if (t > 1) return 0;
+    }
+    return 0;
+}
+hit *sphere_sweep_poly(sphere s, vec3 delta, poly p) {
+    return sweep_conservative_(poly(&s.c, 1), s.r, delta, p, 0);
+}
+hit *capsule_sweep_sphere(capsule c, vec3 delta, sphere s) {
+    return sweep_conservative_(poly(&c.a, 2), c.r, delta, poly(&s.c, 1), s.r);
+}
+hit *capsule_sweep_capsule(capsule c, vec3 delta, capsule b) {
+    return sweep_conservative_(poly(&c.a, 2), c.r, delta, poly(&b.a, 2), b.r);
+}
+hit *capsule_sweep_triangle(capsule c, vec3 delta, triangle t) {
+    return sweep_conservative_(poly(&c.a, 2), c.r, delta, poly(&t.p0, 3), 0);
+}
+hit *capsule_sweep_aabb(capsule c, vec3 delta, aabb a) {
+    vec3 box[8];
+    for (int i = 0; i < 8; ++i) box[i] = vec3(i&4 ? a.max.x : a.min.x, i&2 ? a.max.y : a.min.y, i&1 ? a.max.z : a.min.z);
+    return sweep_conservative_(poly(&c.a, 2), c.r, delta, poly(box, 8), 0);
+}
+hit *capsule_sweep_poly(capsule c, vec3 delta, poly p) {
+    return sweep_conservative_(poly(&c.a, 2), c.r, delta, p, 0);
+}
+hit *poly_sweep_poly(poly a, vec3 delta, poly b) {
+    return sweep_conservative_(a, 0, delta, b, 0);
+}
+
+/* bvh */
+
+#define BVH_MAX_DEPTH 64 // nodes this deep are leaves, so traversal stacks of this size never overflow
+
+static aabb bvh_triangle_box_(triangle t) {
+    return aabb(min3(min3(t.p0, t.p1), t.p2), max3(max3(t.p0, t.p1), t.p2));
+}
+bvh bvh_build(const triangle *tris, int count) {
+    bvh b = {0};
+    if (count <= 0) return b;
+    b.count = count;
+    b.tris = REALLOC(0, sizeof(triangle) * count);
+    b.ids = REALLOC(0, sizeof(int) * count);
+    b.nodes = REALLOC(0, sizeof(bvh_node) * count * 2);
+    memcpy(b.tris, tris, sizeof(triangle) * count);
+    for (int i = 0; i < count; ++i) b.ids[i] = i;
+
+    /* iterative build keeps children adjacent: stack of (node, first, count, depth) */
+    struct { int node, first, count, depth; } stack[BVH_MAX_DEPTH]; int top = 0;
+    b.nodes_count = 1;
+    stack[top].node = 0, stack[top].first = 0, stack[top].depth = 0, stack[top++].count = count;
+    while (top) {
+        int node = stack[--top].node, first = stack[top].first, cnt = stack[top].count, depth = stack[top].depth;
+        bvh_node *n = &b.nodes[node];
+        n->box = bvh_triangle_box_(b.tris[first]);
+        for (int i = first + 1; i < first + cnt; ++i) {
+            aabb tb = bvh_triangle_box_(b.tris[i]);
+            n->box = aabb(min3(n->box.min, tb.min), max3(n->box.max, tb.max));
+        }
+        if (cnt <= 4 || depth >= BVH_MAX_DEPTH - 1) { n->first = first, n->count = cnt; continue; }
+
+        /* split at median centroid of longest axis */
+        vec3 ext = sub3(n->box.max, n->box.min);
+        int axis = ext.x > ext.y && ext.x > ext.z ? 0 : ext.y > ext.z ? 1 : 2;
+        int lo = first, hi = first + cnt - 1, mid = first + cnt / 2;
+        while (lo < hi) { // quickselect
+            triangle *pv = &b.tris[(lo + hi) / 2];
+            float pivot = sweep_axis_(pv->p0, axis) + sweep_axis_(pv->p1, axis) + sweep_axis_(pv->p2, axis);
+            int i = lo, j = hi;
+            while (i <= j) {
+                while (sweep_axis_(b.tris[i].p0, axis) + sweep_axis_(b.tris[i].p1, axis) + sweep_axis_(b.tris[i].p2, axis) < pivot) ++i;
+                while (sweep_axis_(b.tris[j].p0, axis) + sweep_axis_(b.tris[j].p1, axis) + sweep_axis_(b.tris[j].p2, axis) > pivot) --j;
+                if (i <= j) {
+                    triangle tt = b.tris[i]; b.tris[i] = b.tris[j]; b.tris[j] = tt;
+                    int id = b.ids[i]; b.ids[i] = b.ids[j]; b.ids[j] = id;
+                    ++i, --j;
+                }
+            }
+            if (mid <= j) hi = j; else if (mid >= i) lo = i; else break;
+        }
+        int left = b.nodes_count; b.nodes_count += 2;
+        n->first = left, n->count = 0;
+        stack[top].node = left + 0, stack[top].first = first, stack[top].depth = depth + 1, stack[top++].count = mid - first;
+        stack[top].node = left + 1, stack[top].first = mid, stack[top].depth = depth + 1, stack[top++].count = first + cnt - mid;
+    }
+    return b;
+}
+void bvh_free(bvh *b) {
+    REALLOC(b->tris, 0);
+    REALLOC(b->ids, 0);
+    REALLOC(b->nodes, 0);
+    bvh z = {0};
+    *b = z;
+}
+static hit *bvh_sweep_(bvh *b, sphere *s, capsule *c, vec3 delta, int *id) {
+    if (!b->nodes) return 0;
+    /* moving shape as a box: center & half extents. nodes grown by extents are tested against the center segment */
+    vec3 center, ext;
+    if (s) center = s->c, ext = vec3(s->r, s->r, s->r);
+    else center = scale3(add3(c->a, c->b), 0.5f), ext = add3(abs3(scale3(sub3(c->b, c->a), 0.5f)), vec3(c->r, c->r, c->r));
+
+    hit best = {0}; best.t0 = FLT_MAX;
+    /* one pending sibling per level above the current node, plus both children: depth + 2 <= BVH_MAX_DEPTH */
+    int stack[BVH_MAX_DEPTH], top = 0, best_id = -1;
+    stack[top++] = 0;
+    while (top) {
+        bvh_node *n = &b->nodes[stack[--top]];
+        float t;
+        aabb grown = aabb(sub3(n->box.min, ext), add3(n->box.max, ext));
+        if (!sweep_test_aabb_(&t, center, delta, grown, minf(best.t0, 1))) continue;
+        if (n->count == 0) {
+            stack[top++] = n->first + 1, stack[top++] = n->first;
+            continue;
+        }
+        for (int i = n->first; i < n->first + n->count; ++i) {
+            hit *h = s ? sphere_sweep_triangle(*s, delta, b->tris[i]) : capsule_sweep_triangle(*c, delta, b->tris[i]);
+            if (h && h->t0 < best.t0) best = *h, best_id = b->ids[i];
+        }
+    }
+    if (best_id < 0) return 0;
+    if (id) *id = best_id;
+    hit *h = hit_next();
+    *h = best;
+    return h;
+}
+hit *sphere_sweep_bvh(sphere s, vec3 delta, bvh *b, int *id) {
+    return bvh_sweep_(b, &s, 0, delta, id);
+}
+hit *capsule_sweep_bvh(capsule c, vec3 delta, bvh *b, int *id) {
+    return bvh_sweep_(b, 0, &c, delta, id);
+}
+
+/* ============================================================================
+ *
+ *                                SPATIAL GRID
+ *
+ * =========================================================================== */
+
+#ifndef GRID_SLICES
+#define GRID_SLICES    8    // bucket slices sorted in parallel by grid_build (openmp builds only)
+#endif
+#define GRID_SLICE_MIN 4096 // fewer spheres than this are sorted in one slice
+
+static int grid_coord_(grid *g, float v, float origin) {
+    float f = (v - origin) * g->inv; int i = (int)f;
+    return i - (f < i); // floorf
+}
+static int grid_cell_(grid *g, int x, int y, int z) {
+    /* dense grid: linear cell index, -1 if outside. hashed grid: bucket */
+    if( g->dims[0] ) {
+        if( (unsigned)x >= (unsigned)g->dims[0] || (unsigned)y >= (unsigned)g->dims[1] || (unsigned)z >= (unsigned)g->dims[2] ) return -1;
+        return x + g->dims[0] * (y + g->dims[1] * z);
+    }
+    return ((unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^ (unsigned)z * 83492791u) & (g->buckets - 1);
+}
+
+void grid_build(grid *g, const sphere *s, int count, float cell_size) {
+    float maxr = 0;
+    vec3 lo = vec3(FLT_MAX,FLT_MAX,FLT_MAX), hi = vec3(-FLT_MAX,-FLT_MAX,-FLT_MAX);
+    for( int i = 0; i < count; ++i ) {
+        maxr = maxf(maxr, s[i].r);
+        lo = min3(lo, s[i].c), hi = max3(hi, s[i].c);
+    }
+
+    /* cells at least as large as the largest sphere, so overlapping pairs are always within 3x3x3 cells */
+    g->maxr = maxr;
+    g->cell = maxf(cell_size, 2 * maxr);
+    g->cell = g->cell > 0 ? g->cell : 1;
+    g->inv = 1.0f / g->cell;
+    g->origin = count ? lo : vec3(0,0,0);
+    g->count = count;
+
+    if( count > g->cap ) {
+        g->cap = count;
+        g->ids = REALLOC(g->ids, sizeof(int) * count);
+        g->keys = REALLOC(g->keys, sizeof(unsigned) * count);
+        g->spheres = REALLOC(g->spheres, sizeof(sphere) * count);
+    }
+
+    /* compact scenes use a dense uniform grid (no collisions, neighbor rows are contiguous); sparse ones are hashed */
+    int buckets = 64; while( buckets < count * 2 ) buckets <<= 1;
+    double dx = floor((hi.x-lo.x) * g->inv) + 1, dy = floor((hi.y-lo.y) * g->inv) + 1, dz = floor((hi.z-lo.z) * g->inv) + 1;
+    g->dims[0] = g->dims[1] = g->dims[2] = 0;
+    if( count && dx * dy * dz <= buckets * 4.0 ) {
+        g->dims[0] = (int)dx, g->dims[1] = (int)dy, g->dims[2] = (int)dz;
+        buckets = (int)(dx * dy * dz);
+    }
+    if( buckets > g->buckets_cap ) {
+        g->buckets_cap = buckets;
+        g->start = REALLOC(g->start, sizeof(int) * (buckets + 1));
+    }
+    g->buckets = buckets;
+    memset(g->start, 0, sizeof(int) * (buckets + 1));
+
+    /* counting sort into cells. every slice of buckets is counted, prefixed and scattered by its own thread:
+       each one scans all keys in order and only touches its own range of start[], so the sort stays stable.
+       every slice re-reads all keys, so serial builds sort in a single slice */
+#ifdef _OPENMP
+    int slices = count < GRID_SLICE_MIN ? 1 : GRID_SLICES, base[GRID_SLICES+1];
+#else
+    int slices = 1, base[2];
+#endif
+    #pragma omp parallel for
+    for( int i = 0; i < count; ++i ) {
+        vec3 c = s[i].c;
+        g->keys[i] = grid_cell_(g, grid_coord_(g, c.x, g->origin.x), grid_coord_(g, c.y, g->origin.y), grid_coord_(g, c.z, g->origin.z));
+    }
+    #pragma omp parallel for
+    for( int t = 0; t < slices; ++t ) {
+        unsigned lo = (unsigned)((int64_t)buckets * t / slices), hi = (unsigned)((int64_t)buckets * (t+1) / slices);
+        for( int i = 0; i < count; ++i ) {
+            unsigned k = g->keys[i];
+            if( k - lo < hi - lo ) g->start[k]++;
+        }
+        int sum = 0;
+        for( unsigned k = lo; k < hi; ++k ) sum += g->start[k];
+        base[t + 1] = sum;
+    }
+    base[0] = 0;
+    for( int t = 0; t < slices; ++t ) {
+        base[t + 1] += base[t];
+    }
+    #pragma omp parallel for
+    for( int t = 0; t < slices; ++t ) {
+        unsigned lo = (unsigned)((int64_t)buckets * t / slices), hi = (unsigned)((int64_t)buckets * (t+1) / slices);
+        for( unsigned k = lo, at = base[t]; k < hi; ++k ) { // start[k] is used as cursor, then restored below
+            unsigned n = g->start[k];
+            g->start[k] = at, at += n;
+        }
+        for( int i = 0; i < count; ++i ) {
+            unsigned k = g->keys[i];
+            if( k - lo >= hi - lo ) continue;
+            int at = g->start[k]++;
+            g->ids[at] = i;
+            g->spheres[at] = s[i];
+        }
+    }
+    memmove(g->start + 1, g->start, sizeof(int) * buckets);
+    g->start[0] = 0;
+}
+
+void grid_free(grid *g) {
+    REALLOC(g->ids, 0);
+    REALLOC(g->keys, 0);
+    REALLOC(g->spheres, 0);
+    REALLOC(g->start, 0);
+    grid z = {0};
+    *g = z;
+}
+
+static int grid_range_(grid *g, vec3 p, float r, int lo[3], int hi[3]) {
+    /* cells covered by sphere(p,r). returns 1 if it is cheaper to scan all spheres instead */
+    float pv[3] = { p.x, p.y, p.z }, ov[3] = { g->origin.x, g->origin.y, g->origin.z };
+    for( int i = 0; i < 3; ++i ) {
+        lo[i] = grid_coord_(g, pv[i] - r, ov[i]);
+        hi[i] = grid_coord_(g, pv[i] + r, ov[i]);
+        if( g->dims[0] ) lo[i] = lo[i] < 0 ? 0 : lo[i], hi[i] = hi[i] >= g->dims[i] ? g->dims[i] - 1 : hi[i];
+    }
+    int64_t total = (int64_t)(hi[0]-lo[0]+1) * (hi[1]-lo[1]+1) * (hi[2]-lo[2]+1);
+    if( hi[0] < lo[0] || hi[1] < lo[1] || hi[2] < lo[2] ) total = 0, lo[2] = 1, hi[2] = 0; // outside dense grid
+    if( total <= g->count ) return 0;
+    lo[0] = lo[1] = lo[2] = hi[0] = hi[1] = hi[2] = 0;
+    return 1;
+}
+static int grid_cell_is_(grid *g, int i, int x, int y, int z) {
+    /* hashed cells collide: only accept spheres that really belong to cell x,y,z */
+    vec3 c = g->spheres[i].c;
+    return grid_coord_(g, c.x, g->origin.x) == x && grid_coord_(g, c.y, g->origin.y) == y && grid_coord_(g, c.z, g->origin.z) == z;
+}
+
+#define grid_foreach(g, p, r, i) \
+    for( int lo_[3], hi_[3], all_ = grid_range_(g, p, r, lo_, hi_), z_ = lo_[2]; z_ <= hi_[2]; ++z_ ) \
+    for( int y_ = lo_[1]; y_ <= hi_[1]; ++y_ ) \
+    for( int x_ = lo_[0]; x_ <= hi_[0]; ++x_ ) \
+    for( int h_ = all_ ? 0 : grid_cell_(g, x_, y_, z_), i = all_ ? 0 : g->start[h_], e_ = all_ ? g->count : g->start[h_+1]; i < e_; ++i ) \
+    if( all_ || g->dims[0] || grid_cell_is_(g, i, x_, y_, z_) )
+
+int grid_query_sphere(grid *g, sphere s, int *ids, int max) {
+    int found = 0;
+    grid_foreach(g, s.c, s.r + g->maxr, i) {
+        vec3 d = sub3(g->spheres[i].c, s.c);
+        float r = g->spheres[i].r + s.r;
+        if( dot3(d,d) > r*r ) continue;
+        if( found < max ) ids[found] = g->ids[i];
+        ++found;
+    }
+    return found;
+}
+int grid_query_radius(grid *g, vec3 p, float r, int *ids, int max) {
+    int found = 0;
+    grid_foreach(g, p, r, i) {
+        vec3 d = sub3(g->spheres[i].c, p);
+        if( dot3(d,d) > r*r ) continue;
+        if( found < max ) ids[found] = g->ids[i];
+        ++found;
+    }
+    return found;
+}
+int grid_neighbors(grid *g, int id, int *ids, int max) {
+    unsigned key = g->keys[id];
+    for( int i = g->start[key], end = g->start[key + 1]; i < end; ++i ) {
+        if( g->ids[i] != id ) continue;
+        sphere s = g->spheres[i];
+        int found = 0;
+        grid_foreach(g, s.c, s.r + g->maxr, j) {
+            if( j == i ) continue;
+            vec3 d = sub3(g->spheres[j].c, s.c);
+            float r = g->spheres[j].r + s.r;
+            if( dot3(d,d) > r*r ) continue;
+            if( found < max ) ids[found] = g->ids[j];
+            ++found;
+        }
+        return found;
+    }
+    return 0;
+}
+int grid_pairs(grid *g, int *pairs, hit *hits, int max) {
+    int found = 0;
+    #pragma omp parallel for schedule(dynamic, 256)
+    for( int i = 0; i < g->count; ++i ) {
+        sphere a = g->spheres[i];
+        grid_foreach(g, a.c, a.r + g->maxr, j) {
+            if( g->ids[j] <= g->ids[i] ) continue; // each pair once
+            sphere b = g->spheres[j];
+            vec3 d = sub3(b.c, a.c);
+            float r = a.r + b.r, d2 = dot3(d,d);
+            if( d2 > r*r ) continue;
+            int at;
+            #pragma omp atomic capture
+            at = found++;
+            if( at >= max ) continue;
+            pairs[at*2+0] = g->ids[i];
+            pairs[at*2+1] = g->ids[j];
+            if( hits ) { /* same as sphere_hit_sphere() */
+                float l = sqrtf(d2), linv = 1.0f / (l != 0 ? l : 1.0f);
+                hit *m = &hits[at];
+                m->normal = scale3(d, linv);
+                m->depth = r - l;
+                m->contact_point = sub3(b.c, scale3(m->normal, b.r));
+            }
+        }
+    }
+    return found;
+}
+
 #endif
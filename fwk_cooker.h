@@ -47,7 +47,7 @@ typedef struct fs {
 } fs;
 
 struct cooker_args {
-    const char **files;
+    const file_info *files;
     int numfiles;
     cooker_callback_t callback;
     char zipfile[16];
@@ -60,14 +60,24 @@ int cooker__find_thread_number( const char *filename ) {
     return hash_str(filename) % COOKER_MAX_THREADS;
 }
 
+static
+int cooker__atlas_image(const char *fname) {
+    return !!strstr(".png.tga.bmp.psd.jpg.jpeg.", stringf("%s.", file_ext(fname)));
+}
+
 static
 array(fs) cooker__fs_scan(struct cooker_args *args) {
     array(struct fs) fs = 0;
 
+    // .compress tag files change how the images of their folder get cooked
+    array(int) compress = 0;
+    for( int i = 0; i < args->numfiles; ++i ) {
+        if( !strcmp(file_name(args->files[i].name), ".compress") ) array_push(compress, i);
+    }
+
     // iterate all previously scanned files
     for( int i = 0; i < args->numfiles; ++i ) {
-        const char *fname = args->files[i];
-        if( file_directory(fname) ) continue; // skip folders
+        const char *fname = args->files[i].name; // files only: scan skips folders
         if( fname[0] == '.' ) continue; // skip internal files, like .cook.zip
 
         int thread_id_target = cooker__find_thread_number(fname);
@@ -98,11 +108,33 @@ array(fs) cooker__fs_scan(struct cooker_args *args) {
 
         struct fs fi = {0};
         fi.fname = STRDUP(buf);
-        fi.bytes = file_size(buf);
-        fi.stamp = file_stamp_human(buf); // human-readable base10 timestamp
+        fi.bytes = args->files[i].size; // sizes & stamps come along the scan: no stat calls here
+        time_t mtime = (time_t)args->files[i].stamp;
+        struct tm *ti = localtime(&mtime); // human-readable base10 timestamp, as in file_stamp_human()
+        fi.stamp = atoi64(stringf("%04d%02d%02d%02d%02d%02d",ti->tm_year+1900,ti->tm_mon+1,ti->tm_mday,ti->tm_hour,ti->tm_min,ti->tm_sec));
+
+        // images of a .compress folder fold the tag file in, so changing options re-cooks them
+        if( cooker__atlas_image(fname) ) {
+            char *folder = file_path(fname);
+            for( int j = 0; j < array_count(compress); ++j ) {
+                const file_info *tag = &args->files[compress[j]];
+                if( !strcmp(file_path(tag->name), folder) ) fi.bytes += tag->size + tag->stamp;
+            }
+        }
+
+        // atlas tag files are cooked from the images of their folder: fold their sizes & stamps in, so any change re-cooks the atlas
+        if( !strcmp(file_ext(fname), ".atlas") ) {
+            char *folder = file_path(fname);
+            for( int j = 0; j < args->numfiles; ++j ) {
+                if( cooker__atlas_image(args->files[j].name) && !strcmp(file_path(args->files[j].name), folder) ) {
+                    fi.bytes += args->files[j].size + args->files[j].stamp;
+                }
+            }
+        }
 
         array_push(fs, fi);
     }
+    array_free(compress);
     return fs;
 }
 
@@ -246,7 +278,8 @@ unlink(COOKER_TMPFILE); // @fixme:
         if( failed ) PRINTF("importing failed: %s", fname);
         else if( compression >= 0 ) {
             fseek(out, 0L, SEEK_SET);
-            char *comment = stringf("%d",(int)inlen);
+            fs *scanned = cooker__fs_locate(now, fname); // same size cooker__fs_diff() compares against
+            char *comment = stringf("%llu", (unsigned long long)(scanned ? scanned->bytes : inlen));
             if( !zip_append_file(z, fname, comment, out, compression) ) {
                 PANIC("failed to add processed file into %s: %s", args->zipfile, fname);
             }
@@ -287,9 +320,9 @@ int cooker_async( void *userptr ) {
 
 bool cooker( const char *masks, cooker_callback_t callback, int flags ) {
     static struct cooker_args args[16] = {0};
-    const char **files = file_list(masks);
+    const file_info *files = file_scan(masks);
 
-    int numfiles = 0; while(files[numfiles]) ++numfiles;
+    int numfiles = 0; while(files[numfiles].name) ++numfiles;
     args[0].files = files;
     args[0].callback = callback;
     args[0].numfiles = numfiles;
@@ -309,6 +342,815 @@ bool cooker( const char *masks, cooker_callback_t callback, int flags ) {
     }
 }
 
+// -----------------------------------------------------------------------------
+// texture atlases
+
+// a folder becomes an atlas group when it holds a .atlas tag file. every image in that folder gets trimmed, packed
+// and cooked into the .atlas entry itself (see atlas_frame_t for the layout). tag file options, one per line:
+// padding=2 (texels between images), extrude=1 (edge texels repeated around each image, for filtering),
+// rotate=1 (allow 90 degree rotations), trim=1 (crop transparent borders), maxsize=4096 (largest atlas side),
+// pot=0 (power-of-two sides)
+
+typedef struct cooker__rect { int x, y, w, h; } cooker__rect;
+
+typedef struct cooker__atlas_options { int padding, extrude, rotate, trim, maxsize, pot; } cooker__atlas_options;
+
+// maxrects, best short side fit. places rects in the given order, rewriting them in place; returns how many fit
+static
+int cooker__maxrects(cooker__rect *rects, int *rotated, int count, int width, int height, int rotate) {
+    array(cooker__rect) spare = 0;
+    array(cooker__rect) next = 0;
+    array_push(spare, ((cooker__rect){0, 0, width, height}));
+
+    int placed = 0;
+    for( ; placed < count; ++placed ) {
+        cooker__rect *r = &rects[placed];
+        int best = -1, best_short = INT_MAX, best_long = INT_MAX, best_rot = 0;
+        for( int f = 0; f < array_count(spare); ++f ) {
+            for( int rot = 0; rot <= !!rotate; ++rot ) {
+                int w = rot ? r->h : r->w, h = rot ? r->w : r->h;
+                if( w > spare[f].w || h > spare[f].h ) continue;
+                int dw = spare[f].w - w, dh = spare[f].h - h;
+                int lo = dw < dh ? dw : dh, hi = dw < dh ? dh : dw;
+                if( lo < best_short || (lo == best_short && hi < best_long) ) best = f, best_short = lo, best_long = hi, best_rot = rot;
+            }
+        }
+        if( best < 0 ) break;
+
+        cooker__rect p = { spare[best].x, spare[best].y, best_rot ? r->h : r->w, best_rot ? r->w : r->h };
+        *r = p, rotated[placed] = best_rot;
+
+        // split every spare rect overlapping the placed one into its (up to 4) maximal leftovers
+        array_clear(next);
+        for( int f = 0; f < array_count(spare); ++f ) {
+            cooker__rect q = spare[f];
+            if( p.x >= q.x + q.w || p.x + p.w <= q.x || p.y >= q.y + q.h || p.y + p.h <= q.y ) { array_push(next, q); continue; }
+            if( p.x > q.x ) array_push(next, ((cooker__rect){ q.x, q.y, p.x - q.x, q.h }));
+            if( p.x + p.w < q.x + q.w ) array_push(next, ((cooker__rect){ p.x + p.w, q.y, q.x + q.w - p.x - p.w, q.h }));
+            if( p.y > q.y ) array_push(next, ((cooker__rect){ q.x, q.y, q.w, p.y - q.y }));
+            if( p.y + p.h < q.y + q.h ) array_push(next, ((cooker__rect){ q.x, p.y + p.h, q.w, q.y + q.h - p.y - p.h }));
+        }
+
+        // and drop the ones contained in others (first one survives among duplicates)
+        array_clear(spare);
+        for( int i = 0; i < array_count(next); ++i ) {
+            int contained = 0;
+            for( int j = 0; j < array_count(next) && !contained; ++j ) {
+                cooker__rect a = next[i], b = next[j];
+                int same = a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+                contained = i != j && a.x >= b.x && a.y >= b.y && a.x + a.w <= b.x + b.w && a.y + a.h <= b.y + b.h && (!same || i > j);
+            }
+            if( !contained ) array_push(spare, next[i]);
+        }
+    }
+
+    array_free(spare);
+    array_free(next);
+    return placed;
+}
+
+static const cooker__rect *cooker__sort_cells;
+static int cooker__sort_larger(const void *a, const void *b) {
+    const cooker__rect *x = &cooker__sort_cells[*(const int*)a], *y = &cooker__sort_cells[*(const int*)b];
+    int mx = x->w > x->h ? x->w : x->h, my = y->w > y->h ? y->w : y->h;
+    return mx != my ? my - mx : y->w * y->h - x->w * x->h;
+}
+
+// packs rgba8 images into an atlas. fills frames[] in input order and returns the atlas pixels, or 0 if they do not fit
+static
+image_t cooker__atlas(const image_t *images, const char **names, int count, cooker__atlas_options opt, atlas_frame_t *frames) {
+    image_t atlas = {0};
+    int border = opt.extrude, gap = 2 * opt.extrude + opt.padding;
+
+    // trim transparent borders
+    cooker__rect *trims = REALLOC(0, sizeof(cooker__rect) * count), *cells = REALLOC(0, sizeof(cooker__rect) * count);
+    int *order = REALLOC(0, sizeof(int) * count), *rotated = REALLOC(0, sizeof(int) * count);
+    uint64_t area = 0;
+    for( int i = 0; i < count; ++i ) {
+        const uint32_t *px = images[i].pixels32;
+        int w = images[i].w, h = images[i].h, x0 = w, y0 = h, x1 = -1, y1 = -1;
+        if( opt.trim ) {
+            for( int y = 0; y < h; ++y ) for( int x = 0; x < w; ++x ) {
+                if( px[x + y * w] >> 24 ) { // alpha
+                    x0 = x < x0 ? x : x0, x1 = x > x1 ? x : x1;
+                    y0 = y < y0 ? y : y0, y1 = y > y1 ? y : y1;
+                }
+            }
+            if( x1 < 0 ) x0 = y0 = x1 = y1 = 0; // fully transparent: keep a single texel
+        } else {
+            x0 = y0 = 0, x1 = w - 1, y1 = h - 1;
+        }
+        trims[i] = (cooker__rect){ x0, y0, x1 - x0 + 1, y1 - y0 + 1 };
+        cells[i] = (cooker__rect){ 0, 0, trims[i].w + gap, trims[i].h + gap };
+        area += cells[i].w * cells[i].h;
+        order[i] = i;
+    }
+
+    // largest first, then grow the bin from the total area until everything fits.
+    // sides are multiples of 4 (block compression friendly), or powers of two if requested
+    cooker__sort_cells = cells;
+    qsort(order, count, sizeof(int), cooker__sort_larger);
+    cooker__rect *sorted = REALLOC(0, sizeof(cooker__rect) * count);
+
+    int w = 4, h = 4, fits = 0;
+    if( opt.pot ) while( (uint64_t)w * h < area ) if( w <= h ) w *= 2; else h *= 2;
+    if(!opt.pot ) w = h = ((int)ceil(sqrt((double)area)) + 3) & ~3;
+    while( !fits && w <= opt.maxsize && h <= opt.maxsize ) {
+        for( int i = 0; i < count; ++i ) sorted[i] = cells[order[i]];
+        fits = cooker__maxrects(sorted, rotated, count, w, h, opt.rotate) == count;
+        if( !fits && opt.pot ) if( w <= h ) w *= 2; else h *= 2;
+        if( !fits && !opt.pot ) if( w <= h ) w = (w + w / 32 + 4) & ~3; else h = (h + h / 32 + 4) & ~3;
+    }
+
+    if( fits ) {
+        atlas.w = w, atlas.h = h, atlas.n = 4;
+        atlas.pixels = memset(REALLOC(0, w * h * 4), 0, w * h * 4);
+
+        for( int k = 0; k < count; ++k ) {
+            int i = order[k], rot = rotated[k];
+            cooker__rect t = trims[i], c = { sorted[k].x + border, sorted[k].y + border, rot ? t.h : t.w, rot ? t.w : t.h };
+            const uint32_t *src = images[i].pixels32;
+            uint32_t *dst = atlas.pixels32;
+
+            // blit, 90 degrees clockwise when rotated: texel (x,y) lands on (c.x + t.h-1-y, c.y + x)
+            for( int y = 0; y < t.h; ++y ) for( int x = 0; x < t.w; ++x ) {
+                uint32_t texel = src[(t.x + x) + (t.y + y) * images[i].w];
+                if( rot ) dst[(c.x + t.h-1-y) + (c.y + x) * w] = texel;
+                else      dst[(c.x + x) + (c.y + y) * w] = texel;
+            }
+
+            // extrude: repeat the edge texels outwards
+            for( int y = c.y - border; y < c.y + c.h + border; ++y ) for( int x = c.x - border; x < c.x + c.w + border; ++x ) {
+                int sx = x < c.x ? c.x : x >= c.x + c.w ? c.x + c.w - 1 : x;
+                int sy = y < c.y ? c.y : y >= c.y + c.h ? c.y + c.h - 1 : y;
+                if( sx != x || sy != y ) dst[x + y * w] = dst[sx + sy * w];
+            }
+
+            atlas_frame_t *f = &frames[i];
+            memset(f, 0, sizeof(*f));
+            snprintf(f->name, sizeof(f->name), "%s", names[i]);
+            f->x = c.x, f->y = c.y, f->w = c.w, f->h = c.h;
+            f->ox = t.x, f->oy = t.y, f->ow = images[i].w, f->oh = images[i].h;
+            f->rotated = rot;
+        }
+    }
+
+    FREE(sorted);
+    FREE(rotated);
+    FREE(order);
+    FREE(cells);
+    FREE(trims);
+    return atlas;
+}
+
+static int cooker__option(const char *options, const char *key, int defaults) {
+    const char *found = strstr(options, stringf("%s=", key));
+    return found ? atoi(found + strlen(key) + 1) : defaults;
+}
+
+static int cooker__atlas_frame_qsort(const void *a, const void *b) {
+    return strcmp(((const atlas_frame_t*)a)->name, ((const atlas_frame_t*)b)->name);
+}
+
+// cooks the folder of a .atlas tag file. prints packing efficiency
+static
+bool cooker__atlas_cook(const char *tagfile, FILE *out) {
+    char *options = file_read(tagfile);
+    cooker__atlas_options opt = {
+        cooker__option(options ? options : "", "padding", 2),
+        cooker__option(options ? options : "", "extrude", 1),
+        cooker__option(options ? options : "", "rotate", 1),
+        cooker__option(options ? options : "", "trim", 1),
+        cooker__option(options ? options : "", "maxsize", 4096),
+        cooker__option(options ? options : "", "pot", 0),
+    };
+    FREE(options);
+
+    // load every image in the folder, named after its basename
+    array(image_t) images = 0;
+    array(char*) names = 0;
+    uint64_t texels = 0;
+    const char *folder = file_path(tagfile);
+    for( const char **list = file_list(stringf("%s*", folder)); *list; ++list ) {
+        if( !cooker__atlas_image(*list) ) continue;
+        int len = 0;
+        char *data = file_load(*list, &len);
+        image_t img = image_from_mem(data, len, IMAGE_RGBA);
+        FREE(data);
+        if( !img.pixels ) { PRINTF("!cannot decode %s\n", *list); continue; }
+
+        char *name = file_name(*list), *dot = strrchr(name, '.');
+        array_push(names, STRDUP(stringf("%.*s", (int)(dot ? dot - name : strlen(name)), name)));
+        array_push(images, img);
+        texels += img.w * img.h;
+    }
+
+    int count = array_count(images);
+    atlas_frame_t *frames = REALLOC(0, sizeof(atlas_frame_t) * (count + !count));
+    image_t atlas = cooker__atlas(images, (const char **)names, count, opt, frames);
+
+    bool ok = count && atlas.pixels;
+    if( ok ) {
+        uint64_t packed = 0;
+        for( int i = 0; i < count; ++i ) packed += frames[i].w * frames[i].h;
+        printf("%s: %d images, %ux%u atlas, %.1f%% packed (%.1f%% trimmed away)\n", tagfile, count, atlas.w, atlas.h,
+            packed * 100.0 / (atlas.w * atlas.h), (texels - packed) * 100.0 / (texels + !texels));
+
+        qsort(frames, count, sizeof(atlas_frame_t), cooker__atlas_frame_qsort); // sorted for atlas_find()
+        unsigned header[4] = { 0, atlas.w, atlas.h, count };
+        memcpy(header, "ATL1", 4);
+        ok = fwrite(header, sizeof(header), 1, out) == 1
+            && fwrite(frames, sizeof(atlas_frame_t), count, out) == count
+            && fwrite(atlas.pixels, atlas.w * atlas.h * 4, 1, out) == 1;
+    } else {
+        printf("%s: %d images do not fit in a %dx%d atlas\n", tagfile, count, opt.maxsize, opt.maxsize);
+    }
+
+    for( int i = 0; i < count; ++i ) image_destroy(&images[i]), FREE(names[i]);
+    array_free(images);
+    array_free(names);
+    if( atlas.pixels ) FREE(atlas.pixels);
+    FREE(frames);
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// texture compression
+
+// a folder holding a .compress tag file cooks its images into block compressed gpu textures with their mips, which texture() uploads as-is
+// (see TEXTURE_BC* flags for the layout). tag file options, one per line:
+// format=auto (bc1, bc3, bc4, bc5, bc7, rgba8. auto is bc1 for opaque or cutout images, else bc3, or bc7 at quality 2)
+// quality=1 (0 bounding box fit, 1 least squares refined, 2 exhaustive: more refinement & endpoint search)
+// mips=1 (full mip chain stored in the container, 0 for level 0 only)
+// filter=kaiser (or box)
+// srgb=1 (filter color in linear light. defaults to 0 for bc4, bc5 and normal maps)
+// normalmap=0 (1 renormalizes the rgb vectors of every level)
+// coverage=128 for cutouts, else 0 (alpha-test reference whose coverage every level keeps. 0 disables)
+
+// principal axis of the masked texels, by power iteration on their covariance
+static
+int cooker__bc_axis(float px[16][4], const int *mask, int channels, float mean[4], float axis[4]) {
+    int n = 0;
+    float cov[4][4] = {0};
+    mean[0] = mean[1] = mean[2] = mean[3] = 0;
+    for( int c = 0; c < 4; ++c ) axis[c] = c < channels;
+    for( int i = 0; i < 16; ++i ) if( mask[i] ) for( int c = 0; c < channels; ++c ) mean[c] += px[i][c];
+    for( int i = 0; i < 16; ++i ) n += !!mask[i];
+    if( !n ) return 0;
+    for( int c = 0; c < channels; ++c ) mean[c] /= n;
+    for( int i = 0; i < 16; ++i ) if( mask[i] ) {
+        for( int a = 0; a < channels; ++a ) for( int b = 0; b < channels; ++b ) cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+    }
+    for( int it = 0; it < 8; ++it ) {
+        float next[4] = {0}, len = 0;
+        for( int a = 0; a < channels; ++a ) for( int b = 0; b < channels; ++b ) next[a] += cov[a][b] * axis[b];
+        for( int c = 0; c < channels; ++c ) len += next[c] * next[c];
+        if( len < 1e-12f ) break;
+        len = 1 / sqrtf(len);
+        for( int c = 0; c < channels; ++c ) axis[c] = next[c] * len;
+    }
+    return n;
+}
+
+// endpoints along the principal axis, bounding the masked texels
+static
+void cooker__bc_bounds(float px[16][4], const int *mask, int channels, float e0[4], float e1[4]) {
+    float mean[4], axis[4], lo = FLT_MAX, hi = -FLT_MAX;
+    cooker__bc_axis(px, mask, channels, mean, axis);
+    for( int i = 0; i < 16; ++i ) if( mask[i] ) {
+        float t = 0;
+        for( int c = 0; c < channels; ++c ) t += (px[i][c] - mean[c]) * axis[c];
+        lo = minf(lo, t), hi = maxf(hi, t);
+    }
+    if( lo > hi ) lo = hi = 0;
+    for( int c = 0; c < 4; ++c ) e0[c] = mean[c] + axis[c] * hi, e1[c] = mean[c] + axis[c] * lo;
+}
+
+// least squares endpoints for the given weights of e0 (texel = t * e0 + (1-t) * e1). false if degenerate
+static
+int cooker__bc_lsq(float px[16][4], const int *mask, const float *t, int channels, float e0[4], float e1[4]) {
+    float aa = 0, ab = 0, bb = 0, ax[4] = {0}, bx[4] = {0};
+    for( int i = 0; i < 16; ++i ) if( mask[i] ) {
+        float a = t[i], b = 1 - t[i];
+        aa += a * a, ab += a * b, bb += b * b;
+        for( int c = 0; c < channels; ++c ) ax[c] += a * px[i][c], bx[c] += b * px[i][c];
+    }
+    float det = aa * bb - ab * ab;
+    if( fabsf(det) < 1e-6f ) return 0;
+    for( int c = 0; c < channels; ++c ) {
+        e0[c] = clampf((bb * ax[c] - ab * bx[c]) / det, 0, 255);
+        e1[c] = clampf((aa * bx[c] - ab * ax[c]) / det, 0, 255);
+    }
+    return 1;
+}
+
+// bc1: two 565 endpoints + 2-bit indices. c0 > c1 selects 4 colors, else 3 colors + transparent black
+static
+unsigned cooker__bc1_pack565(const float c[4]) {
+    int r = (int)(clampf(c[0], 0, 255) * 31 / 255 + 0.5f), g = (int)(clampf(c[1], 0, 255) * 63 / 255 + 0.5f), b = (int)(clampf(c[2], 0, 255) * 31 / 255 + 0.5f);
+    return r << 11 | g << 5 | b;
+}
+
+static
+void cooker__bc1_palette(unsigned c0, unsigned c1, int four, float pal[4][4]) {
+    for( int k = 0; k < 2; ++k ) {
+        unsigned c = k ? c1 : c0, r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+        pal[k][0] = (r << 3) | (r >> 2), pal[k][1] = (g << 2) | (g >> 4), pal[k][2] = (b << 3) | (b >> 2), pal[k][3] = 255;
+    }
+    for( int c = 0; c < 4; ++c ) {
+        pal[2][c] = four ? (2 * pal[0][c] + pal[1][c]) / 3 : (pal[0][c] + pal[1][c]) / 2;
+        pal[3][c] = four ? (pal[0][c] + 2 * pal[1][c]) / 3 : 0;
+    }
+}
+
+// orders & quantizes the endpoints, assigns indices and returns the squared error of the opaque texels
+static
+float cooker__bc1_fit(float px[16][4], const int *opaque, int transparent, int three, int bc3, const float e0[4], const float e1[4], unsigned *c0, unsigned *c1, uint8_t idx[16]) {
+    *c0 = cooker__bc1_pack565(e0), *c1 = cooker__bc1_pack565(e1);
+    if( !bc3 && (three || transparent) ? *c0 > *c1 : *c0 < *c1 ) { unsigned t = *c0; *c0 = *c1, *c1 = t; }
+    int four = bc3 || *c0 > *c1; // bc3 color blocks always decode 4 colors
+
+    float pal[4][4], err = 0;
+    cooker__bc1_palette(*c0, *c1, four, pal);
+    for( int i = 0; i < 16; ++i ) {
+        if( !opaque[i] ) { idx[i] = 3; continue; }
+        float best = FLT_MAX;
+        for( int k = 0; k < 3 + four; ++k ) {
+            float dr = px[i][0] - pal[k][0], dg = px[i][1] - pal[k][1], db = px[i][2] - pal[k][2], d = dr * dr + dg * dg + db * db;
+            if( d < best ) best = d, idx[i] = k;
+        }
+        err += best;
+    }
+    return err;
+}
+
+static
+void cooker__bc1_block(const uint8_t rgba[64], int quality, int bc3, uint8_t out[8]) {
+    float px[16][4];
+    int opaque[16], transparent = 0;
+    for( int i = 0; i < 16; ++i ) {
+        for( int c = 0; c < 4; ++c ) px[i][c] = rgba[i * 4 + c];
+        opaque[i] = bc3 || rgba[i * 4 + 3] >= 128;
+        transparent |= !opaque[i];
+    }
+
+    unsigned c0 = 0, c1 = 0;
+    uint8_t idx[16];
+    float e0[4], e1[4], err = FLT_MAX;
+    cooker__bc_bounds(px, opaque, 3, e0, e1);
+
+    // 4 colors when every texel is opaque; 3 colors + transparent otherwise. exhaustive quality also tries 3 colors on opaque blocks
+    for( int three = transparent; three <= (transparent || (quality >= 2 && !bc3)); ++three ) {
+        float f0[4] = { e0[0], e0[1], e0[2] }, f1[4] = { e1[0], e1[1], e1[2] };
+        for( int it = 0, iterations = quality <= 0 ? 0 : quality == 1 ? 2 : 8; it <= iterations; ++it ) {
+            unsigned t0, t1; uint8_t tidx[16];
+            float terr = cooker__bc1_fit(px, opaque, transparent, three, bc3, f0, f1, &t0, &t1, tidx);
+            if( terr < err ) err = terr, c0 = t0, c1 = t1, memcpy(idx, tidx, 16);
+            if( it == iterations || terr == 0 ) break;
+
+            // refit both endpoints to the indices just picked. weights are relative to the ordered endpoints
+            int four = bc3 || t0 > t1, swapped = cooker__bc1_pack565(f0) != t0;
+            float t[16], w4[4] = { 1, 0, 2/3.f, 1/3.f }, w3[4] = { 1, 0, 1/2.f, 0 };
+            for( int i = 0; i < 16; ++i ) t[i] = four ? w4[tidx[i]] : w3[tidx[i]];
+            if( !cooker__bc_lsq(px, opaque, t, 3, swapped ? f1 : f0, swapped ? f0 : f1) ) break;
+        }
+    }
+
+    unsigned bits = 0;
+    for( int i = 0; i < 16; ++i ) bits |= (unsigned)idx[i] << (i * 2);
+    out[0] = c0 & 255, out[1] = c0 >> 8, out[2] = c1 & 255, out[3] = c1 >> 8;
+    out[4] = bits & 255, out[5] = (bits >> 8) & 255, out[6] = (bits >> 16) & 255, out[7] = bits >> 24;
+}
+
+// bc4: two 8-bit endpoints + 3-bit indices. e0 > e1 interpolates 6 values, else 4 values plus 0 and 255
+static
+float cooker__bc4_fit(const uint8_t v[16], int e0, int e1, uint8_t idx[16]) {
+    float pal[8] = { e0, e1 }, err = 0;
+    for( int k = 1; k <= 6; ++k ) pal[1 + k] = e0 > e1 ? ((7 - k) * e0 + k * e1) / 7.f : k <= 4 ? ((5 - k) * e0 + k * e1) / 5.f : (k == 5 ? 0 : 255);
+    for( int i = 0; i < 16; ++i ) {
+        float best = FLT_MAX;
+        for( int k = 0; k < 8; ++k ) {
+            float d = (v[i] - pal[k]) * (v[i] - pal[k]);
+            if( d < best ) best = d, idx[i] = k;
+        }
+        err += best;
+    }
+    return err;
+}
+
+static
+void cooker__bc4_block(const uint8_t v[16], int quality, uint8_t out[8]) {
+    int lo = 255, hi = 0, lo6 = 255, hi6 = 0;
+    for( int i = 0; i < 16; ++i ) {
+        lo = mini(lo, v[i]), hi = maxi(hi, v[i]);
+        if( v[i] > 0 && v[i] < 255 ) lo6 = mini(lo6, v[i]), hi6 = maxi(hi6, v[i]);
+    }
+
+    uint8_t idx[16], tidx[16];
+    int e0 = hi, e1 = lo;
+    float err = cooker__bc4_fit(v, e0, e1, idx), terr;
+
+    // 4 values plus exact 0 and 255, when the block has extremes
+    if( quality >= 1 && lo6 <= hi6 && (lo == 0 || hi == 255) ) {
+        if( (terr = cooker__bc4_fit(v, lo6, hi6, tidx)) < err ) err = terr, e0 = lo6, e1 = hi6, memcpy(idx, tidx, 16);
+    }
+    // nudge the bounding endpoints inwards, which trades the extremes for a finer step
+    for( int r = quality <= 0 ? -1 : quality == 1 ? 2 : 6, a = 0; a <= r && err > 0; ++a ) {
+        for( int b = 0; b <= r; ++b ) {
+            int t0 = hi - a, t1 = lo + b;
+            if( t0 <= t1 ) continue;
+            if( (terr = cooker__bc4_fit(v, t0, t1, tidx)) < err ) err = terr, e0 = t0, e1 = t1, memcpy(idx, tidx, 16);
+        }
+    }
+
+    uint64_t bits = 0;
+    for( int i = 0; i < 16; ++i ) bits |= (uint64_t)idx[i] << (i * 3);
+    out[0] = e0, out[1] = e1;
+    for( int i = 0; i < 6; ++i ) out[2 + i] = (bits >> (i * 8)) & 255;
+}
+
+// bc7, mode 6 only: rgba 7.7.7.7 endpoints with a p-bit each, 4-bit indices
+static const int cooker__bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static
+float cooker__bc7_fit(float px[16][4], const int ep[2][4], uint8_t idx[16]) {
+    float pal[16][4], err = 0;
+    for( int k = 0; k < 16; ++k ) for( int c = 0; c < 4; ++c ) {
+        pal[k][c] = ((64 - cooker__bc7_weights[k]) * ep[0][c] + cooker__bc7_weights[k] * ep[1][c] + 32) >> 6;
+    }
+    for( int i = 0; i < 16; ++i ) {
+        float best = FLT_MAX;
+        for( int k = 0; k < 16; ++k ) {
+            float d = 0;
+            for( int c = 0; c < 4; ++c ) d += (px[i][c] - pal[k][c]) * (px[i][c] - pal[k][c]);
+            if( d < best ) best = d, idx[i] = k;
+        }
+        err += best;
+    }
+    return err;
+}
+
+static
+void cooker__bc7_quantize(const float e[4], int pbit, int ep[4]) {
+    for( int c = 0; c < 4; ++c ) ep[c] = mini(127, maxi(0, (int)((clampf(e[c], 0, 255) - pbit) / 2 + 0.5f))) << 1 | pbit;
+}
+
+static
+void cooker__bits(uint8_t *out, int *pos, unsigned value, int bits) {
+    for( int i = 0; i < bits; ++i, ++*pos ) out[*pos >> 3] |= ((value >> i) & 1) << (*pos & 7);
+}
+
+static
+void cooker__bc7_block(const uint8_t rgba[64], int quality, uint8_t out[16]) {
+    float px[16][4];
+    int all[16];
+    for( int i = 0; i < 16; ++i ) {
+        for( int c = 0; c < 4; ++c ) px[i][c] = rgba[i * 4 + c];
+        all[i] = 1;
+    }
+
+    int ep[2][4] = {0};
+    uint8_t idx[16] = {0};
+    float e0[4], e1[4], err = FLT_MAX;
+    cooker__bc_bounds(px, all, 4, e0, e1);
+
+    for( int it = 0, iterations = quality <= 0 ? 0 : quality == 1 ? 2 : 6; it <= iterations; ++it ) {
+        // p-bits: nearest per endpoint, or the best of all 4 combinations
+        uint8_t tidx[16], bidx[16];
+        int tp[2][4], bp[2][4];
+        float berr = FLT_MAX;
+        for( int p = 0; p < 4; ++p ) {
+            int p0 = p & 1, p1 = p >> 1;
+            if( quality <= 0 ) {
+                float d[2][2] = {0};
+                for( int b = 0; b < 2; ++b ) for( int e = 0; e < 2; ++e ) {
+                    int q[4]; cooker__bc7_quantize(e ? e1 : e0, b, q);
+                    for( int c = 0; c < 4; ++c ) d[e][b] += ((e ? e1 : e0)[c] - q[c]) * ((e ? e1 : e0)[c] - q[c]);
+                }
+                p0 = d[0][1] < d[0][0], p1 = d[1][1] < d[1][0], p = 4;
+            }
+            cooker__bc7_quantize(e0, p0, tp[0]), cooker__bc7_quantize(e1, p1, tp[1]);
+            float terr = cooker__bc7_fit(px, tp, tidx);
+            if( terr < berr ) berr = terr, memcpy(bp, tp, sizeof(bp)), memcpy(bidx, tidx, 16);
+        }
+        if( berr < err ) err = berr, memcpy(ep, bp, sizeof(ep)), memcpy(idx, bidx, 16);
+        if( it == iterations || berr == 0 ) break;
+
+        float t[16];
+        for( int i = 0; i < 16; ++i ) t[i] = 1 - cooker__bc7_weights[bidx[i]] / 64.f;
+        if( !cooker__bc_lsq(px, all, t, 4, e0, e1) ) break;
+    }
+
+    // anchor texel index must have its top bit clear: swap endpoints & invert indices otherwise
+    if( idx[0] & 8 ) {
+        for( int c = 0; c < 4; ++c ) { int t = ep[0][c]; ep[0][c] = ep[1][c], ep[1][c] = t; }
+        for( int i = 0; i < 16; ++i ) idx[i] = 15 - idx[i];
+    }
+
+    int pos = 0;
+    memset(out, 0, 16);
+    cooker__bits(out, &pos, 1 << 6, 7); // mode 6
+    for( int c = 0; c < 4; ++c ) cooker__bits(out, &pos, ep[0][c] >> 1, 7), cooker__bits(out, &pos, ep[1][c] >> 1, 7);
+    cooker__bits(out, &pos, ep[0][0] & 1, 1), cooker__bits(out, &pos, ep[1][0] & 1, 1);
+    for( int i = 0; i < 16; ++i ) cooker__bits(out, &pos, idx[i], i ? 4 : 3);
+}
+
+// block compresses a rgba8 image. rows of blocks are encoded in parallel
+static
+char *cooker__bc(const image_t *img, unsigned format, int quality, int *len) {
+    int bw = (img->w + 3) / 4, bh = (img->h + 3) / 4, block = format & (TEXTURE_BC1|TEXTURE_BC4) ? 8 : 16;
+    char *blocks = REALLOC(0, bw * bh * block);
+
+    int by;
+    #pragma omp parallel for
+    for( by = 0; by < bh; ++by ) {
+        for( int bx = 0; bx < bw; ++bx ) {
+            // gather 4x4 texels, repeating the last row/column on partial blocks
+            uint8_t rgba[64], r[16], g[16], a[16];
+            for( int i = 0; i < 16; ++i ) {
+                int x = mini(bx * 4 + (i & 3), img->w - 1), y = mini(by * 4 + (i >> 2), img->h - 1);
+                memcpy(&rgba[i * 4], &img->pixels8[(x + y * img->w) * 4], 4);
+                r[i] = rgba[i * 4 + 0], g[i] = rgba[i * 4 + 1], a[i] = rgba[i * 4 + 3];
+            }
+
+            uint8_t *out = (uint8_t*)blocks + (by * bw + bx) * block;
+            /**/ if( format & TEXTURE_BC1 ) cooker__bc1_block(rgba, quality, 0, out);
+            else if( format & TEXTURE_BC3 ) cooker__bc4_block(a, quality, out), cooker__bc1_block(rgba, quality, 1, out + 8);
+            else if( format & TEXTURE_BC4 ) cooker__bc4_block(r, quality, out);
+            else if( format & TEXTURE_BC5 ) cooker__bc4_block(r, quality, out), cooker__bc4_block(g, quality, out + 8);
+            else if( format & TEXTURE_BC7 ) cooker__bc7_block(rgba, quality, out);
+        }
+    }
+
+    *len = bw * bh * block;
+    return blocks;
+}
+
+// -----------------------------------------------------------------------------
+// mipmaps: full chains filtered on the cpu at cook time, so runtime just uploads levels.
+// levels are filtered in linear space from the previous float level (no requantization drift).
+
+typedef struct cooker__mip_options {
+    int kaiser;    // 0: box, 1: kaiser-windowed sinc
+    int srgb;      // color channels are srgb encoded: filter them in linear space
+    int normalmap; // rgb holds a unit vector: renormalize every texel
+    int coverage;  // alpha-test reference (1..255), 0 to disable alpha coverage preservation
+} cooker__mip_options;
+
+static float cooker__srgb_linear[256];
+static uint8_t cooker__linear_srgb[16384]; // fine enough for a dark step of 0.2 levels
+
+// srgb<->linear lookups. built on first use (texture streaming builds them before starting its workers)
+static void cooker__srgb_tables() {
+    if( cooker__linear_srgb[16383] ) return;
+    for( int i = 0; i < 256; ++i ) {
+        float c = i / 255.f;
+        cooker__srgb_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for( int i = 0; i < 16384; ++i ) {
+        float x = i / 16383.f;
+        cooker__linear_srgb[i] = (uint8_t)((x <= 0.0031308f ? x * 12.92f : 1.055f * powf(x, 1/2.4f) - 0.055f) * 255 + 0.5f);
+    }
+}
+
+static float cooker__bessel_i0(float x) {
+    float sum = 1, term = 1;
+    for( int k = 1; k < 16; ++k ) term *= (x * x / 4) / (k * k), sum += term;
+    return sum;
+}
+
+// weight of a source texel, d being its distance to the destination center in destination texels
+static float cooker__mip_weight(float d, int kaiser) {
+    d = fabsf(d);
+    if( !kaiser ) return d < 0.5f;
+    const float radius = 2, alpha = 4;
+    if( d >= radius ) return 0;
+    float t = d / radius, sinc = d < 1e-5f ? 1 : sinf(C_PI * d) / (C_PI * d);
+    return sinc * cooker__bessel_i0(alpha * sqrtf(1 - t * t)) / cooker__bessel_i0(alpha);
+}
+
+typedef struct cooker__taps {
+    int first, count;
+    float w[16];
+} cooker__taps;
+
+// separable filter taps of a src->dst axis. edges are clamped
+static void cooker__mip_taps(int src, int dst, int kaiser, cooker__taps *taps) {
+    float ratio = src / (float)dst, radius = kaiser ? 2 : 0.5f;
+    for( int x = 0; x < dst; ++x ) {
+        float center = (x + 0.5f) * ratio, sum = 0;
+        int first = (int)floorf(center - radius * ratio), last = (int)ceilf(center + radius * ratio);
+        cooker__taps *t = &taps[x];
+        t->first = first, t->count = mini(last - first + 1, 16);
+        for( int i = 0; i < t->count; ++i ) {
+            sum += t->w[i] = cooker__mip_weight((first + i + 0.5f - center) / ratio, kaiser);
+        }
+        for( int i = 0; i < t->count; ++i ) t->w[i] /= sum ? sum : 1;
+    }
+}
+
+// downsamples a float rgba level into the next one
+static void cooker__mip_filter(const float *src, int w, int h, float *dst, int dw, int dh, int kaiser) {
+    cooker__taps *tx = REALLOC(0, sizeof(cooker__taps) * dw), *ty = REALLOC(0, sizeof(cooker__taps) * dh);
+    cooker__mip_taps(w, dw, kaiser, tx);
+    cooker__mip_taps(h, dh, kaiser, ty);
+    float *tmp = REALLOC(0, sizeof(float) * 4 * dw * h);
+
+    int y;
+    #pragma omp parallel for
+    for( y = 0; y < h; ++y ) {
+        for( int x = 0; x < dw; ++x ) {
+            float acc[4] = {0};
+            for( int i = 0; i < tx[x].count; ++i ) {
+                const float *p = &src[(maxi(mini(tx[x].first + i, w - 1), 0) + y * w) * 4];
+                for( int c = 0; c < 4; ++c ) acc[c] += p[c] * tx[x].w[i];
+            }
+            memcpy(&tmp[(x + y * dw) * 4], acc, sizeof(acc));
+        }
+    }
+    #pragma omp parallel for
+    for( y = 0; y < dh; ++y ) {
+        for( int x = 0; x < dw; ++x ) {
+            float acc[4] = {0};
+            for( int i = 0; i < ty[y].count; ++i ) {
+                const float *p = &tmp[(x + maxi(mini(ty[y].first + i, h - 1), 0) * dw) * 4];
+                for( int c = 0; c < 4; ++c ) acc[c] += p[c] * ty[y].w[i];
+            }
+            memcpy(&dst[(x + y * dw) * 4], acc, sizeof(acc));
+        }
+    }
+
+    FREE(tmp);
+    FREE(ty);
+    FREE(tx);
+}
+
+// fraction of texels passing the alpha test once alpha is scaled
+static float cooker__coverage(const float *rgba, int count, float scale, float ref) {
+    int passed = 0;
+    for( int i = 0; i < count; ++i ) passed += rgba[i * 4 + 3] * scale >= ref;
+    return passed / (float)count;
+}
+
+static float *cooker__mip_load(const image_t *img, int srgb) { // rgba8 -> float rgba, linear if srgb
+    float *level = REALLOC(0, sizeof(float) * 4 * img->w * img->h);
+    for( int i = 0; i < img->w * img->h * 4; ++i ) {
+        uint8_t v = img->pixels8[i];
+        level[i] = srgb && (i & 3) != 3 ? cooker__srgb_linear[v] : v / 255.f;
+    }
+    return level;
+}
+
+static void cooker__mip_renormalize(float *level, int count) {
+    for( int i = 0; i < count; ++i ) {
+        float *p = &level[i * 4];
+        vec3 n = vec3(p[0] * 2 - 1, p[1] * 2 - 1, p[2] * 2 - 1);
+        n = len3(n) > 1e-6f ? norm3(n) : vec3(0,0,1);
+        p[0] = n.x * 0.5f + 0.5f, p[1] = n.y * 0.5f + 0.5f, p[2] = n.z * 0.5f + 0.5f;
+    }
+}
+
+// alpha scale so a level passes the alpha test as often as level 0 did
+static float cooker__mip_coverage(const float *level, int count, float coverage, float ref) {
+    float lo = 0, hi = 4;
+    for( int it = 0; it < 12; ++it ) {
+        float scale = (lo + hi) / 2;
+        if( cooker__coverage(level, count, scale, ref) < coverage ) lo = scale; else hi = scale;
+    }
+    float above = cooker__coverage(level, count, hi, ref), below = cooker__coverage(level, count, lo, ref);
+    return above - coverage < coverage - below ? hi : lo; // coverage is a step function: take the closest side
+}
+
+static void cooker__mip_store(const float *level, int w, int h, float scale, int srgb, image_t *dst) { // float rgba -> rgba8
+    memset(dst, 0, sizeof(image_t));
+    dst->w = w, dst->h = h, dst->n = 4;
+    dst->pixels = REALLOC(0, w * h * 4);
+    for( int i = 0; i < w * h * 4; ++i ) {
+        /**/ if( (i & 3) == 3 ) dst->pixels8[i] = (uint8_t)(clampf(level[i] * scale, 0, 1) * 255 + 0.5f);
+        else if( srgb ) dst->pixels8[i] = cooker__linear_srgb[(int)(clampf(level[i], 0, 1) * 16383 + 0.5f)];
+        else dst->pixels8[i] = (uint8_t)(clampf(level[i], 0, 1) * 255 + 0.5f);
+    }
+}
+
+// builds the full mip chain of a rgba8 image down to 1x1, level 0 included. returns the level count
+static
+int cooker__mips(const image_t *img, cooker__mip_options opt, image_t **levels) {
+    cooker__srgb_tables();
+
+    int srgb = opt.srgb && !opt.normalmap, count = 1;
+    for( unsigned w = img->w, h = img->h; w > 1 || h > 1; w = maxi(w / 2, 1), h = maxi(h / 2, 1) ) ++count;
+    image_t *out = *levels = REALLOC(0, sizeof(image_t) * count);
+
+    int w = img->w, h = img->h;
+    float *level = cooker__mip_load(img, srgb);
+    float ref = opt.coverage / 255.f, coverage = ref ? cooker__coverage(level, w * h, 1, ref) : 0;
+
+    for( int l = 0; l < count; ++l ) {
+        if( l ) {
+            int dw = maxi(w / 2, 1), dh = maxi(h / 2, 1);
+            float *next = REALLOC(0, sizeof(float) * 4 * dw * dh);
+            cooker__mip_filter(level, w, h, next, dw, dh, opt.kaiser);
+            FREE(level);
+            level = next, w = dw, h = dh;
+            if( opt.normalmap ) cooker__mip_renormalize(level, w * h);
+        }
+        float scale = ref && l ? cooker__mip_coverage(level, w * h, coverage, ref) : 1;
+        cooker__mip_store(level, w, h, scale, srgb, &out[l]);
+    }
+
+    FREE(level);
+    return count;
+}
+
+// a single level l of that chain, same texels. the levels above it are filtered on the way down but never stored
+static
+void cooker__mip(const image_t *img, cooker__mip_options opt, int l, image_t *out) {
+    cooker__srgb_tables();
+
+    int srgb = opt.srgb && !opt.normalmap, w = img->w, h = img->h;
+    float *level = cooker__mip_load(img, srgb);
+    float ref = opt.coverage / 255.f, coverage = ref ? cooker__coverage(level, w * h, 1, ref) : 0;
+    for( int i = 0; i < l && (w > 1 || h > 1); ++i ) {
+        int dw = maxi(w / 2, 1), dh = maxi(h / 2, 1);
+        float *next = REALLOC(0, sizeof(float) * 4 * dw * dh);
+        cooker__mip_filter(level, w, h, next, dw, dh, opt.kaiser);
+        FREE(level);
+        level = next, w = dw, h = dh;
+        if( opt.normalmap ) cooker__mip_renormalize(level, w * h);
+    }
+    float scale = ref && l ? cooker__mip_coverage(level, w * h, coverage, ref) : 1;
+    cooker__mip_store(level, w, h, scale, srgb, out);
+    FREE(level);
+}
+
+// cooks an image of a .compress folder into a gpu texture container with its mip chain. prints format, ratio & throughput
+static
+bool cooker__compress_cook(const char *filename, const char *options, FILE *out) {
+    int len = 0;
+    char *data = file_load(filename, &len);
+    image_t img = image_from_mem(data, len, IMAGE_RGBA);
+    FREE(data);
+    if( !img.pixels ) return false;
+
+    char name[16] = "auto", filter[16] = "kaiser";
+    const char *found = strstr(options, "format=");
+    if( found ) sscanf(found, "format=%15[a-z0-9]", name);
+    if( (found = strstr(options, "filter=")) ) sscanf(found, "filter=%15[a-z]", filter);
+    int quality = cooker__option(options, "quality", 1);
+
+    int opaque = 1, cutout = 1;
+    for( unsigned i = 0; i < img.w * img.h; ++i ) {
+        uint8_t alpha = img.pixels8[i * 4 + 3];
+        opaque &= alpha == 255, cutout &= alpha == 0 || alpha == 255;
+    }
+
+    unsigned format = 0;
+    if( !strcmp(name, "bc1") ) format = TEXTURE_BC1;
+    if( !strcmp(name, "bc3") ) format = TEXTURE_BC3;
+    if( !strcmp(name, "bc4") ) format = TEXTURE_BC4;
+    if( !strcmp(name, "bc5") ) format = TEXTURE_BC5;
+    if( !strcmp(name, "bc7") ) format = TEXTURE_BC7;
+    if( !format && strcmp(name, "rgba8") ) {
+        format = cutout ? TEXTURE_BC1 : quality >= 2 ? TEXTURE_BC7 : TEXTURE_BC3;
+        strcpy(name, cutout ? "bc1" : quality >= 2 ? "bc7" : "bc3");
+    }
+
+    // color is srgb unless told otherwise; cutouts keep their alpha-test coverage down the chain
+    cooker__mip_options mip = {0};
+    mip.kaiser = strcmp(filter, "box") != 0;
+    mip.normalmap = cooker__option(options, "normalmap", 0);
+    mip.srgb = cooker__option(options, "srgb", !mip.normalmap && !(format & (TEXTURE_BC4|TEXTURE_BC5)));
+    mip.coverage = cooker__option(options, "coverage", cutout && !opaque ? 128 : 0);
+
+    double t0 = time_ss();
+    image_t *levels = &img;
+    int count = cooker__option(options, "mips", 1) ? cooker__mips(&img, mip, &levels) : 1;
+    double dt_mips = time_ss() - t0;
+
+    // "BCTX" header, then every level (format 0: raw rgba8 texels)
+    unsigned header[5] = { 0, format, img.w, img.h, count };
+    memcpy(header, "BCTX", 4);
+    bool ok = fwrite(header, sizeof(header), 1, out) == 1;
+    int total = 0;
+    for( int l = 0; l < count; ++l ) {
+        int bytes = levels[l].w * levels[l].h * 4;
+        char *blocks = format ? cooker__bc(&levels[l], format, quality, &bytes) : (char*)levels[l].pixels;
+        unsigned level = bytes;
+        ok = ok && fwrite(&level, 4, 1, out) == 1 && fwrite(blocks, bytes, 1, out) == 1;
+        total += bytes;
+        if( format ) FREE(blocks);
+    }
+    double dt = time_ss() - t0;
+    printf("%s: %s q%d %ux%u, %d mips (%s %.1f ms), %.0f:1, %.1f Mpixels/s\n", filename, name, quality, img.w, img.h, count, mip.kaiser ? "kaiser" : "box", dt_mips * 1000, img.w * img.h * 4.0 / total, img.w * img.h / 1e6 / (dt + !dt));
+
+    if( levels != &img ) {
+        for( int l = 0; l < count; ++l ) FREE(levels[l].pixels);
+        FREE(levels);
+    }
+    image_destroy(&img);
+    return ok;
+}
+
 // -----------------------------------------------------------------------------
 // data pipeline
 
@@ -360,7 +1202,7 @@ int fwk_cook(char *filename, const char *ext, const char header[16], FILE *in, F
     // exclude anything which is not supported
     ext = stringf("%s.", ext); // ".c" -> ".c."
     int is_supported = !!strstr(
-        ".image.jpg.jpeg.png.tga.bmp.psd.hdr.pic.pnm"
+        ".image.atlas.jpg.jpeg.png.tga.bmp.psd.hdr.pic.pnm"
         ".model.iqm.gltf.gltf2.fbx.obj.dae.blend.md3.md5.ms3d.smd.x.3ds.bvh.dxf.lwo"
         ".audio.wav.mod.xm.flac.ogg.mp1.mp3.mid"
         ".font.ttf"
@@ -374,7 +1216,10 @@ int fwk_cook(char *filename, const char *ext, const char header[16], FILE *in, F
     int must_process_audio = !!strstr(".audio.mid" ".", ext);
     int must_process_video = !!strstr(".video.mp4.ogv.avi.mkv.wmv.mpg.mpeg" ".", ext);
     int must_process_text  = !!strstr(".text.xml" ".", ext);
-    int must_process = must_process_model || must_process_audio || must_process_video || must_process_text;
+    int must_process_atlas = !!strstr(".atlas" ".", ext);
+    char *compress = cooker__atlas_image(filename) ? file_read(stringf("%s.compress", file_path(filename))) : 0;
+    int must_process_image = !!compress;
+    int must_process = must_process_model || must_process_audio || must_process_video || must_process_text || must_process_atlas || must_process_image;
 
     if( !must_process ) {
         // read -> write
@@ -389,6 +1234,17 @@ int fwk_cook(char *filename, const char *ext, const char header[16], FILE *in, F
 
         tty_color(GREEN);
 
+        if( must_process_atlas ) {
+            bool ok = cooker__atlas_cook(filename, out);
+            tty_color(ok ? GREEN : RED);
+            if( !ok ) goto failed;
+        }
+        if( must_process_image ) {
+            bool ok = cooker__compress_cook(filename, compress, out);
+            tty_color(ok ? GREEN : RED);
+            FREE(compress);
+            if( !ok ) goto failed;
+        }
         if( must_process_text ) {
             const char *infile, *outfile;
             char tempfile[16]; snprintf(tempfile, 16, ".temp%d.xml", threadid);
@@ -514,8 +1370,9 @@ int fwk_cook(char *filename, const char *ext, const char header[16], FILE *in, F
     // exclude non-compressible files (jpg,mp3,...) -> lvl 0
     // exclude also files that compress a little bit, but we better leave them raw inside zip for streaming purposes (like wavs) -> lvl 0
     // exclude also infiles whose outfiles are one of the above (mid->wav)
+    // block compressed images are not compressed yet, whatever their extension
     int level = WITH_COMPRESSOR;
-    return errno = 0, strstr(".jpg.jpeg.png.flac.ogg.mp1.mp3.mpg.mpeg.wav.mid" ".", ext) ? 0 : level;
+    return errno = 0, strstr(".jpg.jpeg.png.flac.ogg.mp1.mp3.mpg.mpeg.wav.mid" ".", ext) && !must_process_image ? 0 : level;
 
     bypass: return errno = 0, -1;
     failed: return errno = -1;
@@ -3,15 +3,13 @@
 //
 // - note: vfs_mount() order matters (last mounts have higher priority).
 // - note: directory/with/trailing/slash/ as mount_point, or zip/tar/pak archive otherwise.
-//
-// @todo: file_mmap
 
 #ifndef FILE_H
 #define FILE_H
 
 // physical filesystem. files
 
-const char** file_list(const char *masks); // **.png;*.c
+const char** file_list(const char *masks); // **.png;*.c;art/**.tga;art/**/*.tga;C:/art/*.tga (or backslashes, on windows). "**" recurses; other masks list their own folder only
 char *       file_read(const char *filename);
 char *       file_load(const char *filename, int *len);
 uint64_t     file_size(const char *pathfile);
@@ -29,25 +27,75 @@ uint64_t     file_stamp_human(const char *pathfile); // 20210319113316 (datetime
 
 bool         file_copy(const char *src, const char *dst);
 
+void *       file_mmap(const char *pathfile, uint64_t *size); // read-only. null on error
+void         file_unmap(void *ptr, uint64_t size);
+
+// directory walks: same masks as file_list(), with sizes & stamps. sorted per mask, {0} terminated
+
+typedef struct file_info {
+    char *name;
+    uint64_t size, stamp; // bytes, seconds since unix epoch
+} file_info;
+
+const file_info* file_scan(const char *masks);
+
 // @todo file_find() from first file_scan()
 
 
 // virtual filesystem
 
 bool         vfs_mount(const char *mount_point);
+int          vfs_mount_snapshot(const char *snapshot, const char **archives, int count, bool rebuild); // mounts via an index snapshot, stale once any archive stamp/size changes. rewritten then if rebuild, else ignored. returns mounted count
 
 char *       vfs_read(const char *pathfile);
-char *       vfs_load(const char *pathfile, int *size);
+char *       vfs_load(const char *pathfile, int *size); // stays valid for the whole run
+char *       vfs_acquire(const char *pathfile, int *size); // same, but refcounted: evictable once vfs_release()d
+void         vfs_release(const char *data);
 int          vfs_size(const char *pathfile);
 
 const char * vfs_resolve(const char *fuzzyname); // guess best match. @todo: fuzzy path
-const char * vfs_find(const char *pathfile); // returns filename to extracted temporary file, so it can be read by foreign/3rd party libs
-FILE*        vfs_handle(const char *pathfile); // same as above, but returns file handle instead. preferred way, will clean descriptors at exit
-
-// cache
-
-void *       cache_insert(const char *key, void *value, int size);
+const char * vfs_find(const char *pathfile); // returns filename to extracted temporary file. last resort for foreign libs that only open files; prefer vfs_load()
+FILE*        vfs_handle(const char *pathfile); // same as above, but returns file handle instead. whole file is loaded; see vfs_open() to stream
+
+// streaming: stored entries are read in place, deflated ones inflated through a small window.
+// - note: memory per open file is bounded (~64 KiB) regardless of entry size.
+// - note: named vfs_fread() because vfs_read() already loads whole files.
+
+typedef struct vfs_file vfs_file;
+
+vfs_file *   vfs_open(const char *pathfile); // null if not found
+int          vfs_fread(vfs_file *fp, void *buf, int len); // returns bytes read, 0 at end of file
+int          vfs_seek(vfs_file *fp, int offset, int whence); // SEEK_SET/CUR/END. returns 0 on success
+int          vfs_tell(vfs_file *fp);
+int          vfs_fsize(vfs_file *fp);
+void         vfs_close(vfs_file *fp);
+
+// async: entries are read & decoded by i/o threads, highest priority first. callbacks run on the main
+// thread, from vfs_async_update() (called by window_swap()), vfs_async_poll() or vfs_async_wait().
+// - note: call these from the main thread. callback data is valid during the callback; cache_acquire() it to keep it.
+// - note: vfs_async_wait() data stays valid for the whole run, same as vfs_load().
+// - note: handles are valid until their callback fires. stale handles poll as -1.
+
+enum { VFS_QUEUED, VFS_LOADING, VFS_LOADED, VFS_FAILED, VFS_CANCELLED };
+typedef void (*vfs_callback)(const char *pathfile, char *data, int size, void *user); // data is null on failure
+
+int          vfs_load_async(const char *pathfile, int priority, vfs_callback cb, void *user); // returns handle
+int          vfs_async_poll(int handle); // returns VFS_QUEUED..VFS_CANCELLED, or -1
+char *       vfs_async_wait(int handle, int *size); // blocks until loaded, bumping priority first
+bool         vfs_async_cancel(int handle); // true if request was dropped before being read
+void         vfs_async_priority(int handle, int priority); // eg, bump assets needed this frame
+void         vfs_async_update(void); // fires pending callbacks
+
+// cache: byte-budgeted, immutable blobs shared without copies. least recently used are evicted first (clock).
+// - note: vfs_load() pins its blobs. loaders that decode & drop their data use vfs_acquire() so the budget applies.
+// - note: thread-safe. cache_lookup() pointers are only safe while nothing evicts: acquire them when other threads insert.
+
+void *       cache_insert(const char *key, void *value, int size); // takes ownership of a REALLOC()ed value. returns cached blob
 void *       cache_lookup(const char *key, int *size);
+void *       cache_acquire(void *blob); // refcount++. acquired blobs are never evicted
+void         cache_release(void *blob); // refcount--
+void         cache_pin(void *blob, bool pinned); // pinned blobs are never evicted
+void         cache_budget(uint64_t bytes);
 
 #endif // FILE_H
 
@@ -56,6 +104,12 @@ void *       cache_lookup(const char *key, int *size);
 #ifdef FILE_C
 #pragma once
 
+#if !is(win32)
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#endif
+
 // -----------------------------------------------------------------------------
 // file
 
@@ -195,36 +249,177 @@ char *ext = strrchr(base, '.'); //if (ext) ext[0] = '\0'; // remove all extensio
     }
     return stringf("%s", buffer);
 }
+// directory walker: workers pop folders from a shared stack, push back subfolders and collect
+// matching files. one readdir per folder; only matching files are stat'ed, and only for file_scan().
+
+#ifndef FILE_SCAN_THREADS
+#define FILE_SCAN_THREADS 8
+#endif
+
+struct file_walk {
+    const char *pattern;
+    int recurse, stats, busy;
+    thread_mutex_t lock;
+    thread_signal_t work; // raised when folders get pushed, or the walk ends
+    array(char*) folders; // pending
+    array(file_info) found;
+};
+
+static bool file_glob(const char *pattern, const char *name) { // case insensitive. '*' any run, '?' any char
+    const char *star = 0, *resume = 0;
+    while( *name ) {
+        if( *pattern == '*' ) { while( *pattern == '*' ) ++pattern; star = pattern, resume = name; continue; }
+        if( *pattern == '?' || tolower(*pattern) == tolower(*name) ) { ++pattern, ++name; continue; }
+        if( !star ) return 0;
+        pattern = star, name = ++resume;
+    }
+    while( *pattern == '*' ) ++pattern;
+    return !*pattern;
+}
+
+static char *file_join(const char *folder, const char *name, const char *suffix) {
+    int f = strlen(folder), n = strlen(name), s = strlen(suffix);
+    char *path = REALLOC(0, f + n + s + 1);
+    memcpy(path, folder, f), memcpy(path + f, name, n), memcpy(path + f + n, suffix, s + 1);
+    return path;
+}
+
+static void file_walk_folder(struct file_walk *w, const char *folder, array(file_info) *found, array(char*) *subfolders) {
+#if is(win32)
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileExA(stringf("%s*", *folder ? folder : "./"), FindExInfoBasic, &fd, FindExSearchNameMatch, 0, FIND_FIRST_EX_LARGE_FETCH);
+    for( int next = h != INVALID_HANDLE_VALUE; next; next = FindNextFileA(h, &fd) ) {
+        if( !strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, "..") ) continue;
+        if( fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT ) continue; // links are neither files nor folders, as in find -type f
+        if( fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) {
+            if( w->recurse ) array_push(*subfolders, file_join(folder, fd.cFileName, "/"));
+        } else if( file_glob(w->pattern, fd.cFileName) ) {
+            uint64_t ft = ((uint64_t)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+            uint64_t size = ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+            array_push(*found, ((file_info){ file_join(folder, fd.cFileName, ""), size, ft / 10000000ULL - 11644473600ULL }));
+        }
+    }
+    if( h != INVALID_HANDLE_VALUE ) FindClose(h);
+#else
+    DIR *dir = opendir(*folder ? folder : ".");
+    for( struct dirent *ep; dir && (ep = readdir(dir)); ) {
+        if( !strcmp(ep->d_name, ".") || !strcmp(ep->d_name, "..") ) continue;
+        int type = ep->d_type, match = type != DT_DIR && file_glob(w->pattern, ep->d_name);
+        struct stat st = {0};
+        if( type == DT_UNKNOWN || (match && w->stats) ) {
+            if( fstatat(dirfd(dir), ep->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0 ) continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+        }
+        if( type == DT_REG && match ) array_push(*found, ((file_info){ file_join(folder, ep->d_name, ""), st.st_size, st.st_mtime }));
+        if( type == DT_DIR && w->recurse ) array_push(*subfolders, file_join(folder, ep->d_name, "/"));
+    }
+    if( dir ) closedir(dir);
+#endif
+}
+
+static int file_walk_thread(void *arg) {
+    struct file_walk *w = arg;
+    array(file_info) found = 0;
+    array(char*) subfolders = 0;
+    for( ;; ) {
+        thread_mutex_lock(&w->lock);
+        char *folder = array_count(w->folders) ? *array_back(w->folders) : 0;
+        if( folder ) array_pop(w->folders), ++w->busy;
+        int done = !folder && !w->busy, more = array_count(w->folders); // done: nothing pending, and nobody can push more
+        thread_mutex_unlock(&w->lock);
+        if( done ) { thread_signal_raise(&w->work); break; } // wakes a sibling, which sees it too
+        if( !folder ) { thread_signal_wait(&w->work, THREAD_SIGNAL_WAIT_INFINITE); continue; }
+        if( more ) thread_signal_raise(&w->work); // wake next sibling
+
+        file_walk_folder(w, folder, &found, &subfolders);
+        FREE(folder);
+
+        thread_mutex_lock(&w->lock);
+        for( int i = 0; i < array_count(subfolders); ++i ) array_push(w->folders, subfolders[i]);
+        int wake = array_count(subfolders) || w->busy == 1; // new work, or walk over
+        --w->busy;
+        thread_mutex_unlock(&w->lock);
+        if( wake ) thread_signal_raise(&w->work);
+        array_resize(subfolders, 0);
+    }
+
+    thread_mutex_lock(&w->lock);
+    for( int i = 0; i < array_count(found); ++i ) array_push(w->found, found[i]);
+    thread_mutex_unlock(&w->lock);
+    array_free(found);
+    array_free(subfolders);
+    return 0;
+}
+
+static int file_info_qsort(const void *a, const void *b) {
+    return strcmp(((const file_info*)a)->name, ((const file_info*)b)->name);
+}
+
+static const file_info* file_walk(const char *masks, bool stats) {
+    static local array(file_info) list = 0;
+
+    for( int i = 0; i < array_count(list); ++i ) {
+        FREE(list[i].name);
+    }
+    array_free(list);
+
+    for each_substring(masks,";",it) {
+        // art/**.png -> folder "art/", pattern "**.png" (recursive). art/**/*.png -> folder "art/", pattern "*.png" (recursive)
+        char *mask = STRDUP(it);
+#if is(win32)
+        for( char *c = mask; *c; ++c ) if( *c == '\\' ) *c = '/';
+#endif
+        char *slash = strrchr(mask, '/'), *stars = strstr(mask, "**"), *pattern = slash ? slash + 1 : mask;
+        if( stars && stars < pattern ) { // "**" in a folder: walk from the one above
+            while( stars > mask && stars[-1] != '/' ) --stars;
+            slash = stars > mask ? stars - 1 : 0;
+        }
+        char *folder = slash ? stringf("%.*s/", (int)(slash - mask), mask) : "";
+        while( folder[0] == '.' && folder[1] == '/' ) folder += 2;
+        struct file_walk w = { pattern, !!stars, stats };
+        thread_mutex_init(&w.lock);
+        thread_signal_init(&w.work);
+        array_push(w.folders, STRDUP(folder));
+
+        // walk sequentially until the tree fans out, then in parallel. flat folders never spawn threads
+        while( array_count(w.folders) && array_count(w.folders) < 2 ) {
+            char *next = *array_back(w.folders);
+            array_pop(w.folders);
+            file_walk_folder(&w, next, &w.found, &w.folders);
+            FREE(next);
+        }
+        int workers = array_count(w.folders) ? mini(FILE_SCAN_THREADS, cpu_cores()) : 0;
+        if( workers == 1 ) file_walk_thread(&w), workers = 0;
+        thread_ptr_t threads[FILE_SCAN_THREADS];
+        for( int i = 0; i < workers; ++i ) threads[i] = thread_create(file_walk_thread, &w, "file_walk_thread()", 0);
+        for( int i = 0; i < workers; ++i ) thread_join(threads[i]), thread_destroy(threads[i]);
+        thread_signal_term(&w.work);
+        thread_mutex_term(&w.lock);
+        FREE(mask);
+
+        if( array_count(w.found) ) qsort(w.found, array_count(w.found), sizeof(file_info), file_info_qsort);
+        for( int i = 0; i < array_count(w.found); ++i ) array_push(list, w.found[i]);
+        array_free(w.found);
+        array_free(w.folders);
+    }
+    array_push(list, ((file_info){0})); // terminator
+    return list;
+}
+
+const file_info* file_scan(const char *masks) {
+    return file_walk(masks, 1);
+}
+
 const char** file_list(const char *masks) {
     static local array(char*) list = 0;
-    const char *arg0 = app_path();
-    int larg0 = strlen(arg0);
 
     for( int i = 0; i < array_count(list); ++i ) {
         FREE(list[i]);
     }
     array_free(list);
 
-    for each_substring(masks,";",it) {
-        int recurse = !!strstr(it, "**");
-        #if is(win32)
-        char *glob = stringf("dir %s /b/o:n %s", recurse ? "/s":"", it);
-        #else
-        char *glob = stringf("find ./ -type f \\( -iname \\%s \\) | sort", it); // @fixme: add non-recursive support
-        #endif
-        for( FILE *in = popen(glob, "r"); in; pclose(in), in = 0) {
-            char buf[1024], *line = buf;
-            while( fgets(buf, sizeof(buf), in) ) {
-                // clean up
-                if( strstr(line, arg0) ) line = buf + larg0;
-                if( !memcmp(line, "./", 2) ) line += 2;
-                int len = strlen(line); while( len > 0 && line[len-1] < 32 ) line[--len] = 0;
-                for(int i = 0; i < len; ++i ) if(line[i] == '\\') line[i] = '/';
-                // insert copy
-                char *copy = STRDUP(line);
-                array_push(list, copy);
-            }
-        }
+    for( const file_info *it = file_walk(masks, 0); it->name; ++it ) { // names only: no stat calls
+        array_push(list, STRDUP(it->name));
     }
     array_push(list, 0); // terminator
     return list;
@@ -244,6 +439,35 @@ bool file_copy(const char *src, const char *dst) {
     return ok;
 }
 
+void *file_mmap(const char *pathfile, uint64_t *size) {
+    void *ptr = 0;
+#if is(win32)
+    HANDLE fh = CreateFileA(pathfile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if( fh == INVALID_HANDLE_VALUE ) return 0;
+    LARGE_INTEGER len = {0}; GetFileSizeEx(fh, &len);
+    HANDLE mh = len.QuadPart ? CreateFileMappingA(fh, 0, PAGE_READONLY, 0, 0, 0) : 0;
+    if( mh ) ptr = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0), CloseHandle(mh); // view keeps mapping alive
+    CloseHandle(fh);
+    if( ptr && size ) *size = len.QuadPart;
+#else
+    int fd = open(pathfile, O_RDONLY);
+    if( fd < 0 ) return 0;
+    struct stat st;
+    if( !fstat(fd, &st) && st.st_size > 0 ) ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // mapping keeps file alive
+    if( ptr == MAP_FAILED ) ptr = 0;
+    if( ptr && size ) *size = st.st_size;
+#endif
+    return ptr;
+}
+void file_unmap(void *ptr, uint64_t size) {
+#if is(win32)
+    if( ptr ) UnmapViewOfFile(ptr);
+#else
+    if( ptr ) munmap(ptr, size);
+#endif
+}
+
 // -----------------------------------------------------------------------------
 // archives
 
@@ -251,42 +475,111 @@ enum { is_zip, is_tar, is_pak, is_dir };
 
 typedef struct archive_dir {
     char* path;
-    union {
-        int type;
-        int size; // for cache only
-    };
+    char* filename; // archive file. snapshot mounts open it on first use only
+    int type;
     union {
         void *archive;
-        void *data; // for cache only
         zip* zip_archive;
         tar* tar_archive;
         pak* pak_archive;
     };
+    char *map; // whole archive, if mapped
+    uint64_t map_size;
+    int latency; // debug: simulated slow storage, in ms per extracted entry
     struct archive_dir *next;
 } archive_dir;
 
 static archive_dir *dir_mount;
-static archive_dir *dir_cache; enum { MAX_CACHED_FILES = 16 }; // @todo: should we cache the cooked contents instead? ie, stbi() result instead of file.png?
 
 struct vfs_entry {
     const char *name;
     const char *id;
     unsigned size;
+    archive_dir *dir; // mounted archive
+    unsigned index;   // entry index within archive
+    unsigned offset;  // entry data within archive
+    unsigned packed;  // compressed size
+    unsigned codec;   // zip compression method, or 0
 };
 array(struct vfs_entry) vfs_entries;
+static int vfs_mounts;
+
+// vfs index: radix trie over entry ids where every node tracks the latest entry below it,
+// so "begins with" lookups cost O(len) and later mounts still win. exact ids hash to their node.
+
+typedef struct vfs_node {
+    const char *label; // edge label, points into a vfs_entries[].id
+    int len, child, next, best;
+} vfs_node;
+
+static array(vfs_node) vfs_trie;
+static map(char*, int) vfs_ids;
+
+static void vfs_index_add(const char *id, int entry) {
+    if( !vfs_ids ) map_init(vfs_ids, less_str, hash_str);
+    if( !vfs_trie ) array_push(vfs_trie, ((vfs_node){ "", 0, -1, -1, -1 }));
+
+    int node = 0;
+    for( const char *s = id; ; ) {
+        vfs_trie[node].best = entry; // entries are appended in mount order
+        if( !*s ) break;
+
+        int prev = -1, c = vfs_trie[node].child;
+        while( c >= 0 && vfs_trie[c].label[0] != *s ) prev = c, c = vfs_trie[c].next;
+        if( c < 0 ) { // new leaf
+            int leaf = array_count(vfs_trie);
+            array_push(vfs_trie, ((vfs_node){ s, strlen(s), -1, vfs_trie[node].child, entry }));
+            vfs_trie[node].child = leaf;
+            node = leaf;
+            break;
+        }
 
-bool vfs_mount(const char *path) {
-    zip *z = NULL; tar *t = NULL; pak *p = NULL;
-    int is_folder = ('/' == path[strlen(path)-1]);
-    if( !is_folder ) z = zip_open(path, "rb");
-    if( !is_folder && !z ) t = tar_open(path, "rb");
-    if( !is_folder && !z && !t ) p = pak_open(path, "rb");
-    if( !is_folder && !z && !t && !p ) return 0;
+        int common = 0;
+        while( common < vfs_trie[c].len && s[common] == vfs_trie[c].label[common] ) ++common;
+        if( common < vfs_trie[c].len ) { // split edge
+            int split = array_count(vfs_trie);
+            array_push(vfs_trie, ((vfs_node){ vfs_trie[c].label, common, c, vfs_trie[c].next, entry }));
+            vfs_trie[c].label += common, vfs_trie[c].len -= common, vfs_trie[c].next = -1;
+            if( prev >= 0 ) vfs_trie[prev].next = split; else vfs_trie[node].child = split;
+            c = split;
+        }
+        node = c, s += common;
+    }
+
+    if( !map_find(vfs_ids, (char*)id) ) map_insert(vfs_ids, (char*)id, node);
+}
+
+static int vfs_index_find(const char *id) { // latest entry whose id begins with given id, or -1
+    if( !vfs_trie ) return -1;
+
+    int *exact = map_find(vfs_ids, (char*)id);
+    if( exact ) return vfs_trie[*exact].best;
+
+    int node = 0;
+    for( const char *s = id; *s; ) {
+        int c = vfs_trie[node].child;
+        while( c >= 0 && vfs_trie[c].label[0] != *s ) c = vfs_trie[c].next;
+        if( c < 0 ) return -1;
+
+        int common = 0;
+        while( common < vfs_trie[c].len && s[common] == vfs_trie[c].label[common] ) ++common;
+        if( !s[common] ) return vfs_trie[c].best; // id ends within this edge
+        if( common < vfs_trie[c].len ) return -1;
+        node = c, s += common;
+    }
+    return vfs_trie[node].best;
+}
+
+static archive_dir *vfs_mount_dir(const char *path, int type, void *archive) {
+    // map archives once. stored entries are read in place, compressed ones decoded from the mapping
+    uint64_t map_size = 0;
+    char *map = type == is_dir ? 0 : file_mmap(path, &map_size);
+    char *filename = STRDUP(path);
 
     // normalize input -> "././" to ""
     while (path[0] == '.' && path[1] == '/') path += 2;
     path = STRDUP(path);
-    if( z || t || p ) {
+    if( type != is_dir ) {
     // save local path for archives, so we can subtract those from upcoming requests
     if(strrchr(path,'/')) strrchr(path,'/')[1] = '\0';
     }
@@ -296,9 +589,24 @@ bool vfs_mount(const char *path) {
     *(dir_mount = REALLOC(0, sizeof(archive_dir))) = zero;
     dir_mount->next = prev;
     dir_mount->path = (char*)path;
-    dir_mount->archive = z ? (void*)z : t ? (void*)t : (void*)p;
-    dir_mount->type = is_folder ? is_dir : z ? is_zip : t ? is_tar : p ? is_pak : -1;
+    dir_mount->filename = filename;
+    dir_mount->archive = archive;
+    dir_mount->type = type;
+    dir_mount->map = map;
+    dir_mount->map_size = map_size;
     ASSERT(dir_mount->type >= 0 && dir_mount->type < 4);
+    return dir_mount;
+}
+
+bool vfs_mount(const char *path) {
+    zip *z = NULL; tar *t = NULL; pak *p = NULL;
+    int is_folder = ('/' == path[strlen(path)-1]);
+    if( !is_folder ) z = zip_open(path, "rb");
+    if( !is_folder && !z ) t = tar_open(path, "rb");
+    if( !is_folder && !z && !t ) p = pak_open(path, "rb");
+    if( !is_folder && !z && !t && !p ) return 0;
+
+    vfs_mount_dir(path, is_folder ? is_dir : z ? is_zip : t ? is_tar : is_pak, z ? (void*)z : t ? (void*)t : (void*)p);
 
     // append list of files to internal listing
     for( archive_dir *dir = dir_mount; dir ; dir = 0 ) { // for(archive_dir *dir = dir_mount; dir; dir = dir->next) {
@@ -306,21 +614,207 @@ bool vfs_mount(const char *path) {
         unsigned (*fn_count[4])(void*) = {zip_count, tar_count, pak_count, dir_count};
         char*    (*fn_name[4])(void*, unsigned index) = {zip_name, tar_name, pak_name, dir_name};
         unsigned (*fn_size[4])(void*, unsigned index) = {zip_size, tar_size, pak_size, dir_size};
+        unsigned (*fn_offset[3])(void*, unsigned index) = {zip_offset, tar_offset, pak_offset};
 
         for( unsigned idx = 0, end = fn_count[dir->type](dir->archive); idx < end; ++idx ) {
             assert(idx < end);
             const char *filename = STRDUP( fn_name[dir->type](dir->archive, idx) );
             const char *fileid = STRDUP( file_id(filename) );
             unsigned filesize = fn_size[dir->type](dir->archive, idx);
+            unsigned offset = dir->type == is_dir ? 0 : fn_offset[dir->type](dir->archive, idx);
+            unsigned packed = dir->type == is_zip ? dir->zip_archive->entries[idx].header.compressedSize : filesize;
+            unsigned codec = dir->type == is_zip ? dir->zip_archive->entries[idx].header.compressionMethod : 0;
             // printf("%u) %s %u [%s]\n", idx, filename, filesize, fileid);
             // append to list
-            array_push(vfs_entries, (struct vfs_entry){filename, fileid, filesize});
+            array_push(vfs_entries, (struct vfs_entry){filename, fileid, filesize, dir, idx, offset, packed, codec});
+            vfs_index_add(fileid, array_count(vfs_entries) - 1);
         }
     }
 
+    ++vfs_mounts;
     return 1;
 }
 
+// index snapshot: entries & trie of a set of archives, saved after mounting them and mapped on next
+// boots while every archive keeps its stamp & size. no zip parsing, name copies or file_id() then.
+// strings are offsets into a trailing blob. archives are opened lazily, only if they cannot be mapped.
+// snapshots are files on disk like any other: every offset & index is checked before use.
+
+struct vfs_snapshot_header { char magic[8]; uint32_t archives, entries, nodes, blob; };
+struct vfs_snapshot_archive { uint64_t stamp, size; uint32_t name; int32_t type; }; // type -1 if missing
+struct vfs_snapshot_entry { uint32_t name, id, size, archive, index, offset, packed, codec; };
+struct vfs_snapshot_node { uint32_t label; int32_t len, child, next, best; };
+
+static const char vfs_snapshot_magic[8] = "FWKVFS2";
+
+static uint64_t vfs_snapshot_stamp(const char *pathfile) { // mtime, in the finest unit the os keeps, mixed with the archive tail
+    uint64_t stamp = 0;
+#if defined _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA fa;
+    if( GetFileAttributesExA(pathfile, GetFileExInfoStandard, &fa) ) stamp = ((uint64_t)fa.ftLastWriteTime.dwHighDateTime << 32) | fa.ftLastWriteTime.dwLowDateTime; // 100ns ticks
+#elif defined __APPLE__
+    struct stat st;
+    if( stat(pathfile, &st) == 0 ) stamp = st.st_mtimespec.tv_sec * 1000000000ull + st.st_mtimespec.tv_nsec;
+#else
+    struct stat st;
+    if( stat(pathfile, &st) == 0 ) stamp = st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+#endif
+    // coarse clocks (fat, network shares) miss rewrites within a tick. zips keep their directory & crcs at the end: hash it too
+    enum { TAIL = 64 * 1024 };
+    FILE *fp = fopen(pathfile, "rb");
+    if( fp ) {
+        unsigned char *tail = REALLOC(0, TAIL);
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, size > TAIL ? size - TAIL : 0, SEEK_SET);
+        size_t len = fread(tail, 1, TAIL, fp);
+        for( size_t i = 0; i < len; ++i ) stamp = (stamp ^ tail[i]) * 0x100000001B3ull; // fnv-1a
+        FREE(tail);
+        fclose(fp);
+    }
+    return stamp;
+}
+
+static uint32_t vfs_snapshot_str(char **blob, const char *str, int len) { // appends to blob, returns offset
+    uint32_t at = array_count(*blob);
+    array_resize(*blob, at + len + 1);
+    memcpy(*blob + at, str, len), (*blob)[at + len] = '\0';
+    return at;
+}
+
+static bool vfs_snapshot_save(const char *snapshot, const char **archives, int count, archive_dir **dirs) {
+    for( int i = 0; i < count; ++i ) if( dirs[i] && dirs[i]->type == is_dir ) return 0; // folder contents are not fingerprinted
+    array(char) blob = 0;
+    struct vfs_snapshot_header h = { {0}, count, array_count(vfs_entries), array_count(vfs_trie), 0 };
+    memcpy(h.magic, vfs_snapshot_magic, 8);
+    array(struct vfs_snapshot_archive) a = 0;
+    array(struct vfs_snapshot_entry) e = 0;
+    array(struct vfs_snapshot_node) n = 0;
+
+    for( int i = 0; i < count; ++i ) {
+        uint32_t name = vfs_snapshot_str(&blob, archives[i], strlen(archives[i]));
+        array_push(a, ((struct vfs_snapshot_archive){ vfs_snapshot_stamp(archives[i]), file_size(archives[i]), name, dirs[i] ? dirs[i]->type : -1 }));
+    }
+    for( int i = 0; i < array_count(vfs_entries); ++i ) {
+        struct vfs_entry *v = &vfs_entries[i];
+        int archive = 0; while( dirs[archive] != v->dir ) ++archive;
+        uint32_t name = vfs_snapshot_str(&blob, v->name, strlen(v->name)), id = vfs_snapshot_str(&blob, v->id, strlen(v->id));
+        array_push(e, ((struct vfs_snapshot_entry){ name, id, v->size, archive, v->index, v->offset, v->packed, v->codec }));
+    }
+    for( int i = 0; i < array_count(vfs_trie); ++i ) {
+        vfs_node *v = &vfs_trie[i];
+        uint32_t label = vfs_snapshot_str(&blob, v->label, v->len);
+        array_push(n, ((struct vfs_snapshot_node){ label, v->len, v->child, v->next, v->best }));
+    }
+    h.blob = array_count(blob);
+
+    FILE *fp = fopen(snapshot, "wb");
+    bool ok = fp && fwrite(&h, sizeof(h), 1, fp) == 1;
+    ok = ok && (!a || fwrite(a, sizeof(a[0]), array_count(a), fp) == array_count(a));
+    ok = ok && (!e || fwrite(e, sizeof(e[0]), array_count(e), fp) == array_count(e));
+    ok = ok && (!n || fwrite(n, sizeof(n[0]), array_count(n), fp) == array_count(n));
+    ok = ok && (!blob || fwrite(blob, 1, array_count(blob), fp) == array_count(blob));
+    if( fp ) fclose(fp);
+    if( !ok ) unlink(snapshot);
+
+    array_free(a), array_free(e), array_free(n), array_free(blob);
+    return ok;
+}
+
+static int vfs_snapshot_load(char *map, uint64_t len, const char **archives, int count) { // mounted count, or -1 if stale
+    struct vfs_snapshot_header *h = (struct vfs_snapshot_header *)map;
+    if( len < sizeof(*h) || memcmp(h->magic, vfs_snapshot_magic, 8) || h->archives != count ) return -1;
+    uint64_t expected = sizeof(*h) + h->archives * sizeof(struct vfs_snapshot_archive) + h->entries * sizeof(struct vfs_snapshot_entry)
+        + h->nodes * sizeof(struct vfs_snapshot_node) + h->blob;
+    if( len != expected ) return -1;
+
+    struct vfs_snapshot_archive *a = (struct vfs_snapshot_archive *)(h + 1);
+    struct vfs_snapshot_entry *e = (struct vfs_snapshot_entry *)(a + h->archives);
+    struct vfs_snapshot_node *n = (struct vfs_snapshot_node *)(e + h->entries);
+    char *blob = (char *)(n + h->nodes);
+
+    // every string is terminated inside the blob, every index in range
+    if( h->blob && blob[h->blob - 1] ) return -1;
+    for( int i = 0; i < count; ++i ) {
+        if( a[i].name >= h->blob || a[i].type < -1 || a[i].type >= is_dir ) return -1; // folders are never snapshotted
+    }
+    for( int i = 0; i < h->entries; ++i ) {
+        if( e[i].name >= h->blob || e[i].id >= h->blob || e[i].archive >= count || a[e[i].archive].type < 0 ) return -1;
+    }
+    for( int i = 0; i < h->nodes; ++i ) {
+        if( n[i].label >= h->blob || n[i].len < 0 || (uint32_t)n[i].len > h->blob - n[i].label ) return -1;
+        if( n[i].child < -1 || n[i].child >= (int)h->nodes || n[i].next < -1 || n[i].next >= (int)h->nodes ) return -1;
+        if( n[i].best < -1 || n[i].best >= (int)h->entries ) return -1;
+    }
+
+    // fingerprints: same archives, unchanged on disk
+    for( int i = 0; i < count; ++i ) {
+        if( strcmp(blob + a[i].name, archives[i]) ) return -1;
+        if( a[i].type < 0 ? file_size(archives[i]) != 0 : file_size(archives[i]) != a[i].size || vfs_snapshot_stamp(archives[i]) != a[i].stamp ) return -1;
+    }
+
+    archive_dir **dirs = REALLOC(0, count * sizeof(archive_dir*));
+    int mounted = 0;
+    for( int i = 0; i < count; ++i ) {
+        dirs[i] = a[i].type < 0 ? 0 : vfs_mount_dir(archives[i], a[i].type, NULL);
+        mounted += !!dirs[i];
+    }
+
+    if( h->entries ) array_resize(vfs_entries, h->entries);
+    for( int i = 0; i < h->entries; ++i ) {
+        vfs_entries[i] = ((struct vfs_entry){ blob + e[i].name, blob + e[i].id, e[i].size, dirs[e[i].archive], e[i].index, e[i].offset, e[i].packed, e[i].codec });
+    }
+    if( h->nodes ) array_resize(vfs_trie, h->nodes);
+    for( int i = 0; i < h->nodes; ++i ) {
+        vfs_trie[i] = ((vfs_node){ blob + n[i].label, n[i].len, n[i].child, n[i].next, n[i].best });
+    }
+    if( !vfs_ids ) map_init(vfs_ids, less_str, hash_str); // exact ids fall back to walking the trie
+
+    FREE(dirs);
+    vfs_mounts += mounted;
+    return mounted;
+}
+
+int vfs_mount_snapshot(const char *snapshot, const char **archives, int count, bool rebuild) {
+    uint64_t t0 = time_ns();
+
+    // snapshots hold absolute entry & node numbers: only usable as first mounts
+    bool fresh = !array_count(vfs_entries) && !dir_mount;
+    uint64_t len = 0;
+    char *map = fresh ? file_mmap(snapshot, &len) : 0;
+    int mounted = map ? vfs_snapshot_load(map, len, archives, count) : -1; // snapshot stays mapped: entries point into it
+    if( mounted >= 0 ) {
+        PRINTF("Mounted %d archives from %s (%d entries, %.2fms)\n", mounted, snapshot, array_count(vfs_entries), (time_ns() - t0) / 1e6);
+        return mounted;
+    }
+    if( map ) file_unmap(map, len);
+
+    archive_dir **dirs = REALLOC(0, count * sizeof(archive_dir*));
+    mounted = 0;
+    for( int i = 0; i < count; ++i ) {
+        dirs[i] = vfs_mount(archives[i]) ? dir_mount : 0;
+        mounted += !!dirs[i];
+    }
+    if( fresh && rebuild ) vfs_snapshot_save(snapshot, archives, count, dirs);
+    FREE(dirs);
+
+    PRINTF("Mounted %d archives, %s %s (%d entries, %.2fms)\n", mounted, snapshot, fresh && rebuild ? "rebuilt" : "skipped", array_count(vfs_entries), (time_ns() - t0) / 1e6);
+    return mounted;
+}
+
+// archive file handles are shared by main and i/o threads. lock is created along the i/o threads
+static thread_mutex_t vfs_io_mutex, *vfs_io;
+static void vfs_lock() { if( vfs_io ) thread_mutex_lock(vfs_io); }
+static void vfs_unlock() { if( vfs_io ) thread_mutex_unlock(vfs_io); }
+
+static void *vfs_archive(archive_dir *dir) { // opens archives mounted from a snapshot on first use. call locked
+    if( !dir->archive && dir->type != is_dir ) {
+        void* (*fn_open[3])(const char *, const char *) = {zip_open, tar_open, pak_open};
+        dir->archive = fn_open[dir->type](dir->filename, "rb");
+    }
+    return dir->archive;
+}
+
 static
 char *vfs_unpack(const char *pathfile, int *size) { // must free() after use
     // @todo: add cache here
@@ -339,36 +833,81 @@ char *vfs_unpack(const char *pathfile, int *size) { // must free() after use
 
             const char* cleanup = pathfile + strbegini(pathfile, dir->path) * strlen(dir->path);
             while (cleanup[0] == '/') ++cleanup;
-            int index = fn_find[dir->type](dir->archive, cleanup);
-            data = fn_unpack[dir->type](dir->archive, index);
-            if( size ) *size = fn_size[dir->type](dir->archive, index);
+            vfs_lock();
+            void *archive = vfs_archive(dir);
+            int index = archive ? fn_find[dir->type](archive, cleanup) : -1;
+            data = index >= 0 ? fn_unpack[dir->type](archive, index) : 0;
+            if( size && data ) *size = fn_size[dir->type](archive, index);
+            vfs_unlock();
         }
         // printf("%c trying %s in %s ...\n", data ? 'Y':'N', pathfile, dir->path);
     }
-    //wait_ms(1000); // <-- simulate slow hdd
     return data;
 }
 
-const char *vfs_resolve(const char *pathfile) {
-    // we dont resolve absolute paths. they dont belong to the vfs
-    if( pathfile[0] == '/' || pathfile[0] == '\\' || pathfile[1] == ':' ) return pathfile;
+static
+char *vfs_view(const struct vfs_entry *e, int *size) { // stored entry within a mapped archive, or null
+    archive_dir *dir = e->dir;
+    if( !dir->map || e->codec || e->offset + (uint64_t)e->size > dir->map_size ) return 0;
+    if( size ) *size = e->size;
+    return dir->map + e->offset;
+}
 
-    // find best match
-    char* id = file_id(pathfile);
-    for (int i = array_count(vfs_entries); --i >= 0; ) {
-        if (strbegini(vfs_entries[i].id, id) ) {
-            return vfs_entries[i].name;
-        }
+static
+char *vfs_extract(const struct vfs_entry *e, int *size) { // must free() after use. safe on i/o threads
+    archive_dir *dir = e->dir;
+    if( dir->latency ) sleep_ms(dir->latency);
+
+    // deflated zip entries decode from the mapping
+    char *data = 0;
+    if( dir->map && (e->codec & 255) == 8 && e->offset + (uint64_t)e->packed <= dir->map_size ) {
+        unsigned flags = e->codec >> 8;
+        data = REALLOC(0, e->size + 1 + EXCESS(flags));
+        if( DECOMPRESS(dir->map + e->offset, e->packed, data, e->size, flags) ) data[e->size] = '\0';
+        else FREE(data), data = 0;
     }
 
-    return pathfile;
+    // archive file handles are shared: reads through them are serialized
+    if( !data && dir->type == is_dir ) data = vfs_unpack(e->name, size);
+    if( !data && dir->type != is_dir ) {
+        void* (*fn_unpack[3])(void *, unsigned) = {zip_extract, tar_extract, pak_extract};
+        vfs_lock();
+        void *archive = vfs_archive(dir);
+        data = archive ? fn_unpack[dir->type](archive, e->index) : 0;
+        vfs_unlock();
+    }
+    if( size ) *size = e->size;
+    return data;
 }
 
-char* vfs_load(const char *pathfile, int *size_out) { // @todo: fix leaks
-    if (!pathfile[0]) return file_load(pathfile, size_out);
-    if (pathfile[0] == '/' || pathfile[1] == ':') return file_load(pathfile, size_out);
+static int vfs_resolve_entry(const char *pathfile) { // vfs_entries[] index, or -1
+    // we dont resolve absolute paths. they dont belong to the vfs
+    if( pathfile[0] == '/' || pathfile[0] == '\\' || pathfile[1] == ':' ) return -1;
+
+    // find best match
+    return vfs_index_find(file_id(pathfile));
+}
+const char *vfs_resolve(const char *pathfile) {
+    int best = vfs_resolve_entry(pathfile);
+    return best >= 0 ? vfs_entries[best].name : pathfile;
+}
+
+// resolved paths: raw request -> cleaned vfs path & entry, so repeated loads of an asset cost
+// a single hash lookup. paths resolved before the latest vfs_mount() are resolved again.
+
+struct vfs_path {
+    char *name;  // resolved & cleaned pathfile
+    int entry;   // vfs_entries[] index, or -1
+    int mounts;  // vfs_mounts at resolve time
+};
+static map(char*, struct vfs_path) vfs_paths;
+
+static struct vfs_path *vfs_path(const char *pathfile) {
+    if( !vfs_paths ) map_init(vfs_paths, less_str, hash_str);
+    struct vfs_path *vp = map_find(vfs_paths, (char*)pathfile);
+    if( vp && vp->mounts == vfs_mounts ) return vp;
+    if( !vp ) vp = map_insert(vfs_paths, STRDUP(pathfile), ((struct vfs_path){0}));
 
-    {
     // exclude garbage from material names
     // @todo: exclude double slashs in paths
     char *base = file_name(pathfile); if(strchr(base,'+')) base = strchr(base, '+')+1;
@@ -376,54 +915,50 @@ char* vfs_load(const char *pathfile, int *size_out) { // @todo: fix leaks
     pathfile = stringf("%s%s", folder, base);
 
     // solve virtual path
-    pathfile = stringf("%s", vfs_resolve(pathfile));
-    base = file_name(pathfile);
-    folder = file_path(pathfile);
-    PRINTF("Loading VFS: (%s)%s\n", folder, base);
-    }
-
-    int size = 0;
-    void *ptr = 0;
+    int entry = vfs_resolve_entry(pathfile);
+    if( entry >= 0 ) pathfile = vfs_entries[entry].name;
+    PRINTF("Loading VFS: (%s)%s\n", file_path(pathfile), file_name(pathfile));
 
     // clean pathfile
     while (pathfile[0] == '.' && pathfile[1] == '/') pathfile += 2;
     while (pathfile[0] == '/') ++pathfile;
 
-    const char *lookup_id = /*file_normalize_with_folder*/(pathfile);
+    if( vp->name ) FREE(vp->name);
+    vp->name = STRDUP(pathfile);
+    vp->entry = entry;
+    vp->mounts = vfs_mounts;
+    return vp;
+}
 
-    // search (last item)
-    static char last_item[256] = { 0 };
-    static void *last_ptr = 0;
-    static int   last_size = 0;
-    if( !strcmpi(lookup_id, last_item)) {
-        ptr = last_ptr;
-        size = last_size;
-    }
+static void* cache_lookup_ex(const char *key, int *size, int hold);
+static void* cache_insert_ex(const char *key, void *ptr, int size, int hold);
+
+static char* vfs_load_ex(const char *pathfile, int *size_out, int hold) { // hold: cached blob is acquired (+1) or pinned (-1)
+    if (!pathfile[0]) return file_load(pathfile, size_out);
+    if (pathfile[0] == '/' || pathfile[1] == ':') return file_load(pathfile, size_out);
+
+    struct vfs_path *vp = vfs_path(pathfile);
+    pathfile = vp->name;
+
+    int size = 0;
+    void *ptr = 0;
+
+    // search (mapped archives)
+    ptr = vp->entry >= 0 ? vfs_view(&vfs_entries[vp->entry], &size) : 0;
 
     // search (cache)
     if( !ptr ) {
-        ptr = cache_lookup(lookup_id, &size);
-    }
-
-    if( ptr ) {
-        PRINTF("Hit cache %s\n", pathfile);
+        ptr = cache_lookup_ex(pathfile, &size, hold);
     }
 
     // search (mounted disks)
     if( !ptr ) {
-        ptr = vfs_unpack(pathfile, &size);
+        ptr = vp->entry >= 0 ? vfs_extract(&vfs_entries[vp->entry], &size) : vfs_unpack(pathfile, &size);
         if( ptr ) {
-            cache_insert(lookup_id, ptr, size);
+            ptr = cache_insert_ex(pathfile, ptr, size, hold);
         }
     }
 
-    if( ptr && size )
-    if( ptr != last_ptr) {
-        snprintf(last_item, 256, "%s", lookup_id);
-        last_ptr = ptr;
-        last_size = size;
-    }
-
     if(!ptr) {
         PRINTF("Loading %s (not found)\n", pathfile);
     }
@@ -431,8 +966,31 @@ char* vfs_load(const char *pathfile, int *size_out) { // @todo: fix leaks
     if( size_out ) *size_out = ptr ? size : 0;
     return ptr;
 }
-char* vfs_read(const char *pathfile) {
-    return vfs_load(pathfile, NULL);
+char* vfs_load(const char *pathfile, int *size_out) { // blob is pinned in cache, as callers may keep it forever
+    return vfs_load_ex(pathfile, size_out, -1);
+}
+char* vfs_acquire(const char *pathfile, int *size_out) {
+    return vfs_load_ex(pathfile, size_out, +1);
+}
+void vfs_release(const char *data) {
+    cache_release((void*)data);
+}
+char* vfs_read(const char *pathfile) { // null-terminated
+    int size;
+    char *data = vfs_load(pathfile, &size);
+
+    // views into mapped archives are not terminated: cache a terminated copy once
+    for( archive_dir *dir = dir_mount; data && dir; dir = dir->next ) {
+        if( data < dir->map || data >= dir->map + dir->map_size ) continue;
+        const char *key = vfs_path(pathfile)->name;
+        char *copy = cache_lookup_ex(key, 0, -1);
+        if( !copy ) {
+            copy = memcpy(REALLOC(0, size + 1), data, size), copy[size] = '\0';
+            copy = cache_insert_ex(key, copy, size, -1);
+        }
+        return copy;
+    }
+    return data;
 }
 int vfs_size(const char *pathfile) {
     int sz;
@@ -443,7 +1001,7 @@ int vfs_size(const char *pathfile) {
 FILE* vfs_handle(const char *pathfile) { // preferred way, will clean descriptors at exit
     int sz;
     char *buf = vfs_load(pathfile, &sz);
-    FILE *fp = fmemopen(buf ? buf : "", buf ? sz : 0, "a+b");
+    FILE *fp = fmemopen(buf ? buf : "", buf ? sz : 0, "rb");
     ASSERT( fp, "cannot create tempfile" );
     return fp;
 }
@@ -474,51 +1032,539 @@ const char *vfs_find(const char *pathfile) {
 }
 
 
-// -----------------------------------------------------------------------------
-// cache
+// streaming: entries are read from the archive mapping, or from the archive/disk file in chunks.
+// deflated zip entries are inflated through a 32 KiB window (the deflate dictionary size):
+// forward seeks inflate and discard, backward seeks restart from the beginning of the entry.
+
+enum { VFS_WINDOW = 32 * 1024, VFS_CHUNK = 16 * 1024 };
+
+struct vfs_file {
+    const char *src;   // entry bytes within mapping, or null
+    FILE *fp;          // else file holding the entry bytes at `base`
+    bool owned;        // fp opened by us (disk files), archive handles are shared
+    void *blob;        // acquired cache blob (codecs that cannot stream)
+    unsigned base;     // entry offset within fp
+    int size;          // uncompressed size
+    int pos;           // read position
+    // inflate state
+    bool deflated;
+    int packed;        // compressed size
+    int in_pos;        // compressed bytes consumed
+    int in_len, in_head; // chunk buffer state (fp sources)
+    int out_len, out_head, out_pos; // window: pending bytes, read head, write head
+    tinfl_decompressor inflator;
+    uint8_t window[VFS_WINDOW];
+    uint8_t chunk[VFS_CHUNK];
+};
+
+static FILE *vfs_archive_file(archive_dir *dir) {
+    return dir->type == is_zip ? dir->zip_archive->in : dir->type == is_tar ? dir->tar_archive->in : dir->pak_archive->in;
+}
+
+static vfs_file *vfs_open_disk(const char *pathfile) {
+    FILE *fp = fopen(pathfile, "rb");
+    if( !fp ) return 0;
+    vfs_file *f = REALLOC(0, sizeof(vfs_file));
+    memset(f, 0, offsetof(vfs_file, inflator));
+    f->fp = fp, f->owned = 1;
+    fseek(fp, 0, SEEK_END); f->size = (int)ftell(fp); fseek(fp, 0, SEEK_SET);
+    return f;
+}
 
-void* cache_lookup(const char *pathfile, int *size) { // find key->value
-    if( !MAX_CACHED_FILES ) return 0;
-    for(archive_dir *dir = dir_cache; dir; dir = dir->next) {
-        if( !strcmp(dir->path, pathfile) ) {
-            if(size) *size = dir->size;
-            return dir->data;
+vfs_file *vfs_open(const char *pathfile) {
+    if (!pathfile[0]) return 0;
+    if (pathfile[0] == '/' || pathfile[1] == ':') return vfs_open_disk(pathfile);
+
+    struct vfs_path *vp = vfs_path(pathfile);
+    if( vp->entry < 0 ) {
+        // not archived: try mounted directories, latest first
+        for( archive_dir *dir = dir_mount; dir; dir = dir->next ) {
+            if( dir->type != is_dir ) continue;
+            vfs_file *f = vfs_open_disk(stringf("%s%s", dir->path, vp->name));
+            if( f ) return f;
         }
+        return 0;
     }
-    return 0;
+
+    struct vfs_entry *e = &vfs_entries[vp->entry];
+    archive_dir *dir = e->dir;
+    vfs_file *f = REALLOC(0, sizeof(vfs_file));
+    memset(f, 0, offsetof(vfs_file, inflator));
+    f->size = e->size;
+
+    if( e->codec == 0 || e->codec == 8 ) { // stored, or plain deflate
+        f->deflated = e->codec == 8;
+        f->packed = e->packed;
+        f->base = e->offset;
+        if( dir->map ) f->src = dir->map + f->base;
+        else {
+            vfs_lock();
+            f->fp = vfs_archive(dir) ? vfs_archive_file(dir) : 0;
+            vfs_unlock();
+            if( !f->fp ) return FREE(f), (vfs_file*)0;
+        }
+        if( f->deflated ) memset(&f->inflator, 0, sizeof(f->inflator));
+        return f;
+    }
+
+    // other codecs decode whole entries: stream from the cached blob instead
+    int size; f->blob = vfs_acquire(pathfile, &size);
+    if( !f->blob ) return FREE(f), (vfs_file*)0;
+    f->src = f->blob, f->size = size;
+    return f;
 }
-void* cache_insert(const char *pathfile, void *ptr, int size) { // append key/value; return LRU or NULL
-    if( !MAX_CACHED_FILES ) return 0;
-    assert( ptr );
-    assert( size );
-
-    // append to cache
-    archive_dir zero = {0}, *old = dir_cache;
-    *(dir_cache = REALLOC(0, sizeof(archive_dir))) = zero;
-    dir_cache->next = old;
-    dir_cache->path = STRDUP(pathfile);
-    dir_cache->size = size;
-    dir_cache->data = REALLOC(0, size+1);
-    memcpy(dir_cache->data, ptr, size); size[(char*)dir_cache->data] = 0; // copy+terminator
-
-    // keep cached files within limits
-    static int added = 0;
-    if( added < MAX_CACHED_FILES ) {
-        ++added;
-    } else {
-        // remove oldest cache entry
-        for( archive_dir *prev = dir_cache, *dir = prev; dir ; prev = dir, dir = dir->next ) {
-            if( !dir->next ) {
-                prev->next = 0; // break link
-                void *data = dir->data;
-                dir->path = REALLOC(dir->path, 0);
-                dir->data = REALLOC(dir->data, 0);
-                dir = REALLOC(dir, 0);
-                return data;
+
+static int vfs_inflate(vfs_file *f, char *out, int len) { // out may be null to skip bytes
+    int done = 0;
+    while( done < len && f->pos < f->size ) {
+        // drain window
+        if( f->out_len ) {
+            int n = len - done < f->out_len ? len - done : f->out_len;
+            if( out ) memcpy(out + done, f->window + f->out_head, n);
+            f->out_head += n, f->out_len -= n, f->pos += n, done += n;
+            continue;
+        }
+
+        // next compressed bytes
+        const uint8_t *in;
+        if( f->src ) {
+            in = (const uint8_t*)f->src + f->in_pos, f->in_len = f->packed - f->in_pos;
+        } else {
+            if( !f->in_len ) {
+                int n = f->packed - f->in_pos < VFS_CHUNK ? f->packed - f->in_pos : VFS_CHUNK;
+                vfs_lock();
+                fseek(f->fp, f->base + f->in_pos, SEEK_SET);
+                f->in_len = (int)fread(f->chunk, 1, n, f->fp), f->in_head = 0;
+                vfs_unlock();
             }
+            in = f->chunk + f->in_head;
         }
+
+        size_t in_len = f->in_len, out_len = VFS_WINDOW - f->out_pos;
+        int more = f->in_pos + f->in_len < f->packed ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+        tinfl_status status = tinfl_decompress(&f->inflator, in, &in_len, f->window, f->window + f->out_pos, &out_len, more);
+        f->in_pos += (int)in_len;
+        if( !f->src ) f->in_head += (int)in_len, f->in_len -= (int)in_len;
+        f->out_head = f->out_pos, f->out_len = (int)out_len;
+        f->out_pos = (f->out_pos + (int)out_len) & (VFS_WINDOW - 1);
+        if( status < TINFL_STATUS_DONE || (!in_len && !out_len) ) break; // corrupt or truncated
     }
+    return done;
+}
+
+int vfs_fread(vfs_file *f, void *buf, int len) {
+    if( len > f->size - f->pos ) len = f->size - f->pos;
+    if( len <= 0 ) return 0;
+    if( f->deflated ) return vfs_inflate(f, buf, len);
+    if( f->src ) memcpy(buf, f->src + f->pos, len);
+    else {
+        if( !f->owned ) vfs_lock();
+        fseek(f->fp, f->base + f->pos, SEEK_SET), len = (int)fread(buf, 1, len, f->fp);
+        if( !f->owned ) vfs_unlock();
+    }
+    f->pos += len;
+    return len;
+}
+
+int vfs_seek(vfs_file *f, int offset, int whence) {
+    int pos = whence == SEEK_SET ? offset : whence == SEEK_CUR ? f->pos + offset : f->size + offset;
+    if( pos < 0 || pos > f->size ) return -1;
+    if( f->deflated ) {
+        if( pos < f->pos ) { // restart
+            memset(&f->inflator, 0, sizeof(f->inflator));
+            f->pos = f->in_pos = f->in_len = f->in_head = f->out_len = f->out_head = f->out_pos = 0;
+        }
+        int skip = pos - f->pos;
+        if( vfs_inflate(f, 0, skip) != skip ) return -1;
+    }
+    f->pos = pos;
     return 0;
 }
 
+int vfs_tell(vfs_file *f) {
+    return f->pos;
+}
+
+int vfs_fsize(vfs_file *f) {
+    return f->size;
+}
+
+void vfs_close(vfs_file *f) {
+    if( f ) {
+        if( f->owned ) fclose(f->fp);
+        if( f->blob ) cache_release(f->blob);
+        FREE(f);
+    }
+}
+
+
+// async: requests live in recycled slots, handles are slot+generation. queued slots sit in a binary
+// heap ordered by priority (then by submission), so bumping a request is a sift-up. i/o threads copy
+// the request, read it unlocked, and hand the result back; the main thread caches it & fires callbacks.
+
+#ifndef VFS_IO_THREADS
+#define VFS_IO_THREADS 4
+#endif
+
+struct vfs_request {
+    char *name;            // cleaned pathfile, cache key
+    struct vfs_entry entry; // copy, so i/o threads never touch vfs_entries
+    bool disk;             // absolute path, not vfs
+    int priority, seq, heap; // heap: position in vfs_queue, or -1
+    int state, generation;
+    bool owned;            // data must be cached
+    char *data; int size;
+    vfs_callback cb; void *user;
+};
+
+static array(struct vfs_request) vfs_requests;
+static array(int) vfs_request_slots; // free slots
+static array(int) vfs_queue;         // heap of queued slots
+static array(int) vfs_done;          // read slots, not yet dispatched
+static int vfs_seq;
+static thread_mutex_t vfs_async_mutex;
+static thread_signal_t vfs_work, vfs_ready;
+
+static bool vfs_before(int a, int b) { // heap order
+    struct vfs_request *ra = &vfs_requests[a], *rb = &vfs_requests[b];
+    return ra->priority != rb->priority ? ra->priority > rb->priority : ra->seq < rb->seq;
+}
+static void vfs_heap_swap(int i, int j) {
+    int t = vfs_queue[i]; vfs_queue[i] = vfs_queue[j]; vfs_queue[j] = t;
+    vfs_requests[vfs_queue[i]].heap = i, vfs_requests[vfs_queue[j]].heap = j;
+}
+static void vfs_heap_fix(int i) { // restores heap around position i
+    for( ; i > 0 && vfs_before(vfs_queue[i], vfs_queue[(i-1)/2]); i = (i-1)/2 ) vfs_heap_swap(i, (i-1)/2);
+    for( int n = array_count(vfs_queue);; ) {
+        int best = i, l = 2*i+1, r = l+1;
+        if( l < n && vfs_before(vfs_queue[l], vfs_queue[best]) ) best = l;
+        if( r < n && vfs_before(vfs_queue[r], vfs_queue[best]) ) best = r;
+        if( best == i ) break;
+        vfs_heap_swap(i, best), i = best;
+    }
+}
+static void vfs_heap_remove(int slot) {
+    int i = vfs_requests[slot].heap, last = array_count(vfs_queue) - 1;
+    vfs_heap_swap(i, last);
+    array_pop(vfs_queue);
+    vfs_requests[slot].heap = -1;
+    if( i < last ) vfs_heap_fix(i);
+}
+
+static int vfs_io_thread(void *arg) {
+    for(;;) {
+        thread_mutex_lock(&vfs_async_mutex);
+        int slot = array_count(vfs_queue) ? vfs_queue[0] : -1;
+        struct vfs_request r = {0};
+        if( slot >= 0 ) {
+            vfs_heap_remove(slot);
+            vfs_requests[slot].state = VFS_LOADING;
+            r = vfs_requests[slot];
+        }
+        bool more = array_count(vfs_queue) > 0;
+        thread_mutex_unlock(&vfs_async_mutex);
+
+        if( slot < 0 ) { thread_signal_wait(&vfs_work, 100); continue; }
+        if( more ) thread_signal_raise(&vfs_work); // wake next sibling
+
+        int size = 0; bool owned = 0;
+        char *data = r.disk ? file_load(r.name, &size) : 0;
+        if( data ) owned = 1;
+        if( !data && !r.disk ) data = vfs_view(&r.entry, &size);
+        if( !data && !r.disk ) data = vfs_extract(&r.entry, &size), owned = !!data;
+
+        thread_mutex_lock(&vfs_async_mutex);
+        struct vfs_request *q = &vfs_requests[slot];
+        if( q->state == VFS_LOADING ) q->state = data ? VFS_LOADED : VFS_FAILED;
+        q->data = data, q->size = size, q->owned = owned;
+        array_push(vfs_done, slot);
+        thread_mutex_unlock(&vfs_async_mutex);
+        thread_signal_raise(&vfs_ready);
+    }
+    return 0;
+}
+
+static struct vfs_request *vfs_request(int handle) { // live request, or null
+    int slot = (handle & 0xFFFFF) - 1;
+    if( slot < 0 || slot >= array_count(vfs_requests) ) return 0;
+    struct vfs_request *r = &vfs_requests[slot];
+    return r->generation == (handle >> 20) ? r : 0;
+}
+
+int vfs_load_async(const char *pathfile, int priority, vfs_callback cb, void *user) {
+    do_once {
+        thread_mutex_init(&vfs_async_mutex);
+        thread_mutex_init(vfs_io = &vfs_io_mutex);
+        thread_signal_init(&vfs_work);
+        thread_signal_init(&vfs_ready);
+        for( int i = 0; i < VFS_IO_THREADS; ++i ) thread_create(vfs_io_thread, 0, "vfs_io_thread()", 0);
+    }
+
+    // resolve on this thread: path cache and entries are not thread-safe
+    bool disk = !pathfile[0] || pathfile[0] == '/' || pathfile[1] == ':';
+    struct vfs_path *vp = disk ? 0 : vfs_path(pathfile);
+    const char *name = disk ? pathfile : vp->name;
+    int size = 0; char *hit = cache_lookup_ex(name, &size, +1); // held until dispatched
+
+    thread_mutex_lock(&vfs_async_mutex);
+    int slot = array_count(vfs_request_slots) ? *array_back(vfs_request_slots) : array_count(vfs_requests);
+    if( array_count(vfs_request_slots) ) array_pop(vfs_request_slots);
+    else array_push(vfs_requests, ((struct vfs_request){0}));
+
+    struct vfs_request *r = &vfs_requests[slot];
+    int generation = (r->generation + 1) & 0x7FF;
+    *r = ((struct vfs_request){ STRDUP(name), {0}, disk, priority, vfs_seq++, -1, VFS_QUEUED, generation, 0, 0, 0, cb, user });
+    if( !disk && vp->entry >= 0 ) r->entry = vfs_entries[vp->entry];
+
+    if( hit || (!disk && vp->entry < 0) ) { // cached, or not found: complete without i/o
+        r->state = hit ? VFS_LOADED : VFS_FAILED, r->data = hit, r->size = size;
+        array_push(vfs_done, slot);
+    } else {
+        r->heap = array_count(vfs_queue);
+        array_push(vfs_queue, slot);
+        vfs_heap_fix(r->heap);
+    }
+    thread_mutex_unlock(&vfs_async_mutex);
+    thread_signal_raise(&vfs_work);
+    return (generation << 20) | (slot + 1);
+}
+
+static char* vfs_dispatch(int slot, int *size, bool pin) { // main thread, async mutex not held. returns what the callback got
+    struct vfs_request r = vfs_requests[slot];
+    char *held = r.owned ? 0 : r.data; // cache hit, acquired by vfs_load_async()
+    if( r.state == VFS_CANCELLED ) { if( r.owned ) FREE(r.data); r.data = 0; }
+    else if( r.owned ) r.data = held = cache_insert_ex(r.name, r.data, r.size, +1);
+    if( pin ) cache_pin(r.data, 1);
+
+    thread_mutex_lock(&vfs_async_mutex);
+    vfs_requests[slot].data = r.data, vfs_requests[slot].owned = 0;
+    vfs_requests[slot].generation = (vfs_requests[slot].generation + 1) & 0x7FF; // retire handle
+    array_push(vfs_request_slots, slot);
+    thread_mutex_unlock(&vfs_async_mutex);
+
+    if( r.state != VFS_CANCELLED && r.cb ) r.cb(r.name, r.data, r.data ? r.size : 0, r.user);
+    cache_release(held);
+    FREE(r.name);
+    if( size ) *size = r.data ? r.size : 0;
+    return r.data; // from locals: the slot may be recycled by now
+}
+
+void vfs_async_update(void) {
+    if( !vfs_requests ) return;
+    thread_mutex_lock(&vfs_async_mutex);
+    array(int) done = vfs_done; vfs_done = 0;
+    thread_mutex_unlock(&vfs_async_mutex);
+
+    for( int i = 0; i < array_count(done); ++i ) vfs_dispatch(done[i], 0, 0);
+    array_free(done);
+}
+
+int vfs_async_poll(int handle) {
+    vfs_async_update();
+    struct vfs_request *r = vfs_request(handle);
+    return r ? r->state : -1;
+}
+
+char *vfs_async_wait(int handle, int *size) {
+    vfs_async_priority(handle, INT_MAX);
+    for(;;) {
+        thread_mutex_lock(&vfs_async_mutex);
+        struct vfs_request *r = vfs_request(handle);
+        int state = r ? r->state : -1, slot = (handle & 0xFFFFF) - 1;
+        bool done = false;
+        for( int i = 0; i < array_count(vfs_done); ++i ) {
+            if( vfs_done[i] == slot ) { vfs_done[i] = *array_back(vfs_done), array_pop(vfs_done), done = true; break; }
+        }
+        thread_mutex_unlock(&vfs_async_mutex);
+
+        if( state < 0 ) return size ? *size = 0 : 0, (char*)0; // stale, or fired already
+        if( done ) {
+            int len = 0;
+            char *data = vfs_dispatch(slot, &len, 1); // pinned: same contract as vfs_load()
+            if( size ) *size = state == VFS_LOADED ? len : 0;
+            return state == VFS_LOADED ? data : 0;
+        }
+        thread_signal_wait(&vfs_ready, 1);
+    }
+}
+
+bool vfs_async_cancel(int handle) {
+    thread_mutex_lock(&vfs_async_mutex);
+    struct vfs_request *r = vfs_request(handle);
+    bool dropped = r && r->state == VFS_QUEUED;
+    if( dropped ) {
+        vfs_heap_remove((handle & 0xFFFFF) - 1);
+        array_push(vfs_done, (handle & 0xFFFFF) - 1);
+    }
+    if( r && (r->state == VFS_QUEUED || r->state == VFS_LOADING) ) r->state = VFS_CANCELLED; // result dropped on arrival
+    thread_mutex_unlock(&vfs_async_mutex);
+    return dropped;
+}
+
+void vfs_async_priority(int handle, int priority) {
+    if( !vfs_requests ) return;
+    thread_mutex_lock(&vfs_async_mutex);
+    struct vfs_request *r = vfs_request(handle);
+    if( r && r->heap >= 0 && r->priority < priority ) r->priority = priority, vfs_heap_fix(r->heap);
+    thread_mutex_unlock(&vfs_async_mutex);
+}
+
+
+// -----------------------------------------------------------------------------
+// cache
+
+#ifndef CACHE_BUDGET
+#define CACHE_BUDGET (256 << 20) // bytes
+#endif
+
+struct cache_blob {
+    char *key;
+    char *data;  // null if slot is free
+    int size;
+    int refs;
+    bool pinned;
+    bool used;   // clock reference bit
+};
+
+static array(struct cache_blob) cache_blobs;
+static array(int) cache_slots;      // free blobs
+static map(char*, int) cache_keys;  // key -> blob
+static map(void*, int) cache_datas; // data -> blob
+static uint64_t cache_bytes, cache_limit = CACHE_BUDGET;
+static int cache_hand;
+static uint64_t cache_hits, cache_misses, cache_evictions;
+static thread_mutex_t cache_mutex;
+
+static void cache_lock() {
+    do_once thread_mutex_init(&cache_mutex); // first use is a vfs_mount()/vfs_load() on the main thread
+    thread_mutex_lock(&cache_mutex);
+}
+static void cache_unlock() {
+    thread_mutex_unlock(&cache_mutex);
+}
+
+static void cache_hold(struct cache_blob *b, int hold) {
+    if( hold > 0 ) ++b->refs;
+    if( hold < 0 ) b->pinned = 1;
+}
+
+static struct cache_blob *cache_find_blob(void *data) {
+    int *slot = data && cache_datas ? map_find(cache_datas, data) : 0;
+    return slot ? &cache_blobs[*slot] : 0;
+}
+
+static void cache_evict(uint64_t incoming) {
+    // clock sweep: recently used blobs get a second chance. acquired & pinned blobs are skipped
+    int count = array_count(cache_blobs);
+    for( int visits = 0; cache_bytes + incoming > cache_limit && visits < 2 * count; ++visits ) {
+        struct cache_blob *b = &cache_blobs[ cache_hand = (cache_hand + 1) % count ];
+        if( !b->data || b->refs || b->pinned ) continue;
+        if( b->used ) { b->used = 0; continue; }
+
+        map_erase(cache_keys, b->key);
+        map_erase(cache_datas, (void*)b->data);
+        cache_bytes -= b->size;
+        FREE(b->key);
+        FREE(b->data);
+        b->data = 0;
+        array_push(cache_slots, (int)(b - cache_blobs));
+        ++cache_evictions;
+        profile_incstat("Cache evictions", +1);
+    }
+}
+
+void cache_budget(uint64_t bytes) {
+    cache_lock();
+    cache_limit = bytes;
+    if( cache_blobs ) cache_evict(0);
+    cache_unlock();
+}
+
+static void* cache_lookup_ex(const char *key, int *size, int hold) { // find key->value
+    cache_lock();
+    int *slot = cache_keys ? map_find(cache_keys, (char*)key) : 0;
+    if( !slot ) {
+        ++cache_misses;
+        cache_unlock();
+        profile_incstat("Cache misses", +1);
+        return 0;
+    }
+    ++cache_hits;
+
+    struct cache_blob *b = &cache_blobs[*slot];
+    b->used = 1;
+    cache_hold(b, hold);
+    if(size) *size = b->size;
+    void *data = b->data;
+    cache_unlock();
+    profile_incstat("Cache hits", +1);
+    return data;
+}
+void* cache_lookup(const char *key, int *size) {
+    return cache_lookup_ex(key, size, 0);
+}
+static void* cache_insert_ex(const char *key, void *ptr, int size, int hold) { // append key/value. value is not copied
+    assert( ptr );
+    cache_lock();
+    if( !cache_keys ) map_init(cache_keys, less_str, hash_str);
+    if( !cache_datas ) map_init(cache_datas, less_ptr, hash_ptr);
+
+    // already cached: keep existing blob, as it may be in use
+    int *found = map_find(cache_keys, (char*)key);
+    if( found ) {
+        struct cache_blob *b = &cache_blobs[*found];
+        if( ptr != b->data ) FREE(ptr);
+        cache_hold(b, hold);
+        void *data = b->data;
+        cache_unlock();
+        return data;
+    }
+
+    // keep cached files within budget. an oversized blob stays cached until next insertion
+    cache_evict(size);
+
+    int slot = array_count(cache_blobs);
+    if( array_count(cache_slots) ) slot = *array_back(cache_slots), array_pop(cache_slots);
+    else array_push(cache_blobs, (struct cache_blob){0});
+
+    struct cache_blob *b = &cache_blobs[slot];
+    b->key = STRDUP(key);
+    b->data = ptr;
+    b->size = size;
+    b->refs = 0;
+    b->pinned = 0;
+    b->used = 1;
+    cache_hold(b, hold);
+    map_insert(cache_keys, b->key, slot);
+    map_insert(cache_datas, ptr, slot);
+    cache_bytes += size;
+    cache_unlock();
+    return ptr;
+}
+void* cache_insert(const char *key, void *ptr, int size) {
+    return cache_insert_ex(key, ptr, size, 0);
+}
+void* cache_acquire(void *blob) {
+    if( !blob ) return 0;
+    cache_lock();
+    struct cache_blob *b = cache_find_blob(blob);
+    if( b ) ++b->refs;
+    cache_unlock();
+    return blob;
+}
+void cache_release(void *blob) {
+    if( !blob ) return;
+    cache_lock();
+    struct cache_blob *b = cache_find_blob(blob);
+    if( b && b->refs > 0 ) --b->refs;
+    cache_unlock();
+}
+void cache_pin(void *blob, bool pinned) {
+    if( !blob ) return;
+    cache_lock();
+    struct cache_blob *b = cache_find_blob(blob);
+    if( b ) b->pinned = pinned;
+    cache_unlock();
+}
+
 #endif // FILE_C
@@ -60,7 +60,9 @@ enum {
     TEXTURE_BC1 = 8,  // DXT1, RGB with 8:1 compression ratio (+ optional 1bpp for alpha)
     TEXTURE_BC2 = 16, // DXT3, RGBA with 4:1 compression ratio (BC1 for RGB + 4bpp for alpha)
     TEXTURE_BC3 = 32, // DXT5, RGBA with 4:1 compression ratio (BC1 for RGB + BC4 for A)
-//  TEXTURE_BC4,     // Alpha
+    TEXTURE_BC4 = 1 << 27, // RGTC1, R with 2:1 compression ratio vs R8 (alpha, masks, heights)
+    TEXTURE_BC5 = 1 << 28, // RGTC2, RG with 2:1 compression ratio vs RG8 (normal maps)
+    TEXTURE_BC7 = 1 << 29, // BPTC, RGBA with 4:1 compression ratio, higher quality than BC3
 
     TEXTURE_NEAREST = 0,
     TEXTURE_LINEAR = 64,
@@ -96,6 +98,8 @@ typedef struct {
     unsigned flags;
 } texture_t;
 
+// cooked gpu textures (.compress folders, see fwk_cooker) are loaded as-is by texture() and texture_from_mem(), mips included:
+// "BCTX", format (TEXTURE_BC* flag, 0 for rgba8), width, height, levels (u32) | per level: bytes (u32), blocks or texels
 texture_t texture(const char* filename, int flags);
 texture_t texture_from_mem(const char* ptr, int len, int flags);
 texture_t texture_create(unsigned w, unsigned h, unsigned n, void *pixels, int flags);
@@ -105,6 +109,18 @@ void      texture_destroy(texture_t *t);
 //void texture_add_loader( int(*loader)(const char *filename, int *w, int *h, int *bpp, int reqbpp, int flags) );
 unsigned  texture_update(texture_t *t, unsigned w, unsigned h, unsigned n, void *pixels, int flags);
 
+// streaming: texture_async() returns at once, its id bound to a checker placeholder. files are read by vfs i/o
+// threads & decoded by stream workers; texture_stream_update() (called by window_swap()) uploads them within a per
+// frame budget, smallest mips first, swapping in higher resolution levels as they land.
+// - note: w/h stay 0 until texture_ready() refreshes them. plain images get their mips filtered on the workers.
+// - note: #define TEXTURE_STREAM_PBO 1 to upload through an orphaned pixel unpack buffer.
+
+texture_t texture_async(const char *filename, int flags);
+bool      texture_ready(texture_t *t); // true once all levels are in (or load failed: checker stays). refreshes w/h/flags
+void      texture_stream_budget(int bytes, float ms); // per frame upload budget. defaults to 4 MiB, 2 ms
+int       texture_stream_update(void); // uploads within budget. returns bytes uploaded
+int       texture_stream_pending(void); // textures still loading
+
 // -----------------------------------------------------------------------------
 // fullscreen quads
 
@@ -122,6 +138,29 @@ void sprite_ex( texture_t texture,
     float frame, float xcells, float ycells       // frame_number in a 8x4 spritesheet
 );
 
+// -----------------------------------------------------------------------------
+// atlases
+
+// cooked .atlas layout: "ATL1", width, height, count (u32) | atlas_frame_t[count] sorted by name | width*height rgba8 texels
+typedef struct atlas_frame_t {
+    char name[64];                 // image basename, without extension
+    unsigned short x, y, w, h;     // texels in atlas. w & h are swapped when rotated
+    unsigned short ox, oy, ow, oh; // offset of the trimmed texels in, and size of, the original image
+    unsigned rotated;              // stored 90 degrees clockwise
+} atlas_frame_t;
+
+typedef struct atlas_t {
+    texture_t texture;
+    atlas_frame_t *frames;
+    int count;
+} atlas_t;
+
+atlas_t atlas(const char *pathfile, int flags);
+int     atlas_find(atlas_t a, const char *name); // frame index, or -1
+void    atlas_destroy(atlas_t *a);
+
+void sprite_atlas( atlas_t a, const char *name, float px, float py, float pz, float rot );
+
 // -----------------------------------------------------------------------------
 // cubemaps
 
@@ -185,6 +224,8 @@ unsigned shader_bind(unsigned program);
 unsigned shader_get_active();
 void     shader_destroy(unsigned shader);
 
+int      shader_uniform_location(unsigned shader, const char *uniform); // reflected once per program. -1 if not active
+
 // -----------------------------------------------------------------------------
 // meshes (@fixme: deprecate?)
 
@@ -245,6 +286,7 @@ float    model_animate_clip(model_t, float curframe, int minframe, int maxframe,
 aabb     model_aabb(model_t, mat44 transform);
 void     model_render2(model_t, mat44 proj, mat44 view, mat44 model, int shader);
 void     model_render(model_t, mat44 proj, mat44 view, mat44 model);
+void     model_render_instanced(model_t, mat44 proj, mat44 view, mat44 *models, int shader, unsigned count); // one draw per mesh. skinned instances share current pose
 void     model_destroy(model_t);
 
 // -----------------------------------------------------------------------------
@@ -277,6 +319,23 @@ int      fx_enabled(int pass);
 void     fx_enable_all(int enabled);
 char *   fx_name(int pass);
 
+// -----------------------------------------------------------------------------
+// gl state cache. state changes go through here; calls that would set the current value are dropped.
+// code touching gl state directly (ie, 3rd party) must glstate_invalidate() afterwards.
+
+void     glstate_enable(unsigned cap, int enabled);
+void     glstate_blend_func(unsigned src, unsigned dst);
+void     glstate_depth_func(unsigned func);
+void     glstate_cull_face(unsigned mode);
+void     glstate_front_face(unsigned mode);
+void     glstate_polygon_mode(unsigned mode); // front and back
+void     glstate_active_texture(unsigned unit); // 0,1,2... not GL_TEXTURE0+
+void     glstate_bind_texture(unsigned target, unsigned texture);
+void     glstate_use_program(unsigned program);
+void     glstate_bind_vao(unsigned vao);
+void     glstate_bind_buffer(unsigned target, unsigned buffer);
+void     glstate_invalidate();
+
 // -----------------------------------------------------------------------------
 // utils
 
@@ -294,6 +353,11 @@ void*    screenshot(unsigned components); // 3 RGB, 4 RGBA, -3 BGR, -4 BGRA
 #define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT  0x83F1
 #define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT  0x83F2
 #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT  0x83F3
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#define GL_COMPRESSED_RGBA_BPTC_UNORM       0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
 
 #define GL_DEBUG_SEVERITY_HIGH            0x9146
 #define GL_DEBUG_SEVERITY_NOTIFICATION    0x826B
@@ -323,16 +387,94 @@ void glDebugEnable() {
     typedef void (*GLDEBUGPROC)(uint32_t, uint32_t, uint32_t, uint32_t, int32_t, const char *, const void *);
     typedef void (*GLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC, const void *);
     void (*glDebugMessageCallback)(GLDEBUGPROC, const void *) = (GLDEBUGMESSAGECALLBACKPROC)glfwGetProcAddress("glDebugMessageCallback");
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
+    glstate_enable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB, 1);
     glDebugMessageCallback((GLDEBUGPROC)glDebugCallback, NULL);
     }
 }
 
 void glNewFrame() {
+    glstate_invalidate(); // demos may touch gl directly between frames
     glViewport(0, 0, window_width(), window_height());
     //glClearColor(0,0,0,1);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_BLEND);
+    glstate_enable(GL_BLEND, 1);
+}
+
+// -----------------------------------------------------------------------------
+// gl state cache
+
+enum { GLSTATE_UNITS = 16, GLSTATE_UNKNOWN = ~0u };
+
+static const unsigned glstate_caps[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST, GL_LINE_SMOOTH, GL_PROGRAM_POINT_SIZE };
+static const unsigned glstate_textures[] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY };
+static const unsigned glstate_buffers[] = { GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER };
+
+static struct glstate_t {
+    unsigned caps[countof(glstate_caps)];
+    unsigned blend, depth, cull, front, polygon;
+    unsigned unit, textures[GLSTATE_UNITS][countof(glstate_textures)];
+    unsigned program, vao, buffers[countof(glstate_buffers)]; // element array binding belongs to the vao
+} gls; // zeroed, as gl defaults: caps disabled, texture unit 0, nothing bound
+
+void glstate_invalidate() {
+    memset(&gls, 0xFF, sizeof(gls));
+}
+
+// true if value is not the one current, which gets shadowed then
+static
+bool glstate_(unsigned *shadow, unsigned value) {
+    if( *shadow == value ) {
+        profile_incstat("gl calls filtered", +1);
+        return false;
+    }
+    *shadow = value;
+    profile_incstat("gl calls", +1);
+    return true;
+}
+static
+int glstate_find(const unsigned *list, int count, unsigned value) {
+    for( int i = 0; i < count; ++i ) if( list[i] == value ) return i;
+    return -1;
+}
+
+void glstate_enable(unsigned cap, int enabled) {
+    int i = glstate_find(glstate_caps, countof(glstate_caps), cap);
+    if( i < 0 || glstate_(&gls.caps[i], !!enabled) ) (enabled ? glEnable : glDisable)(cap);
+}
+void glstate_blend_func(unsigned src, unsigned dst) {
+    if( glstate_(&gls.blend, src << 16 | dst) ) glBlendFunc(src, dst);
+}
+void glstate_depth_func(unsigned func) {
+    if( glstate_(&gls.depth, func) ) glDepthFunc(func);
+}
+void glstate_cull_face(unsigned mode) {
+    if( glstate_(&gls.cull, mode) ) glCullFace(mode);
+}
+void glstate_front_face(unsigned mode) {
+    if( glstate_(&gls.front, mode) ) glFrontFace(mode);
+}
+void glstate_polygon_mode(unsigned mode) {
+    if( glstate_(&gls.polygon, mode) ) glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+void glstate_active_texture(unsigned unit) {
+    if( glstate_(&gls.unit, unit) ) glActiveTexture(GL_TEXTURE0 + unit);
+}
+void glstate_bind_texture(unsigned target, unsigned texture) {
+    int i = glstate_find(glstate_textures, countof(glstate_textures), target);
+    if( i < 0 || gls.unit >= GLSTATE_UNITS || glstate_(&gls.textures[gls.unit][i], texture) ) glBindTexture(target, texture);
+}
+void glstate_use_program(unsigned program) {
+    if( glstate_(&gls.program, program) ) glUseProgram(program);
+}
+void glstate_bind_vao(unsigned vao) {
+    if( glstate_(&gls.vao, vao) ) {
+        glBindVertexArray(vao);
+        gls.buffers[1] = GLSTATE_UNKNOWN; // GL_ELEMENT_ARRAY_BUFFER
+    }
+}
+void glstate_bind_buffer(unsigned target, unsigned buffer) {
+    int i = glstate_find(glstate_buffers, countof(glstate_buffers), target);
+    if( i < 0 || glstate_(&gls.buffers[i], buffer) ) glBindBuffer(target, buffer);
 }
 
 // ----------------------------------------------------------------------------
@@ -722,6 +864,7 @@ static const char *const vs_32344443_332_model = "//" FILELINE "\n"
     "uniform bool SKINNED = false;\n"
     // "uniform mat4 M;\n" // RIM
     "uniform mat4 MVP;\n"
+    "uniform bool u_instanced = false;\n" // model & MVP are then premultiplied by att_instanced_matrix
 
     "in vec3 att_position;\n"
     "in vec2 att_texcoord;\n"
@@ -731,6 +874,7 @@ static const char *const vs_32344443_332_model = "//" FILELINE "\n"
     "in vec4 att_weights;\n"
     "in vec4 att_color;\n"
     "in vec3 att_bitangent;\n"
+    "in mat4 att_instanced_matrix;\n"
     "out vec3 v_position;\n"
     "out vec3 v_normal, v_normal_ws;\n"
     "out vec2 v_texcoord;\n"
@@ -742,14 +886,16 @@ static const char *const vs_32344443_332_model = "//" FILELINE "\n"
         "out vec4 vneye;\n"
         "out vec4 vpeye;\n"
         "out vec4 sc;\n"
+        "mat4 l_model;\n" // model, per instance
         "void do_shadow() {\n"
-        "    vneye = view * model * vec4(att_normal,   0.0f);\n"
-        "    vpeye = view * model * vec4(att_position, 1.0);\n"
-        "    sc = cameraToShadowProjector * model * vec4(att_position, 1.0f);\n"
+        "    vneye = view * l_model * vec4(att_normal,   0.0f);\n"
+        "    vpeye = view * l_model * vec4(att_position, 1.0);\n"
+        "    sc = cameraToShadowProjector * l_model * vec4(att_position, 1.0f);\n"
         "}\n"
 
 
     "void main() {\n"
+    "   l_model = u_instanced ? model * att_instanced_matrix : model;\n"
     "   vec3 objPos;\n"
     "   if(!SKINNED) {\n"
     "       objPos = att_position;\n"
@@ -763,11 +909,11 @@ static const char *const vs_32344443_332_model = "//" FILELINE "\n"
     "       v_normal = vec4(att_normal, 0.0) * m;\n"
     "       //@todo: tangents\n"
     "   }\n"
-    "   v_normal_ws = normalize(vec3(model * vec4(v_normal, 0.)));\n" // normal to world/model space
+    "   v_normal_ws = normalize(vec3(l_model * vec4(v_normal, 0.)));\n" // normal to world/model space
     "   v_normal = normalize(v_normal);\n"
     "   v_position = att_position;\n"
     "   v_texcoord = att_texcoord;\n"
-    "   gl_Position = MVP * vec4( objPos, 1.0 );\n"
+    "   gl_Position = (u_instanced ? MVP * att_instanced_matrix : MVP) * vec4( objPos, 1.0 );\n"
     "   do_shadow();\n"
     "}\n";
 
@@ -891,13 +1037,13 @@ static const char *const fs_2_4_texel_ycbr_gamma_saturation = "//" FILELINE "\n"
     "    fragcolor = vec4(texel.rgb, 1.0);\n"
     "}\n";
 
-static const char *const vs_324_24_sprite = "//" FILELINE "\n"
+static const char *const vs_334_34_sprite = "//" FILELINE "\n"
     "uniform mat4 u_mvp;\n"
 
     "in vec3 att_Position;\n"
-    "in vec2 att_TexCoord;\n"
+    "in vec3 att_TexCoord;\n" // u, v, texture array layer
     "in vec4 att_Color;\n"
-    "out vec2 vTexCoord;\n"
+    "out vec3 vTexCoord;\n"
     "out vec4 vColor;\n"
 
     "void main() {\n"
@@ -906,10 +1052,24 @@ static const char *const vs_324_24_sprite = "//" FILELINE "\n"
     "    gl_Position = u_mvp * vec4(att_Position, 1.0);\n"
     "}\n";
 
-static const char *const fs_24_4_sprite = "//" FILELINE "\n"
+static const char *const fs_34_4_sprite = "//" FILELINE "\n"
     "uniform sampler2D u_texture;\n"
 
-    "in vec2 vTexCoord;\n"
+    "in vec3 vTexCoord;\n"
+    "in vec4 vColor;\n"
+    "out vec4 fragColor;\n"
+
+    "void main() {\n"
+    "    vec4 texColor = texture(u_texture, vTexCoord.xy);\n"
+    "texColor = vColor * texColor;\n"
+    "if(texColor.a < 0.5) discard;"
+    "    fragColor = texColor;\n"
+    "}\n";
+
+static const char *const fs_34_4_sprite_array = "//" FILELINE "\n"
+    "uniform sampler2DArray u_texture;\n"
+
+    "in vec3 vTexCoord;\n"
     "in vec4 vColor;\n"
     "out vec4 fragColor;\n"
 
@@ -979,6 +1139,125 @@ GLuint shader_compile( GLenum type, const char *source ) {
     return shader;
 }
 
+// uniform cache. active uniforms are reflected once per program into a hashed location table,
+// and the last value uploaded to every location is shadowed so unchanged uniforms skip the gl call.
+
+typedef struct shader_reflect_t {
+    array(uint64_t) keys;      // entries of this program in shader_locations
+    array(array(char)) values; // last value uploaded, per location
+} shader_reflect_t;
+
+static map(int, shader_reflect_t*) shader_reflects;
+static map(uint64_t, int) shader_locations; // hash(program,name) -> location. -1 if not active
+static unsigned shader_reflect_last = ~0u;
+static shader_reflect_t *shader_reflect_last_ptr;
+
+static
+uint64_t shader_key(unsigned program, const char *name) {
+    return hash_str(name) ^ hash_64(program);
+}
+static
+void shader_reflect_add(unsigned program, shader_reflect_t *r, const char *name, int location) {
+    uint64_t key = shader_key(program, name);
+    if( map_find(shader_locations, key) ) return;
+    map_insert(shader_locations, key, location);
+    array_push(r->keys, key);
+}
+static
+shader_reflect_t *shader_reflect(unsigned program) {
+    if( program == shader_reflect_last ) return shader_reflect_last_ptr;
+    if( !shader_reflects ) map_init(shader_reflects, less_int, hash_int);
+    if( !shader_locations ) map_init(shader_locations, less_u64, hash_64);
+
+    shader_reflect_t **found = map_find(shader_reflects, (int)program), *r = found ? *found : 0;
+    if( !r ) {
+        r = CALLOC(1, sizeof(shader_reflect_t));
+        map_insert(shader_reflects, (int)program, r);
+
+        GLint count = 0;
+        if( glIsProgram(program) ) glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        for( int i = 0; i < count; ++i ) {
+            char name[128] = {0}; GLint size; GLenum type;
+            glGetActiveUniform(program, i, sizeof(name), NULL, &size, &type, name);
+            int location = glGetUniformLocation(program, name);
+            if( location < 0 ) continue; // uniform block members
+            shader_reflect_add(program, r, name, location);
+            // arrays are reported as "name[0]". register them by their plain name too
+            char *bracket = strstr(name, "[0]");
+            if( bracket ) *bracket = 0, shader_reflect_add(program, r, name, location);
+        }
+    }
+
+    return shader_reflect_last = program, shader_reflect_last_ptr = r;
+}
+static
+void shader_unreflect(unsigned program) {
+    shader_reflect_t **found = shader_reflects ? map_find(shader_reflects, (int)program) : 0;
+    if( !found ) return;
+
+    shader_reflect_t *r = *found;
+    for( int i = 0; i < array_count(r->keys); ++i ) map_erase(shader_locations, r->keys[i]);
+    for( int i = 0; i < array_count(r->values); ++i ) array_free(r->values[i]);
+    array_free(r->keys);
+    array_free(r->values);
+    FREE(r);
+
+    map_erase(shader_reflects, (int)program);
+    shader_reflect_last = ~0u;
+}
+
+int shader_uniform_location(unsigned program, const char *name) {
+    shader_reflect_t *r = shader_reflect(program);
+    int *found = map_find(shader_locations, shader_key(program, name));
+    if( found ) return *found;
+
+    // not reflected (ie, "array[3]" elements or inactive uniforms). resolve once and remember
+    int location = glGetUniformLocation(program, name);
+    shader_reflect_add(program, r, name, location);
+    return location;
+}
+
+// true if value differs from the last one uploaded to this location, and shadows it.
+// expects program in use, as callers upload right after.
+static
+bool shader_uniform_changed(unsigned program, int location, const void *value, int bytes) {
+    if( location < 0 ) return false;
+    shader_reflect_t *r = shader_reflect(program);
+    if( location >= array_count(r->values) ) array_resize(r->values, location + 1);
+
+    array(char) *shadow = &r->values[location];
+    if( array_count(*shadow) == bytes && !memcmp(*shadow, value, bytes) ) {
+        profile_incstat("uniforms skipped", +1);
+        return false;
+    }
+    array_resize(*shadow, bytes);
+    memcpy(*shadow, value, bytes);
+    profile_incstat("uniforms", +1);
+    return true;
+}
+
+static void uniform_int(unsigned program, int location, int i) {
+    if( shader_uniform_changed(program, location, &i, sizeof(i)) ) glUniform1i(location, i);
+}
+static void uniform_float(unsigned program, int location, float f) {
+    if( shader_uniform_changed(program, location, &f, sizeof(f)) ) glUniform1f(location, f);
+}
+static void uniform_vec2v(unsigned program, int location, int count, const float *v) {
+    if( shader_uniform_changed(program, location, v, count * 2 * sizeof(float)) ) glUniform2fv(location, count, v);
+}
+static void uniform_vec3v(unsigned program, int location, int count, const float *v) {
+    if( shader_uniform_changed(program, location, v, count * 3 * sizeof(float)) ) glUniform3fv(location, count, v);
+}
+static void uniform_vec4v(unsigned program, int location, int count, const float *v) {
+    if( shader_uniform_changed(program, location, v, count * 4 * sizeof(float)) ) glUniform4fv(location, count, v);
+}
+static void uniform_mat34v(unsigned program, int location, int count, const float *m) {
+    if( shader_uniform_changed(program, location, m, count * 12 * sizeof(float)) ) glUniformMatrix3x4fv(location, count, GL_FALSE, m);
+}
+static void uniform_mat44(unsigned program, int location, const float *m) {
+    if( shader_uniform_changed(program, location, m, 16 * sizeof(float)) ) glUniformMatrix4fv(location, 1, GL_FALSE/*GL_TRUE*/, m);
+}
+
 unsigned shader(const char *vs, const char *fs, const char *attribs, const char *fragcolor) {
     PRINTF("Compiling shader\n");
 
@@ -1039,6 +1318,8 @@ unsigned shader(const char *vs, const char *fs, const char *attribs, const char
         glDeleteShader(frag);
         // glDeleteShader(geom);
 
+        shader_reflect(program);
+
 //#ifdef DEBUG_ANY_SHADER
 //        PRINTF("Shader #%d:\n", program);
 //        shader_print(vs);
@@ -1050,26 +1331,28 @@ unsigned shader(const char *vs, const char *fs, const char *attribs, const char
 }
 
 void shader_destroy(unsigned program){
+    shader_unreflect(program);
     glDeleteProgram(program);
+    glstate_invalidate(); // ids get recycled
 }
 
 unsigned last_shader = -1;
 static
 int shader_uniform(const char *name) {
-    int ret = glGetUniformLocation(last_shader, name);
+    int ret = shader_uniform_location(last_shader, name);
     if( ret < 0 ) PRINTF("!cannot find uniform '%s' in shader program %d\n", name, (int)last_shader );
     return ret;
 }
 unsigned shader_get_active() { return last_shader; }
-unsigned shader_bind(unsigned program) { unsigned ret = last_shader; return glUseProgram(last_shader = program), ret; }
-void shader_int(const char *uniform, int i)     { glUniform1i(shader_uniform(uniform), i); }
-void shader_float(const char *uniform, float f) { glUniform1f(shader_uniform(uniform), f); }
-void shader_vec2(const char *uniform, vec2 v)   { glUniform2fv(shader_uniform(uniform), 1, &v.x); }
-void shader_vec3(const char *uniform, vec3 v)   { glUniform3fv(shader_uniform(uniform), 1, &v.x); }
-void shader_vec4(const char *uniform, vec4 v)   { glUniform4fv(shader_uniform(uniform), 1, &v.x); }
-void shader_mat44(const char *uniform, mat44 m) { glUniformMatrix4fv(shader_uniform(uniform), 1, GL_FALSE/*GL_TRUE*/, m); }
-void shader_texture(const char *sampler, unsigned texture, unsigned unit) { glBindTexture(GL_TEXTURE_2D, texture); glActiveTexture(GL_TEXTURE0 + unit); glUniform1i(shader_uniform(sampler), unit); }
-void shader_cubemap(const char *sampler, unsigned texture) { glUniform1i(shader_uniform(sampler), 0); glBindTexture(GL_TEXTURE_CUBE_MAP, texture); }
+unsigned shader_bind(unsigned program) { unsigned ret = last_shader; return glstate_use_program(last_shader = program), ret; }
+void shader_int(const char *uniform, int i)     { uniform_int(last_shader, shader_uniform(uniform), i); }
+void shader_float(const char *uniform, float f) { uniform_float(last_shader, shader_uniform(uniform), f); }
+void shader_vec2(const char *uniform, vec2 v)   { uniform_vec2v(last_shader, shader_uniform(uniform), 1, &v.x); }
+void shader_vec3(const char *uniform, vec3 v)   { uniform_vec3v(last_shader, shader_uniform(uniform), 1, &v.x); }
+void shader_vec4(const char *uniform, vec4 v)   { uniform_vec4v(last_shader, shader_uniform(uniform), 1, &v.x); }
+void shader_mat44(const char *uniform, mat44 m) { uniform_mat44(last_shader, shader_uniform(uniform), m); }
+void shader_texture(const char *sampler, unsigned texture, unsigned unit) { glstate_bind_texture(GL_TEXTURE_2D, texture); glstate_active_texture(unit); uniform_int(last_shader, shader_uniform(sampler), unit); }
+void shader_cubemap(const char *sampler, unsigned texture) { uniform_int(last_shader, shader_uniform(sampler), 0); glstate_bind_texture(GL_TEXTURE_CUBE_MAP, texture); }
 
 // -----------------------------------------------------------------------------
 // colors
@@ -1101,7 +1384,7 @@ image_t image_create(int x, int y, int flags) {
 image_t image_from_mem(const char *data, int size, int flags) {
     image_t img = {0};
     if( data && size ) {
-        stbi_set_flip_vertically_on_load(flags & IMAGE_FLIP ? 1 : 0);
+        stbi_set_flip_vertically_on_load_thread(flags & IMAGE_FLIP ? 1 : 0); // texture streaming decodes on workers
 
         int n = 0;
         if(flags & IMAGE_R) n = 1;
@@ -1120,18 +1403,11 @@ image_t image_from_mem(const char *data, int size, int flags) {
 }
 
 image_t image(const char *pathfile, int flags) {
-    const char *fname = vfs_find(pathfile);
-    // if( !fname[0] ) fname = vfs_find(stringf("%s.png",pathfile)); // needed?
-    // if( !fname[0] ) fname = vfs_find(stringf("%s.jpg",pathfile)); // needed?
-    // if( !fname[0] ) fname = vfs_find(stringf("%s.tga",pathfile)); // needed?
-    // if( !fname[0] ) fname = vfs_find(stringf("%s.jpg.png",pathfile)); // needed?
-    // if( !fname[0] ) fname = vfs_find(stringf("%s.tga.png",pathfile)); // needed?
-    // if( !fname[0] ) fname = vfs_find(stringf("%s.png.jpg",pathfile)); // needed?
-    // if( !fname[0] ) fname = vfs_find(stringf("%s.tga.jpg",pathfile)); // needed?
-
     int size = 0;
-    char *data = vfs_load(fname, &size);
-    return image_from_mem(data, size, flags);
+    char *data = vfs_acquire(pathfile, &size); // decoded from memory: mapped archive view or cached blob
+    image_t img = image_from_mem(data, size, flags);
+    vfs_release(data);
+    return img;
 }
 
 void image_destroy(image_t *img) {
@@ -1159,15 +1435,47 @@ vec3 bilinear(image_t in, vec2 uv) { // image_bilinear_pixel() ?
 // -----------------------------------------------------------------------------
 // textures
 
+static void sprite_forget(unsigned texture_id);
+static void sprite_target(unsigned texture_id, bool attached);
+static void texture_stream_forget(unsigned texture_id);
+
+static
+void texture_sampling(GLenum texture_type, int flags) {
+    GLenum wrap = GL_CLAMP_TO_EDGE;
+    GLenum min_filter = GL_NEAREST, mag_filter = GL_NEAREST;
+
+    if( flags & TEXTURE_REPEAT ) wrap = GL_REPEAT;
+    if( flags & TEXTURE_BORDER ) wrap = GL_CLAMP_TO_BORDER;
+    if( flags & TEXTURE_LINEAR ) min_filter = GL_LINEAR, mag_filter = GL_LINEAR;
+    if( flags & TEXTURE_MIPMAPS  ) min_filter = flags & TEXTURE_LINEAR ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_LINEAR;
+    if( flags & TEXTURE_MIPMAPS  ) mag_filter = flags & TEXTURE_LINEAR ? GL_LINEAR : GL_NEAREST;
+
+    glTexParameteri(texture_type, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(texture_type, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(texture_type, GL_TEXTURE_MIN_FILTER, min_filter);
+    glTexParameteri(texture_type, GL_TEXTURE_MAG_FILTER, mag_filter);
+}
+
+static
+GLenum texture_compressed_format(int flags) {
+    int srgb = !!(flags & TEXTURE_SRGB);
+    if( flags & TEXTURE_BC1 ) return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    if( flags & TEXTURE_BC2 ) return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    if( flags & TEXTURE_BC3 ) return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    if( flags & TEXTURE_BC4 ) return GL_COMPRESSED_RED_RGTC1;
+    if( flags & TEXTURE_BC5 ) return GL_COMPRESSED_RG_RGTC2;
+    if( flags & TEXTURE_BC7 ) return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    return 0;
+}
+
 unsigned texture_update(texture_t *t, unsigned w, unsigned h, unsigned n, void *pixels, int flags) {
     ASSERT( t && t->id );
     ASSERT( n <= 4 );
+    sprite_forget(t->id); // contents or size changed: copy it again into a sprite page when next drawn
     GLuint pixel_types[] = { GL_RED, GL_RED, GL_RG, GL_RGB, GL_RGBA, GL_R32F, GL_R32F, GL_RG32F, GL_RGB32F, GL_RGBA32F };
     GLenum pixel_storage = flags & TEXTURE_FLOAT ? GL_FLOAT : GL_UNSIGNED_BYTE;
     GLuint pixel_type = pixel_types[ n ];
     GLuint texel_type = pixel_types[ n + 5 * !!(flags & TEXTURE_FLOAT) ];
-    GLenum wrap = GL_CLAMP_TO_EDGE;
-    GLenum min_filter = GL_NEAREST, mag_filter = GL_NEAREST;
 //    GLfloat color = (flags&7)/7.f, border_color[4] = { color, color, color, 1.f };
 
     if( flags & TEXTURE_BGR )  if( pixel_type == GL_RGB )  pixel_type = GL_BGR;
@@ -1175,17 +1483,9 @@ unsigned texture_update(texture_t *t, unsigned w, unsigned h, unsigned n, void *
     if( flags & TEXTURE_SRGB ) if( texel_type == GL_RGB )  texel_type = GL_SRGB;
     if( flags & TEXTURE_SRGB ) if( texel_type == GL_RGBA ) texel_type = GL_SRGB_ALPHA;
 
-    if( flags & TEXTURE_BC1 ) texel_type = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
-    if( flags & TEXTURE_BC2 ) texel_type = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
-    if( flags & TEXTURE_BC3 ) texel_type = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    if( flags & (TEXTURE_BC1|TEXTURE_BC2|TEXTURE_BC3|TEXTURE_BC4|TEXTURE_BC5|TEXTURE_BC7) ) texel_type = texture_compressed_format(flags);
     if( flags & TEXTURE_DEPTH ) texel_type = pixel_type = GL_DEPTH_COMPONENT; // GL_DEPTH_COMPONENT32
 
-    if( flags & TEXTURE_REPEAT ) wrap = GL_REPEAT;
-    if( flags & TEXTURE_BORDER ) wrap = GL_CLAMP_TO_BORDER;
-    if( flags & TEXTURE_LINEAR ) min_filter = GL_LINEAR, mag_filter = GL_LINEAR;
-    if( flags & TEXTURE_MIPMAPS  ) min_filter = flags & TEXTURE_LINEAR ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_LINEAR;
-    if( flags & TEXTURE_MIPMAPS  ) mag_filter = flags & TEXTURE_LINEAR ? GL_LINEAR : GL_NEAREST;
-
     if( 0 ) { // flags & TEXTURE_PREMULTIPLY_ALPHA )
         uint8_t *p = pixels;
         if(n == 2) for( unsigned i = 0; i < 2*w*h; i += 2 ) {
@@ -1202,12 +1502,9 @@ GLenum texture_type = t->flags & TEXTURE_ARRAY ? GL_TEXTURE_2D_ARRAY : GL_TEXTUR
 
 //glPixelStorei( GL_UNPACK_ALIGNMENT, n < 4 ? 1 : 4 ); // for framebuffer reading
 //glActiveTexture(GL_TEXTURE0 + (flags&7));
-    glBindTexture(texture_type, t->id);
+    glstate_bind_texture(texture_type, t->id);
     glTexImage2D(texture_type, 0, texel_type, w, h, 0, pixel_type, pixel_storage, pixels);
-    glTexParameteri(texture_type, GL_TEXTURE_WRAP_S, wrap);
-    glTexParameteri(texture_type, GL_TEXTURE_WRAP_T, wrap);
-    glTexParameteri(texture_type, GL_TEXTURE_MIN_FILTER, min_filter);
-    glTexParameteri(texture_type, GL_TEXTURE_MAG_FILTER, mag_filter);
+    texture_sampling(texture_type, flags);
 #if 0 // only for sampler2DShadow
     if( flags & TEXTURE_DEPTH )   glTexParameteri(texture_type, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
     if( flags & TEXTURE_DEPTH )   glTexParameteri(texture_type, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
@@ -1277,7 +1574,40 @@ texture_t texture_checker() {
     return texture;
 }
 
+// uploads a cooked gpu texture: every level as stored, no decoding nor mip generation
+static
+texture_t texture_compressed(const char *ptr, int len, int flags) {
+    texture_t t = {0};
+    unsigned header[5];
+    memcpy(header, ptr, sizeof(header));
+    flags = (flags & ~(TEXTURE_BC1|TEXTURE_BC2|TEXTURE_BC3|TEXTURE_BC4|TEXTURE_BC5|TEXTURE_BC7)) | header[1];
+
+    glGenTextures(1, &t.id);
+    glstate_bind_texture(GL_TEXTURE_2D, t.id);
+
+    const char *level = ptr + sizeof(header), *end = ptr + len;
+    unsigned w = header[2], h = header[3], levels = 0;
+    for( unsigned bytes; levels < header[4] && level + 4 <= end; ++levels, w = maxi(w / 2, 1), h = maxi(h / 2, 1) ) {
+        memcpy(&bytes, level, 4);
+        if( level + 4 + bytes > end ) break;
+        if( header[1] ) glCompressedTexImage2D(GL_TEXTURE_2D, levels, texture_compressed_format(flags), w, h, 0, bytes, level + 4);
+        else glTexImage2D(GL_TEXTURE_2D, levels, flags & TEXTURE_SRGB ? GL_SRGB_ALPHA : GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, level + 4);
+        level += 4 + bytes;
+    }
+    if( !header[1] && levels == 1 && (flags & TEXTURE_MIPMAPS) ) glGenerateMipmap(GL_TEXTURE_2D); // raw texels cooked without mips
+    else glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels ? levels - 1 : 0); // complete with the levels cooked; no glGenerateMipmap at load time
+    texture_sampling(GL_TEXTURE_2D, flags);
+
+    t.w = header[2];
+    t.h = header[3];
+    t.n = 4;
+    t.flags = flags;
+    return t;
+}
+
 texture_t texture_from_mem(const char *ptr, int len, int flags) {
+    if( ptr && len >= 20 && !memcmp(ptr, "BCTX", 4) ) return texture_compressed(ptr, len, flags);
+
     image_t img = image_from_mem(ptr, len, flags);
     if( img.pixels ) {
         texture_t t = texture_create(img.x, img.y, img.n, img.pixels, flags);
@@ -1289,20 +1619,313 @@ texture_t texture_from_mem(const char *ptr, int len, int flags) {
 
 texture_t texture(const char *pathfile, int flags) {
     // PRINTF("Loading file %s\n", pathfile);
-    image_t img = image(pathfile, flags);
-    if( img.pixels ) {
-        texture_t t = texture_create(img.x, img.y, img.n, img.pixels, flags);
-        image_destroy(&img);
-        return t;
-    }
-    return texture_checker();
+    int size = 0;
+    char *data = vfs_acquire(pathfile, &size); // block compressed when cooked from a .compress folder; image otherwise
+    texture_t t = texture_from_mem(data, size, flags);
+    vfs_release(data);
+    return t;
 }
 
 void texture_destroy( texture_t *t ) {
-    if(t->id) glDeleteTextures(1, &t->id);
+    if(t->id) sprite_forget(t->id), sprite_target(t->id, 0), texture_stream_forget(t->id), glDeleteTextures(1, &t->id), glstate_invalidate(); // ids get recycled
     t->id = 0;
 }
 
+// -----------------------------------------------------------------------------
+// texture streaming
+
+// jobs are owned by the main thread, except while queued for or held by a stream worker. uploads go smallest
+// level first, in bands of rows; GL_TEXTURE_BASE_LEVEL follows the finest complete level so a partial band
+// is never sampled, and the placeholder keeps showing until the first level lands.
+
+#ifndef TEXTURE_STREAM_THREADS
+#define TEXTURE_STREAM_THREADS 2
+#endif
+#ifndef TEXTURE_STREAM_PBO
+#define TEXTURE_STREAM_PBO 0
+#endif
+
+enum { STREAM_READING, STREAM_DECODING, STREAM_UPLOADING, STREAM_DONE, STREAM_FAILED };
+
+struct texture_stream {
+    GLuint id;
+    int flags, handle, state, cancelled;
+    char *blob; int size;      // file contents, acquired from the cache
+    GLenum format;             // compressed internal format, or 0 for rgba8
+    unsigned w, h;
+    int count, next, row;      // levels to upload, smallest first. upload cursor
+    int preview;               // index in levels[] of the preview: levels up to it go before any finer level of any texture
+    struct { unsigned level, w, h, bytes; const char *data; } levels[32];
+    image_t *mips; int mipcount; // decoded chain of a plain image
+};
+
+static array(struct texture_stream*) texture_streams;  // main thread
+static array(struct texture_stream*) texture_decodes;  // queued for workers, locked
+static array(struct texture_stream*) texture_decoded;  // back from workers, locked
+static thread_mutex_t texture_stream_mutex;
+static thread_signal_t texture_stream_work;
+static int texture_stream_bytes = 4 << 20;
+static float texture_stream_ms = 2;
+#if TEXTURE_STREAM_PBO
+static GLuint texture_stream_pbo;
+#endif
+
+// fills the levels to upload: the whole chain with mipmaps, else a small preview plus level 0. worker thread
+static
+void texture_stream_decode(struct texture_stream *s) {
+    unsigned w[32], h[32], bytes[32], count = 0;
+    const char *data[32];
+
+    if( s->size >= 20 && !memcmp(s->blob, "BCTX", 4) ) {
+        unsigned header[5];
+        memcpy(header, s->blob, sizeof(header));
+        s->flags = (s->flags & ~(TEXTURE_BC1|TEXTURE_BC2|TEXTURE_BC3|TEXTURE_BC4|TEXTURE_BC5|TEXTURE_BC7)) | header[1];
+        s->format = header[1] ? texture_compressed_format(s->flags) : 0;
+        const char *level = s->blob + sizeof(header), *end = s->blob + s->size;
+        for( unsigned lw = header[2], lh = header[3]; count < header[4] && count < 32 && level + 4 <= end; ++count ) {
+            memcpy(&bytes[count], level, 4);
+            if( level + 4 + bytes[count] > end ) break;
+            w[count] = lw, h[count] = lh, data[count] = level + 4;
+            level += 4 + bytes[count], lw = maxi(lw / 2, 1), lh = maxi(lh / 2, 1);
+        }
+    } else {
+        image_t img = image_from_mem(s->blob, s->size, IMAGE_RGBA | (s->flags & IMAGE_FLIP));
+        cooker__mip_options opt = { 0, !!(s->flags & TEXTURE_SRGB) }; // box filtered, as glGenerateMipmap
+        if( img.pixels && (s->flags & TEXTURE_MIPMAPS) ) {
+            s->mipcount = cooker__mips(&img, opt, &s->mips);
+            for( ; count < s->mipcount && count < 32; ++count ) {
+                w[count] = s->mips[count].w, h[count] = s->mips[count].h, bytes[count] = w[count] * h[count] * 4, data[count] = s->mips[count].pixels;
+            }
+        }
+        else if( img.pixels ) { // only level 0 & the preview get uploaded: build those two
+            for( unsigned lw = img.w, lh = img.h; count < 32; lw = maxi(lw / 2, 1), lh = maxi(lh / 2, 1) ) {
+                w[count] = lw, h[count] = lh, bytes[count] = lw * lh * 4, data[count] = 0, ++count;
+                if( lw == 1 && lh == 1 ) break;
+            }
+            int preview = 0;
+            while( preview + 1 < (int)count && maxi(w[preview], h[preview]) > 64 ) ++preview;
+            s->mips = REALLOC(0, sizeof(image_t) * 2), s->mipcount = 1 + !!preview;
+            s->mips[0] = img, s->mips[0].pixels = REALLOC(0, bytes[0]), memcpy(s->mips[0].pixels, img.pixels, bytes[0]);
+            if( preview ) cooker__mip(&img, opt, preview, &s->mips[1]);
+            data[0] = s->mips[0].pixels, data[preview] = s->mips[s->mipcount - 1].pixels;
+        }
+        image_destroy(&img);
+    }
+
+    int preview = 0;
+    while( preview + 1 < (int)count && maxi(w[preview], h[preview]) > 64 ) ++preview;
+    for( int l = count; --l >= 0; ) {
+        if( l == preview ) s->preview = s->count;
+        if( (s->flags & TEXTURE_MIPMAPS) || l == 0 || l == preview ) {
+            s->levels[s->count].level = l, s->levels[s->count].w = w[l], s->levels[s->count].h = h[l];
+            s->levels[s->count].bytes = bytes[l], s->levels[s->count].data = data[l];
+            ++s->count;
+        }
+    }
+    s->w = count ? w[0] : 0, s->h = count ? h[0] : 0;
+}
+
+static int texture_stream_thread(void *arg) {
+    for(;;) {
+        thread_mutex_lock(&texture_stream_mutex);
+        struct texture_stream *s = array_count(texture_decodes) ? texture_decodes[0] : 0;
+        if( s ) array_erase(texture_decodes, 0);
+        int cancelled = s && s->cancelled;
+        thread_mutex_unlock(&texture_stream_mutex);
+
+        if( !s ) { thread_signal_wait(&texture_stream_work, 100); continue; }
+        if( !cancelled ) texture_stream_decode(s);
+
+        thread_mutex_lock(&texture_stream_mutex);
+        array_push(texture_decoded, s);
+        thread_mutex_unlock(&texture_stream_mutex);
+    }
+    return 0;
+}
+
+static
+void texture_stream_free(struct texture_stream *s) {
+    if( s->blob ) cache_release(s->blob);
+    for( int l = 0; l < s->mipcount; ++l ) FREE(s->mips[l].pixels);
+    FREE(s->mips);
+    FREE(s);
+}
+
+static
+void texture_stream_loaded(const char *pathfile, char *data, int size, void *user) {
+    struct texture_stream *s = user;
+    if( !data ) { s->state = STREAM_FAILED; return; }
+
+    s->blob = cache_acquire(data), s->size = size, s->state = STREAM_DECODING;
+    thread_mutex_lock(&texture_stream_mutex);
+    array_push(texture_decodes, s);
+    thread_mutex_unlock(&texture_stream_mutex);
+    thread_signal_raise(&texture_stream_work);
+}
+
+texture_t texture_async(const char *pathfile, int flags) {
+    do_once {
+        thread_mutex_init(&texture_stream_mutex);
+        thread_signal_init(&texture_stream_work);
+        cooker__srgb_tables();
+        for( int i = 0; i < TEXTURE_STREAM_THREADS; ++i ) thread_create(texture_stream_thread, 0, "texture_stream_thread()", 0);
+    }
+
+    // placeholder: a tiny checker in level 0, replaced once the file gets decoded
+    static uint32_t checker[8*8];
+    do_once for( int i = 0; i < 8*8; ++i ) checker[i] = ((i ^ (i >> 3)) & 1) ? 0xFFFF00FF : 0xFF404040;
+
+    texture_t t = {0};
+    glGenTextures(1, &t.id);
+    glstate_bind_texture(GL_TEXTURE_2D, t.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 8, 8, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    texture_sampling(GL_TEXTURE_2D, flags);
+    t.n = 4;
+    t.flags = flags;
+
+    struct texture_stream *s = REALLOC(0, sizeof(struct texture_stream));
+    memset(s, 0, sizeof(struct texture_stream));
+    s->id = t.id, s->flags = flags, s->state = STREAM_READING;
+    array_push(texture_streams, s);
+    s->handle = vfs_load_async(pathfile, 0, texture_stream_loaded, s);
+    return t;
+}
+
+static
+struct texture_stream *texture_stream_find(unsigned id) {
+    for( int i = 0; i < array_count(texture_streams); ++i ) if( texture_streams[i]->id == id ) return texture_streams[i];
+    return 0;
+}
+
+static
+void texture_stream_forget(unsigned id) {
+    struct texture_stream *s = id && texture_streams ? texture_stream_find(id) : 0;
+    if( !s ) return;
+    for( int i = 0; i < array_count(texture_streams); ++i ) if( texture_streams[i] == s ) { array_erase(texture_streams, i); break; }
+
+    if( s->state == STREAM_READING ) vfs_async_poll(s->handle); // read already (eg, cached): its callback fires now
+    if( s->state == STREAM_READING ) vfs_async_cancel(s->handle); // still queued or reading: its callback never fires
+    if( s->state == STREAM_DECODING ) {
+        thread_mutex_lock(&texture_stream_mutex);
+        s->cancelled = 1; // freed when back from the worker
+        thread_mutex_unlock(&texture_stream_mutex);
+        return;
+    }
+    texture_stream_free(s);
+}
+
+bool texture_ready(texture_t *t) {
+    struct texture_stream *s = t->id && texture_streams ? texture_stream_find(t->id) : 0;
+    if( !s ) return true;
+    if( s->state < STREAM_DONE ) return false;
+    if( s->state == STREAM_DONE ) t->w = s->w, t->h = s->h, t->n = 4, t->flags = s->flags;
+    texture_stream_forget(t->id);
+    return true;
+}
+
+void texture_stream_budget(int bytes, float ms) {
+    texture_stream_bytes = bytes, texture_stream_ms = ms;
+}
+
+int texture_stream_pending(void) {
+    int pending = 0;
+    for( int i = 0; i < array_count(texture_streams); ++i ) pending += texture_streams[i]->state < STREAM_DONE;
+    return pending;
+}
+
+// uploads rows [row, row+rows) of the current level of a job. rows are block rows when compressed
+static
+void texture_stream_band(struct texture_stream *s, int row, int rows, int pitch) {
+    int step = s->format ? 4 : 1, y = row * step, band = rows * pitch;
+    int w = s->levels[s->next].w, h = mini(rows * step, s->levels[s->next].h - y), level = s->levels[s->next].level;
+    const char *src = s->levels[s->next].data + (size_t)row * pitch;
+#if TEXTURE_STREAM_PBO
+    if( !texture_stream_pbo ) glGenBuffers(1, &texture_stream_pbo);
+    glstate_bind_buffer(GL_PIXEL_UNPACK_BUFFER, texture_stream_pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, band, NULL, GL_STREAM_DRAW); // orphaned: no stall on the previous band
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, band, GL_MAP_WRITE_BIT|GL_MAP_INVALIDATE_BUFFER_BIT);
+    memcpy(dst, src, band);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    src = 0;
+#endif
+    if( s->format ) glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, w, h, s->format, band, src);
+    else glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, src);
+#if TEXTURE_STREAM_PBO
+    glstate_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+}
+
+// uploads as many bands of a job as the budget left allows, up to levels[last]. returns bytes uploaded
+static
+int texture_stream_upload(struct texture_stream *s, int budget, int forced, uint64_t deadline, int last) {
+    int uploaded = 0;
+    glstate_bind_texture(GL_TEXTURE_2D, s->id);
+    while( s->next <= last && s->next < s->count && time_ns() < deadline ) {
+        unsigned level = s->levels[s->next].level, w = s->levels[s->next].w, h = s->levels[s->next].h;
+        int rows = s->format ? (h + 3) / 4 : h, pitch = s->levels[s->next].bytes / rows;
+        int band = mini(rows - s->row, (budget - uploaded) / pitch);
+        if( !band && !uploaded && forced ) band = 1; // a single row over budget: keep streaming anyway
+        if( !band ) break;
+
+        if( !s->row ) { // define the level storage first, unsampled until complete
+            GLenum internal = s->flags & TEXTURE_SRGB ? GL_SRGB_ALPHA : GL_RGBA;
+            if( s->format ) glCompressedTexImage2D(GL_TEXTURE_2D, level, s->format, w, h, 0, s->levels[s->next].bytes, NULL);
+            else glTexImage2D(GL_TEXTURE_2D, level, internal, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        texture_stream_band(s, s->row, band, pitch);
+        uploaded += band * pitch;
+        s->row += band;
+
+        if( s->row == rows ) { // level complete: sample it
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+            if( !s->next ) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
+            sprite_forget(s->id);
+            s->next++, s->row = 0;
+        }
+    }
+    if( s->next == s->count ) {
+        if( !(s->flags & TEXTURE_MIPMAPS) ) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        texture_sampling(GL_TEXTURE_2D, s->flags);
+        s->state = s->count ? STREAM_DONE : STREAM_FAILED;
+        if( s->blob ) cache_release(s->blob), s->blob = 0;
+        for( int l = 0; l < s->mipcount; ++l ) FREE(s->mips[l].pixels);
+        FREE(s->mips), s->mips = 0, s->mipcount = 0;
+    }
+    return uploaded;
+}
+
+int texture_stream_update(void) {
+    if( !texture_streams ) return 0;
+
+    thread_mutex_lock(&texture_stream_mutex);
+    array(struct texture_stream*) decoded = texture_decoded; texture_decoded = 0;
+    thread_mutex_unlock(&texture_stream_mutex);
+    for( int i = 0; i < array_count(decoded); ++i ) {
+        if( decoded[i]->cancelled ) texture_stream_free(decoded[i]);
+        else if( decoded[i]->count ) decoded[i]->state = STREAM_UPLOADING;
+        else decoded[i]->state = STREAM_FAILED, cache_release(decoded[i]->blob), decoded[i]->blob = 0; // checker stays
+    }
+    array_free(decoded);
+
+    // previews of every texture first (and the tiny levels below them), then the finer levels in request order.
+    // finer levels wait for a frame where every preview is complete
+    uint64_t deadline = time_ns() + (uint64_t)(texture_stream_ms * 1e6);
+    int uploaded = 0, previews = 0;
+    for( int pass = 0; pass < 2 && !previews; ++pass ) {
+        for( int i = 0; i < array_count(texture_streams) && uploaded < texture_stream_bytes; ++i ) {
+            struct texture_stream *s = texture_streams[i];
+            if( s->state != STREAM_UPLOADING || (pass == 0) != (s->next <= s->preview) ) continue;
+            uploaded += texture_stream_upload(s, texture_stream_bytes - uploaded, !uploaded, deadline, pass ? s->count - 1 : s->preview);
+        }
+        for( int i = 0; pass == 0 && i < array_count(texture_streams); ++i ) {
+            previews += texture_streams[i]->state == STREAM_UPLOADING && texture_streams[i]->next <= texture_streams[i]->preview;
+        }
+    }
+    profile_incstat("texture stream bytes", +uploaded);
+    return uploaded;
+}
+
 // -----------------------------------------------------------------------------
 // shadowmaps
 
@@ -1315,9 +1938,9 @@ shadowmap_t shadowmap(int texture_width) { // = 1024
     glGenFramebuffers(1, &s.fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, s.fbo);
 
-    glActiveTexture(GL_TEXTURE0);
+    glstate_active_texture(0);
     glGenTextures(1, &s.texture);
-    glBindTexture(GL_TEXTURE_2D, s.texture);
+    glstate_bind_texture(GL_TEXTURE_2D, s.texture);
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, texture_width, texture_width, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, 0);
 
@@ -1339,6 +1962,7 @@ shadowmap_t shadowmap(int texture_width) { // = 1024
 void shadowmap_destroy(shadowmap_t *s) {
     if (s->texture) {
         glDeleteTextures(1, &s->texture);
+        glstate_invalidate();
     }
     if (s->fbo) {
         glDeleteFramebuffers(1, &s->fbo);
@@ -1408,27 +2032,27 @@ void fullscreen_rgb_quad( texture_t texture, float gamma ) {
         const char* fs = fs_2_4_texel_inv_gamma;
 
         program = shader(vs, fs, "", "fragcolor" );
-        u_inv_gamma = glGetUniformLocation(program, "u_inv_gamma");
+        u_inv_gamma = shader_uniform_location(program, "u_inv_gamma");
         glGenVertexArrays( 1, &vao );
     }
 
     GLenum texture_type = texture.flags & TEXTURE_ARRAY ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
 //    glEnable( GL_BLEND );
-    glUseProgram( program );
-    glUniform1f( u_inv_gamma, 1.0f / (gamma + !gamma) );
+    glstate_use_program( program );
+    uniform_float( program, u_inv_gamma, 1.0f / (gamma + !gamma) );
 
-    glBindVertexArray( vao );
+    glstate_bind_vao( vao );
 
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( texture_type, texture.id );
+    glstate_active_texture(0);
+    glstate_bind_texture( texture_type, texture.id );
 
     glDrawArrays( GL_TRIANGLES, 0, 6 );
     profile_incstat("drawcalls", +1);
     profile_incstat("triangles", +2);
 
-    glBindTexture( texture_type, 0 );
-    glBindVertexArray( 0 );
-    glUseProgram( 0 );
+    glstate_bind_texture( texture_type, 0 );
+    glstate_bind_vao( 0 );
+    glstate_use_program( 0 );
 //    glDisable( GL_BLEND );
 }
 
@@ -1439,40 +2063,40 @@ void fullscreen_ycbcr_quad( texture_t textureYCbCr[3], float gamma ) {
         const char* fs = fs_2_4_texel_ycbr_gamma_saturation;
 
         program = shader(vs, fs, "", "fragcolor" );
-        u_gamma = glGetUniformLocation(program, "u_gamma");
+        u_gamma = shader_uniform_location(program, "u_gamma");
 
-        uy = glGetUniformLocation(program, "u_texture_y");
-        ucb = glGetUniformLocation(program, "u_texture_cb");
-        ucr = glGetUniformLocation(program, "u_texture_cr");
+        uy = shader_uniform_location(program, "u_texture_y");
+        ucb = shader_uniform_location(program, "u_texture_cb");
+        ucr = shader_uniform_location(program, "u_texture_cr");
 
         glGenVertexArrays( 1, &vao );
     }
 
 //    glEnable( GL_BLEND );
-    glUseProgram( program );
-    glUniform1f( u_gamma, gamma );
+    glstate_use_program( program );
+    uniform_float( program, u_gamma, gamma );
 
-    glBindVertexArray( vao );
+    glstate_bind_vao( vao );
 
-    glUniform1i(uy, 0);
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D, textureYCbCr[0].id );
+    uniform_int(program, uy, 0);
+    glstate_active_texture(0);
+    glstate_bind_texture( GL_TEXTURE_2D, textureYCbCr[0].id );
 
-    glUniform1i(ucb, 1);
-    glActiveTexture( GL_TEXTURE1 );
-    glBindTexture( GL_TEXTURE_2D, textureYCbCr[1].id );
+    uniform_int(program, ucb, 1);
+    glstate_active_texture(1);
+    glstate_bind_texture( GL_TEXTURE_2D, textureYCbCr[1].id );
 
-    glUniform1i(ucr, 2);
-    glActiveTexture( GL_TEXTURE2 );
-    glBindTexture( GL_TEXTURE_2D, textureYCbCr[2].id );
+    uniform_int(program, ucr, 2);
+    glstate_active_texture(2);
+    glstate_bind_texture( GL_TEXTURE_2D, textureYCbCr[2].id );
 
     glDrawArrays( GL_TRIANGLES, 0, 6 );
     profile_incstat("drawcalls", +1);
     profile_incstat("triangles", +2);
 
-    glBindTexture( GL_TEXTURE_2D, 0 );
-    glBindVertexArray( 0 );
-    glUseProgram( 0 );
+    glstate_bind_texture( GL_TEXTURE_2D, 0 );
+    glstate_bind_vao( 0 );
+    glstate_use_program( 0 );
 //    glDisable( GL_BLEND );
 }
 
@@ -1481,32 +2105,182 @@ void fullscreen_ycbcr_quad( texture_t textureYCbCr[3], float gamma ) {
 
 typedef struct sprite_t {
     int cellw, cellh;         // dimensions of any cell in spritesheet
-    int frame, ncx, ncy;      // frame in a (num cellx, num celly) spritesheet
+    float u0, v0, u1, v1;     // texture rect of the cell
     float px, py, pz;         // origin x, y, depth
     float ox, oy, cos, sin;   // offset x, offset y, cos/sin of rotation degree
     float sx, sy;             // scale x,y
     uint32_t rgba;            // vertex color
+    int layer;                // layer in its sprite page
+    int rotated;              // texture rect stored 90 degrees clockwise (atlases)
 } sprite_t;
 
 // sprite batching
-typedef struct batch_t { array(sprite_t) sprites; mesh_t mesh; int dirty; } batch_t;
-typedef map(int, batch_t) batch_group_t; // mapkey is anything that forces a flush. texture_id for now, might be texture_id+program_id soon
+typedef struct batch_t { array(sprite_t) sprites; int first, count, dirty, layered; } batch_t; // first vertex & quads in the stream this frame
+typedef map(int, batch_t) batch_group_t; // mapkey is anything that forces a flush. sprite page (texture array) id, or texture_id if it cannot be paged
 
 // sprite stream
-typedef struct sprite_vertex { vec3 pos; vec2 uv; uint32_t rgba; } sprite_vertex;
+typedef struct sprite_vertex { vec3 pos; vec3 uv; uint32_t rgba; } sprite_vertex; // uv.z is the page layer
 typedef struct sprite_index  { GLuint triangle[3]; } sprite_index;
 
 #define sprite_vertex(...) M_CAST(sprite_vertex, __VA_ARGS__)
 #define sprite_index(...)  M_CAST(sprite_index, __VA_ARGS__)
 
+// persistent ring of vertices. every frame appends after the last one, unsynchronized; the buffer
+// is only orphaned when the ring wraps, so the gpu never sees a region being rewritten. all quads share one index buffer.
+static struct sprite_stream_t {
+    GLuint vao, vbo, ibo;
+    int capacity, head; // in vertices
+    int quads;          // quads covered by ibo
+} sprite_stream;
+
+// sprite pages: sprite textures of equal size and sampling are copied into the layers of one GL_TEXTURE_2D_ARRAY,
+// so hundreds of small sprite sheets share a single draw. float, depth, srgb and compressed textures are drawn on their own,
+// as are large ones (a full page of them would not pay off) and fbo render targets (rewritten every frame, copies go stale).
+enum { SPRITE_PAGE_LAYERS = 256 }; // minimum GL_MAX_ARRAY_TEXTURE_LAYERS on GL3
+enum { SPRITE_PAGE_SIZE = 512 };   // largest side paged. a full page is 256 MiB then
+
+typedef struct sprite_layer_t { GLuint source; int stale; } sprite_layer_t;
+
+typedef struct sprite_page_t {
+    GLuint id;                    // texture array
+    unsigned w, h, flags;         // size & sampling shared by every layer
+    array(sprite_layer_t) layers; // source texture of each layer, 0 if free
+    int allocated, dirty;         // layers with storage, any layer stale
+} sprite_page_t;
+
+static array(sprite_page_t) sprite_pages;
+static map(int, int) sprite_layers; // texture id > page << 16 | layer
+static map(int, int) sprite_targets; // texture ids attached to fbos: never paged
+static GLuint sprite_page_fbo;
+
 // sprite impl
 static int sprite_count = 0;
 static int sprite_program = -1;
-static array(sprite_index)  sprite_indices = 0;
-static array(sprite_vertex) sprite_vertices = 0;
+static int sprite_program_array = -1;
+
+static
+int sprite_pageable(texture_t t) {
+    return t.w && t.h && t.w <= SPRITE_PAGE_SIZE && t.h <= SPRITE_PAGE_SIZE
+        && !(t.flags & (TEXTURE_FLOAT|TEXTURE_DEPTH|TEXTURE_SRGB|TEXTURE_ARRAY|TEXTURE_BC1|TEXTURE_BC2|TEXTURE_BC3|TEXTURE_BC4|TEXTURE_BC5|TEXTURE_BC7))
+        && !(sprite_targets && map_find(sprite_targets, t.id));
+}
+
+// page << 16 | layer of a texture. a layer is claimed the first time the texture is drawn; -1 if not pageable
+static
+int sprite_layer(texture_t t) {
+    if( !sprite_pageable(t) ) return -1;
+    int *found = map_find(sprite_layers, t.id);
+    if( found ) return *found;
+
+    unsigned flags = t.flags & (TEXTURE_LINEAR|TEXTURE_MIPMAPS|TEXTURE_REPEAT|TEXTURE_BORDER);
+    int p, l = 0;
+    for( p = 0; p < array_count(sprite_pages); ++p ) {
+        sprite_page_t *pg = &sprite_pages[p];
+        if( pg->w != t.w || pg->h != t.h || pg->flags != flags ) continue;
+        for( l = 0; l < array_count(pg->layers); ++l ) if( !pg->layers[l].source ) break; // reuse freed layers
+        if( l < SPRITE_PAGE_LAYERS ) break;
+    }
+    if( p == array_count(sprite_pages) ) {
+        sprite_page_t pg = {0};
+        pg.w = t.w, pg.h = t.h, pg.flags = flags;
+        glGenTextures(1, &pg.id);
+        array_push(sprite_pages, pg);
+        l = 0;
+    }
+
+    sprite_page_t *pg = &sprite_pages[p];
+    if( l == array_count(pg->layers) ) array_push(pg->layers, ((sprite_layer_t){0}));
+    pg->layers[l].source = t.id, pg->layers[l].stale = 1, pg->dirty = 1;
+    return *map_insert(sprite_layers, t.id, p << 16 | l);
+}
+
+static
+void sprite_forget(unsigned texture_id) {
+    if( !sprite_pages ) return;
+    int *found = map_find(sprite_layers, texture_id);
+    if( found ) {
+        sprite_pages[*found >> 16].layers[*found & 0xFFFF].source = 0;
+        map_erase(sprite_layers, texture_id);
+    }
+}
+
+static
+void sprite_target(unsigned texture_id, bool attached) {
+    if( attached ) {
+        if( !sprite_targets ) map_init(sprite_targets, less_int, hash_int);
+        sprite_forget(texture_id); // may have been paged before
+        map_find_or_add(sprite_targets, texture_id, 1);
+    }
+    else if( sprite_targets ) map_erase(sprite_targets, texture_id);
+}
+
+// (re)allocates grown pages and copies stale layers from their source textures, gpu side
+static
+void sprite_pages_update() {
+    GLint saved_fb = -1;
+    for( int p = 0; p < array_count(sprite_pages); ++p ) {
+        sprite_page_t *pg = &sprite_pages[p];
+        if( !pg->dirty ) continue;
+
+        glstate_active_texture(0);
+        glstate_bind_texture(GL_TEXTURE_2D_ARRAY, pg->id);
+
+        int layers = array_count(pg->layers);
+        if( layers > pg->allocated ) {
+            // storage doubles. reallocation drops every layer, so all of them are copied again
+            int allocated = pg->allocated ? pg->allocated : 4;
+            while( allocated < layers ) allocated *= 2;
+            allocated = allocated < SPRITE_PAGE_LAYERS ? allocated : SPRITE_PAGE_LAYERS;
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, pg->w, pg->h, allocated, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+            texture_sampling(GL_TEXTURE_2D_ARRAY, pg->flags);
+
+            for( int l = 0; l < layers; ++l ) pg->layers[l].stale = !!pg->layers[l].source;
+            pg->allocated = allocated;
+        }
+
+        if( saved_fb < 0 ) {
+            if( !sprite_page_fbo ) glGenFramebuffers(1, &sprite_page_fbo);
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &saved_fb);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, sprite_page_fbo);
+        }
+        for( int l = 0; l < layers; ++l ) {
+            if( !pg->layers[l].stale ) continue;
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pg->layers[l].source, 0);
+            glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, l, 0, 0, pg->w, pg->h);
+            pg->layers[l].stale = 0;
+            profile_incstat("sprite layers copied", +1);
+        }
+        if( pg->flags & TEXTURE_MIPMAPS ) glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        pg->dirty = 0;
+    }
+    if( saved_fb >= 0 ) {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, saved_fb);
+    }
+}
 static batch_group_t sprite_additive_group = {0};
 static batch_group_t sprite_translucent_group = {0};
 
+static
+void sprite_queue( texture_t texture, sprite_t s, int additive ) {
+    // batch by sprite page when the texture fits in one, else by texture
+    int layer = sprite_layer(texture), key = texture.id;
+    s.layer = layer >= 0 ? layer & 0xFFFF : 0;
+    if( layer >= 0 ) key = sprite_pages[layer >> 16].id;
+
+    batch_group_t *batches = additive == 1 ? &sprite_additive_group : &sprite_translucent_group;
+#if 0
+    batch_t *found = map_find(*batches, key);
+    if( !found ) found = map_insert(*batches, key, (batch_t){0});
+#else
+    batch_t *found = map_find_or_add(*batches, key, (batch_t){0});
+#endif
+
+    found->layered = layer >= 0;
+    array_push(found->sprites, s);
+}
+
 void sprite( texture_t texture, float px, float py, float pz, float rot ) {
     sprite_ex( texture,
         px,py,pz, rot,                 // position (x,y,depth), rotation angle
@@ -1527,19 +2301,25 @@ void sprite_ex( texture_t texture,
 
     // no need to queue if alpha or scale are zero
     if( sx && sy && alpha(rgba) ) {
+        int ncx = xcells ? xcells : 1, ncy = ycells ? ycells : 1, idx = (int)frame;
+        float cx = (1.0f / ncx) - 1e-9f;
+        float cy = (1.0f / ncy) - 1e-9f;
+
         sprite_t s;
         s.px = px;
         s.py = py;
         s.pz = pz;
-        s.frame = frame;
-        s.ncx = xcells ? xcells : 1;
-        s.ncy = ycells ? ycells : 1;
+        s.u0 = (idx % ncx) * cx;
+        s.v0 = (idx / ncx) * cy;
+        s.u1 = s.u0 + cx;
+        s.v1 = s.v0 + cy;
+        s.rotated = 0;
         s.sx = sx;
         s.sy = sy;
         s.ox = ox * sx;
         s.oy = oy * sy;
-        s.cellw = texture.x * sx / s.ncx;
-        s.cellh = texture.y * sy / s.ncy;
+        s.cellw = texture.x * sx / ncx;
+        s.cellh = texture.y * sy / ncy;
         s.rgba = rgba;
         s.cos = 1;
         s.sin = 0;
@@ -1549,138 +2329,272 @@ void sprite_ex( texture_t texture,
             s.sin = sinf(rotation);
         }
 
-        batch_group_t *batches = additive == 1 ? &sprite_additive_group : &sprite_translucent_group;
-#if 0
-        batch_t *found = map_find(*batches, texture.id);
-        if( !found ) found = map_insert(*batches, texture.id, (batch_t){0});
-#else
-        batch_t *found = map_find_or_add(*batches, texture.id, (batch_t){0});
-#endif
+        sprite_queue(texture, s, additive);
+    }
+}
+
+void sprite_atlas( atlas_t a, const char *name, float px, float py, float pz, float rotation ) {
+    int found = atlas_find(a, name);
+    if( found < 0 ) return;
+
+    const atlas_frame_t *f = &a.frames[found];
+    float iw = 1.f / a.texture.w, ih = 1.f / a.texture.h;
+
+    sprite_t s;
+    s.px = px;
+    s.py = py;
+    s.pz = pz;
+    s.u0 = f->x * iw;
+    s.v0 = f->y * ih;
+    s.u1 = (f->x + f->w) * iw;
+    s.v1 = (f->y + f->h) * ih;
+    s.rotated = f->rotated;
+    s.sx = 1;
+    s.sy = 1;
+    s.cellw = f->rotated ? f->h : f->w;
+    s.cellh = f->rotated ? f->w : f->h;
+    s.ox = f->ox + s.cellw / 2 - f->ow / 2.f; // trimmed quad lands where the whole image would
+    s.oy = f->oy + s.cellh / 2 - f->oh / 2.f;
+    s.rgba = ~0u;
+    s.cos = 1;
+    s.sin = 0;
+    if(rotation) {
+        rotation = (rotation + 0) * ((float)C_PI / 180);
+        s.cos = cosf(rotation);
+        s.sin = sinf(rotation);
+    }
+
+    sprite_queue(a.texture, s, 0);
+}
+
+// drops sprites fully outside the [0,w]x[0,h] screen. compacts in place, returns the survivors
+static
+int sprite_cull(sprite_t *s, int n, float w, float h) {
+    int kept = 0;
+    for( int i = 0; i < n; ++i ) {
+        // bounding circle of any rotation: offset plus half the cell diagonal (+1 for integer halving)
+        float r = sqrtf(s[i].ox * s[i].ox + s[i].oy * s[i].oy) + 0.5f * sqrtf((float)s[i].cellw * s[i].cellw + (float)s[i].cellh * s[i].cellh) + 1;
+        if( s[i].px + r < 0 || s[i].px - r > w || s[i].py + r < 0 || s[i].py - r > h ) continue;
+        s[kept++] = s[i];
+    }
+    return kept;
+}
+
+// 4 vertices per sprite, written in place. one sprite per iteration (aos in, interleaved vertices out); threaded when large
+static
+void sprite_expand(const sprite_t *s, int n, sprite_vertex *out) {
+    int i;
+    #pragma omp parallel for if(n > 8192)
+    for( i = 0; i < n; ++i ) {
+        const sprite_t *it = &s[i];
+        float x0 = it->ox - it->cellw/2, x3 = x0 + it->cellw;
+        float y0 = it->oy - it->cellh/2, y3 = y0;
+        float x1 = x0,                   x2 = x3;
+        float y1 = y0 + it->cellh,       y2 = y1;
+
+        // @todo: move this affine transform into glsl shader
+        vec3 v0 = { it->px + ( x0 * it->cos - y0 * it->sin ), it->py + ( x0 * it->sin + y0 * it->cos ), it->pz };
+        vec3 v1 = { it->px + ( x1 * it->cos - y1 * it->sin ), it->py + ( x1 * it->sin + y1 * it->cos ), it->pz };
+        vec3 v2 = { it->px + ( x2 * it->cos - y2 * it->sin ), it->py + ( x2 * it->sin + y2 * it->cos ), it->pz };
+        vec3 v3 = { it->px + ( x3 * it->cos - y3 * it->sin ), it->py + ( x3 * it->sin + y3 * it->cos ), it->pz };
+
+        float ux = it->u0, uy = it->v0;
+        float vx = it->u1, vy = it->v1, layer = it->layer;
+
+        vec3 ta = vec3(ux, uy, layer), tb = vec3(ux, vy, layer), tc = vec3(vx, vy, layer), td = vec3(vx, uy, layer);
+        if( it->rotated ) { vec3 t = ta; ta = td, td = tc, tc = tb, tb = t; } // rect turned 90 degrees clockwise
+
+        sprite_vertex *v = &out[i * 4];
+        v[0] = sprite_vertex(v0, ta, it->rgba); // Vertex 0 (A)
+        v[1] = sprite_vertex(v1, tb, it->rgba); // Vertex 1 (B)
+        v[2] = sprite_vertex(v2, tc, it->rgba); // Vertex 2 (C)
+        v[3] = sprite_vertex(v3, td, it->rgba); // Vertex 3 (D)
+    }
+}
+
+// grows the index buffer shared by all batches, which draw from their own base vertex
+static
+void sprite_stream_indices(int quads) {
+    if( quads <= sprite_stream.quads ) return;
+    int capacity = sprite_stream.quads ? sprite_stream.quads : 1024;
+    while( capacity < quads ) capacity *= 2;
+
+    //      A--B                  A               A-B
+    // quad |  | becomes triangle |\  and triangle \|
+    //      D--C                  D-C               C
+    array(sprite_index) indices = 0;
+    array_resize(indices, capacity * 2);
+    for( int q = 0; q < capacity; ++q ) {
+        GLuint A = q*4+0, B = q*4+1, C = q*4+2, D = q*4+3;
+        indices[q*2+0] = sprite_index(C, D, A); // Triangle 1
+        indices[q*2+1] = sprite_index(C, A, B); // Triangle 2
+    }
+
+    glstate_bind_vao(sprite_stream.vao);
+    glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, sprite_stream.ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, capacity * 2 * sizeof(sprite_index), indices, GL_STATIC_DRAW);
+    array_free(indices);
+
+    sprite_stream.quads = capacity;
+}
+
+static
+void sprite_stream_create() {
+    if( sprite_stream.vao ) return;
+
+    glGenVertexArrays(1, &sprite_stream.vao);
+    glGenBuffers(1, &sprite_stream.vbo);
+    glGenBuffers(1, &sprite_stream.ibo);
+
+    glstate_bind_vao(sprite_stream.vao);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, sprite_stream.vbo);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(sprite_vertex), (GLvoid*)offsetof(sprite_vertex, pos));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(sprite_vertex), (GLvoid*)offsetof(sprite_vertex, uv));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(sprite_vertex), (GLvoid*)offsetof(sprite_vertex, rgba));
+    for( int i = 0; i < 3; ++i ) glEnableVertexAttribArray(i);
+}
 
-        array_push(found->sprites, s);
+// maps room for this frame's vertices at the ring head
+static
+sprite_vertex *sprite_stream_map(int vertices) {
+    glstate_bind_buffer(GL_ARRAY_BUFFER, sprite_stream.vbo);
+    if( vertices > sprite_stream.capacity ) {
+        // room for a few frames, so the ring seldom wraps
+        int capacity = sprite_stream.capacity ? sprite_stream.capacity : 64 * 1024;
+        while( capacity < vertices * 4 ) capacity *= 2;
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(sprite_vertex), NULL, GL_STREAM_DRAW);
+        sprite_stream.capacity = capacity, sprite_stream.head = 0;
+    }
+    else if( sprite_stream.head + vertices > sprite_stream.capacity ) {
+        glBufferData(GL_ARRAY_BUFFER, sprite_stream.capacity * sizeof(sprite_vertex), NULL, GL_STREAM_DRAW); // orphan
+        sprite_stream.head = 0;
     }
+
+    return (sprite_vertex*)glMapBufferRange(GL_ARRAY_BUFFER, sprite_stream.head * sizeof(sprite_vertex), vertices * sizeof(sprite_vertex),
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
 }
 
 static void sprite_rebuild_meshes() {
     sprite_count = 0;
 
+    // cull off-screen sprites, then lay every batch out in this frame's stream
+    float w = window_width(), h = window_height();
+    int vertices = 0, largest = 0;
+
     batch_group_t* list[] = { &sprite_additive_group, &sprite_translucent_group };
     for( int l = 0; l < countof(list); ++l) {
         for each_map_ptr(*list[l], int,_, batch_t,bt) {
+            int queued = array_count(bt->sprites);
+            bt->count = sprite_cull(bt->sprites, queued, w, h);
+            bt->first = vertices;
+            bt->dirty = bt->count ? 1 : 0;
+
+            vertices += bt->count * 4;
+            largest = bt->count > largest ? bt->count : largest;
+            sprite_count += queued;
+            profile_incstat("sprites culled", queued - bt->count);
+        }
+    }
 
-            bt->dirty = array_count(bt->sprites) ? 1 : 0;
-            if( !bt->dirty ) continue;
-
-            int index = 0;
-            array_clear(sprite_indices);
-            array_clear(sprite_vertices);
-
-            array_foreach_ptr(bt->sprites, sprite_t,it ) {
-                float x0 = it->ox - it->cellw/2, x3 = x0 + it->cellw;
-                float y0 = it->oy - it->cellh/2, y3 = y0;
-                float x1 = x0,                   x2 = x3;
-                float y1 = y0 + it->cellh,       y2 = y1;
-
-                // @todo: move this affine transform into glsl shader
-                vec3 v0 = { it->px + ( x0 * it->cos - y0 * it->sin ), it->py + ( x0 * it->sin + y0 * it->cos ), it->pz };
-                vec3 v1 = { it->px + ( x1 * it->cos - y1 * it->sin ), it->py + ( x1 * it->sin + y1 * it->cos ), it->pz };
-                vec3 v2 = { it->px + ( x2 * it->cos - y2 * it->sin ), it->py + ( x2 * it->sin + y2 * it->cos ), it->pz };
-                vec3 v3 = { it->px + ( x3 * it->cos - y3 * it->sin ), it->py + ( x3 * it->sin + y3 * it->cos ), it->pz };
-
-                float cx = (1.0f / it->ncx) - 1e-9f;
-                float cy = (1.0f / it->ncy) - 1e-9f;
-                int idx = (int)it->frame;
-                int px = idx % it->ncx;
-                int py = idx / it->ncx;
-
-                float ux = px * cx, uy = py * cy;
-                float vx = ux + cx, vy = uy + cy;
-
-                vec2 uv0 = vec2(ux, uy);
-                vec2 uv1 = vec2(ux, vy);
-                vec2 uv2 = vec2(vx, vy);
-                vec2 uv3 = vec2(vx, uy);
-
-                array_push( sprite_vertices, sprite_vertex(v0, uv0, it->rgba) ); // Vertex 0 (A)
-                array_push( sprite_vertices, sprite_vertex(v1, uv1, it->rgba) ); // Vertex 1 (B)
-                array_push( sprite_vertices, sprite_vertex(v2, uv2, it->rgba) ); // Vertex 2 (C)
-                array_push( sprite_vertices, sprite_vertex(v3, uv3, it->rgba) ); // Vertex 3 (D)
-
-                //      A--B                  A               A-B
-                // quad |  | becomes triangle |\  and triangle \|
-                //      D--C                  D-C               C
-                GLuint A = (index+0), B = (index+1), C = (index+2), D = (index+3); index += 4;
-
-                array_push( sprite_indices, sprite_index(C, D, A) ); // Triangle 1
-                array_push( sprite_indices, sprite_index(C, A, B) ); // Triangle 2
-            }
+    sprite_vertex *stream = 0;
+    if( vertices ) {
+        sprite_pages_update();
+        sprite_stream_create();
+        sprite_stream_indices(largest);
+        stream = sprite_stream_map(vertices);
+    }
 
-            mesh_upgrade(&bt->mesh, "p3 t2 c4b", 0,array_count(sprite_vertices),sprite_vertices, 3*array_count(sprite_indices),sprite_indices, MESH_STATIC);
+    for( int l = 0; l < countof(list); ++l) {
+        for each_map_ptr(*list[l], int,_, batch_t,bt) {
+            if( bt->dirty && stream ) sprite_expand(bt->sprites, bt->count, stream + bt->first);
+            bt->first += sprite_stream.head;
+            bt->dirty &= !!stream;
 
             // clear elements from queue
-            sprite_count += array_count(bt->sprites);
             array_clear(bt->sprites);
         }
     }
+
+    if( stream ) {
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        sprite_stream.head += vertices;
+    }
+}
+
+static void sprite_draw(batch_t *bt) {
+    glDrawElementsBaseVertex(GL_TRIANGLES, 6 * bt->count, GL_UNSIGNED_INT, (char*)0, bt->first);
+    profile_incstat("drawcalls", +1);
+    profile_incstat("sprite draws", +1);
+    profile_incstat("triangles", 2 * bt->count);
+}
+
+// one draw per sprite page (or unpaged texture) in the group
+static void sprite_draw_group(batch_group_t *group) {
+    for each_map_ptr(*group, int,texture_id, batch_t,bt) {
+        if( bt->dirty ) {
+            shader_bind(bt->layered ? sprite_program_array : sprite_program);
+            glstate_bind_texture(bt->layered ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, *texture_id);
+            sprite_draw(bt);
+        }
+    }
 }
 
 static void sprite_render_meshes() {
     if( sprite_program < 0 ) {
-        sprite_program = shader( vs_324_24_sprite, fs_24_4_sprite,
+        sprite_program = shader( vs_334_34_sprite, fs_34_4_sprite,
+            "att_Position,att_TexCoord,att_Color",
+            "fragColor"
+        );
+        sprite_program_array = shader( vs_334_34_sprite, fs_34_4_sprite_array,
             "att_Position,att_TexCoord,att_Color",
             "fragColor"
         );
     }
 
-    // use the shader and  bind the texture @ unit 0
-    shader_bind(sprite_program);
-    glActiveTexture(GL_TEXTURE0);
-
     // setup rendering state
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glDepthFunc(GL_LEQUAL); // try to help with zfighting
+    glstate_enable(GL_DEPTH_TEST, 1);
+    glstate_enable(GL_BLEND, 1);
+    glstate_depth_func(GL_LEQUAL); // try to help with zfighting
 
-    // update camera and set mvp in the uniform
+    // update camera and set mvp & (unit 0) texture sampler in the uniforms of both programs
     mat44 mvp2d;
     float zdepth_max = window_height(); // 1;
     ortho44(mvp2d, 0, window_width(), window_height(), 0, -zdepth_max, +zdepth_max);
-    shader_mat44("u_mvp", mvp2d);
+    unsigned programs[] = { sprite_program, sprite_program_array };
+    for( int i = 0; i < countof(programs); ++i ) {
+        shader_bind(programs[i]);
+        uniform_mat44(programs[i], shader_uniform_location(programs[i], "u_mvp"), mvp2d);
+        uniform_int(programs[i], shader_uniform_location(programs[i], "u_texture"), 0);
+    }
+    glstate_active_texture(0);
+    glstate_bind_vao(sprite_stream.vao);
 
-    // set (unit 0) in the uniform texture sampler, and render batch
-    // for all additive then translucent groups
+    // render all additive then translucent groups.
+    // depth layering is resolved by the depth test, so pages need no further split per depth
 
     if( map_count(sprite_additive_group) > 0 ) {
-        glBlendFunc( GL_SRC_ALPHA, GL_ONE );
-        for each_map_ptr(sprite_additive_group, int,texture_id, batch_t,bt) {
-            if( bt->dirty ) {
-                shader_texture("u_texture", *texture_id, 0);
-                mesh_render(&bt->mesh);
-            }
-        }
+        glstate_blend_func( GL_SRC_ALPHA, GL_ONE );
+        sprite_draw_group(&sprite_additive_group);
 //        map_clear(sprite_additive_group);
     }
 
     if( map_count(sprite_translucent_group) > 0 ) {
-        glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
-        for each_map_ptr(sprite_translucent_group, int,texture_id, batch_t,bt) {
-            if( bt->dirty ) {
-                shader_texture("u_texture", *texture_id, 0);
-                mesh_render(&bt->mesh);
-            }
-        }
+        glstate_blend_func( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+        sprite_draw_group(&sprite_translucent_group);
 //        map_clear(sprite_translucent_group);
     }
 
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
-    glDepthFunc(GL_LESS);
-    glUseProgram(0);
+    glstate_bind_vao(0);
+    glstate_enable(GL_DEPTH_TEST, 0);
+    glstate_enable(GL_BLEND, 0);
+    glstate_depth_func(GL_LESS);
+    glstate_use_program(0);
 }
 
 static void sprite_init() {
     map_init(sprite_translucent_group, less_int, hash_int);
     map_init(sprite_additive_group, less_int, hash_int);
+    map_init(sprite_layers, less_int, hash_int);
 }
 
 static void sprite_update() {
@@ -1692,6 +2606,46 @@ static void sprite_update() {
     }
 }
 
+// -----------------------------------------------------------------------------
+// atlases
+
+atlas_t atlas(const char *pathfile, int flags) {
+    atlas_t a = {0};
+    int size = 0;
+    const char *data = vfs_acquire(pathfile, &size); // cooked by the .atlas stage in fwk_cooker
+    unsigned header[4] = {0};
+    if( data && size >= sizeof(header) ) memcpy(header, data, sizeof(header));
+
+    uint64_t expected = sizeof(header) + (uint64_t)header[3] * sizeof(atlas_frame_t) + (uint64_t)header[1] * header[2] * 4;
+    if( memcmp(header, "ATL1", 4) || size < expected ) {
+        PRINTF("!cannot load atlas (%s)\n", pathfile);
+        vfs_release(data);
+        return a;
+    }
+
+    a.count = header[3];
+    a.frames = REALLOC(0, sizeof(atlas_frame_t) * (a.count + !a.count));
+    memcpy(a.frames, data + sizeof(header), sizeof(atlas_frame_t) * a.count);
+    a.texture = texture_create(header[1], header[2], 4, (void*)(data + sizeof(header) + sizeof(atlas_frame_t) * a.count), flags);
+    vfs_release(data);
+    return a;
+}
+
+int atlas_find(atlas_t a, const char *name) {
+    for( int lo = 0, hi = a.count - 1; lo <= hi; ) { // frames are sorted by name
+        int mid = (lo + hi) / 2, cmp = strcmp(name, a.frames[mid].name);
+        if( !cmp ) return mid;
+        if( cmp < 0 ) hi = mid - 1; else lo = mid + 1;
+    }
+    return -1;
+}
+
+void atlas_destroy(atlas_t *a) {
+    texture_destroy(&a->texture);
+    FREE(a->frames);
+    a->frames = 0, a->count = 0;
+}
+
 // -----------------------------------------------------------------------------
 // cubemaps
 
@@ -1769,7 +2723,7 @@ cubemap_t cubemap6( const image_t images[6], int flags ) {
     cubemap_t c = {0}, z = {0};
 
     glGenTextures(1, &c.id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, c.id);
+    glstate_bind_texture(GL_TEXTURE_CUBE_MAP, c.id);
 
     int samples = 0;
     for (int i = 0; i < 6; i++) {
@@ -1818,7 +2772,7 @@ cubemap_t cubemap6( const image_t images[6], int flags ) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, glGenerateMipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glstate_bind_texture(GL_TEXTURE_CUBE_MAP, 0);
 
     return c;
 }
@@ -1837,6 +2791,7 @@ cubemap_t cubemap( const image_t in, int flags ) {
 
 void cubemap_destroy(cubemap_t *c) {
     glDeleteTextures(1, &c->id);
+    glstate_invalidate();
     c->id = 0; // do not destroy SH coefficients still. they might be useful in the future.
 }
 
@@ -1891,9 +2846,9 @@ int skybox_push_state(skybox_t *sky, mat44 proj, mat44 view) {
 
 //glClear(GL_DEPTH_BUFFER_BIT);
 //glEnable(GL_DEPTH_TEST);
-glDepthFunc(GL_LEQUAL);
+glstate_depth_func(GL_LEQUAL);
 //glDisable(GL_CULL_FACE);
-glDisable(GL_DEPTH_TEST);
+glstate_enable(GL_DEPTH_TEST, 0);
 
     mat44 mvp; multiply44x2(mvp, proj, view);
 
@@ -1911,7 +2866,7 @@ int skybox_pop_state(skybox_t *sky) {
     return 0;
 }
 void skybox_destroy(skybox_t *sky) {
-    glDeleteProgram(sky->program);
+    shader_destroy(sky->program);
     cubemap_destroy(&sky->cubemap);
     mesh_destroy(&sky->geometry);
 }
@@ -1962,14 +2917,14 @@ void mesh_upgrade(mesh_t *m, const char *format, int vertex_stride,int vertex_co
 
     // layout
     if(!m->vao) glGenVertexArrays(1, &m->vao);
-    glBindVertexArray(m->vao);
+    glstate_bind_vao(m->vao);
 
     // index data
     if( index_data && index_count ) {
         m->index_count = index_count;
 
         if(!m->ibo) glGenBuffers(1, &m->ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m->ibo);
+        glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, m->ibo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, m->index_count * sizeof_index, index_data, flags & MESH_STREAM ? GL_STREAM_DRAW : GL_STATIC_DRAW);
     }
 
@@ -1978,7 +2933,7 @@ void mesh_upgrade(mesh_t *m, const char *format, int vertex_stride,int vertex_co
         m->vertex_count = vertex_count;
 
         if(!m->vbo) glGenBuffers(1, &m->vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, m->vbo);
+        glstate_bind_buffer(GL_ARRAY_BUFFER, m->vbo);
         glBufferData(GL_ARRAY_BUFFER, m->vertex_count * sizeof_vertex, vertex_data, flags & MESH_STREAM ? GL_STREAM_DRAW : GL_STATIC_DRAW);
     }
 
@@ -1999,7 +2954,7 @@ void mesh_upgrade(mesh_t *m, const char *format, int vertex_stride,int vertex_co
         }
     }
 
-    glBindVertexArray(0);
+    glstate_bind_vao(0);
 }
 
 void mesh_pop_state(mesh_t *sm) {
@@ -2007,9 +2962,9 @@ void mesh_pop_state(mesh_t *sm) {
 }
 
 void mesh_push_state(mesh_t *sm, unsigned program, unsigned texture_id, float model[16], float view[16], float proj[16], unsigned billboard) {
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glActiveTexture(GL_TEXTURE0);
+    glstate_enable(GL_DEPTH_TEST, 1);
+    glstate_depth_func(GL_LESS);
+    glstate_active_texture(0);
 
     shader_bind(program);
 
@@ -2025,17 +2980,16 @@ void mesh_push_state(mesh_t *sm, unsigned program, unsigned texture_id, float mo
     shader_mat44("u_mvp", mvp);
 
     if (cubemap_get_active()) {
-    GLuint uniform_loc = glGetUniformLocation(program, "u_coefficients_sh");
-    glUniform3fv(uniform_loc, 9, &cubemap_get_active()->sh[0].x);
+    uniform_vec3v(program, shader_uniform_location(program, "u_coefficients_sh"), 9, &cubemap_get_active()->sh[0].x);
     }
 
     shader_texture("u_texture2d", texture_id, 0);
 }
 
 void mesh_render(mesh_t *sm) {
-    glBindVertexArray(sm->vao);
+    glstate_bind_vao(sm->vao);
     if( sm->ibo ) { // with indices
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sm->ibo); // <-- why intel?
+        glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, sm->ibo); // <-- why intel?
         glDrawElements(sm->flags & MESH_TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES, sm->index_count, GL_UNSIGNED_INT, (char*)0);
         profile_incstat("drawcalls", +1);
         profile_incstat("triangles", sm->index_count/3);
@@ -2060,7 +3014,7 @@ void* screenshot( unsigned n ) { // 3 RGB, 4 RGBA, -3 BGR, -4 BGRA
     pixels = (uint8_t*)REALLOC(pixels, w * h * 4 );
 #if 0
     // sync, 10 ms
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0); // disable any pbo, in case somebody did for us
+    glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, 0); // disable any pbo, in case somebody did for us
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
     glReadBuffer(GL_FRONT);
     glReadPixels(0, 0, w, h, mode, GL_UNSIGNED_BYTE, pixels);
@@ -2080,18 +3034,18 @@ void* screenshot( unsigned n ) { // 3 RGB, 4 RGBA, -3 BGR, -4 BGRA
         // @fixme: delete previous pbos
         for( int i = 0; i < NUM_PBOS; ++i ) {
         glGenBuffers(1, &pbo[i]);
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+        glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
         glBufferData(GL_PIXEL_PACK_BUFFER, w * h * 4, NULL, GL_STREAM_READ); // GL_STATIC_READ);
         }
     }
 
     if (frame < NUM_PBOS) {
         // do setup during initial frames
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[bound]);
+        glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, pbo[bound]);
         glReadPixels(0, 0, w, h, mode, GL_UNSIGNED_BYTE, (GLvoid*)((GLchar*)NULL+0));
     } else {
         // read from oldest bound pbo
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[bound]);
+        glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, pbo[bound]);
         void *ptr = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
         memcpy(pixels, ptr, w * h * abs(n));
         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
@@ -2103,7 +3057,7 @@ void* screenshot( unsigned n ) { // 3 RGB, 4 RGBA, -3 BGR, -4 BGRA
     frame += frame >= 0 && frame < NUM_PBOS;
     frame *= frame == NUM_PBOS ? -1 : +1;
 
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
     return pixels;
 #endif
 }
@@ -2137,7 +3091,7 @@ unsigned fbo(unsigned color_texture_id, unsigned depth_texture_id, int flags) {
     glGenFramebuffers(1, &fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
-    if( color_texture_id ) glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture_id, 0);
+    if( color_texture_id ) glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture_id, 0), sprite_target(color_texture_id, 1);
     if( depth_texture_id ) glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_texture_id, 0);
 #if 0 // this is working; it's just not enabled for now
     else {
@@ -2288,35 +3242,35 @@ bool postfx_load_from_mem( postfx *fx, const char *name, const char *fs ) {
 
     FREE(fs2);
 
-    glUseProgram(p->program); // needed?
+    glstate_use_program(p->program); // needed?
 
     for( int i = 0; i < countof(p->uniforms); ++i ) p->uniforms[i] = -1;
 
-    if( p->uniforms[u_time] == -1 )   p->uniforms[u_time] = glGetUniformLocation(p->program, "iTime");
+    if( p->uniforms[u_time] == -1 )   p->uniforms[u_time] = shader_uniform_location(p->program, "iTime");
 
-    if( p->uniforms[u_frame] == -1 )   p->uniforms[u_frame] = glGetUniformLocation(p->program, "iFrame");
+    if( p->uniforms[u_frame] == -1 )   p->uniforms[u_frame] = shader_uniform_location(p->program, "iFrame");
 
-    if( p->uniforms[u_width] == -1 )  p->uniforms[u_width] = glGetUniformLocation(p->program, "iWidth");
-    if( p->uniforms[u_height] == -1 ) p->uniforms[u_height] = glGetUniformLocation(p->program, "iHeight");
+    if( p->uniforms[u_width] == -1 )  p->uniforms[u_width] = shader_uniform_location(p->program, "iWidth");
+    if( p->uniforms[u_height] == -1 ) p->uniforms[u_height] = shader_uniform_location(p->program, "iHeight");
 
-    if( p->uniforms[u_mousex] == -1 ) p->uniforms[u_mousex] = glGetUniformLocation(p->program, "iMousex");
-    if( p->uniforms[u_mousey] == -1 ) p->uniforms[u_mousey] = glGetUniformLocation(p->program, "iMousey");
+    if( p->uniforms[u_mousex] == -1 ) p->uniforms[u_mousex] = shader_uniform_location(p->program, "iMousex");
+    if( p->uniforms[u_mousey] == -1 ) p->uniforms[u_mousey] = shader_uniform_location(p->program, "iMousey");
 
-    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = glGetUniformLocation(p->program, "tex");
-    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = glGetUniformLocation(p->program, "tex0");
-    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = glGetUniformLocation(p->program, "tColor");
-    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = glGetUniformLocation(p->program, "tDiffuse");
-    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = glGetUniformLocation(p->program, "iChannel0");
+    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = shader_uniform_location(p->program, "tex");
+    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = shader_uniform_location(p->program, "tex0");
+    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = shader_uniform_location(p->program, "tColor");
+    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = shader_uniform_location(p->program, "tDiffuse");
+    if( p->uniforms[u_color] == -1 ) p->uniforms[u_color] = shader_uniform_location(p->program, "iChannel0");
 
-    if( p->uniforms[u_depth] == -1 ) p->uniforms[u_depth] = glGetUniformLocation(p->program, "tex1");
-    if( p->uniforms[u_depth] == -1 ) p->uniforms[u_depth] = glGetUniformLocation(p->program, "tDepth");
-    if( p->uniforms[u_depth] == -1 ) p->uniforms[u_depth] = glGetUniformLocation(p->program, "iChannel1");
+    if( p->uniforms[u_depth] == -1 ) p->uniforms[u_depth] = shader_uniform_location(p->program, "tex1");
+    if( p->uniforms[u_depth] == -1 ) p->uniforms[u_depth] = shader_uniform_location(p->program, "tDepth");
+    if( p->uniforms[u_depth] == -1 ) p->uniforms[u_depth] = shader_uniform_location(p->program, "iChannel1");
 
-    if( p->uniforms[u_channelres0x] == -1 ) p->uniforms[u_channelres0x] = glGetUniformLocation(p->program, "iChannelRes0x");
-    if( p->uniforms[u_channelres0y] == -1 ) p->uniforms[u_channelres0y] = glGetUniformLocation(p->program, "iChannelRes0y");
+    if( p->uniforms[u_channelres0x] == -1 ) p->uniforms[u_channelres0x] = shader_uniform_location(p->program, "iChannelRes0x");
+    if( p->uniforms[u_channelres0y] == -1 ) p->uniforms[u_channelres0y] = shader_uniform_location(p->program, "iChannelRes0y");
 
-    if( p->uniforms[u_channelres1x] == -1 ) p->uniforms[u_channelres1x] = glGetUniformLocation(p->program, "iChannelRes1x");
-    if( p->uniforms[u_channelres1y] == -1 ) p->uniforms[u_channelres1y] = glGetUniformLocation(p->program, "iChannelRes1y");
+    if( p->uniforms[u_channelres1x] == -1 ) p->uniforms[u_channelres1x] = shader_uniform_location(p->program, "iChannelRes1x");
+    if( p->uniforms[u_channelres1y] == -1 ) p->uniforms[u_channelres1y] = shader_uniform_location(p->program, "iChannelRes1y");
 
     // set quad
     glGenVertexArrays(1, &p->m.vao);
@@ -2403,7 +3357,7 @@ bool postfx_end(postfx *fx) {
     fbo_unbind();
 
     // disable depth test in 2d rendering
-    glDisable(GL_DEPTH_TEST);
+    glstate_enable(GL_DEPTH_TEST, 0);
 
     int frame = 0;
     float t = time_ms() / 1000.f;
@@ -2417,44 +3371,44 @@ bool postfx_end(postfx *fx) {
             passfx *pass = &fx->pass[i];
 
             if( !pass->program ) { --num_active_passes; continue; }
-            glUseProgram(pass->program);
+            glstate_use_program(pass->program);
 
             // bind texture to texture unit 0
             // shader_texture(fx->diffuse[frame], 0);
- glActiveTexture(GL_TEXTURE0 + 0);            glBindTexture(GL_TEXTURE_2D, fx->diffuse[frame].id);
-            glUniform1i(pass->uniforms[u_color], 0);
+ glstate_active_texture(0);            glstate_bind_texture(GL_TEXTURE_2D, fx->diffuse[frame].id);
+            uniform_int(pass->program, pass->uniforms[u_color], 0);
 
-            glUniform1f(pass->uniforms[u_channelres0x], fx->diffuse[frame].w);
-            glUniform1f(pass->uniforms[u_channelres0y], fx->diffuse[frame].h);
+            uniform_float(pass->program, pass->uniforms[u_channelres0x], fx->diffuse[frame].w);
+            uniform_float(pass->program, pass->uniforms[u_channelres0y], fx->diffuse[frame].h);
 
             // bind depth to texture unit 1
             // shader_texture(fx->depth[frame], 1);
- glActiveTexture(GL_TEXTURE0 + 1);            glBindTexture(GL_TEXTURE_2D, fx->depth[frame].id);
-            glUniform1i(pass->uniforms[u_depth], 1);
+ glstate_active_texture(1);            glstate_bind_texture(GL_TEXTURE_2D, fx->depth[frame].id);
+            uniform_int(pass->program, pass->uniforms[u_depth], 1);
 
             // bind uniforms
             static unsigned f = 0; ++f;
-            glUniform1f(pass->uniforms[u_time], t);
-            glUniform1f(pass->uniforms[u_frame], f-1);
-            glUniform1f(pass->uniforms[u_width], w);
-            glUniform1f(pass->uniforms[u_height], h);
+            uniform_float(pass->program, pass->uniforms[u_time], t);
+            uniform_float(pass->program, pass->uniforms[u_frame], f-1);
+            uniform_float(pass->program, pass->uniforms[u_width], w);
+            uniform_float(pass->program, pass->uniforms[u_height], h);
 
-            glUniform1f(pass->uniforms[u_mousex], mx);
-            glUniform1f(pass->uniforms[u_mousey], my);
+            uniform_float(pass->program, pass->uniforms[u_mousex], mx);
+            uniform_float(pass->program, pass->uniforms[u_mousey], my);
 
             // bind the vao
             int bound = --num_active_passes;
             if( bound ) fbo_bind(fx->fb[frame ^= 1]);
 
                 // fullscreen quad
-                glBindVertexArray(pass->m.vao);
+                glstate_bind_vao(pass->m.vao);
                 glDrawArrays(GL_TRIANGLES, 0, 6);
                 profile_incstat("drawcalls", +1);
                 profile_incstat("triangles", +2);
-                glBindVertexArray(0);
+                glstate_bind_vao(0);
 
             if( bound ) fbo_unbind();
-            else glUseProgram(0);
+            else glstate_use_program(0);
         }
     }
 
@@ -2607,6 +3561,7 @@ typedef struct iqm_t {
     int nummeshes, numtris, numverts, numjoints, numframes, numanims;
     GLuint program;
     GLuint vao, ibo, vbo;
+    GLuint instances; // per-instance model matrices, vertex attribs 8..11
     GLuint *textures;
     uint8_t *buf, *meshdata, *animdata;
     struct iqmmesh *meshes;
@@ -2648,55 +3603,56 @@ void model_set_uniforms(model_t m, int shader, mat44 proj, mat44 view, mat44 mod
     if(!m.iqm) return;
     iqm_t *q = m.iqm;
 
-    glUseProgram(shader);
+    glstate_use_program(shader);
     int loc;
     //if( (loc = glGetUniformLocation(shader, "M")) >= 0 ) glUniformMatrix4fv( loc, 1, GL_FALSE/*GL_TRUE*/, m); // RIM
-    if( (loc = glGetUniformLocation(shader, "MVP")) >= 0 ) {
+    if( (loc = shader_uniform_location(shader, "MVP")) >= 0 ) {
         mat44 mvp; multiply44x3(mvp, proj, view, model);
-        glUniformMatrix4fv( loc, 1, GL_FALSE/*GL_TRUE*/, mvp);
+        uniform_mat44(shader, loc, mvp);
     }
     else
-    if( (loc = glGetUniformLocation(shader, "u_mvp")) >= 0 ) {
+    if( (loc = shader_uniform_location(shader, "u_mvp")) >= 0 ) {
         mat44 mvp; multiply44x3(mvp, proj, view, model);
-        glUniformMatrix4fv( loc, 1, GL_FALSE/*GL_TRUE*/, mvp);
+        uniform_mat44(shader, loc, mvp);
     }
 #if 0
     // @todo: mat44 projview
 #endif
-    if ((loc = glGetUniformLocation(shader, "M")) >= 0) {
-        glUniformMatrix4fv(loc, 1, GL_FALSE/*GL_TRUE*/, model);
+    if ((loc = shader_uniform_location(shader, "M")) >= 0) {
+        uniform_mat44(shader, loc, model);
     }
     else
-    if ((loc = glGetUniformLocation(shader, "model")) >= 0) {
-        glUniformMatrix4fv(loc, 1, GL_FALSE/*GL_TRUE*/, model);
+    if ((loc = shader_uniform_location(shader, "model")) >= 0) {
+        uniform_mat44(shader, loc, model);
     }
-    if ((loc = glGetUniformLocation(shader, "V")) >= 0) {
-        glUniformMatrix4fv(loc, 1, GL_FALSE/*GL_TRUE*/, view);
+    if ((loc = shader_uniform_location(shader, "V")) >= 0) {
+        uniform_mat44(shader, loc, view);
     }
     else
-    if ((loc = glGetUniformLocation(shader, "view")) >= 0) {
-        glUniformMatrix4fv(loc, 1, GL_FALSE/*GL_TRUE*/, view);
+    if ((loc = shader_uniform_location(shader, "view")) >= 0) {
+        uniform_mat44(shader, loc, view);
     }
-    if ((loc = glGetUniformLocation(shader, "P")) >= 0) {
-        glUniformMatrix4fv(loc, 1, GL_FALSE/*GL_TRUE*/, proj);
+    if ((loc = shader_uniform_location(shader, "P")) >= 0) {
+        uniform_mat44(shader, loc, proj);
     }
     else
-    if ((loc = glGetUniformLocation(shader, "proj")) >= 0) {
-        glUniformMatrix4fv(loc, 1, GL_FALSE/*GL_TRUE*/, proj);
+    if ((loc = shader_uniform_location(shader, "proj")) >= 0) {
+        uniform_mat44(shader, loc, proj);
     }
-    if( (loc = glGetUniformLocation(shader, "SKINNED")) >= 0 ) glUniform1i( loc, numanims ? GL_TRUE : GL_FALSE);
+    if( (loc = shader_uniform_location(shader, "SKINNED")) >= 0 ) uniform_int( shader, loc, numanims ? GL_TRUE : GL_FALSE);
+    if( (loc = shader_uniform_location(shader, "u_instanced")) >= 0 ) uniform_int( shader, loc, GL_FALSE);
     if( numanims )
-    if( (loc = glGetUniformLocation(shader, "vsBoneMatrix")) >= 0 ) glUniformMatrix3x4fv( loc, numjoints, GL_FALSE, outframe[0]);
+    if( (loc = shader_uniform_location(shader, "vsBoneMatrix")) >= 0 ) uniform_mat34v( shader, loc, numjoints, outframe[0]);
 }
 static
 void model_set_state(model_t m) {
     if(!m.iqm) return;
     iqm_t *q = m.iqm;
 
-    glBindVertexArray( vao );
+    glstate_bind_vao( vao );
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, vbo);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(iqm_vertex), (GLvoid*)offsetof(iqm_vertex, position) );
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(iqm_vertex), (GLvoid*)offsetof(iqm_vertex, texcoord) );
@@ -2726,11 +3682,11 @@ void model_set_state(model_t m) {
         glDisableVertexAttribArray(4);
         glDisableVertexAttribArray(5);
     }
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, 0);
 #endif
 
-    glBindVertexArray( 0 );
+    glstate_bind_vao( 0 );
 }
 
 static
@@ -2791,12 +3747,12 @@ bool model_load_meshes(iqm_t *q, const struct iqmheader *hdr) {
     struct iqmtriangle *tris = (struct iqmtriangle *)&buf[hdr->ofs_triangles];
 
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    glstate_bind_vao(vao);
 
     if(!ibo) glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, hdr->num_triangles*sizeof(struct iqmtriangle), tris, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     iqm_vertex *verts = CALLOC(hdr->num_vertexes, sizeof(iqm_vertex));
     for(int i = 0; i < (int)hdr->num_vertexes; i++) {
@@ -2818,9 +3774,9 @@ bool model_load_meshes(iqm_t *q, const struct iqmheader *hdr) {
     }
 
     if(!vbo) glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, hdr->num_vertexes*sizeof(iqm_vertex), verts, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, 0);
     FREE(verts);
 
     textures = CALLOC(hdr->num_meshes, sizeof(GLuint));
@@ -2958,7 +3914,7 @@ model_t model_from_mem(const void *mem, int len, int flags) {
     if( shaderprog < 0 ) {
         const char *symbols[] = { "{{include-shadowmap}}", fs_0_0_shadowmap_lit }; // #define RIM
         shaderprog = shader(strlerp(1,symbols,vs_32344443_332_model), strlerp(1,symbols,fs_32_4_model), //fs,
-            "att_position,att_texcoord,att_normal,att_tangent,att_indexes,att_weights,att_color,att_bitangent","fragColor");
+            "att_position,att_texcoord,att_normal,att_tangent,att_indexes,att_weights,att_color,att_bitangent,att_instanced_matrix","fragColor");
     }
 
     iqm_t *q = CALLOC(1, sizeof(iqm_t));
@@ -3002,8 +3958,10 @@ model_t model_from_mem(const void *mem, int len, int flags) {
 }
 model_t model(const char *filename, int flags) {
     int len;  // vfs_pushd(filedir(filename))
-    char *ptr = vfs_load(filename, &len); // + vfs_popd
-    return model_from_mem( ptr, len, flags );
+    char *ptr = vfs_acquire(filename, &len); // + vfs_popd
+    model_t m = model_from_mem( ptr, len, flags );
+    vfs_release(ptr);
+    return m;
 }
 
 void model_get_bone_pose(model_t m, float curframe, int joint, vec3 *pos, vec3 *from) { // bugs?
@@ -3087,27 +4045,56 @@ float model_animate(model_t m, float curframe) {
     return model_animate_clip(m, curframe, 0, numframes-1, true);
 }
 
+static
+void model_set_instances(model_t m, int shader, const float *models, unsigned count) { // expects vao bound
+    iqm_t *q = m.iqm;
+
+    if( !q->instances ) {
+        glGenBuffers(1, &q->instances);
+        glstate_bind_buffer(GL_ARRAY_BUFFER, q->instances);
+        for( int c = 0; c < 4; ++c ) { // mat4 attribute: one vec4 column each
+            glVertexAttribPointer(8+c, 4, GL_FLOAT, GL_FALSE, sizeof(mat44), (GLvoid*)(c * 4 * sizeof(float)));
+            glEnableVertexAttribArray(8+c);
+            glVertexAttribDivisor(8+c, 1);
+        }
+    }
+    glstate_bind_buffer(GL_ARRAY_BUFFER, q->instances);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(mat44), NULL, GL_STREAM_DRAW); // orphan previous contents
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(mat44), models);
+
+    int loc;
+    if( (loc = shader_uniform_location(shader, "u_instanced")) >= 0 ) uniform_int( shader, loc, GL_TRUE);
+}
+
+static
+void model_draw_mesh(model_t m, int mesh, unsigned instances) { // expects vao, program & texture bound. 0 instances if not instanced
+    iqm_t *q = m.iqm;
+    struct iqmtriangle *tris = NULL;
+    struct iqmmesh *im = &meshes[mesh];
+
+    if( instances ) glDrawElementsInstanced(GL_TRIANGLES, 3*im->num_triangles, GL_UNSIGNED_INT, &tris[im->first_triangle], instances);
+    else glDrawElements(GL_TRIANGLES, 3*im->num_triangles, GL_UNSIGNED_INT, &tris[im->first_triangle]);
+    profile_incstat("drawcalls", +1);
+    profile_incstat("triangles", +im->num_triangles * (instances + !instances));
+    profile_incstat("instances", +instances);
+}
+
 static
 void model_draw_call(model_t m) {
     if(!m.iqm) return;
     iqm_t *q = m.iqm;
 
-    glBindVertexArray( vao );
+    glstate_bind_vao( vao );
 
-    struct iqmtriangle *tris = NULL;
     for(int i = 0; i < nummeshes; i++) {
-        struct iqmmesh *m = &meshes[i];
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[i] );
-        glUniform1i(glGetUniformLocation(program, "fsDiffTex"), 0 /*<-- unit!*/ );
+        glstate_active_texture(0);
+        glstate_bind_texture(GL_TEXTURE_2D, textures[i] );
+        uniform_int(program, shader_uniform_location(program, "fsDiffTex"), 0 /*<-- unit!*/ );
 
-        glDrawElements(GL_TRIANGLES, 3*m->num_triangles, GL_UNSIGNED_INT, &tris[m->first_triangle]);
-        profile_incstat("drawcalls", +1);
-        profile_incstat("triangles", +m->num_triangles);
+        model_draw_mesh(m, i, 0);
     }
 
-    glBindVertexArray( 0 );
+    glstate_bind_vao( 0 );
 }
 
 void model_render2(model_t m, mat44 proj, mat44 view, mat44 model, int shader) {
@@ -3120,6 +4107,27 @@ void model_render2(model_t m, mat44 proj, mat44 view, mat44 model, int shader) {
 void model_render(model_t m, mat44 proj, mat44 view, mat44 model) {
     model_render2(m, proj, view, model, 0);
 }
+void model_render_instanced(model_t m, mat44 proj, mat44 view, mat44 *models, int shader, unsigned count) {
+    if(!m.iqm || !count) return;
+    iqm_t *q = m.iqm;
+
+    mat44 id; identity44(id); // MVP is then proj*view, and each instance premultiplies it
+    shader = shader ? shader : program;
+    model_set_uniforms(m, shader, proj, view, id);
+
+    glstate_bind_vao( vao );
+    model_set_instances(m, shader, models[0], count);
+
+    for(int i = 0; i < nummeshes; i++) {
+        glstate_active_texture(0);
+        glstate_bind_texture(GL_TEXTURE_2D, textures[i] );
+        uniform_int(shader, shader_uniform_location(shader, "fsDiffTex"), 0 /*<-- unit!*/ );
+
+        model_draw_mesh(m, i, count);
+    }
+
+    glstate_bind_vao( 0 );
+}
 
 static
 aabb aabb_transform( aabb A, mat44 M) {
@@ -3162,6 +4170,8 @@ void model_destroy(model_t m) {
     //FREE(meshdata);
     FREE(frames);
     FREE(buf);
+    if(q->instances) glDeleteBuffers(1, &q->instances);
+    glstate_invalidate();
     FREE(q);
 }
 
@@ -95,24 +95,24 @@ static bool        dd_ontop = 0;
 
 static
 void ddraw_flush() {
-    glEnable(GL_DEPTH_TEST);
-    glActiveTexture(GL_TEXTURE0);
+    glstate_enable(GL_DEPTH_TEST, 1);
+    glstate_active_texture(0);
 
     mat44 mvp;
     multiply44x2(mvp, camera_get_active()->proj, camera_get_active()->view); // MVP where M=id
 
-    glUseProgram(dd_program);
-    glUniformMatrix4fv(glGetUniformLocation(dd_program, "u_MVP"), 1, GL_FALSE, mvp);
+    glstate_use_program(dd_program);
+    uniform_mat44(dd_program, shader_uniform_location(dd_program, "u_MVP"), mvp);
 
     static GLuint vao, vbo;
-    if(!vao) glGenVertexArrays(1, &vao);    glBindVertexArray(vao);
-    if(!vbo) glGenBuffers(1, &vbo);         glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if(!vao) glGenVertexArrays(1, &vao);    glstate_bind_vao(vao);
+    if(!vbo) glGenBuffers(1, &vbo);         glstate_bind_buffer(GL_ARRAY_BUFFER, vbo);
 
     glEnableVertexAttribArray(0);
 
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_PROGRAM_POINT_SIZE); // for GL_POINTS
-    glEnable(GL_LINE_SMOOTH); // for GL_LINES (thin)
+    glstate_depth_func(GL_LEQUAL);
+    glstate_enable(GL_PROGRAM_POINT_SIZE, 1); // for GL_POINTS
+    glstate_enable(GL_LINE_SMOOTH, 1); // for GL_LINES (thin)
 
     for( int i = 0; i < 3; ++i ) { // [0] thin, [1] thick, [2] points
         GLenum mode = i < 2 ? GL_LINES : GL_POINTS;
@@ -122,7 +122,7 @@ void ddraw_flush() {
             if(!count) continue;
                 // color
                 vec3 rgbf = {((rgb>>16)&255)/255.f,((rgb>>8)&255)/255.f,((rgb>>0)&255)/255.f};
-                glUniform3fv(dd_u_color, GL_TRUE, &rgbf.x);
+                uniform_vec3v(dd_program, dd_u_color, 1, &rgbf.x);
                 // config vertex data
                 glBufferData(GL_ARRAY_BUFFER, count * 3 * 4, list, GL_STATIC_DRAW);
                 glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
@@ -140,7 +140,7 @@ void ddraw_flush() {
         float mvp[16]; float zdepth_max = 1;
         ortho44(mvp, -window_width()/2, window_width()/2, -window_height()/2, window_height()/2, -1, 1);
         translate44(mvp, -window_width()/2, window_height()/2, 0);
-        glUniformMatrix4fv(glGetUniformLocation(dd_program, "u_MVP"), 1, GL_FALSE, mvp);
+        uniform_mat44(dd_program, shader_uniform_location(dd_program, "u_MVP"), mvp);
         ddraw_color(BLACK);
         for(int i = 0; i < 10; ++i)
         ddraw_text(vec3(window_width()/2,-(i * 12),0), 0.5, "\nhello world"); // scale 0.5 is like 12units each
@@ -155,7 +155,7 @@ void ddraw_flush() {
                 if(!count) continue;
                     // color
                     vec3 rgbf = {((rgb>>16)&255)/255.f,((rgb>>8)&255)/255.f,((rgb>>0)&255)/255.f};
-                    glUniform3fv(dd_u_color, GL_TRUE, &rgbf.x);
+                    uniform_vec3v(dd_program, dd_u_color, 1, &rgbf.x);
                     // config vertex data
                     glBufferData(GL_ARRAY_BUFFER, count * 3 * 4, list, GL_STATIC_DRAW);
                     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
@@ -168,10 +168,10 @@ void ddraw_flush() {
         }
     }
 
-    glDisable(GL_LINE_SMOOTH);
-    glDisable(GL_PROGRAM_POINT_SIZE);
+    glstate_enable(GL_LINE_SMOOTH, 0);
+    glstate_enable(GL_PROGRAM_POINT_SIZE, 0);
 
-    glBindVertexArray(0);
+    glstate_bind_vao(0);
 
     ddraw_color(WHITE); // reset color for next drawcall
 }
@@ -631,7 +631,7 @@ void ddraw_init() {
     for( int i = 0; i < 2; ++i )
     for( int j = 0; j < 3; ++j ) map_init(dd_lists[i][j], less_int, hash_int);
     dd_program = shader(dd_vs,dd_fs,"att_position","fragcolor");
-    dd_u_color = glGetUniformLocation(dd_program, "u_color");
+    dd_u_color = shader_uniform_location(dd_program, "u_color");
     ddraw_flush(); // alloc vao & vbo, also resets color
 }
 
@@ -24,7 +24,7 @@ camera_t *camera_get_active();
 // object
 
 typedef struct {
-    uint64_t renderbucket;
+    uint64_t renderbucket; // draw group, sorted before any state: [0..15]. 0 by default
     mat44 transform;
     quat rot;
     vec3 sca, pos, euler, pivot;
@@ -48,6 +48,51 @@ void object_billboard(object_t *obj, unsigned mode);
 
 // object_pose(transform); // @todo
 
+// occlusion
+
+typedef struct {
+    int w, h, tiles_x, tiles_y; // depth buffer size (multiple of 8), in 8x8 tiles
+    uint64_t *mask;             // per tile: pixels covered by working layer
+    float *zfar;                // per tile: farthest 1/w of [reference layer, working layer]
+    float *hiz;                 // per 4x4 tiles: farthest 1/w of reference layers
+    mat44 viewproj;
+    array(vec3) tris;           // queued occluder triangles: x,y in pixels, z = 1/w
+    float *setup; int setup_cap; // per triangle: 3 edge equations, 1/w plane and its min
+    int *bins, *bin_start, bins_cap;
+    int occluders, triangles, tested, culled; // stats
+    double raster_ms;
+} occlusion_t;
+
+occlusion_t occlusion(int w, int h);
+void occlusion_begin(occlusion_t *oc, mat44 proj, mat44 view);
+void occlusion_occluder(occlusion_t *oc, mat44 transform, const vec3 *verts, const unsigned *indices, int num_triangles);
+void occlusion_end(occlusion_t *oc);
+int  occlusion_test_aabb(occlusion_t *oc, aabb box); // 1 if box may be visible
+int  occlusion_test_object(occlusion_t *oc, object_t *obj);
+void occlusion_destroy(occlusion_t *oc);
+
+// render queue: one 64-bit key per draw, radix sorted every frame, then submitted in key order
+// so that draws sharing state are adjacent and redundant binds can be skipped.
+// - key bits, msb first: bucket:4 shader:12 texture:16 mesh:16 depth:16 (near first)
+
+typedef struct {
+    array(uint64_t) keys;
+    array(unsigned) items; // user payload per key, reordered along
+    array(uint64_t) tmp_keys;
+    array(unsigned) tmp_items;
+} renderqueue_t;
+
+uint64_t renderkey(unsigned bucket, unsigned shader, unsigned texture, unsigned mesh, float depth);
+void     renderqueue_clear(renderqueue_t *q);
+void     renderqueue_push(renderqueue_t *q, uint64_t key, unsigned item);
+void     renderqueue_sort(renderqueue_t *q);
+void     renderqueue_destroy(renderqueue_t *q);
+
+#define RENDERKEY_BUCKET(k)  ((unsigned)((k) >> 60))
+#define RENDERKEY_SHADER(k)  ((unsigned)((k) >> 48) & 0xFFF)
+#define RENDERKEY_TEXTURE(k) ((unsigned)((k) >> 32) & 0xFFFF)
+#define RENDERKEY_MESH(k)    ((unsigned)((k) >> 16) & 0xFFFF)
+
 // scene
 
 enum {
@@ -55,6 +100,7 @@ enum {
     SCENE_CULLFACE = 2,
     SCENE_BACKGROUND = 4,
     SCENE_FOREGROUND = 8,
+    SCENE_OCCLUSION = 16,
 };
 
 typedef struct {
@@ -65,6 +111,8 @@ typedef struct {
     // special objects below:
     skybox_t skybox;
     int u_coefficients_sh;
+    occlusion_t *occlusion; // filled by user every frame, if SCENE_OCCLUSION
+    renderqueue_t queue; // visible draws of last scene_render()
 } scene_t;
 
 scene_t*  scene_push();
@@ -73,6 +121,8 @@ scene_t*  scene_get_active();
 
 int       scene_merge(const char *source);
 void      scene_render(int flags);
+renderqueue_t* scene_queue(int flags); // sorted visible draws for the active camera. used by scene_render()
+int       scene_run(renderqueue_t *rq, int k); // queue items from k on that draw as one instanced call: same model mesh, texture & bucket
 
 object_t* scene_spawn();
 unsigned  scene_count();
@@ -247,6 +297,317 @@ void object_billboard(object_t *obj, unsigned mode) {
 
 // -----------------------------------------------------------------------------
 
+// -----------------------------------------------------------------------------
+// masked software occlusion: occluders are rasterized into 8x8 tiles, each one
+// keeping a coverage mask and two depth layers instead of per-pixel depth.
+// [ref] https://www.intel.com/content/www/us/en/developer/articles/technical/masked-software-occlusion-culling.html
+
+occlusion_t occlusion(int w, int h) {
+    occlusion_t oc = {0};
+    oc.w = (w + 7) & ~7, oc.h = (h + 7) & ~7;
+    oc.tiles_x = oc.w / 8, oc.tiles_y = oc.h / 8;
+    int tiles = oc.tiles_x * oc.tiles_y, blocks = ((oc.tiles_x + 3) / 4) * ((oc.tiles_y + 3) / 4);
+    oc.mask = REALLOC(0, sizeof(uint64_t) * tiles);
+    oc.zfar = REALLOC(0, sizeof(float) * tiles * 2);
+    oc.hiz = REALLOC(0, sizeof(float) * blocks);
+    oc.bin_start = REALLOC(0, sizeof(int) * (tiles + 1));
+    identity44(oc.viewproj);
+    return oc;
+}
+
+void occlusion_destroy(occlusion_t *oc) {
+    REALLOC(oc->mask, 0);
+    REALLOC(oc->zfar, 0);
+    REALLOC(oc->hiz, 0);
+    REALLOC(oc->setup, 0);
+    REALLOC(oc->bins, 0);
+    REALLOC(oc->bin_start, 0);
+    array_free(oc->tris);
+    occlusion_t clear = {0};
+    *oc = clear;
+}
+
+void occlusion_begin(occlusion_t *oc, mat44 proj, mat44 view) {
+    multiply44x2(oc->viewproj, proj, view);
+    array_clear(oc->tris);
+    oc->occluders = oc->triangles = oc->tested = oc->culled = 0;
+}
+
+static
+void occlusion_emit(occlusion_t *oc, vec4 a, vec4 b, vec4 c) {
+    vec3 p[3]; vec4 v[3] = {a, b, c};
+    for( int i = 0; i < 3; ++i ) {
+        float iw = 1 / v[i].w;
+        p[i] = vec3((v[i].x * iw * 0.5f + 0.5f) * oc->w, (0.5f - v[i].y * iw * 0.5f) * oc->h, iw);
+    }
+    float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+    if( fabsf(area) < 1e-6f ) return;
+    if( maxf(p[0].x, maxf(p[1].x, p[2].x)) < 0 || minf(p[0].x, minf(p[1].x, p[2].x)) >= oc->w ) return;
+    if( maxf(p[0].y, maxf(p[1].y, p[2].y)) < 0 || minf(p[0].y, minf(p[1].y, p[2].y)) >= oc->h ) return;
+    array_push(oc->tris, p[0]);
+    array_push(oc->tris, p[1]);
+    array_push(oc->tris, p[2]);
+}
+
+void occlusion_occluder(occlusion_t *oc, mat44 transform, const vec3 *verts, const unsigned *indices, int num_triangles) {
+    mat44 mvp; multiply44x2(mvp, oc->viewproj, transform);
+    oc->occluders++;
+    for( int t = 0; t < num_triangles; ++t ) {
+        vec4 v[3], out[4]; int n = 0;
+        for( int i = 0; i < 3; ++i ) v[i] = transform444(mvp, vec34(verts[indices ? indices[t*3+i] : t*3+i], 1));
+        // clip against near plane (z >= -w), polygon has 4 vertices at most
+        for( int i = 0; i < 3; ++i ) {
+            vec4 a = v[i], b = v[(i+1)%3];
+            float da = a.z + a.w, db = b.z + b.w;
+            if( da >= 0 ) out[n++] = a;
+            if( (da >= 0) != (db >= 0) ) {
+                float k = da / (da - db);
+                out[n++] = add4(a, scale4(sub4(b, a), k));
+            }
+        }
+        for( int i = 2; i < n; ++i ) occlusion_emit(oc, out[0], out[i-1], out[i]);
+    }
+}
+
+static
+void occlusion_raster_tile(occlusion_t *oc, int tx, int ty) {
+    int tile = tx + ty * oc->tiles_x;
+    uint64_t mask = 0;
+    float z0 = 0, z1 = FLT_MAX; // 0 means nothing covered (1/w of infinity)
+    float x0 = tx * 8, y0 = ty * 8;
+
+    for( int b = oc->bin_start[tile]; b < oc->bin_start[tile+1]; ++b ) {
+        const float *ea = &oc->setup[ oc->bins[b] * 13 ], *eb = ea + 3, *ec = ea + 6;
+        float za = ea[9], zb = ea[10], zc = ea[11], zmin = ea[12];
+
+        // farthest depth of triangle within tile: plane at tile corners, clamped to vertex range
+        float ztri = zc + minf(za * x0, za * (x0+8)) + minf(zb * y0, zb * (y0+8));
+        ztri = maxf(ztri, zmin);
+        if( ztri <= z0 ) continue; // cannot improve reference layer
+
+        // trivial reject/accept: edges are linear, so test them at the 4 corner pixels of the tile first
+        int inside = 0, outside = 0;
+        for( int i = 0; i < 3; ++i ) {
+            float lo = ec[i] + minf(ea[i] * (x0+0.5f), ea[i] * (x0+7.5f)) + minf(eb[i] * (y0+0.5f), eb[i] * (y0+7.5f));
+            float hi = ec[i] + maxf(ea[i] * (x0+0.5f), ea[i] * (x0+7.5f)) + maxf(eb[i] * (y0+0.5f), eb[i] * (y0+7.5f));
+            inside += lo >= 0, outside += hi < 0;
+        }
+        if( outside ) continue;
+
+        // coverage mask, 8 pixels per row
+        uint64_t cov = inside == 3 ? ~0ull : 0;
+        for( int y = 0; y < 8 && inside < 3; ++y ) {
+            float py = y0 + y + 0.5f;
+            unsigned row = 0;
+            for( int x = 0; x < 8; ++x ) {
+                float px = x0 + x + 0.5f;
+                float e0 = ea[0] * px + eb[0] * py + ec[0];
+                float e1 = ea[1] * px + eb[1] * py + ec[1];
+                float e2 = ea[2] * px + eb[2] * py + ec[2];
+                row |= (unsigned)(e0 >= 0 && e1 >= 0 && e2 >= 0) << x;
+            }
+            cov |= (uint64_t)row << (y * 8);
+        }
+        if( !cov ) continue;
+
+        // merge into working layer. once full it becomes the reference layer
+        float z = minf(z1, ztri);
+        if( !mask || z <= z0 ) z1 = ztri, mask = cov; // working layer would be useless: restart it
+        else z1 = z, mask |= cov;
+        if( mask == ~0ull ) z0 = z1, z1 = FLT_MAX, mask = 0;
+    }
+
+    oc->mask[tile] = mask;
+    oc->zfar[tile*2+0] = z0;
+    oc->zfar[tile*2+1] = z1;
+}
+
+static
+int occlusion_sort_nearest(const void *a, const void *b) {
+    const vec3 *p = (const vec3*)a, *q = (const vec3*)b;
+    float zp = maxf(p[0].z, maxf(p[1].z, p[2].z)), zq = maxf(q[0].z, maxf(q[1].z, q[2].z));
+    return (zp < zq) - (zp > zq);
+}
+
+void occlusion_end(occlusion_t *oc) {
+    uint64_t t0 = time_ns();
+    int tiles = oc->tiles_x * oc->tiles_y, count = array_count(oc->tris) / 3;
+    oc->triangles = count;
+
+    // front to back, so tiles settle their reference layer early and skip farther triangles
+    qsort(oc->tris, count, sizeof(vec3) * 3, occlusion_sort_nearest);
+
+    // triangle setup
+    if( count * 13 > oc->setup_cap ) {
+        oc->setup_cap = count * 13 * 2;
+        oc->setup = REALLOC(oc->setup, sizeof(float) * oc->setup_cap);
+    }
+    #pragma omp parallel for
+    for( int t = 0; t < count; ++t ) {
+        const vec3 *p = &oc->tris[t*3];
+        float *ea = &oc->setup[t*13], *eb = ea + 3, *ec = ea + 6;
+
+        // edge equations, inside >= 0. 1/w is linear in screen space
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y), sign = area > 0 ? 1 : -1;
+        // pixels are covered when their center is inside, as gpus do: triangles sharing an edge leave no cracks
+        for( int i = 0; i < 3; ++i ) {
+            vec3 a = p[i], c = p[(i+1)%3];
+            ea[i] = (a.y - c.y) * sign, eb[i] = (c.x - a.x) * sign, ec[i] = (a.x * c.y - a.y * c.x) * sign;
+        }
+        ea[ 9] = ((p[1].z - p[0].z) * (p[2].y - p[0].y) - (p[2].z - p[0].z) * (p[1].y - p[0].y)) / area;
+        ea[10] = ((p[2].z - p[0].z) * (p[1].x - p[0].x) - (p[1].z - p[0].z) * (p[2].x - p[0].x)) / area;
+        ea[11] = p[0].z - ea[9] * p[0].x - ea[10] * p[0].y;
+        ea[12] = minf(p[0].z, minf(p[1].z, p[2].z));
+    }
+
+    // bin triangles into tiles (counting sort)
+    for( int i = 0; i <= tiles; ++i ) oc->bin_start[i] = 0;
+    for( int pass = 0; pass < 2; ++pass ) {
+        for( int t = 0; t < count; ++t ) {
+            const vec3 *p = &oc->tris[t*3];
+            int x0 = maxf(0, minf(p[0].x, minf(p[1].x, p[2].x))) / 8, x1 = minf(oc->w - 1, maxf(p[0].x, maxf(p[1].x, p[2].x))) / 8;
+            int y0 = maxf(0, minf(p[0].y, minf(p[1].y, p[2].y))) / 8, y1 = minf(oc->h - 1, maxf(p[0].y, maxf(p[1].y, p[2].y))) / 8;
+            for( int y = y0; y <= y1; ++y )
+            for( int x = x0; x <= x1; ++x ) {
+                int tile = x + y * oc->tiles_x;
+                if( pass == 0 ) oc->bin_start[tile+1]++;
+                else oc->bins[ oc->bin_start[tile]++ ] = t;
+            }
+        }
+        if( pass == 0 ) {
+            for( int i = 0; i < tiles; ++i ) oc->bin_start[i+1] += oc->bin_start[i];
+            if( oc->bin_start[tiles] > oc->bins_cap ) {
+                oc->bins_cap = oc->bin_start[tiles] * 2;
+                oc->bins = REALLOC(oc->bins, sizeof(int) * oc->bins_cap);
+            }
+        } else {
+            for( int i = tiles; i > 0; --i ) oc->bin_start[i] = oc->bin_start[i-1]; // fill pass shifted starts by one bin
+            oc->bin_start[0] = 0;
+        }
+    }
+
+    // tiles are independent, so rows of tiles are rasterized in parallel
+    #pragma omp parallel for schedule(dynamic, 1)
+    for( int ty = 0; ty < oc->tiles_y; ++ty ) {
+        for( int tx = 0; tx < oc->tiles_x; ++tx ) occlusion_raster_tile(oc, tx, ty);
+    }
+
+    // hierarchical level: farthest reference depth per 4x4 tiles
+    int bx = (oc->tiles_x + 3) / 4, by = (oc->tiles_y + 3) / 4;
+    for( int j = 0; j < by; ++j )
+    for( int i = 0; i < bx; ++i ) {
+        float z = FLT_MAX;
+        for( int y = j*4; y < j*4+4 && y < oc->tiles_y; ++y )
+        for( int x = i*4; x < i*4+4 && x < oc->tiles_x; ++x ) z = minf(z, oc->zfar[(x + y * oc->tiles_x)*2]);
+        oc->hiz[i + j * bx] = z;
+    }
+
+    oc->raster_ms = (time_ns() - t0) / 1e6;
+}
+
+int occlusion_test_aabb(occlusion_t *oc, aabb box) {
+    oc->tested++;
+
+    // screen rect and nearest depth of box
+    float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX, znear = 0;
+    for( int i = 0; i < 8; ++i ) {
+        vec3 c = vec3(i&1 ? box.max.x : box.min.x, i&2 ? box.max.y : box.min.y, i&4 ? box.max.z : box.min.z);
+        vec4 v = transform444(oc->viewproj, vec34(c, 1));
+        if( v.z < -v.w || v.w <= 0 ) return 1; // crosses near plane
+        float iw = 1 / v.w;
+        float x = (v.x * iw * 0.5f + 0.5f) * oc->w, y = (0.5f - v.y * iw * 0.5f) * oc->h;
+        x0 = minf(x0, x), x1 = maxf(x1, x), y0 = minf(y0, y), y1 = maxf(y1, y), znear = maxf(znear, iw);
+    }
+    if( x1 < 0 || y1 < 0 || x0 >= oc->w || y0 >= oc->h ) return oc->culled++, 0; // off screen
+    int px0 = maxf(0, x0), px1 = minf(oc->w - 1, x1), py0 = maxf(0, y0), py1 = minf(oc->h - 1, y1);
+
+    // coarse hierarchical test, then per tile against both layers
+    int bx = (oc->tiles_x + 3) / 4, visible = 0;
+    for( int j = py0 / 32; j <= py1 / 32 && !visible; ++j )
+    for( int i = px0 / 32; i <= px1 / 32 && !visible; ++i ) visible = znear >= oc->hiz[i + j * bx];
+    if( !visible ) return oc->culled++, 0;
+
+    for( int ty = py0 / 8; ty <= py1 / 8; ++ty )
+    for( int tx = px0 / 8; tx <= px1 / 8; ++tx ) {
+        int tile = tx + ty * oc->tiles_x;
+        if( znear < oc->zfar[tile*2+0] ) continue;
+        if( znear < oc->zfar[tile*2+1] ) {
+            // behind working layer: occluded if every pixel of the rect inside this tile is covered
+            int rx0 = maxi(px0 - tx*8, 0), rx1 = mini(px1 - tx*8, 7), ry0 = maxi(py0 - ty*8, 0), ry1 = mini(py1 - ty*8, 7);
+            uint64_t row = (0xFFu >> (7 - rx1 + rx0)) << rx0, rect = 0;
+            for( int y = ry0; y <= ry1; ++y ) rect |= row << (y * 8);
+            if( !(rect & ~oc->mask[tile]) ) continue;
+        }
+        return 1;
+    }
+    return oc->culled++, 0;
+}
+
+int occlusion_test_object(occlusion_t *oc, object_t *obj) {
+    aabb b = model_aabb(obj->model, obj->transform);
+    if( !len3sq(sub3(b.max, b.min)) ) return 1; // unknown bounds
+    return occlusion_test_aabb(oc, b);
+}
+
+// -----------------------------------------------------------------------------
+// render queue
+
+uint64_t renderkey(unsigned bucket, unsigned shader, unsigned texture, unsigned mesh, float depth) {
+    // positive floats sort as their bits: top 16 bits keep exponent & 7 mantissa bits, ~1% depth steps
+    union { float f; uint32_t u; } d = { depth > 0 ? depth : 0 };
+    return (uint64_t)(bucket & 0xF) << 60 | (uint64_t)(shader & 0xFFF) << 48 | (uint64_t)(texture & 0xFFFF) << 32
+        | (uint64_t)(mesh & 0xFFFF) << 16 | (d.u >> 15);
+}
+
+void renderqueue_clear(renderqueue_t *q) {
+    array_resize(q->keys, 0);
+    array_resize(q->items, 0);
+}
+
+void renderqueue_push(renderqueue_t *q, uint64_t key, unsigned item) {
+    array_push(q->keys, key);
+    array_push(q->items, item);
+}
+
+void renderqueue_sort(renderqueue_t *q) { // lsd radix, 8 bits per pass. stable
+    int n = array_count(q->keys);
+    if( n < 2 ) return;
+    array_resize(q->tmp_keys, n);
+    array_resize(q->tmp_items, n);
+
+    // histograms of all digits in a single read. digits where all keys agree are skipped
+    static local unsigned hist[8][256];
+    memset(hist, 0, sizeof(hist));
+    for( int i = 0; i < n; ++i ) {
+        uint64_t k = q->keys[i];
+        for( int d = 0; d < 8; ++d ) hist[d][(k >> (d * 8)) & 255]++;
+    }
+
+    for( int d = 0; d < 8; ++d ) {
+        unsigned *h = hist[d];
+        if( h[(q->keys[0] >> (d * 8)) & 255] == n ) continue;
+        for( unsigned i = 0, sum = 0; i < 256; ++i ) { unsigned c = h[i]; h[i] = sum, sum += c; }
+
+        uint64_t *keys = q->keys, *out_keys = q->tmp_keys;
+        unsigned *items = q->items, *out_items = q->tmp_items;
+        for( int i = 0; i < n; ++i ) {
+            unsigned at = h[(keys[i] >> (d * 8)) & 255]++;
+            out_keys[at] = keys[i], out_items[at] = items[i];
+        }
+        q->keys = out_keys, q->tmp_keys = keys; // same counts: arrays swap roles
+        q->items = out_items, q->tmp_items = items;
+    }
+}
+
+void renderqueue_destroy(renderqueue_t *q) {
+    array_free(q->keys);
+    array_free(q->items);
+    array_free(q->tmp_keys);
+    array_free(q->tmp_items);
+}
+
+// -----------------------------------------------------------------------------
+
 array(scene_t*) scenes;
 scene_t* last_scene;
 
@@ -298,11 +659,15 @@ int scene_merge(const char *source) {
             PRINTF("Scene %d/%d Scale: (%f,%f,%f)\n", i, e, scale.x, scale.y, scale.z);
             PRINTF("Scene %d/%d Swap_ZY: %d\n", i, e, opt_swap_zy );
             PRINTF("Scene %d/%d Flip_UV: %d\n", i, e, opt_flip_uv );
-            model_t m = model_from_mem(vfs_read(mesh_file), vfs_size(mesh_file), 0/*opt_swap_zy*/);
+            int mesh_size; char *mesh_data = vfs_acquire(mesh_file, &mesh_size);
+            model_t m = model_from_mem(mesh_data, mesh_size, 0/*opt_swap_zy*/);
+            vfs_release(mesh_data);
             //char *a = archive_read(animation_file);
             object_t *o = scene_spawn();
             object_model(o, m);
-            if( texture_file[0] ) object_diffuse(o, texture_from_mem(vfs_read(texture_file), vfs_size(texture_file), opt_flip_uv ? IMAGE_FLIP : 0) );
+            int texture_size; char *texture_data = texture_file[0] ? vfs_acquire(texture_file, &texture_size) : 0;
+            if( texture_data ) object_diffuse(o, texture_from_mem(texture_data, texture_size, opt_flip_uv ? IMAGE_FLIP : 0) );
+            vfs_release(texture_data);
             object_scale(o, scale);
             object_teleport(o, position);
             object_pivot(o, rotation); // object_rotate(o, rotation);
@@ -344,19 +709,66 @@ object_t* scene_index(unsigned obj_index) {
     return &last_scene->objs[obj_index];
 }
 
+renderqueue_t* scene_queue(int flags) {
+    camera_t *cam = camera_get_active();
+
+    // visible meshes -> render queue. objects keep their own texture: shared models are left untouched
+    renderqueue_t *rq = &last_scene->queue;
+    renderqueue_clear(rq);
+
+    mat44 projview; multiply44x2(projview, cam->proj, cam->view);
+    frustum f = frustum_build(projview);
+
+    for(unsigned j = 0, obj_count = scene_count(); j < obj_count; ++j ) {
+        object_t *obj = scene_index(j);
+        iqm_t *q = obj->model.iqm;
+        if( !q ) continue;
+        if( q->bounds ) {
+            aabb box = model_aabb(obj->model, obj->transform);
+            if( !frustum_test_aabb(f, box) ) continue;
+            if( flags & SCENE_OCCLUSION && last_scene->occlusion && !occlusion_test_aabb(last_scene->occlusion, box) ) continue;
+        }
+
+        ASSERT(q->nummeshes <= 256, "Model has %d meshes; render queue items hold 256 at most", q->nummeshes);
+        float depth = len3(sub3(object_position(obj), cam->position));
+        for( int i = 0; i < q->nummeshes; ++i ) {
+            unsigned texture = obj->texture_id ? obj->texture_id : q->textures[i];
+            renderqueue_push(rq, renderkey(obj->renderbucket, q->program, texture, q->vao << 8 | i, depth), j << 8 | i);
+        }
+    }
+    renderqueue_sort(rq);
+    return rq;
+}
+
+int scene_run(renderqueue_t *rq, int k) {
+    unsigned j = rq->items[k] >> 8, i = rq->items[k] & 255;
+    object_t *obj = scene_index(j);
+    iqm_t *q = obj->model.iqm;
+    unsigned texture = obj->texture_id ? obj->texture_id : q->textures[i];
+
+    int run = 1;
+    for( int end = array_count(rq->items); k + run < end; ++run ) {
+        unsigned jj = rq->items[k + run] >> 8, ii = rq->items[k + run] & 255;
+        object_t *other = scene_index(jj);
+        if( ii != i || other->model.iqm != q || other->renderbucket != obj->renderbucket ) break;
+        if( (other->texture_id ? other->texture_id : q->textures[ii]) != texture ) break;
+    }
+    return run;
+}
+
 void scene_render(int flags) {
     camera_t *cam = camera_get_active();
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glActiveTexture(GL_TEXTURE0);
-    glUseProgram(last_scene->program);
+    glstate_enable(GL_DEPTH_TEST, 1);
+    glstate_depth_func(GL_LESS);
+    glstate_active_texture(0);
+    glstate_use_program(last_scene->program);
 
     if(flags & SCENE_BACKGROUND) {
         if(last_scene->skybox.program) {
         skybox_push_state(&last_scene->skybox, cam->proj, cam->view);
 
-        glDisable(GL_DEPTH_TEST);
+        glstate_enable(GL_DEPTH_TEST, 0);
     //  glDepthFunc(GL_LESS);
     //    glActiveTexture(GL_TEXTURE0);
     //    (flags & SCENE_CULLFACE ? glEnable : glDisable)(GL_CULL_FACE); glCullFace(GL_BACK); glFrontFace(GL_CCW);
@@ -369,38 +781,65 @@ void scene_render(int flags) {
         ddraw_flush();
     }
 
-    glDepthFunc(GL_LESS);
-    glActiveTexture(GL_TEXTURE0);
+    glstate_depth_func(GL_LESS);
+    glstate_active_texture(0);
 //  glUseProgram(last_scene->program);
 
     // @fixme: CW ok for one-sided rendering. CCW ok for FXs. we need both
-    (flags & SCENE_CULLFACE ? glEnable : glDisable)(GL_CULL_FACE); glCullFace(GL_BACK); glFrontFace(GL_CCW);
-    glPolygonMode( GL_FRONT_AND_BACK, flags & SCENE_WIREFRAME ? GL_LINE : GL_FILL );
+    glstate_enable(GL_CULL_FACE, flags & SCENE_CULLFACE); glstate_cull_face(GL_BACK); glstate_front_face(GL_CCW);
+    glstate_polygon_mode(flags & SCENE_WIREFRAME ? GL_LINE : GL_FILL);
     // @todo alpha mode
     // @todo texture mode
 
     if( flags & SCENE_FOREGROUND ) {
-        for(unsigned j = 0, obj_count = scene_count(); j < obj_count; ++j ) {
+        renderqueue_t *rq = scene_queue(flags);
+
+        // submit in key order. binds only on state changes, object uniforms once per object & program.
+        // runs of the same model mesh & texture are drawn at once, instanced
+        static array(float) instances = 0;
+        unsigned last_program = ~0u, last_vao = ~0u, last_texture = ~0u, last_object = ~0u;
+        for( int k = 0, run, end = array_count(rq->items); k < end; k += run ) {
+            unsigned j = rq->items[k] >> 8, i = rq->items[k] & 255;
             object_t *obj = scene_index(j);
-            model_t *model = &obj->model;
-            mat44 *views = (mat44*)(&cam->view);
-#if 0
-            for( unsigned i = 0; i < model->num_meshes; ++i ) {
-                mesh_t *mesh = &model->mesh[i];
-                mesh_push_state(mesh, last_scene->program, obj->texture_id, obj->transform, cam->view, cam->proj, obj->billboard);
-                mesh_render(mesh);
+            iqm_t *q = obj->model.iqm;
+            unsigned texture = obj->texture_id ? obj->texture_id : q->textures[i];
+            run = scene_run(rq, k);
+
+            if( q->program != last_program ) {
+                glstate_use_program(last_program = q->program);
+                uniform_int(q->program, shader_uniform_location(q->program, "fsDiffTex"), 0 /*<-- unit!*/ );
+                last_object = ~0u;
+                profile_incstat("binds", +1);
+            }
+            if( run == 1 && j != last_object ) {
+                model_set_uniforms(obj->model, q->program, cam->proj, cam->view, obj->transform);
+                last_object = j;
+            }
+            if( q->vao != last_vao ) {
+                glstate_bind_vao(last_vao = q->vao);
+                profile_incstat("binds", +1);
+            }
+            if( texture != last_texture ) {
+                glstate_bind_texture(GL_TEXTURE_2D, last_texture = texture);
+                profile_incstat("binds", +1);
+            }
+            if( run == 1 ) {
+                model_draw_mesh(obj->model, i, 0);
+                continue;
             }
-#else
-            if(model->iqm) for(int i = 0; i < model->iqm->nummeshes; ++i)
-                model->iqm->textures[i] = obj->texture_id;
 
-            model_render(*model, cam->proj, cam->view, obj->transform);
-#endif
+            array_resize(instances, run * 16);
+            for( int r = 0; r < run; ++r ) memcpy(&instances[r * 16], scene_index(rq->items[k + r] >> 8)->transform, sizeof(mat44));
+            mat44 id; identity44(id);
+            model_set_uniforms(obj->model, q->program, cam->proj, cam->view, id);
+            model_set_instances(obj->model, q->program, instances, run);
+            model_draw_mesh(obj->model, i, run);
+            last_object = ~0u;
         }
-        glBindVertexArray(0);
+        glstate_bind_vao(0);
     }
 
-    glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+    glstate_polygon_mode(GL_FILL);
 }
 
 #endif // SCENE_C
@@ -28,6 +28,7 @@ void        app_reload();
 
 double      time_ss();
 double      time_ms();
+uint64_t    time_ns(); // monotonic. works without a window, for headless benchmarks
 uint64_t    time_human(); // YYYYMMDDhhmmss
 double      sleep_ss(double ss);
 double      sleep_ms(double ms);
@@ -389,6 +390,18 @@ double time_ss() {
 double time_ms() {
     return glfwGetTime() * 1000.0;
 }
+uint64_t time_ns() {
+#if is(win32)
+    static LARGE_INTEGER freq = {0};
+    if( !freq.QuadPart ) QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER now; QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000000ull + (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000000ull / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
 uint64_t time_human() {
     time_t mtime = time(0);
     struct tm *ti = localtime(&mtime);
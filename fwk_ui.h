@@ -51,6 +51,7 @@ static struct nk_glfw ui_glfw = {0};
 void ui_destroy(void) {
     if(ui_ctx) {
         nk_glfw3_shutdown(&ui_glfw); // nk_sdl_shutdown();
+        glstate_invalidate();
         ui_ctx = 0;
     }
 }
@@ -68,11 +69,13 @@ void ui_create() {
 #if is(win32)
         struct nk_font *arial = nk_font_atlas_add_from_file(atlas, stringf("%s/fonts/arial.ttf",getenv("windir")), 14.5, 0); last = arial ? arial : last;
 #else
-        struct nk_font *arial = nk_font_atlas_add_from_file(atlas, vfs_find("LiberationSans-Regular.ttf"), 15.0, 0); last = arial ? arial : last;
+        int size; char *ttf = vfs_load("LiberationSans-Regular.ttf", &size); // stays valid: the atlas may keep pointing into it
+        struct nk_font *arial = ttf ? nk_font_atlas_add_from_memory(atlas, ttf, size, 15.0, 0) : 0; last = arial ? arial : last;
 #endif
         /*struct nk_font *droid = nk_font_atlas_add_from_file(atlas, "nuklear/extra_font/DroidSans.ttf", 14, 0); last = droid ? droid : last; */
         /*struct nk_font *roboto = nk_font_atlas_add_from_file(atlas, "nuklear/extra_font/Roboto-Regular.ttf", 16, 0); last = roboto ? roboto : last; */
         nk_glfw3_font_stash_end(&ui_glfw); // nk_sdl_font_stash_end();
+        glstate_invalidate(); // device objects were created & bound by nuklear
         /* nk_style_load_all_cursors(ctx, atlas->cursors); glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_HIDDEN); */
         if(last) nk_style_set_font(ui_ctx, &last->handle);}
 
@@ -232,6 +235,7 @@ void ui_render() {
      * rendering the UI. */
     //nk_sdl_render(NK_ANTI_ALIASING_ON, MAX_VERTEX_MEMORY, MAX_ELEMENT_MEMORY);
     nk_glfw3_render(&ui_glfw, NK_ANTI_ALIASING_ON, MAX_VERTEX_MEMORY, MAX_ELEMENT_MEMORY);
+    glstate_invalidate(); // nuklear sets gl state behind our back
     ui_dirty = 1;
     ui_hue = 0;
 
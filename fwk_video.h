@@ -21,6 +21,7 @@ void       video_destroy( video_t *v );
 struct video_t {
     // mpeg player
     plm_t *plm;
+    vfs_file *fp; // streamed source
     double previous_time;
     // yCbCr
     union {
@@ -37,8 +38,8 @@ struct video_t {
 };
 
 static void mpeg_update_texture(GLuint unit, GLuint texture, plm_plane_t *plane) {
-    glActiveTexture(unit);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    glstate_active_texture(unit - GL_TEXTURE0);
+    glstate_bind_texture(GL_TEXTURE_2D, texture);
     glTexImage2D(
         GL_TEXTURE_2D, 0, GL_RED, plane->width, plane->height, 0,
         GL_RED, GL_UNSIGNED_BYTE, plane->data
@@ -55,14 +56,25 @@ static void mpeg_video_callback( plm_t* plm, plm_frame_t* frame, void* user ) {
     texture_update( &v->texture, v->texture.w, v->texture.h, v->texture.n, v->surface, v->texture.flags );
 #endif
 }
+static size_t mpeg_read_callback(uint8_t *bytes, size_t length, void *user) {
+    int len = vfs_fread((vfs_file*)user, bytes, (int)length);
+    return len > 0 ? len : 0;
+}
+static void mpeg_seek_callback(size_t pos, void *user) {
+    vfs_seek((vfs_file*)user, (int)pos, SEEK_SET);
+}
 static void mpeg_audio_callback(plm_t *plm, plm_samples_t *samples, void *user) {
     video_t *v = (video_t*)user;
     audio_queue(samples->interleaved, samples->count, AUDIO_FLOAT | AUDIO_2CH | AUDIO_44KHZ );
 }
 
 video_t* video( const char *filename, int flags ) {
-    plm_t* plm = plm_create_with_filename( vfs_find(filename) );
+    // stream: only the decoder buffer and vfs window are resident, not the whole video. seekable, as a file is
+    vfs_file *fp = vfs_open( filename );
+    plm_buffer_t *buf = fp ? plm_buffer_create_with_callbacks( mpeg_read_callback, mpeg_seek_callback, vfs_fsize(fp), fp ) : 0;
+    plm_t* plm = buf ? plm_create_with_buffer( buf, 1 ) : 0;
     if ( !plm ) {
+        vfs_close( fp );
         PANIC( "!Cannot open '%s' file for reading\n", filename );
         return 0;
     }
@@ -86,6 +98,7 @@ video_t* video( const char *filename, int flags ) {
     p->surface = REALLOC( p->surface,  w * h * 3 );
 #endif
     p->plm = plm;
+    p->fp = fp;
 
     plm_set_loop(plm, false);
     plm_set_audio_enabled(plm, true);
@@ -114,6 +127,7 @@ texture_t* video_decode( video_t *v ) { // decodes next frame, returns associate
 
 void video_destroy(video_t *v) {
     plm_destroy( v->plm );
+    vfs_close( v->fp );
 
 #if WITH_VIDEO_YCBCR
     texture_destroy(&v->textureY);
@@ -268,6 +268,9 @@ int window_swap() {
 
         glfwPollEvents();
 
+        vfs_async_update(); // fire async load callbacks
+        texture_stream_update(); // upload streamed textures within budget
+
         // input_update(); // already hooked!
 
         double now = paused ? t : glfwGetTime();
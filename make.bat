@@ -18,6 +18,11 @@ clang test_scene.c   -g -w -lm -ldl -lpthread -o test_scene
 clang test_sprite.c  -g -w -lm -ldl -lpthread -o test_sprite
 clang test_video.c   -g -w -lm -ldl -lpthread -o test_video
 clang test_script.c  -g -w -lm -ldl -lpthread -o test_script
+clang test_occlusion.c -g -w -lm -ldl -lpthread -o test_occlusion
+clang test_collide_suite.c -g -w -lm -ldl -lpthread -o test_collide_suite
+clang test_vfs.c -g -w -lm -ldl -lpthread -o test_vfs
+clang test_render.c -g -w -lm -ldl -lpthread -o test_render
+clang test_instanced.c -g -w -lm -ldl -lpthread -o test_instanced
 
 exit
 
@@ -58,6 +63,11 @@ cl test_scene.c   /nologo /openmp /Zi
 cl test_sprite.c  /nologo /openmp /Zi
 cl test_video.c   /nologo /openmp /Zi
 cl test_script.c  /nologo /openmp /Zi
+cl test_occlusion.c /nologo /openmp /Zi
+cl test_collide_suite.c /nologo /openmp /Zi
+cl test_vfs.c /nologo /openmp /Zi
+cl test_render.c /nologo /openmp /Zi
+cl test_instanced.c /nologo /openmp /Zi
 
 pause
 exit /b
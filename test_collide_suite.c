@@ -0,0 +1,590 @@
+// headless collision regression & benchmark suite. counterpart of test_collide.c demo.
+// - rlyeh, public domain
+//
+// every primitive pair in fwk_collide.h runs over randomized and edge-case configurations:
+// - oracle: analytic pairs must agree with gjk distance between shape cores (point, segment, box).
+// - test/hit: X_test_Y() and X_hit_Y() agree, and hits carry non-negative depth & unit normals.
+// - symmetry: X_test_Y(a,b) == Y_test_X(b,a).
+// results near contact (|separation| < 1e-3) are not judged. exit code is the number of failed checks.
+// pass any argument to skip the large benchmarks.
+
+#define FWK_C
+#include "fwk.h"
+
+enum { CASES = 20000, BENCH = 4096 };
+
+// -----------------------------------------------------------------------------
+// shapes
+
+enum { SPHERE, AABB, CAPSULE, POLY };
+
+typedef struct shape {
+    int type;
+    sphere sphere; aabb aabb; capsule capsule; poly poly;
+    vec3 core[8]; int cores; float radius; // convex core + radius, for the gjk oracle
+    vec3 verts[8];                        // poly storage
+} shape;
+
+static float frand(float lo, float hi) {
+    return lo + (hi - lo) * (float)randf();
+}
+static vec3 vrand(float lo, float hi) {
+    return vec3(frand(lo,hi), frand(lo,hi), frand(lo,hi));
+}
+static void shape_aabb_corners(vec3 *out, aabb a) {
+    for( int i = 0; i < 8; ++i ) out[i] = vec3(i&4 ? a.max.x : a.min.x, i&2 ? a.max.y : a.min.y, i&1 ? a.max.z : a.min.z);
+}
+static shape shape_make(int type, int edge) {
+    // edge cases: degenerate sizes and coincident centers
+    shape s = {0};
+    s.type = type;
+    vec3 c = edge ? vec3(0,0,0) : vrand(-2,2);
+    if( type == SPHERE ) {
+        s.sphere = sphere(c, edge ? frand(0, 0.01f) : frand(0.1f, 1.5f));
+        s.core[0] = c, s.cores = 1, s.radius = s.sphere.r;
+    }
+    if( type == AABB ) {
+        vec3 e = edge ? vec3(frand(0,1),0,frand(0,1)) : vrand(0.1f, 1.5f);
+        s.aabb = aabb(sub3(c, e), add3(c, e));
+        shape_aabb_corners(s.core, s.aabb), s.cores = 8;
+    }
+    if( type == CAPSULE ) {
+        vec3 b = edge ? c : add3(c, vrand(-1.5f, 1.5f));
+        s.capsule = capsule(c, b, edge ? frand(0.1f, 1) : frand(0.1f, 1));
+        s.core[0] = s.capsule.a, s.core[1] = s.capsule.b, s.cores = 2, s.radius = s.capsule.r;
+    }
+    if( type == POLY ) {
+        for( int i = 0; i < 8; ++i ) s.verts[i] = add3(c, edge ? vec3(i&1 ? 0.5f : -0.5f, 0, i&2 ? 0.5f : -0.5f) : vrand(-1,1));
+        s.poly = poly(0, 8);
+        memcpy(s.core, s.verts, sizeof(s.verts)), s.cores = 8;
+    }
+    return s;
+}
+static shape* shape_fix(shape *s) { // polys point to their own storage: fix after copies
+    if( s->type == POLY ) s->poly.verts = s->verts;
+    return s;
+}
+static float shape_separation(shape *a, shape *b) {
+    // oracle: gjk distance between cores minus radii. negative if overlapping
+    struct gjk_result res;
+    if( poly_hit_poly(&res, poly(a->core, a->cores), poly(b->core, b->cores)) ) return -1;
+    return sqrtf(res.distance_squared) - (a->radius + b->radius);
+}
+
+// -----------------------------------------------------------------------------
+// pairs
+
+typedef int (*test_fn)(shape *a, shape *b);
+typedef hit* (*hit_fn)(shape *a, shape *b);
+typedef int (*gjk_fn)(struct gjk_result *res, shape *a, shape *b);
+
+#define TEST(A,B) \
+    static int test_##A##_##B(shape *a, shape *b) { return A##_test_##B(a->A, b->B); }
+#define HIT(A,B) \
+    static hit* hit_##A##_##B(shape *a, shape *b) { return A##_hit_##B(a->A, b->B); }
+#define GJK(B) \
+    static int gjk_poly_##B(struct gjk_result *res, shape *a, shape *b) { return poly_hit_##B(res, a->poly, b->B); }
+
+TEST(sphere,sphere)   HIT(sphere,sphere)
+TEST(sphere,aabb)     HIT(sphere,aabb)
+TEST(sphere,capsule)  HIT(sphere,capsule)
+TEST(sphere,poly)
+TEST(aabb,sphere)     HIT(aabb,sphere)
+TEST(aabb,aabb)       HIT(aabb,aabb)
+TEST(aabb,capsule)    HIT(aabb,capsule)
+TEST(aabb,poly)
+TEST(capsule,sphere)  HIT(capsule,sphere)
+TEST(capsule,aabb)    HIT(capsule,aabb)
+TEST(capsule,capsule) HIT(capsule,capsule)
+TEST(capsule,poly)
+TEST(poly,sphere)     GJK(sphere)
+TEST(poly,aabb)       GJK(aabb)
+TEST(poly,capsule)    GJK(capsule)
+TEST(poly,poly)       GJK(poly)
+
+static const char *names[] = { "sphere", "aabb", "capsule", "poly" };
+static test_fn tests[4][4] = {
+    { test_sphere_sphere,  test_sphere_aabb,  test_sphere_capsule,  test_sphere_poly  },
+    { test_aabb_sphere,    test_aabb_aabb,    test_aabb_capsule,    test_aabb_poly    },
+    { test_capsule_sphere, test_capsule_aabb, test_capsule_capsule, test_capsule_poly },
+    { test_poly_sphere,    test_poly_aabb,    test_poly_capsule,    test_poly_poly    },
+};
+static hit_fn hitters[4][4] = {
+    { hit_sphere_sphere,  hit_sphere_aabb,  hit_sphere_capsule,  0 },
+    { hit_aabb_sphere,    hit_aabb_aabb,    hit_aabb_capsule,    0 },
+    { hit_capsule_sphere, hit_capsule_aabb, hit_capsule_capsule, 0 },
+    { 0, 0, 0, 0 },
+};
+static gjk_fn gjkers[4] = { gjk_poly_sphere, gjk_poly_aabb, gjk_poly_capsule, gjk_poly_poly };
+
+// -----------------------------------------------------------------------------
+// report
+
+static int failures;
+
+typedef struct stats {
+    const char *name;
+    int cases, judged, hits;
+    int oracle, testhit, symmetry, depth; // mismatches
+    double ns_test, ns_hit;
+} stats;
+
+static void report_header() {
+    printf("%-18s %7s %6s %8s %8s %8s %8s %9s %9s\n", "pair", "cases", "hit%", "oracle", "test/hit", "symmetry", "depth", "ns/test", "ns/hit");
+}
+// known approximations in the analytic pairs. seeds are fixed, so their mismatch counts are pinned per check:
+// counts up to the pinned ones are reported, but not counted as failures. any rise fails
+static const struct { const char *pair; int oracle, testhit, symmetry, depth; const char *reason; } known[] = {
+    { "sphere-sphere",      0,    0, 0,  621, "coincident centers give a zero normal" },
+    { "sphere-aabb",        0,    0, 0, 4892, "normal & depth are measured towards aabb center" },
+    { "aabb-sphere",        0,    0, 0,  550, "normal & depth are measured towards aabb center" },
+    { "aabb-aabb",          0,    0, 0, 3771, "normal & depth are measured between aabb centers" },
+    { "sphere-capsule",     0, 1601, 0, 1268, "sphere_hit_capsule() is a ray cast approximation" },
+    { "aabb-capsule",    1136,    0, 0,  625, "only the capsule point closest to aabb center is tested" },
+    { "capsule-aabb",    1440,    0, 0, 1249, "only the capsule point closest to aabb center is tested" },
+    { "capsule-sphere",     0,  549, 0, 4517, "capsule surface point is tested against sphere radius, depth is sqrt(d2-r2)" },
+    { "capsule-capsule",    0,    0, 0,  625, "coincident segments give a zero normal" },
+};
+
+static void report(stats *s) {
+    int checks[4] = { s->oracle, s->testhit, s->symmetry, s->depth }, allowed[4] = {0}, bad = 0, excused = 0;
+    const char *reason = 0;
+    for( int i = 0; i < countof(known); ++i ) if( !strcmp(known[i].pair, s->name) ) {
+        reason = known[i].reason;
+        allowed[0] = known[i].oracle, allowed[1] = known[i].testhit, allowed[2] = known[i].symmetry, allowed[3] = known[i].depth;
+    }
+    for( int c = 0; c < 4; ++c ) if( checks[c] ) checks[c] <= allowed[c] ? ++excused : ++bad;
+    failures += !!bad;
+    char ns[2][16]; // timings not taken are shown as '-'
+    for( int i = 0; i < 2; ++i ) {
+        double t = i ? s->ns_hit : s->ns_test;
+        snprintf(ns[i], 16, t > 0 ? "%.1f" : "-", t);
+    }
+    printf("%-18s %7d %5.1f%% %8d %8d %8d %8d %9s %9s%s%s\n", s->name, s->cases, s->hits * 100.0 / (s->cases + !s->cases),
+        s->oracle, s->testhit, s->symmetry, s->depth, ns[0], ns[1], bad ? "  FAIL" : excused ? "  KNOWN: " : "", !bad && excused ? reason : "");
+}
+
+// ns per call of expr, over inputs i in [0..BENCH)
+#define BENCH_NS(out, expr) do { \
+    volatile int sink_ = 0; uint64_t t0_ = time_ns(); \
+    for( int rep_ = 0; rep_ < 4; ++rep_ ) for( int i = 0; i < BENCH; ++i ) sink_ += !!(expr); \
+    out = (time_ns() - t0_) / (4.0 * BENCH); \
+} while(0)
+
+// -----------------------------------------------------------------------------
+// shape pairs: sphere, aabb, capsule, poly
+
+static void suite_pairs() {
+    static shape A[BENCH], B[BENCH];
+    report_header();
+
+    for( int ta = 0; ta < 4; ++ta )
+    for( int tb = 0; tb < 4; ++tb ) {
+        stats s = { stringf("%s-%s", names[ta], names[tb]) };
+
+        for( int i = 0; i < CASES; ++i ) {
+            int edge = i % 16 == 0;
+            shape a = shape_make(ta, edge), b = shape_make(tb, edge && i % 32 == 0);
+            shape_fix(&a), shape_fix(&b);
+
+            int t = tests[ta][tb](&a, &b), r = tests[tb][ta](&b, &a);
+            float sep = shape_separation(&a, &b);
+            s.cases++, s.hits += t;
+            if( fabsf(sep) < 1e-3f ) continue;
+            s.judged++;
+
+            // analytic pairs are judged by their tests, poly pairs by their gjk results below
+            if( ta != POLY && tb != POLY ) s.oracle += t != (sep < 0);
+            s.symmetry += t != r;
+
+            if( hitters[ta][tb] ) {
+                hit *h = hitters[ta][tb](&a, &b);
+                s.testhit += !!h != t;
+                if( h ) s.depth += !(h->depth >= -1e-4f) || fabsf(len3(h->n) - 1) > 1e-3f;
+            }
+            if( ta == POLY ) {
+                struct gjk_result res;
+                int g = gjkers[tb](&res, &a, &b);
+                s.testhit += g != t;
+                s.depth += !(res.distance_squared >= 0);
+                s.oracle += g != (sep < 0);
+            }
+        }
+
+        // timings, over a fixed set of random pairs
+        for( int i = 0; i < BENCH; ++i ) A[i] = shape_make(ta, 0), B[i] = shape_make(tb, 0);
+        for( int i = 0; i < BENCH; ++i ) shape_fix(&A[i]), shape_fix(&B[i]);
+        BENCH_NS(s.ns_test, tests[ta][tb](&A[i], &B[i]));
+        if( hitters[ta][tb] || ta == POLY ) {
+            struct gjk_result res;
+            BENCH_NS(s.ns_hit, hitters[ta][tb] ? !!hitters[ta][tb](&A[i], &B[i]) : gjkers[tb](&res, &A[i], &B[i]));
+        }
+        report(&s);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// poly variants: transformed and cached queries must match plain ones
+
+static void suite_poly_variants() {
+    static shape A[BENCH], B[BENCH];
+    stats t = { "poly-transform" }, c = { "poly-cached" };
+    mat33 id; id33(id);
+    vec3 zero = vec3(0,0,0);
+
+    for( int i = 0; i < CASES; ++i ) {
+        shape a = shape_make(POLY, 0), b = shape_make(POLY, 0), s = shape_make(SPHERE, 0), k = shape_make(CAPSULE, 0), x = shape_make(AABB, 0);
+        shape_fix(&a), shape_fix(&b);
+        if( i < BENCH ) A[i] = a, B[i] = b, shape_fix(&A[i]), shape_fix(&B[i]);
+        float sep = shape_separation(&a, &b);
+        t.cases++, c.cases++;
+        if( fabsf(sep) < 1e-3f ) continue;
+        t.judged++, c.judged++;
+
+        int p = poly_test_poly(a.poly, b.poly);
+        t.hits += p;
+        t.oracle += poly_test_poly_transform(a.poly, zero, id, b.poly, zero, id) != p;
+        if( fabsf(shape_separation(&a, &s)) > 1e-3f ) t.oracle += poly_test_sphere_transform(a.poly, zero, id, s.sphere) != poly_test_sphere(a.poly, s.sphere);
+        if( fabsf(shape_separation(&a, &k)) > 1e-3f ) t.oracle += poly_test_capsule_transform(a.poly, zero, id, k.capsule) != poly_test_capsule(a.poly, k.capsule);
+        if( fabsf(shape_separation(&a, &x)) > 1e-3f ) t.oracle += poly_test_aabb_transform(a.poly, zero, id, x.aabb) != poly_test_aabb(a.poly, x.aabb);
+
+        // cached pairs, queried twice: cold and warm
+        struct gjk_result res;
+        for( int warm = 0; warm < 2; ++warm ) {
+            int h = poly_hit_poly_cached(&res, 1, a.poly, 2, b.poly);
+            c.hits += h * warm;
+            c.oracle += h != p;
+            c.depth += !(res.distance_squared >= 0);
+        }
+        poly_cache_drop(1, 2);
+    }
+
+    // timings: transformed test, and warm cached hit of pairs that stay in place
+    struct gjk_result res;
+    BENCH_NS(t.ns_test, poly_test_poly_transform(A[i].poly, zero, id, B[i].poly, zero, id));
+    for( int i = 0; i < BENCH; ++i ) poly_hit_poly_cached(&res, i, A[i].poly, BENCH + i, B[i].poly);
+    BENCH_NS(c.ns_hit, poly_hit_poly_cached(&res, i, A[i].poly, BENCH + i, B[i].poly));
+    poly_cache_clear();
+
+    report(&t);
+    report(&c);
+}
+
+// -----------------------------------------------------------------------------
+// rays
+
+static void suite_rays() {
+    static ray R[BENCH]; static sphere S[BENCH]; static aabb A[BENCH]; static triangle T[BENCH]; static plane P[BENCH];
+    stats rs = { "ray-sphere" }, ra = { "ray-aabb" }, rt = { "ray-triangle" }, rp = { "ray-plane" };
+
+    for( int i = 0; i < CASES; ++i ) {
+        // rays start outside shapes, pointing roughly at them
+        vec3 o = vrand(-6,6), target = vrand(-1.5f,1.5f);
+        ray r = ray(o, norm3(sub3(target, o)));
+        if( i % 16 == 0 ) r.d = scale3(r.d, -1); // pointing away
+        if( i < BENCH ) R[i] = r;
+
+        // sphere: hit iff line passes within radius, ahead of origin
+        sphere s = sphere(vrand(-1,1), frand(0.1f, 1.5f));
+        if( i < BENCH ) S[i] = s;
+        if( len3(sub3(o, s.c)) > s.r + 1e-3f ) {
+            vec3 oc = sub3(s.c, o); float tc = dot3(oc, r.d), d2 = dot3(oc,oc) - tc*tc;
+            int expected = tc >= 0 && d2 <= s.r*s.r;
+            float t0, t1;
+            int got = ray_test_sphere(&t0, &t1, r, s);
+            rs.cases++, rs.hits += got;
+            if( fabsf(sqrtf(fabsf(d2)) - s.r) > 1e-3f ) {
+                rs.judged++;
+                rs.oracle += got != expected;
+                hit *h = ray_hit_sphere(r, s);
+                rs.testhit += !!h != got;
+                if( h ) rs.depth += h->t0 > h->t1 || fabsf(len3(sub3(h->p, s.c)) - s.r) > 1e-3f;
+            }
+        }
+
+        // aabb: slab test, ahead of origin
+        aabb a = aabb(sub3(target, vrand(0.1f,1.5f)), add3(target, vrand(0.1f,1.5f)));
+        if( i < BENCH ) A[i] = a;
+        if( !aabb_contains_point(a, o) ) {
+            float tn = -FLT_MAX, tf = FLT_MAX;
+            for( int k = 0; k < 3; ++k ) {
+                float p = k == 0 ? o.x : k == 1 ? o.y : o.z, d = k == 0 ? r.d.x : k == 1 ? r.d.y : r.d.z;
+                float lo = k == 0 ? a.min.x : k == 1 ? a.min.y : a.min.z, hi = k == 0 ? a.max.x : k == 1 ? a.max.y : a.max.z;
+                float n = (lo - p) / d, f = (hi - p) / d;
+                tn = maxf(tn, minf(n, f)), tf = minf(tf, maxf(n, f));
+            }
+            int expected = tn <= tf && tf >= 0;
+            float t0, t1;
+            int got = ray_test_aabb(&t0, &t1, r, a);
+            ra.cases++, ra.hits += got;
+            if( fabsf(tf - tn) > 1e-3f ) {
+                ra.judged++;
+                ra.oracle += got != expected;
+                hit *h = ray_hit_aabb(r, a);
+                ra.testhit += !!h != got;
+                if( h && expected ) ra.depth += h->t0 > h->t1 || aabb_distance2_point(a, h->p) > 1e-4f || fabsf(len3(h->n) - 1) > 1e-3f;
+            }
+        }
+
+        // triangle: ray_test_triangle() > 0 iff hit
+        triangle tr = { vrand(-2,2), vrand(-2,2), vrand(-2,2) };
+        if( i < BENCH ) T[i] = tr;
+        vec3 n = cross3(sub3(tr.p1, tr.p0), sub3(tr.p2, tr.p0));
+        if( len3(n) > 1e-2f ) {
+            float t = ray_test_triangle(r, tr);
+            hit *h = ray_hit_triangle(r, tr);
+            rt.cases++, rt.judged++, rt.hits += t > 0;
+            rt.testhit += !!h != (t > 0);
+            if( h ) rt.depth += fabsf(dot3(norm3(n), sub3(h->p, tr.p0))) > 1e-3f;
+        }
+
+        // plane: hit point lies on plane. error grows with distance along the ray
+        plane pl = plane(vrand(-1,1), norm3(vrand(-1,1)));
+        if( i < BENCH ) P[i] = pl;
+        hit *h = ray_hit_plane(r, pl);
+        rp.cases++, rp.judged++, rp.hits += !!h;
+        if( h ) rp.depth += fabsf(dot3(pl.n, sub3(h->p, pl.p))) > 1e-3f * maxf(1, h->t0) || h->t0 < 0;
+    }
+
+    float t0, t1;
+    BENCH_NS(rs.ns_test, ray_test_sphere(&t0, &t1, R[i], S[i]));
+    BENCH_NS(rs.ns_hit, ray_hit_sphere(R[i], S[i]));
+    BENCH_NS(ra.ns_test, ray_test_aabb(&t0, &t1, R[i], A[i]));
+    BENCH_NS(ra.ns_hit, ray_hit_aabb(R[i], A[i]));
+    BENCH_NS(rt.ns_test, ray_test_triangle(R[i], T[i]) > 0);
+    BENCH_NS(rt.ns_hit, ray_hit_triangle(R[i], T[i]));
+    BENCH_NS(rp.ns_hit, ray_hit_plane(R[i], P[i]));
+    report(&rs);
+    report(&ra);
+    report(&rt);
+    report(&rp);
+}
+
+// -----------------------------------------------------------------------------
+// frustum: tests may be conservative (false positives), but never reject visible shapes
+
+static void suite_frustum() {
+    static frustum F[BENCH]; static sphere S[BENCH]; static aabb A[BENCH];
+    stats fs = { "frustum-sphere" }, fa = { "frustum-aabb" };
+    mat44 proj, view, projview;
+    perspective44(proj, 60, 16/9.f, 0.1f, 50);
+
+    for( int i = 0; i < CASES; ++i ) {
+        vec3 eye = vrand(-5,5);
+        lookat44(view, eye, add3(eye, vrand(-1,1)), vec3(0,1,0));
+        multiply44x2(projview, proj, view);
+        frustum f = frustum_build(projview);
+
+        // sphere: visible if any sample of it lies in clip volume
+        sphere s = sphere(vrand(-30,30), frand(0.1f, 3));
+        int visible = 0;
+        for( int k = 0; k < 27 && !visible; ++k ) {
+            vec3 p = add3(s.c, scale3(vec3(k%3-1, k/3%3-1, k/9-1), s.r * 0.57f));
+            vec4 c = transform444(projview, vec34(p, 1));
+            visible = c.w > 0 && fabsf(c.x) <= c.w && fabsf(c.y) <= c.w && fabsf(c.z) <= c.w;
+        }
+        int got = frustum_test_sphere(f, s);
+        fs.cases++, fs.judged++, fs.hits += got;
+        fs.oracle += visible && !got;
+
+        // aabb: visible if any corner or center lies in clip volume
+        aabb a = aabb(sub3(s.c, vec3(s.r,s.r,s.r)), add3(s.c, vec3(s.r,s.r,s.r)));
+        vec3 corners[9]; shape_aabb_corners(corners, a); corners[8] = s.c;
+        visible = 0;
+        for( int k = 0; k < 9 && !visible; ++k ) {
+            vec4 c = transform444(projview, vec34(corners[k], 1));
+            visible = c.w > 0 && fabsf(c.x) <= c.w && fabsf(c.y) <= c.w && fabsf(c.z) <= c.w;
+        }
+        got = frustum_test_aabb(f, a);
+        fa.cases++, fa.judged++, fa.hits += got;
+        fa.oracle += visible && !got;
+        fa.symmetry += got < frustum_test_sphere(f, sphere(s.c, 0)); // box around sphere center must pass if its center does
+        if( i < BENCH ) F[i] = f, S[i] = s, A[i] = a;
+    }
+    BENCH_NS(fs.ns_test, frustum_test_sphere(F[i], S[i]));
+    BENCH_NS(fa.ns_test, frustum_test_aabb(F[i], A[i]));
+    report(&fs);
+    report(&fa);
+}
+
+// -----------------------------------------------------------------------------
+// sweeps: time of impact in [0..1], overlap at start gives t=0, shapes touch at t
+
+static void suite_sweeps() {
+    static sphere S[BENCH], S2[BENCH]; static aabb X[BENCH]; static capsule K[BENCH], M[BENCH]; static triangle T[BENCH]; static vec3 D[BENCH];
+    stats ss = { "sweep-sphere" }, sa = { "sweep-sphere-aabb" }, sc = { "sweep-capsule" }, st = { "sweep-triangle" };
+
+    for( int i = 0; i < CASES / 4; ++i ) {
+        shape a = shape_make(SPHERE, 0), b = shape_make(SPHERE, 0), x = shape_make(AABB, 0), k = shape_make(CAPSULE, 0), m = shape_make(CAPSULE, 0);
+        vec3 d = vrand(-4,4);
+        hit *h;
+        if( i < BENCH ) S[i] = a.sphere, S2[i] = b.sphere, X[i] = x.aabb, K[i] = k.capsule, M[i] = m.capsule, D[i] = d;
+
+        #define JUDGE(st, h, start, moved) do { \
+            st.cases++, st.judged++, st.hits += !!h; \
+            if( h ) st.depth += !(h->t0 >= 0 && h->t0 <= 1); \
+            if( (start) < -1e-3f ) st.testhit += !h || h->t0 > 0; \
+            if( h && h->t0 > 0 ) { shape z = moved; st.oracle += fabsf(shape_separation(&z, &b_)) > 2e-3f; } \
+        } while(0)
+
+        shape a_ = a, b_ = b, ma = a;
+        h = sphere_sweep_sphere(a.sphere, d, b.sphere);
+        if( h ) ma.core[0] = add3(a.sphere.c, scale3(d, h->t0));
+        JUDGE(ss, h, shape_separation(&a, &b), ma);
+
+        b_ = x; ma = a;
+        h = sphere_sweep_aabb(a.sphere, d, x.aabb);
+        if( h ) ma.core[0] = add3(a.sphere.c, scale3(d, h->t0));
+        JUDGE(sa, h, shape_separation(&a, &x), ma);
+
+        b_ = m; shape mk = k;
+        h = capsule_sweep_capsule(k.capsule, d, m.capsule);
+        if( h ) mk.core[0] = add3(k.capsule.a, scale3(d, h->t0)), mk.core[1] = add3(k.capsule.b, scale3(d, h->t0));
+        JUDGE(sc, h, shape_separation(&k, &m), mk);
+
+        triangle tr = { vrand(-2,2), vrand(-2,2), vrand(-2,2) };
+        if( i < BENCH ) T[i] = tr;
+        shape ts = {0}; ts.core[0] = tr.p0, ts.core[1] = tr.p1, ts.core[2] = tr.p2, ts.cores = 3;
+        b_ = ts; ma = a;
+        h = sphere_sweep_triangle(a.sphere, d, tr);
+        if( h ) ma.core[0] = add3(a.sphere.c, scale3(d, h->t0));
+        JUDGE(st, h, shape_separation(&a, &ts), ma);
+
+        #undef JUDGE
+    }
+    BENCH_NS(ss.ns_hit, sphere_sweep_sphere(S[i], D[i], S2[i]));
+    BENCH_NS(sa.ns_hit, sphere_sweep_aabb(S[i], D[i], X[i]));
+    BENCH_NS(sc.ns_hit, capsule_sweep_capsule(K[i], D[i], M[i]));
+    BENCH_NS(st.ns_hit, sphere_sweep_triangle(S[i], D[i], T[i]));
+    report(&ss);
+    report(&sa);
+    report(&sc);
+    report(&st);
+}
+
+// -----------------------------------------------------------------------------
+// benchmarks
+
+static void bench_cached() {
+    // resting stacks: 64 boxes (or capsules on boxes) sinking 1mm into each other, swaying slowly. every pair touches,
+    // so gjk runs every call and the cached simplex is what warm starts it
+    enum { STACK = 64, FRAMES = 200 };
+    vec3 box[8]; shape_aabb_corners(box, aabb(vec3(-0.5f,-0.5f,-0.5f), vec3(0.5f,0.5f,0.5f)));
+    static vec3 verts[STACK][8];
+    mat33 id; id33(id);
+
+    for( int kind = 0; kind < 2; ++kind ) {
+        double ns[2] = {1e30, 1e30}; int iters[2] = {0}, hitcount[2] = {0}, queries = 0;
+        for( int run = 0; run < 6; ++run ) { // best of 3 runs per mode, modes interleaved
+            int cached = run & 1;
+            double total = 0;
+            iters[cached] = hitcount[cached] = 0;
+            poly_cache_clear();
+            for( int f = 0; f < FRAMES; ++f ) {
+                for( int i = 0; i < STACK; ++i ) {
+                    vec3 jitter = vec3(0.01f * sinf(f * 0.05f + i), 0, 0.01f * cosf(f * 0.03f + i));
+                    for( int v = 0; v < 8; ++v ) verts[i][v] = add3(add3(box[v], vec3(0, i * 0.999f, 0)), jitter);
+                }
+                uint64_t t0 = time_ns();
+                for( int i = 0; i + 1 < STACK; ++i ) {
+                    struct gjk_result res;
+                    int h;
+                    if( kind == 0 ) {
+                        poly a = poly(verts[i], 8), b = poly(verts[i+1], 8);
+                        h = cached ? poly_hit_poly_cached(&res, i, a, i+1, b) : poly_hit_poly(&res, a, b);
+                    } else {
+                        capsule c = capsule(add3(verts[i+1][0], vec3(0.5f,0.2f,0)), add3(verts[i+1][0], vec3(0.5f,0.2f,1)), 0.2f);
+                        h = cached ? poly_hit_capsule_cached(&res, i, poly(verts[i], 8), i+1, c) : poly_hit_capsule(&res, poly(verts[i], 8), c);
+                    }
+                    hitcount[cached] += h, iters[cached] += res.iterations;
+                }
+                total += time_ns() - t0;
+            }
+            ns[cached] = total < ns[cached] ? total : ns[cached];
+        }
+        queries = FRAMES * (STACK - 1);
+        printf("%-18s uncached %6.1fns/pair, cached %6.1fns/pair %4.2f iters, hits %d/%d%s\n", kind ? "stack-capsules" : "stack-boxes",
+            ns[0] / queries, ns[1] / queries, iters[1] / (float)queries, hitcount[0], hitcount[1], hitcount[0] != hitcount[1] || hitcount[0] != queries ? " FAIL" : "");
+        failures += hitcount[0] != hitcount[1] || hitcount[0] != queries;
+    }
+    poly_cache_clear();
+}
+
+static void bench_grid(int large) {
+    // crowd of small spheres at constant density: build & self collision, 10K to 1M
+    for( int n = 10000; n <= (large ? 1000000 : 10000); n *= 10 ) {
+        sphere *s = REALLOC(0, sizeof(sphere) * n);
+        float side = cbrtf(n) * 2;
+        for( int i = 0; i < n; ++i ) s[i] = sphere(vrand(0, side), frand(0.1f, 0.4f));
+
+        grid g = {0};
+        uint64_t t0 = time_ns();
+        grid_build(&g, s, n, 0);
+        uint64_t t1 = time_ns();
+        int count = grid_pairs(&g, 0, 0, 0);
+        uint64_t t2 = time_ns();
+        printf("%-18s n=%-7d build %7.2fms, pairs %7.2fms (%d pairs, %s)", "grid", n, (t1-t0)/1e6, (t2-t1)/1e6, count, g.dims[0] ? "dense" : "hashed");
+
+        if( n == 10000 ) { // against brute force
+            int brute = 0;
+            uint64_t t3 = time_ns();
+            for( int i = 0; i < n; ++i ) for( int j = i + 1; j < n; ++j ) brute += sphere_test_sphere(s[i], s[j]);
+            printf(", brute %.2fms (%d pairs)%s", (time_ns()-t3)/1e6, brute, brute != count ? "  FAIL" : "");
+            failures += brute != count;
+        }
+        puts("");
+
+        grid_free(&g);
+        REALLOC(s, 0);
+    }
+}
+
+static void bench_bvh() {
+    // triangle soup, swept spheres & capsules: bvh against linear scan
+    enum { TRIS = 5000, SWEEPS = 500 };
+    triangle *tris = REALLOC(0, sizeof(triangle) * TRIS);
+    for( int i = 0; i < TRIS; ++i ) {
+        vec3 c = vrand(-20,20);
+        tris[i] = (triangle){ add3(c, vrand(-1,1)), add3(c, vrand(-1,1)), add3(c, vrand(-1,1)) };
+    }
+    bvh b = bvh_build(tris, TRIS);
+
+    double ns[2] = {0}; int mismatches = 0;
+    for( int i = 0; i < SWEEPS; ++i ) {
+        sphere s = sphere(vrand(-20,20), 0.3f);
+        vec3 d = vrand(-10,10);
+        uint64_t t0 = time_ns();
+        hit *h = sphere_sweep_bvh(s, d, &b, 0);
+        float tb = h ? h->t0 : 2;
+        uint64_t t1 = time_ns();
+        float tl = 2;
+        for( int k = 0; k < TRIS; ++k ) if( (h = sphere_sweep_triangle(s, d, tris[k])) && h->t0 < tl ) tl = h->t0;
+        uint64_t t2 = time_ns();
+        ns[0] += t1 - t0, ns[1] += t2 - t1;
+        mismatches += fabsf(tb - tl) > 1e-5f;
+    }
+    printf("%-18s %d tris, bvh %.1fus/sweep, linear %.1fus/sweep, mismatches %d%s\n", "sweep-bvh", TRIS,
+        ns[0] / SWEEPS / 1e3, ns[1] / SWEEPS / 1e3, mismatches, mismatches ? "  FAIL" : "");
+    failures += !!mismatches;
+
+    bvh_free(&b);
+    REALLOC(tris, 0);
+}
+
+int main(int argc, char **argv) {
+    randset(1234);
+
+    suite_pairs();
+    suite_poly_variants();
+    suite_rays();
+    suite_frustum();
+    suite_sweeps();
+    puts("");
+
+    bench_cached();
+    bench_grid(argc <= 1);
+    bench_bvh();
+
+    printf("\n%d failed\n", failures);
+    return failures;
+}
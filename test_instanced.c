@@ -0,0 +1,62 @@
+// instanced model demo: a crowd of identical props, drawn per object or in one instanced call per mesh
+// - rlyeh, public domain
+
+#define FWK_C
+#include "fwk.h"
+
+int main() {
+    enum { CROWD = 5000 };
+    bool do_instanced = 1;
+
+    window_create(75, WINDOW_MSAA4);
+    window_title(__FILE__);
+
+    camera_t cam = camera();
+    model_t m = model("models/witch/witch_object.obj", 0);
+    texture_t t = texture("models/witch/witch_object_diffuse.tga.png", TEXTURE_RGB);
+    for( int i = 0; i < m.iqm->nummeshes; ++i ) m.iqm->textures[i] = t.id;
+
+    // lay the crowd out on a grid, randomly spun and scaled
+    mat44 *crowd = REALLOC(0, sizeof(mat44) * CROWD);
+    for( int i = 0, side = sqrt(CROWD); i < CROWD; ++i ) {
+        vec3 p = vec3((i % side - side/2) * 2.f, 0, (i / side - side/2) * 2.f);
+        vec3 r = vec3(0, randf() * 360, 0);
+        float s = 0.5f + randf();
+        rotationq44(crowd[i], eulerq(r)); scale44(crowd[i], s,s,s); relocate44(crowd[i], p.x,p.y,p.z);
+    }
+
+    while( window_swap() ) {
+        if(input(KEY_ESC)) break;
+
+        // fps camera
+        bool active = ui_active() ? false : input(MOUSE_L) || input(MOUSE_M) || input(MOUSE_R);
+        window_cursor( !active );
+
+        if( active ) cam.speed = clampf(cam.speed + input_diff(MOUSE_W) / 10, 0.05f, 5.0f);
+        vec2 mouse = scale2(vec2(input_diff(MOUSE_X), -input_diff(MOUSE_Y)), 0.2f * active);
+        vec3 wasdec = scale3(vec3(input(KEY_D)-input(KEY_A),input(KEY_E)-input(KEY_C),input(KEY_W)-input(KEY_S)), cam.speed);
+        camera_move(&cam, wasdec.x,wasdec.y,wasdec.z);
+        camera_fps(&cam, mouse.x,mouse.y);
+
+        ddraw_ground(0);
+        ddraw_flush();
+
+        double t0 = time_ss();
+        profile(crowd submit) {
+            if( do_instanced ) {
+                model_render_instanced(m, cam.proj, cam.view, crowd, 0, CROWD);
+            } else {
+                for( int i = 0; i < CROWD; ++i ) model_render(m, cam.proj, cam.view, crowd[i]);
+            }
+        }
+        double t1 = time_ss();
+
+        if( ui_begin("Crowd", 0) ) {
+            if( ui_bool("Instanced", &do_instanced) ) {}
+            ui_label(va("%d objects, %.3f ms cpu submit", CROWD, (t1 - t0) * 1000));
+            ui_end();
+        }
+    }
+
+    FREE(crowd);
+}
@@ -0,0 +1,68 @@
+// software occlusion culling benchmark. headless, no window or gpu required.
+// - rlyeh, public domain
+
+#define FWK_C
+#include "fwk.h"
+
+// a city: grid of buildings used as occluders, and lots of small props in between
+enum { CITY = 24, PROPS = 20000 };
+
+static vec3 box_verts[8];
+static unsigned box_indices[36] = {
+    0,1,3, 0,3,2, 4,6,7, 4,7,5, 0,4,5, 0,5,1, 2,3,7, 2,7,6, 0,2,6, 0,6,4, 1,5,7, 1,7,3,
+};
+
+int main() {
+    for( int i = 0; i < 8; ++i ) box_verts[i] = vec3(i&4 ? 0.5f : -0.5f, i&2 ? 0.5f : -0.5f, i&1 ? 0.5f : -0.5f);
+
+    array(aabb) buildings = 0;
+    for( int z = 0; z < CITY; ++z )
+    for( int x = 0; x < CITY; ++x ) {
+        float h = 8 + (x * 7 + z * 13) % 17;
+        vec3 c = vec3((x - CITY/2) * 12.f, h * 0.5f, (z - CITY/2) * 12.f);
+        aabb b = { sub3(c, vec3(4, h*0.5f, 4)), add3(c, vec3(4, h*0.5f, 4)) };
+        array_push(buildings, b);
+    }
+
+    array(aabb) props = 0;
+    for( int i = 0; i < PROPS; ++i ) {
+        vec3 c = vec3((randf() - 0.5f) * CITY * 12, 0.5f + randf() * 20, (randf() - 0.5f) * CITY * 12);
+        aabb b = { sub3(c, vec3(0.5f,0.5f,0.5f)), add3(c, vec3(0.5f,0.5f,0.5f)) };
+        array_push(props, b);
+    }
+
+    int resolutions[][2] = { {256,128}, {512,256}, {1024,512} };
+    for( int r = 0; r < countof(resolutions); ++r ) {
+        occlusion_t oc = occlusion(resolutions[r][0], resolutions[r][1]);
+
+        mat44 proj; perspective44(proj, 60, 2, 0.1f, 1000);
+        double raster = 0, test = 0; int tested = 0, culled = 0, frames = 16;
+        for( int f = 0; f < frames; ++f ) {
+            // walk along a street, looking around
+            float a = f * C_PI * 2 / frames;
+            vec3 eye = vec3(6, 2, -CITY * 6 + f * CITY * 0.75f);
+            mat44 view; lookat44(view, eye, add3(eye, vec3(cosf(a), 0, sinf(a))), vec3(0,1,0));
+
+            occlusion_begin(&oc, proj, view);
+            for( int i = 0; i < array_count(buildings); ++i ) {
+                aabb b = buildings[i];
+                vec3 c = scale3(add3(b.min, b.max), 0.5f), s = sub3(b.max, b.min);
+                mat44 m; scaling44(m, s.x, s.y, s.z); relocate44(m, c.x, c.y, c.z);
+                occlusion_occluder(&oc, m, box_verts, box_indices, 12);
+            }
+            occlusion_end(&oc);
+            raster += oc.raster_ms;
+
+            uint64_t t0 = time_ns();
+            for( int i = 0; i < array_count(props); ++i ) occlusion_test_aabb(&oc, props[i]);
+            test += (time_ns() - t0) / 1e6;
+            tested += oc.tested, culled += oc.culled;
+        }
+
+        printf("%4dx%-4d occluders:%d triangles:%d raster:%.3fms test:%.3fms (%.0fns/box) culled:%d/%d (%.1f%%)\n",
+            oc.w, oc.h, oc.occluders, oc.triangles, raster / frames, test / frames, test * 1e6 / tested,
+            culled / frames, tested / frames, culled * 100.0 / tested);
+
+        occlusion_destroy(&oc);
+    }
+}
@@ -0,0 +1,881 @@
+// render cpu-side benchmark. headless, no window or gpu required.
+// - rlyeh, public domain
+
+#define FWK_C
+#include "fwk.h"
+
+static int failures;
+
+// binds a submission would issue: program, mesh and texture changes between consecutive draws
+static int count_binds(const uint64_t *keys, int n) {
+    int binds = 0;
+    for( int i = 0; i < n; ++i ) {
+        binds += !i || RENDERKEY_SHADER(keys[i]) != RENDERKEY_SHADER(keys[i-1]);
+        binds += !i || RENDERKEY_MESH(keys[i]) != RENDERKEY_MESH(keys[i-1]);
+        binds += !i || RENDERKEY_TEXTURE(keys[i]) != RENDERKEY_TEXTURE(keys[i-1]);
+    }
+    return binds;
+}
+
+typedef struct { uint64_t key; unsigned item; } keyed;
+static int keyed_qsort(const void *a, const void *b) {
+    uint64_t x = ((const keyed*)a)->key, y = ((const keyed*)b)->key;
+    return (x > y) - (x < y);
+}
+
+// render queue: 100K draws over a few programs, hundreds of textures and meshes, random depths
+static void bench_queue() {
+    enum { DRAWS = 100000, SHADERS = 8, TEXTURES = 300, MESHES = 64, FRAMES = 16 };
+
+    renderqueue_t rq = {0};
+    array(uint64_t) keys = 0;
+    keyed *pairs = REALLOC(0, sizeof(keyed) * DRAWS);
+    for( int i = 0; i < DRAWS; ++i ) {
+        unsigned mesh = 1 + randi(0, MESHES), texture = 1 + (mesh * 7 + randi(0, 5)) % TEXTURES; // meshes mostly keep their textures
+        uint64_t key = renderkey(i % 97 == 0, 1 + mesh % SHADERS, texture, mesh, randf() * 500);
+        array_push(keys, key);
+    }
+
+    double radix = 0, quick = 0;
+    int mismatches = 0;
+    for( int f = 0; f < FRAMES; ++f ) {
+        uint64_t t0 = time_ns();
+        renderqueue_clear(&rq);
+        for( int i = 0; i < DRAWS; ++i ) renderqueue_push(&rq, keys[i], i);
+        renderqueue_sort(&rq);
+        uint64_t t1 = time_ns();
+        for( int i = 0; i < DRAWS; ++i ) pairs[i].key = keys[i], pairs[i].item = i;
+        qsort(pairs, DRAWS, sizeof(keyed), keyed_qsort);
+        uint64_t t2 = time_ns();
+        radix += (t1 - t0) / 1e6, quick += (t2 - t1) / 1e6;
+    }
+
+    // sorted, items follow their keys, and equal keys keep submission order (stable)
+    for( int i = 0; i < DRAWS; ++i ) {
+        mismatches += rq.keys[i] != keys[rq.items[i]] || rq.keys[i] != pairs[i].key;
+        if( i ) mismatches += rq.keys[i] < rq.keys[i-1] || (rq.keys[i] == rq.keys[i-1] && rq.items[i] < rq.items[i-1]);
+    }
+    mismatches += RENDERKEY_BUCKET(rq.keys[DRAWS-1]) != 1; // bucket sorts first
+    failures += !!mismatches;
+
+    int unsorted = count_binds(keys, DRAWS), sorted = count_binds(rq.keys, DRAWS);
+    printf("%-8s %10s %10s %12s %12s %10s\n", "draws", "radix ms", "qsort ms", "binds", "sorted", "mismatches");
+    printf("%-8d %10.3f %10.3f %12d %12d %10d%s\n", DRAWS, radix / FRAMES, quick / FRAMES, unsorted, sorted,
+        mismatches, mismatches ? "  FAIL" : "");
+
+    renderqueue_destroy(&rq);
+    array_free(keys);
+    FREE(pairs);
+}
+
+// runs share mesh, model & texture, and are maximal: the item right after each one breaks it
+static int check_runs(renderqueue_t *rq) {
+    int mismatches = 0;
+    for( int k = 0, run, end = array_count(rq->items); k < end; k += run ) {
+        run = scene_run(rq, k);
+        object_t *a = scene_index(rq->items[k] >> 8);
+        for( int r = 1; r <= run && k + r < end; ++r ) {
+            object_t *b = scene_index(rq->items[k + r] >> 8);
+            int same = (rq->items[k] & 255) == (rq->items[k + r] & 255) && a->model.iqm == b->model.iqm && a->texture_id == b->texture_id;
+            mismatches += r < run ? !same : same;
+        }
+    }
+    return mismatches;
+}
+
+// instanced submission: 5K objects over a few models. draws issued per object vs merged into instanced runs by scene_run()
+static void bench_instancing() {
+    enum { OBJECTS = 5000, MODELS = 4, MESHES = 3, FRAMES = 16 };
+
+    // models without gpu resources or bounds (never culled). one object in 8 overrides its texture: runs of their own
+    GLuint textures[MODELS][MESHES];
+    iqm_t iqms[MODELS] = {0};
+    model_t models[MODELS] = {0};
+    for( int m = 0; m < MODELS; ++m ) {
+        for( int i = 0; i < MESHES; ++i ) textures[m][i] = 1 + m;
+        iqms[m].nummeshes = MESHES, iqms[m].numframes = 1, iqms[m].program = 1, iqms[m].vao = 1 + m, iqms[m].textures = textures[m];
+        models[m].iqm = &iqms[m];
+    }
+
+    camera_t cam = {0}, *prev_camera = last_camera;
+    perspective44(cam.proj, 60, 1, 0.1f, 1000);
+    identity44(cam.view);
+    last_camera = &cam;
+
+    scene_t sc = {0}, *prev_scene = last_scene;
+    last_scene = &sc;
+    for( int j = 0; j < OBJECTS; ++j ) {
+        object_t *obj = scene_spawn();
+        object_model(obj, models[randi(0, MODELS)]);
+        object_teleport(obj, vec3(randf() * 100, 0, randf() * 100));
+        if( j % 8 == 7 ) obj->texture_id = 99;
+    }
+
+    // same queue, run merging & instance packing scene_render() does, minus the gl calls
+    double ms = 0;
+    array(float) instances = 0;
+    int draws = 0, merged = 0, mismatches = 0;
+    for( int f = 0; f < FRAMES; ++f ) {
+        uint64_t t0 = time_ns();
+        renderqueue_t *rq = scene_queue(SCENE_FOREGROUND);
+        draws = 0;
+        for( int k = 0, run, end = array_count(rq->items); k < end; k += run, ++draws ) {
+            run = scene_run(rq, k);
+            array_resize(instances, run * 16);
+            for( int r = 0; r < run; ++r ) memcpy(&instances[r * 16], scene_index(rq->items[k + r] >> 8)->transform, sizeof(mat44));
+        }
+        uint64_t t1 = time_ns();
+        ms += (t1 - t0) / 1e6;
+        merged += draws;
+    }
+    merged /= FRAMES;
+
+    mismatches += check_runs(&sc.queue) || array_count(sc.queue.items) != OBJECTS * MESHES;
+    mismatches += merged != MODELS * MESHES * 2; // one instanced draw per model mesh, plus one for its overrides
+
+    // texture ids that collide in the 16 key bits sort together: only scene_run() keeps them apart
+    for( int j = 7; j < OBJECTS; j += 8 ) scene_index(j)->texture_id = 0x10000 | textures[0][0];
+    mismatches += check_runs(scene_queue(SCENE_FOREGROUND));
+    failures += !!mismatches;
+
+    printf("%-8s %10s %12s %12s %10s\n", "objects", "submit ms", "draws", "instanced", "mismatches");
+    printf("%-8d %10.3f %12d %12d %10d%s\n", OBJECTS, ms / FRAMES, OBJECTS * MESHES, merged,
+        mismatches, mismatches ? "  FAIL" : "");
+
+    array_free(instances);
+    array_free(sc.objs);
+    renderqueue_destroy(&sc.queue);
+    last_scene = prev_scene;
+    last_camera = prev_camera;
+}
+
+// scene culling: a wall drawn as occluder hides the object behind it, but not the ones in front or beside it
+static void test_scene_occlusion() {
+    static vec3 box_verts[8];
+    static unsigned box_indices[36] = {
+        0,1,3, 0,3,2, 4,6,7, 4,7,5, 0,4,5, 0,5,1, 2,3,7, 2,7,6, 0,2,6, 0,6,4, 1,5,7, 1,7,3,
+    };
+    for( int i = 0; i < 8; ++i ) box_verts[i] = vec3(i&4 ? 0.5f : -0.5f, i&2 ? 0.5f : -0.5f, i&1 ? 0.5f : -0.5f);
+
+    camera_t cam = {0}, *prev_camera = last_camera;
+    perspective44(cam.proj, 60, 1, 0.1f, 100);
+    lookat44(cam.view, vec3(0,0,0), vec3(0,0,-1), vec3(0,1,0));
+    last_camera = &cam;
+
+    occlusion_t oc = occlusion(256, 256);
+    occlusion_begin(&oc, cam.proj, cam.view);
+    mat44 wall; scaling44(wall, 4, 4, 0.2f); relocate44(wall, 0, 0, -5);
+    occlusion_occluder(&oc, wall, box_verts, box_indices, 12);
+    occlusion_end(&oc);
+
+    // one unit box model, no gpu resources. objects: behind the wall, in front of it, beside it
+    struct iqmbounds unit = {0}; unit.min3 = vec3(-0.5f,-0.5f,-0.5f), unit.max3 = vec3(0.5f,0.5f,0.5f);
+    GLuint tex = 1;
+    iqm_t q = {0}; q.nummeshes = 1, q.numframes = 1, q.program = 1, q.vao = 1, q.textures = &tex, q.bounds = &unit;
+    model_t m = {0}; m.iqm = &q;
+
+    scene_t sc = {0}, *prev_scene = last_scene;
+    last_scene = &sc;
+    vec3 at[] = { vec3(0,0,-10), vec3(0,0,-3), vec3(4.5f,0,-10) };
+    for( int i = 0; i < countof(at); ++i ) {
+        object_t *obj = scene_spawn();
+        object_model(obj, m);
+        object_teleport(obj, at[i]);
+    }
+
+    int mismatches = 0;
+    int all = array_count(scene_queue(SCENE_FOREGROUND)->items);
+    mismatches += all != 3; // occlusion disabled
+    mismatches += array_count(scene_queue(SCENE_FOREGROUND | SCENE_OCCLUSION)->items) != 3; // no occlusion buffer given
+    sc.occlusion = &oc;
+    renderqueue_t *rq = scene_queue(SCENE_FOREGROUND | SCENE_OCCLUSION);
+    int visible = array_count(rq->items);
+    mismatches += visible != 2;
+    for( int k = 0; k < visible; ++k ) mismatches += (rq->items[k] >> 8) == 0; // object #0 is the hidden one
+
+    printf("%-8s %10s %10s %10s\n", "objects", "frustum", "occlusion", "mismatches");
+    printf("%-8d %10d %10d %10d%s\n", countof(at), all, visible, mismatches, mismatches ? "  FAIL" : "");
+    failures += !!mismatches;
+
+    array_free(sc.objs);
+    renderqueue_destroy(&sc.queue);
+    occlusion_destroy(&oc);
+    last_scene = prev_scene;
+    last_camera = prev_camera;
+}
+
+// sprites: 200K queued over twice the screen area. legacy per-vertex array pushes vs in-place cull & expand
+static void bench_sprites() {
+    enum { SPRITES = 200000, FRAMES = 16, W = 1280, H = 720 };
+
+    sprite_t *queued = REALLOC(0, sizeof(sprite_t) * SPRITES), *culled = REALLOC(0, sizeof(sprite_t) * SPRITES);
+    for( int i = 0; i < SPRITES; ++i ) {
+        sprite_t s = {0};
+        float rotation = randf() * 360 * ((float)C_PI / 180), scale = 0.5f + randf();
+        s.px = randf() * W * 2 - W / 2, s.py = randf() * H * 2 - H / 2, s.pz = randf();
+        int frame = randi(0, 32);
+        s.u0 = (frame % 8) / 8.f, s.v0 = (frame / 8) / 4.f, s.u1 = s.u0 + 1 / 8.f, s.v1 = s.v0 + 1 / 4.f;
+        s.sx = s.sy = scale, s.ox = 4 * scale, s.oy = -2 * scale;
+        s.cellw = 256 * scale / 8, s.cellh = 128 * scale / 4;
+        s.rgba = ~0u, s.cos = cosf(rotation), s.sin = sinf(rotation);
+        queued[i] = s;
+    }
+
+    array(sprite_vertex) legacy = 0;
+    array(sprite_index) indices = 0;
+    sprite_vertex *stream = REALLOC(0, sizeof(sprite_vertex) * 4 * SPRITES);
+
+    double ms_legacy = 0, ms_stream = 0;
+    int kept = 0, mismatches = 0;
+    for( int f = 0; f < FRAMES; ++f ) {
+        uint64_t t0 = time_ns();
+        array_clear(legacy);
+        array_clear(indices);
+        for( int i = 0, index = 0; i < SPRITES; ++i, index += 4 ) {
+            sprite_vertex v[4]; sprite_expand(&queued[i], 1, v);
+            for( int k = 0; k < 4; ++k ) array_push(legacy, v[k]);
+            array_push(indices, sprite_index(index+2, index+3, index+0));
+            array_push(indices, sprite_index(index+2, index+0, index+1));
+        }
+        uint64_t t1 = time_ns();
+        memcpy(culled, queued, sizeof(sprite_t) * SPRITES);
+        kept = sprite_cull(culled, SPRITES, W, H);
+        sprite_expand(culled, kept, stream);
+        uint64_t t2 = time_ns();
+        ms_legacy += (t1 - t0) / 1e6, ms_stream += (t2 - t1) / 1e6;
+    }
+
+    // every sprite culled lies fully off-screen, and kept ones expand exactly as before
+    for( int i = 0, j = 0; i < SPRITES; ++i ) {
+        sprite_vertex *v = &legacy[i * 4];
+        bool kept_this = j < kept && !memcmp(&culled[j], &queued[i], sizeof(sprite_t));
+        if( kept_this ) { mismatches += !!memcmp(&stream[j * 4], v, sizeof(sprite_vertex) * 4); ++j; continue; }
+        for( int k = 0; k < 4; ++k ) mismatches += v[k].pos.x >= 0 && v[k].pos.x <= W && v[k].pos.y >= 0 && v[k].pos.y <= H;
+    }
+    failures += !!mismatches;
+
+    printf("%-8s %10s %10s %10s %10s\n", "sprites", "legacy ms", "stream ms", "visible", "mismatches");
+    printf("%-8d %10.3f %10.3f %10d %10d%s\n", SPRITES, ms_legacy / FRAMES, ms_stream / FRAMES, kept, mismatches, mismatches ? "  FAIL" : "");
+
+    array_free(legacy);
+    array_free(indices);
+    FREE(stream);
+    FREE(culled);
+    FREE(queued);
+}
+
+// atlas packer: hundreds of images with transparent borders. every texel must survive trimming, rotation & extrusion
+static void bench_atlas() {
+    enum { IMAGES = 400 };
+    cooker__atlas_options opt = { 2, 1, 1, 1, 4096, 0 }; // padding, extrude, rotate, trim, maxsize, pot
+
+    image_t images[IMAGES];
+    const char *names[IMAGES];
+    atlas_frame_t frames[IMAGES];
+    for( int i = 0; i < IMAGES; ++i ) {
+        int w = randi(4, 97), h = randi(4, 97), x0 = randi(0, w/3), y0 = randi(0, h/3), x1 = w - randi(0, w/3), y1 = h - randi(0, h/3);
+        images[i].w = w, images[i].h = h, images[i].n = 4;
+        images[i].pixels32 = REALLOC(0, w * h * 4);
+        for( int y = 0; y < h; ++y ) for( int x = 0; x < w; ++x ) {
+            int inside = x >= x0 && x < x1 && y >= y0 && y < y1;
+            images[i].pixels32[x + y * w] = inside ? 0xFF000000u | (i << 14) | (y << 7) | x : 0;
+        }
+        names[i] = STRDUP(stringf("img%03d", IMAGES - i));
+    }
+
+    uint64_t t0 = time_ns();
+    image_t atlas = cooker__atlas(images, names, IMAGES, opt, frames);
+    uint64_t t1 = time_ns();
+
+    int mismatches = !atlas.pixels, rotated = 0;
+    uint64_t texels = 0;
+    for( int i = 0; i < IMAGES && atlas.pixels; ++i ) {
+        const atlas_frame_t *f = &frames[i];
+        int tw = f->rotated ? f->h : f->w, th = f->rotated ? f->w : f->h;
+        rotated += f->rotated, texels += f->w * f->h;
+
+        // texels in the trimmed rect land where the frame says; the ones trimmed away were transparent
+        for( int y = 0; y < images[i].h; ++y ) for( int x = 0; x < images[i].w; ++x ) {
+            uint32_t texel = images[i].pixels32[x + y * images[i].w];
+            int rx = x - f->ox, ry = y - f->oy;
+            if( rx < 0 || ry < 0 || rx >= tw || ry >= th ) { mismatches += !!(texel >> 24); continue; }
+            int ax = f->rotated ? f->x + th-1-ry : f->x + rx, ay = f->rotated ? f->y + rx : f->y + ry;
+            mismatches += atlas.pixels32[ax + ay * atlas.w] != texel;
+        }
+
+        // extruded corner repeats the corner texel
+        mismatches += atlas.pixels32[(f->x - 1) + (f->y - 1) * atlas.w] != atlas.pixels32[f->x + f->y * atlas.w];
+
+        // extruded rects stay inside the atlas and apart from each other
+        mismatches += f->x < opt.extrude || f->y < opt.extrude || f->x + f->w + opt.extrude > atlas.w || f->y + f->h + opt.extrude > atlas.h;
+        for( int j = 0; j < i; ++j ) {
+            const atlas_frame_t *g = &frames[j];
+            int gap = 2 * opt.extrude + opt.padding;
+            mismatches += f->x < g->x + g->w + gap && g->x < f->x + f->w + gap && f->y < g->y + g->h + gap && g->y < f->y + f->h + gap;
+        }
+    }
+
+    // names resolve once sorted, as the cooker writes them
+    qsort(frames, IMAGES, sizeof(atlas_frame_t), cooker__atlas_frame_qsort);
+    atlas_t a = { {0}, frames, IMAGES };
+    for( int i = 0; i < IMAGES; ++i ) mismatches += strcmp(frames[atlas_find(a, names[i]) < 0 ? 0 : atlas_find(a, names[i])].name, names[i]) != 0;
+    mismatches += atlas_find(a, "missing") != -1;
+    failures += !!mismatches;
+
+    printf("%-8s %10s %10s %10s %10s %10s\n", "images", "atlas", "packed %", "rotated", "cook ms", "mismatches");
+    printf("%-8d %5ux%-4u %10.1f %10d %10.3f %10d%s\n", IMAGES, atlas.w, atlas.h, atlas.pixels ? texels * 100.0 / (atlas.w * atlas.h) : 0,
+        rotated, (t1 - t0) / 1e6, mismatches, mismatches ? "  FAIL" : "");
+
+    for( int i = 0; i < IMAGES; ++i ) FREE(images[i].pixels), FREE((char*)names[i]);
+    FREE(atlas.pixels);
+}
+
+// block compression: reference decoders, written from the format spec rather than the encoder, then psnr & throughput
+static void bc1_decode(const uint8_t *b, int bc3, uint8_t rgba[64]) {
+    unsigned c0 = b[0] | b[1] << 8, c1 = b[2] | b[3] << 8, bits = b[4] | b[5] << 8 | b[6] << 16 | (unsigned)b[7] << 24;
+    float pal[4][4];
+    for( int e = 0; e < 2; ++e ) { // rgb565, bits replicated to 8
+        unsigned c = e ? c1 : c0, r = c >> 11, g = (c >> 5) & 63, bl = c & 31;
+        pal[e][0] = r << 3 | r >> 2, pal[e][1] = g << 2 | g >> 4, pal[e][2] = bl << 3 | bl >> 2, pal[e][3] = 255;
+    }
+    for( int c = 0; c < 4; ++c ) {
+        if( bc3 || c0 > c1 ) pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3, pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+        else pal[2][c] = (pal[0][c] + pal[1][c]) / 2, pal[3][c] = 0; // 3 colors plus transparent black
+    }
+    for( int i = 0; i < 16; ++i ) for( int c = 0; c < 4; ++c ) rgba[i * 4 + c] = (uint8_t)(pal[(bits >> (i * 2)) & 3][c] + 0.5f);
+}
+static void bc4_decode(const uint8_t *b, uint8_t v[16]) {
+    int e0 = b[0], e1 = b[1];
+    uint64_t bits = 0;
+    for( int i = 0; i < 6; ++i ) bits |= (uint64_t)b[2 + i] << (i * 8);
+    for( int i = 0; i < 16; ++i ) {
+        int k = (bits >> (i * 3)) & 7;
+        float value = k == 0 ? e0 : k == 1 ? e1 : e0 > e1 ? ((8 - k) * e0 + (k - 1) * e1) / 7.f : k <= 5 ? ((6 - k) * e0 + (k - 1) * e1) / 5.f : k == 6 ? 0 : 255;
+        v[i] = (uint8_t)(value + 0.5f);
+    }
+}
+static unsigned bc7_bits(const uint8_t *b, int *pos, int bits) {
+    unsigned v = 0;
+    for( int i = 0; i < bits; ++i, ++*pos ) v |= ((b[*pos >> 3] >> (*pos & 7)) & 1) << i;
+    return v;
+}
+static void bc7_decode(const uint8_t *b, uint8_t rgba[64]) {
+    int pos = 0, ep[2][4];
+    if( bc7_bits(b, &pos, 7) != 1 << 6 ) { memset(rgba, 0, 64); return; } // mode 6 only
+    for( int c = 0; c < 4; ++c ) ep[0][c] = bc7_bits(b, &pos, 7) << 1, ep[1][c] = bc7_bits(b, &pos, 7) << 1;
+    int p0 = bc7_bits(b, &pos, 1), p1 = bc7_bits(b, &pos, 1);
+    for( int c = 0; c < 4; ++c ) ep[0][c] |= p0, ep[1][c] |= p1;
+    for( int i = 0; i < 16; ++i ) {
+        static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 }; // 4-bit index interpolation
+        int w = weights[bc7_bits(b, &pos, i ? 4 : 3)];
+        for( int c = 0; c < 4; ++c ) rgba[i * 4 + c] = ((64 - w) * ep[0][c] + w * ep[1][c] + 32) >> 6;
+    }
+}
+
+static void bench_bc() {
+    enum { W = 512, H = 512 };
+
+    // smooth gradients, fine detail, hard edges and a soft alpha ramp
+    image_t img = { {W}, {H}, {4} };
+    img.pixels = REALLOC(0, W * H * 4);
+    for( int y = 0; y < H; ++y ) for( int x = 0; x < W; ++x ) {
+        uint8_t *p = &img.pixels8[(x + y * W) * 4];
+        int edge = ((x / 64) ^ (y / 64)) & 1, noise = randi(-12, 13);
+        p[0] = (uint8_t)clampf(x / 2 + noise + 60 * edge, 0, 255);
+        p[1] = (uint8_t)clampf(y / 2 + 40 * sinf(x * 0.05f) + 40, 0, 255);
+        p[2] = (uint8_t)clampf((x + y) / 4 + 100 * edge, 0, 255);
+        p[3] = (uint8_t)clampf(255 - sqrtf((x - W/2) * (x - W/2) + (y - H/2) * (y - H/2)), 0, 255);
+    }
+
+    const char *names[] = { "bc1", "bc3", "bc4", "bc5", "bc7" };
+    unsigned formats[] = { TEXTURE_BC1, TEXTURE_BC3, TEXTURE_BC4, TEXTURE_BC5, TEXTURE_BC7 };
+    float minimum[] = { 38, 40, 46, 48, 44 }; // db at quality 0; higher qualities must not do worse
+
+    printf("%-8s %8s %10s %10s %10s\n", "format", "quality", "psnr db", "Mpixels/s", "mismatches");
+    for( int f = 0; f < countof(formats); ++f ) {
+        float last = 0;
+        for( int quality = 0; quality <= 2; ++quality ) {
+            int bytes = 0, mismatches = 0;
+            uint64_t t0 = time_ns();
+            uint8_t *blocks = (uint8_t*)cooker__bc(&img, formats[f], quality, &bytes);
+            uint64_t t1 = time_ns();
+
+            // compare the channels each format carries. bc1 is a cutout: its alpha must match the 50% threshold
+            double sse = 0, samples = 0;
+            int block = formats[f] & (TEXTURE_BC1|TEXTURE_BC4) ? 8 : 16;
+            for( int by = 0; by < H / 4; ++by ) for( int bx = 0; bx < W / 4; ++bx ) {
+                const uint8_t *b = blocks + (by * (W / 4) + bx) * block;
+                uint8_t out[64] = {0}, v[16];
+                if( formats[f] & TEXTURE_BC1 ) bc1_decode(b, 0, out);
+                if( formats[f] & TEXTURE_BC3 ) { bc1_decode(b + 8, 1, out); bc4_decode(b, v); for( int i = 0; i < 16; ++i ) out[i * 4 + 3] = v[i]; }
+                if( formats[f] & (TEXTURE_BC4|TEXTURE_BC5) ) { bc4_decode(b, v); for( int i = 0; i < 16; ++i ) out[i * 4 + 0] = v[i]; }
+                if( formats[f] & TEXTURE_BC5 ) { bc4_decode(b + 8, v); for( int i = 0; i < 16; ++i ) out[i * 4 + 1] = v[i]; }
+                if( formats[f] & TEXTURE_BC7 ) bc7_decode(b, out);
+
+                int channels = formats[f] & TEXTURE_BC4 ? 1 : formats[f] & TEXTURE_BC5 ? 2 : formats[f] & TEXTURE_BC1 ? 3 : 4;
+                for( int i = 0; i < 16; ++i ) {
+                    const uint8_t *src = &img.pixels8[((bx * 4 + (i & 3)) + (by * 4 + (i >> 2)) * W) * 4];
+                    if( formats[f] & TEXTURE_BC1 ) {
+                        mismatches += (src[3] >= 128) != (out[i * 4 + 3] == 255);
+                        if( src[3] < 128 ) continue;
+                    }
+                    for( int c = 0; c < channels; ++c ) sse += (src[c] - out[i * 4 + c]) * (src[c] - out[i * 4 + c]), ++samples;
+                }
+            }
+            double psnr = 10 * log10(255.0 * 255.0 / (sse / samples + 1e-9));
+            mismatches += quality == 0 ? psnr < minimum[f] : psnr < last - 0.01;
+            last = psnr;
+
+            printf("%-8s %8d %10.2f %10.2f %10d%s\n", names[f], quality, psnr, W * H / ((t1 - t0) / 1e3), mismatches, mismatches ? "  FAIL" : "");
+            failures += !!mismatches;
+            FREE(blocks);
+        }
+    }
+    FREE(img.pixels);
+}
+
+static image_t mips_image(int w, int h) {
+    image_t img = { {w}, {h}, {4} };
+    img.pixels = REALLOC(0, w * h * 4);
+    return img;
+}
+
+static void mips_texel(image_t *img, int i, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    uint8_t *p = &img->pixels8[i * 4];
+    p[0] = r, p[1] = g, p[2] = b, p[3] = a;
+}
+
+static void mips_free(image_t *levels, int count) {
+    for( int l = 0; l < count; ++l ) FREE(levels[l].pixels);
+    FREE(levels);
+}
+
+// mip filters: chain shape, linear-space averaging, flat fields, alpha coverage, renormalized normals & throughput
+static void bench_mips() {
+    image_t *levels;
+    int count, mismatches;
+    const char *filters[] = { "box", "kaiser" };
+
+    printf("%-28s %10s %10s\n", "check", "result", "mismatches");
+
+    // full chain down to 1x1, odd sizes rounding down
+    image_t img = mips_image(300, 200);
+    memset(img.pixels, 255, 300 * 200 * 4);
+    count = cooker__mips(&img, (cooker__mip_options){0}, &levels);
+    mismatches = count != 9 || levels[3].w != 37 || levels[3].h != 25 || levels[7].w != 2 || levels[7].h != 1 || levels[8].w != 1 || levels[8].h != 1;
+    printf("%-28s %10d %10d%s\n", "levels 300x200", count, mismatches, mismatches ? "  FAIL" : "");
+    failures += !!mismatches;
+    mips_free(levels, count);
+    FREE(img.pixels);
+
+    // flat color survives every level of both filters, odd sizes included
+    img = mips_image(301, 199);
+    for( int i = 0; i < 301 * 199; ++i ) mips_texel(&img, i, 200, 90, 30, 160);
+    for( int f = 0; f < 2; ++f ) {
+        count = cooker__mips(&img, (cooker__mip_options){ f, 1 }, &levels);
+        int worst = 0;
+        for( int l = 0; l < count; ++l ) for( unsigned i = 0; i < levels[l].w * levels[l].h * 4; ++i ) {
+            worst = maxi(worst, abs(levels[l].pixels8[i] - img.pixels8[i & 3]));
+        }
+        mismatches = worst > 1;
+        printf("%-28s %10d %10d%s\n", stringf("flat %s (max error)", filters[f]), worst, mismatches, mismatches ? "  FAIL" : "");
+        failures += !!mismatches;
+        mips_free(levels, count);
+    }
+    FREE(img.pixels);
+
+    // black/white checker averages to 50% linear light: srgb 188, not 128
+    img = mips_image(64, 64);
+    for( int y = 0; y < 64; ++y ) for( int x = 0; x < 64; ++x ) mips_texel(&img, x + y * 64, 255 * ((x ^ y) & 1), 255 * ((x ^ y) & 1), 255 * ((x ^ y) & 1), 255);
+    for( int f = 0; f < 2; ++f ) for( int srgb = 0; srgb < 2; ++srgb ) {
+        count = cooker__mips(&img, (cooker__mip_options){ f, srgb }, &levels);
+        int expected = srgb ? 188 : 128, worst = 0, value = levels[1].pixels8[(16 + 16 * 32) * 4];
+        for( int y = 2; y < 30; ++y ) for( int x = 2; x < 30; ++x ) worst = maxi(worst, abs(levels[1].pixels8[(x + y * 32) * 4] - expected));
+        mismatches = worst > 2;
+        printf("%-28s %10d %10d%s\n", stringf("checker %s %s", filters[f], srgb ? "srgb" : "linear"), value, mismatches, mismatches ? "  FAIL" : "");
+        failures += !!mismatches;
+        mips_free(levels, count);
+    }
+    FREE(img.pixels);
+
+    // foliage-like cutout, thin leaves over ~30% of texels: plain filtering washes it out, coverage scaling keeps it
+    img = mips_image(256, 256);
+    for( int y = 0; y < 256; ++y ) for( int x = 0; x < 256; ++x ) {
+        float leaves = sinf(x * 0.31f + 2 * sinf(y * 0.07f)) + sinf(y * 0.27f + 2 * sinf(x * 0.05f));
+        mips_texel(&img, x + y * 256, 40, 160, 40, leaves > 0.6f ? 255 : 0);
+    }
+    for( int preserve = 0; preserve < 2; ++preserve ) {
+        count = cooker__mips(&img, (cooker__mip_options){ 0, 1, 0, preserve ? 128 : 0 }, &levels);
+        float base = 0, drift = 0;
+        for( int l = 0; l < count; ++l ) {
+            int passed = 0, texels = levels[l].w * levels[l].h;
+            for( int i = 0; i < texels; ++i ) passed += levels[l].pixels8[i * 4 + 3] >= 128;
+            if( !l ) base = passed / (float)texels;
+            if( texels >= 64 ) drift = maxf(drift, fabsf(passed / (float)texels - base));
+        }
+        mismatches = preserve ? drift > 0.05f : drift < 0.2f;
+        printf("%-28s %10.3f %10d%s\n", preserve ? "coverage kept (max drift)" : "coverage lost (max drift)", drift, mismatches, mismatches ? "  FAIL" : "");
+        failures += !!mismatches;
+        mips_free(levels, count);
+    }
+    FREE(img.pixels);
+
+    // random unit normals stay unit length
+    img = mips_image(128, 128);
+    for( int i = 0; i < 128 * 128; ++i ) {
+        vec3 n = norm3(vec3(randf() * 2 - 1, randf() * 2 - 1, randf() + 0.1f));
+        mips_texel(&img, i, n.x * 127.5f + 127.5f, n.y * 127.5f + 127.5f, n.z * 127.5f + 127.5f, 255);
+    }
+    for( int renormalize = 0; renormalize < 2; ++renormalize ) {
+        count = cooker__mips(&img, (cooker__mip_options){ 1, 0, renormalize }, &levels);
+        float worst = 0;
+        for( int l = 1; l < count; ++l ) for( unsigned i = 0; i < levels[l].w * levels[l].h; ++i ) {
+            const uint8_t *p = &levels[l].pixels8[i * 4];
+            worst = maxf(worst, fabsf(1 - len3(vec3(p[0] / 127.5f - 1, p[1] / 127.5f - 1, p[2] / 127.5f - 1))));
+        }
+        mismatches = renormalize ? worst > 0.02f : worst < 0.1f;
+        printf("%-28s %10.3f %10d%s\n", renormalize ? "normals renormalized" : "normals shrunk", worst, mismatches, mismatches ? "  FAIL" : "");
+        failures += !!mismatches;
+        mips_free(levels, count);
+    }
+    FREE(img.pixels);
+
+    // throughput on a 2048x2048 srgb texture, whole chain
+    puts("");
+    printf("%-8s %10s %10s %10s\n", "filter", "size", "ms", "Mpixels/s");
+    img = mips_image(2048, 2048);
+    for( int i = 0; i < 2048 * 2048; ++i ) mips_texel(&img, i, randi(0, 256), randi(0, 256), randi(0, 256), 255);
+    for( int f = 0; f < 2; ++f ) {
+        uint64_t t0 = time_ns();
+        count = cooker__mips(&img, (cooker__mip_options){ f, 1 }, &levels);
+        uint64_t t1 = time_ns();
+        printf("%-8s %10s %10.2f %10.2f\n", filters[f], "2048^2", (t1 - t0) / 1e6, 2048 * 2048 / ((t1 - t0) / 1e3));
+        mips_free(levels, count);
+    }
+    FREE(img.pixels);
+}
+
+// gl state cache against a recording gl stub: glad entry points are swapped for functions that log the calls
+static int gl_calls;
+static unsigned gl_last[3];
+#define GL_REC(...) (++gl_calls, memcpy(gl_last, (unsigned[3]){__VA_ARGS__}, sizeof(gl_last)))
+static void GLAD_API_PTR rec_enable(GLenum cap) { GL_REC('E', cap, 1); }
+static void GLAD_API_PTR rec_disable(GLenum cap) { GL_REC('E', cap, 0); }
+static void GLAD_API_PTR rec_blend_func(GLenum src, GLenum dst) { GL_REC('B', src, dst); }
+static void GLAD_API_PTR rec_depth_func(GLenum func) { GL_REC('D', func, 0); }
+static void GLAD_API_PTR rec_active_texture(GLenum unit) { GL_REC('A', unit, 0); }
+static void GLAD_API_PTR rec_bind_texture(GLenum target, GLuint id) { GL_REC('T', target, id); }
+static void GLAD_API_PTR rec_use_program(GLuint id) { GL_REC('P', id, 0); }
+static void GLAD_API_PTR rec_bind_vao(GLuint id) { GL_REC('V', id, 0); }
+static void GLAD_API_PTR rec_bind_buffer(GLenum target, GLuint id) { GL_REC('U', target, id); }
+
+static int expect_calls(const char *what, int calls) {
+    int ok = gl_calls == calls;
+    if( !ok ) printf("%-40s %d calls, expected %d  FAIL\n", what, gl_calls, calls);
+    gl_calls = 0;
+    return !ok;
+}
+
+static void test_glstate() {
+    glad_glEnable = rec_enable, glad_glDisable = rec_disable, glad_glBlendFunc = rec_blend_func, glad_glDepthFunc = rec_depth_func;
+    glad_glActiveTexture = rec_active_texture, glad_glBindTexture = rec_bind_texture, glad_glUseProgram = rec_use_program;
+    glad_glBindVertexArray = rec_bind_vao, glad_glBindBuffer = rec_bind_buffer;
+
+    int mismatches = 0;
+    glstate_invalidate(); gl_calls = 0;
+
+    for( int i = 0; i < 3; ++i ) glstate_enable(GL_BLEND, 1);
+    mismatches += expect_calls("repeated enable", 1);
+    mismatches += gl_last[0] != 'E' || gl_last[1] != GL_BLEND || gl_last[2] != 1;
+    for( int i = 0; i < 4; ++i ) glstate_enable(GL_BLEND, i & 1);
+    mismatches += expect_calls("toggled enable", 4);
+    for( int i = 0; i < 2; ++i ) glstate_enable(GL_DITHER, 1);
+    mismatches += expect_calls("untracked cap passes through", 2);
+    for( int i = 0; i < 2; ++i ) glstate_blend_func(GL_SRC_ALPHA, GL_ONE), glstate_depth_func(GL_LEQUAL);
+    mismatches += expect_calls("blend & depth funcs", 2);
+
+    glstate_active_texture(0); glstate_bind_texture(GL_TEXTURE_2D, 5);
+    glstate_active_texture(1); glstate_bind_texture(GL_TEXTURE_2D, 5);
+    mismatches += expect_calls("textures shadowed per unit", 4);
+    glstate_active_texture(0); glstate_bind_texture(GL_TEXTURE_2D, 5); glstate_bind_texture(GL_TEXTURE_CUBE_MAP, 5);
+    mismatches += expect_calls("textures shadowed per target", 2);
+    mismatches += gl_last[0] != 'T' || gl_last[1] != GL_TEXTURE_CUBE_MAP;
+
+    glstate_bind_vao(1); glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 4); glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 4);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, 4);
+    mismatches += expect_calls("buffers", 3);
+    glstate_bind_vao(2); glstate_bind_vao(1); glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 4); glstate_bind_buffer(GL_ARRAY_BUFFER, 4);
+    mismatches += expect_calls("vao change forgets element buffer", 3);
+
+    glstate_use_program(3); glstate_use_program(3); glstate_invalidate(); glstate_use_program(3);
+    mismatches += expect_calls("invalidate reissues", 2);
+
+    // submission: 100K draws over few programs, vaos & textures. every draw sets its full state, as legacy code did
+    enum { DRAWS = 100000 };
+    int issued = 0, filtered = 0;
+    for( int i = 0; i < DRAWS; ++i ) {
+        glstate_enable(GL_DEPTH_TEST, 1); glstate_enable(GL_BLEND, 1);
+        glstate_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); glstate_depth_func(GL_LESS);
+        glstate_use_program(1 + i / 25000); glstate_bind_vao(1 + i / 1000); glstate_active_texture(0); glstate_bind_texture(GL_TEXTURE_2D, 1 + i / 100);
+        issued += gl_calls, filtered += 8 - gl_calls, gl_calls = 0;
+    }
+    mismatches += issued != 4 + 4 + 100 + 1 + 1000; // first draw sets everything, then program, vao & texture changes only
+
+    printf("%-8s %12s %12s %10s\n", "draws", "gl calls", "filtered", "mismatches");
+    printf("%-8d %12d %12d %10d%s\n", DRAWS, issued, filtered, mismatches, mismatches ? "  FAIL" : "");
+    failures += !!mismatches;
+
+    glad_glEnable = 0, glad_glDisable = 0, glad_glBlendFunc = 0, glad_glDepthFunc = 0;
+    glad_glActiveTexture = 0, glad_glBindTexture = 0, glad_glUseProgram = 0, glad_glBindVertexArray = 0, glad_glBindBuffer = 0;
+}
+
+// sprite pages against the recording gl stub: hundreds of unique sprite sheets collapse into a few texture arrays
+static unsigned gl_names, gl_copies, gl_allocs;
+static void GLAD_API_PTR rec_gen_textures(GLsizei n, GLuint *ids) { while( n-- ) ids[n] = ++gl_names; }
+static void GLAD_API_PTR rec_delete_textures(GLsizei n, const GLuint *ids) {}
+static void GLAD_API_PTR rec_tex_image_2d(GLenum t, GLint l, GLint f, GLsizei w, GLsizei h, GLint b, GLenum pf, GLenum ty, const void *p) {}
+static void GLAD_API_PTR rec_tex_image_3d(GLenum t, GLint l, GLint f, GLsizei w, GLsizei h, GLsizei d, GLint b, GLenum pf, GLenum ty, const void *p) { ++gl_allocs; }
+static void GLAD_API_PTR rec_tex_parameteri(GLenum t, GLenum k, GLint v) {}
+static void GLAD_API_PTR rec_generate_mipmap(GLenum t) {}
+static void GLAD_API_PTR rec_gen_framebuffers(GLsizei n, GLuint *ids) { while( n-- ) ids[n] = ++gl_names; }
+static void GLAD_API_PTR rec_bind_framebuffer(GLenum t, GLuint id) {}
+static void GLAD_API_PTR rec_framebuffer_texture_2d(GLenum t, GLenum a, GLenum tt, GLuint id, GLint l) {}
+static GLenum GLAD_API_PTR rec_check_framebuffer_status(GLenum t) { return GL_FRAMEBUFFER_COMPLETE; }
+static void GLAD_API_PTR rec_get_integerv(GLenum k, GLint *v) { *v = 0; }
+static void GLAD_API_PTR rec_copy_tex_sub_image_3d(GLenum t, GLint l, GLint x, GLint y, GLint z, GLint sx, GLint sy, GLsizei w, GLsizei h) { ++gl_copies; }
+
+static int sprite_batches() {
+    int batches = 0;
+    batch_group_t* list[] = { &sprite_additive_group, &sprite_translucent_group };
+    for( int l = 0; l < countof(list); ++l ) {
+        for each_map_ptr(*list[l], int,_, batch_t,bt) {
+            batches += array_count(bt->sprites) > 0;
+            array_clear(bt->sprites);
+        }
+    }
+    return batches;
+}
+
+static void test_sprite_pages() {
+    glad_glActiveTexture = rec_active_texture, glad_glBindTexture = rec_bind_texture;
+    glad_glGenTextures = rec_gen_textures, glad_glDeleteTextures = rec_delete_textures, glad_glTexImage2D = rec_tex_image_2d;
+    glad_glTexImage3D = rec_tex_image_3d, glad_glTexParameteri = rec_tex_parameteri, glad_glGenerateMipmap = rec_generate_mipmap;
+    glad_glGenFramebuffers = rec_gen_framebuffers, glad_glBindFramebuffer = rec_bind_framebuffer;
+    glad_glFramebufferTexture2D = rec_framebuffer_texture_2d, glad_glGetIntegerv = rec_get_integerv;
+    glad_glCopyTexSubImage3D = rec_copy_tex_sub_image_3d, glad_glCheckFramebufferStatus = rec_check_framebuffer_status;
+
+    enum { SHEETS = 300, UNPAGED = 12 };
+    const unsigned sizes[3][2] = { {32,32}, {64,64}, {128,32} };
+
+    sprite_init();
+    glstate_invalidate();
+
+    // 300 sheets in 3 sizes, plus textures that cannot be paged: float, larger than a page side, render targets
+    // (same size & sampling as sheets otherwise). a quarter is also drawn additive
+    texture_t sheets[SHEETS + UNPAGED];
+    for( int i = 0; i < SHEETS + UNPAGED; ++i ) {
+        int big = i >= SHEETS && i % 3 == 1, target = i >= SHEETS && i % 3 == 2;
+        unsigned w = big ? SPRITE_PAGE_SIZE * 2 : sizes[i%3][0], h = big ? SPRITE_PAGE_SIZE : sizes[i%3][1];
+        sheets[i] = texture_create(w, h, 4, NULL, i < SHEETS || big || target ? TEXTURE_LINEAR : TEXTURE_FLOAT);
+        if( target ) fbo(sheets[i].id, 0, 0);
+    }
+    int legacy = 0;
+    for( int i = 0; i < SHEETS + UNPAGED; ++i ) {
+        sprite_ex(sheets[i], i, i, i, 0, 0,0, 1,1, 0,~0u, 0,0,0), ++legacy;
+        if( i % 4 == 0 ) sprite_ex(sheets[i], i, i, i, 0, 0,0, 1,1, 1,~0u, 0,0,0), ++legacy;
+    }
+
+    int mismatches = 0;
+    int draws = sprite_batches();
+    mismatches += draws != (3 + UNPAGED) + (3 + UNPAGED / 4);
+    mismatches += array_count(sprite_pages) != 3;
+
+    gl_copies = gl_allocs = 0, sprite_pages_update();
+    mismatches += gl_copies != SHEETS || gl_allocs != 3;
+    int copies = gl_copies;
+
+    gl_copies = gl_allocs = 0, sprite_pages_update();
+    mismatches += gl_copies != 0; // nothing changed, nothing copied
+
+    // updated texture is copied again; destroyed texture frees its layer for the next one
+    texture_update(&sheets[0], 32, 32, 4, NULL, TEXTURE_LINEAR);
+    texture_destroy(&sheets[3]);
+    sheets[3] = texture_create(32, 32, 4, NULL, TEXTURE_LINEAR);
+    sprite(sheets[0], 0,0,0, 0), sprite(sheets[3], 0,0,0, 0);
+    mismatches += sprite_batches() != 1;
+    mismatches += array_count(sprite_pages[0].layers) != SHEETS / 3;
+    gl_copies = gl_allocs = 0, sprite_pages_update();
+    mismatches += gl_copies != 2 || gl_allocs != 0;
+
+    // growing a page reallocates it and copies every layer again
+    for( int i = 0; i < SHEETS / 3; ++i ) sprite(texture_create(32, 32, 4, NULL, TEXTURE_LINEAR), 0,0,0, 0);
+    mismatches += sprite_batches() != 1;
+    gl_copies = gl_allocs = 0, sprite_pages_update();
+    mismatches += gl_copies != 2 * SHEETS / 3 || gl_allocs != 1;
+
+    printf("%-8s %10s %10s %10s %10s %10s\n", "sheets", "legacy", "draws", "pages", "copies", "mismatches");
+    printf("%-8d %10d %10d %10d %10d %10d%s\n", SHEETS + UNPAGED, legacy, draws, array_count(sprite_pages), copies, mismatches, mismatches ? "  FAIL" : "");
+    failures += !!mismatches;
+
+    glad_glActiveTexture = 0, glad_glBindTexture = 0;
+    glad_glGenTextures = 0, glad_glDeleteTextures = 0, glad_glTexImage2D = 0, glad_glTexImage3D = 0, glad_glTexParameteri = 0, glad_glGenerateMipmap = 0;
+    glad_glGenFramebuffers = 0, glad_glBindFramebuffer = 0, glad_glFramebufferTexture2D = 0, glad_glGetIntegerv = 0, glad_glCopyTexSubImage3D = 0;
+    glad_glCheckFramebufferStatus = 0;
+}
+
+// texture streaming against gl stubs: frames never upload over budget, levels land smallest first, all complete
+static unsigned stream_bound, stream_bytes, stream_bands, stream_order, stream_early, stream_base[1024];
+static double stream_spin_ms;
+static void GLAD_API_PTR stream_bind_texture(GLenum t, GLuint id) { stream_bound = id; }
+static void GLAD_API_PTR stream_tex_image_2d(GLenum t, GLint l, GLint f, GLsizei w, GLsizei h, GLint b, GLenum pf, GLenum ty, const void *p) { if( p ) stream_bytes += w * h * 4; }
+static void GLAD_API_PTR stream_compressed_tex_image_2d(GLenum t, GLint l, GLenum f, GLsizei w, GLsizei h, GLint b, GLsizei size, const void *p) { if( p ) stream_bytes += size; }
+static void stream_spin() { for( uint64_t t0 = time_ns(); time_ns() - t0 < stream_spin_ms * 1e6; ) {} }
+static void stream_finer(GLint l) { // a level finer than the bound texture's preview: every other preview must be uploaded by now
+    struct texture_stream *bound = 0;
+    for( int i = 0; i < array_count(texture_streams); ++i ) if( texture_streams[i]->id == stream_bound ) bound = texture_streams[i];
+    if( !bound || l >= bound->levels[bound->preview].level ) return;
+    for( int i = 0; i < array_count(texture_streams); ++i ) {
+        struct texture_stream *s = texture_streams[i];
+        stream_early += s != bound && s->state == STREAM_UPLOADING && s->next <= s->preview;
+    }
+}
+static void GLAD_API_PTR stream_tex_sub_image_2d(GLenum t, GLint l, GLint x, GLint y, GLsizei w, GLsizei h, GLenum pf, GLenum ty, const void *p) { stream_finer(l), stream_bytes += w * h * 4, ++stream_bands, stream_spin(); }
+static void GLAD_API_PTR stream_compressed_tex_sub_image_2d(GLenum t, GLint l, GLint x, GLint y, GLsizei w, GLsizei h, GLenum f, GLsizei size, const void *p) { stream_finer(l), stream_bytes += size, ++stream_bands, stream_spin(); }
+static void GLAD_API_PTR stream_tex_parameteri(GLenum t, GLenum k, GLint v) {
+    if( k != GL_TEXTURE_BASE_LEVEL || stream_bound >= 1024 ) return;
+    stream_order += (unsigned)v >= stream_base[stream_bound]; // every new base level must be finer than the last
+    stream_base[stream_bound] = v;
+}
+
+static void test_texture_stream() {
+    enum { PLAIN = 24, COOKED = 8, BUDGET = 256 * 1024 };
+    glad_glBindTexture = stream_bind_texture, glad_glGenTextures = rec_gen_textures, glad_glDeleteTextures = rec_delete_textures;
+    glad_glTexImage2D = stream_tex_image_2d, glad_glTexSubImage2D = stream_tex_sub_image_2d, glad_glTexParameteri = stream_tex_parameteri;
+    glad_glCompressedTexImage2D = stream_compressed_tex_image_2d, glad_glCompressedTexSubImage2D = stream_compressed_tex_sub_image_2d;
+    glad_glGenerateMipmap = rec_generate_mipmap, glad_glActiveTexture = rec_active_texture;
+    glstate_invalidate();
+
+    // plain pngs of many sizes, and bc1 containers cooked with their mips
+    unsigned sizes[PLAIN + COOKED][2];
+    zip *z = zip_open(".stream.zip", "wb");
+    for( int i = 0; i < PLAIN + COOKED; ++i ) {
+        int w = sizes[i][0] = i < PLAIN ? randi(16, 1025) : 256 << (i & 1), h = sizes[i][1] = i < PLAIN ? randi(16, 1025) : 256;
+        image_t img = mips_image(w, h);
+        for( int t = 0; t < w * h; ++t ) mips_texel(&img, t, t % w, t / w, 128, 255);
+
+        int len = 0;
+        char *blob = 0;
+        if( i < PLAIN ) blob = (char*)stbi_write_png_to_mem(img.pixels8, w * 4, w, h, 4, &len);
+        else {
+            image_t *levels;
+            int count = cooker__mips(&img, (cooker__mip_options){ 0, 1 }, &levels);
+            unsigned header[5] = { 0, TEXTURE_BC1, w, h, count };
+            memcpy(header, "BCTX", 4);
+            blob = REALLOC(0, len = sizeof(header)), memcpy(blob, header, sizeof(header));
+            for( int l = 0; l < count; ++l ) {
+                int bytes = 0;
+                char *blocks = cooker__bc(&levels[l], TEXTURE_BC1, 0, &bytes);
+                blob = REALLOC(blob, len + 4 + bytes);
+                memcpy(blob + len, &bytes, 4), memcpy(blob + len + 4, blocks, bytes), len += 4 + bytes;
+                FREE(blocks);
+            }
+            mips_free(levels, count);
+        }
+        FILE *in = fmemopen(blob, len, "rb");
+        zip_append_file(z, stringf("stream/tex%02d.%s", i, i < PLAIN ? "png" : "bctx"), "", in, 0);
+        fclose(in);
+        i < PLAIN ? free(blob) : FREE(blob);
+        FREE(img.pixels);
+    }
+    zip_close(z);
+    vfs_mount(".stream.zip");
+
+    // every request returns a handle at once; half of them with mips
+    texture_stream_budget(BUDGET, 1000);
+    texture_t textures[PLAIN + COOKED];
+    uint64_t t0 = time_ns();
+    for( int i = 0; i < PLAIN + COOKED; ++i ) {
+        textures[i] = texture_async(stringf("stream/tex%02d.%s", i, i < PLAIN ? "png" : "bctx"), TEXTURE_LINEAR | (i & 1 ? TEXTURE_MIPMAPS : 0));
+        stream_base[textures[i].id] = 99;
+    }
+    double request_ms = (time_ns() - t0) / 1e6;
+
+    int frames = 0, mismatches = 0, pending = texture_stream_pending();
+    unsigned worst = 0, total = 0;
+    for( t0 = time_ns(); texture_stream_pending() && frames < 100000; ++frames ) {
+        vfs_async_update();
+        stream_bytes = 0;
+        unsigned uploaded = texture_stream_update();
+        mismatches += uploaded != stream_bytes;
+        worst = maxi(worst, uploaded), total += uploaded;
+        if( !uploaded ) sleep_ms(1); // waiting on workers
+    }
+    double stream_ms = (time_ns() - t0) / 1e6;
+
+    unsigned levels0 = 0;
+    for( int i = 0; i < PLAIN + COOKED; ++i ) {
+        levels0 += i < PLAIN ? sizes[i][0] * sizes[i][1] * 4 : sizes[i][0] * sizes[i][1] / 2;
+        mismatches += !texture_ready(&textures[i]) || textures[i].w != sizes[i][0] || textures[i].h != sizes[i][1];
+        mismatches += stream_base[textures[i].id] != 0;
+    }
+    mismatches += worst > BUDGET || stream_order || stream_early || total < levels0 || frames < total / BUDGET;
+
+    printf("%-9s %9s %9s %10s %10s %10s %10s %10s\n", "textures", "pending", "frames", "worst KiB", "total KiB", "request ms", "stream ms", "mismatches");
+    printf("%-9d %9d %9d %10.1f %10.1f %10.3f %10.1f %10d%s\n", PLAIN + COOKED, pending, frames, worst / 1024.0, total / 1024.0, request_ms, stream_ms, mismatches, mismatches ? "  FAIL" : "");
+    failures += !!mismatches;
+
+    // time budget: bands cost 0.2ms each, so a 0.5ms frame fits no more than three
+    texture_stream_budget(1 << 30, 0.5f);
+    stream_spin_ms = 0.2;
+    for( int i = 0; i < 4; ++i ) texture_destroy(&textures[i]), textures[i] = texture_async(stringf("stream/tex%02d.png", i), TEXTURE_LINEAR);
+    // destroyed while reading, decoding or uploading: nothing leaks into later frames
+    texture_t dropped = texture_async("stream/tex04.png", 0), missing = texture_async("stream/missing.png", 0);
+    texture_destroy(&dropped);
+
+    unsigned most = 0;
+    mismatches = 0, frames = 0;
+    for( ; texture_stream_pending() && frames < 100000; ++frames ) {
+        vfs_async_update();
+        stream_bands = 0;
+        if( texture_stream_update() ) most = maxi(most, stream_bands);
+        else sleep_ms(1);
+        if( frames == 2 ) texture_destroy(&textures[3]);
+    }
+    mismatches += most > 3 || !texture_ready(&missing) || missing.w;
+    printf("%-9s %9s %9s %10s\n", "ms budget", "frames", "bands", "mismatches");
+    printf("%-9.1f %9d %9d %10d%s\n", 0.5, frames, most, mismatches, mismatches ? "  FAIL" : "");
+    failures += !!mismatches;
+
+    for( int i = 0; i < PLAIN + COOKED; ++i ) texture_destroy(&textures[i]);
+    texture_destroy(&missing);
+    stream_spin_ms = 0;
+    unlink(".stream.zip");
+
+    glad_glBindTexture = 0, glad_glGenTextures = 0, glad_glDeleteTextures = 0, glad_glTexImage2D = 0, glad_glTexSubImage2D = 0, glad_glTexParameteri = 0;
+    glad_glCompressedTexImage2D = 0, glad_glCompressedTexSubImage2D = 0, glad_glGenerateMipmap = 0, glad_glActiveTexture = 0;
+}
+
+int main() {
+    bench_queue();
+    puts("");
+    bench_instancing();
+    puts("");
+    test_scene_occlusion();
+    puts("");
+    test_glstate();
+    puts("");
+    bench_sprites();
+    puts("");
+    test_sprite_pages();
+    puts("");
+    bench_atlas();
+    puts("");
+    bench_bc();
+    puts("");
+    bench_mips();
+    puts("");
+    test_texture_stream();
+
+    printf("\n%d failed\n", failures);
+    return failures;
+}
@@ -137,6 +137,44 @@ void demo_kids() {
     }
 }
 
+// stress: hundreds of unique sprite sheets. same-sized ones share a sprite page, so draws stay few (see profiler stats)
+void demo_sheets() {
+    enum { SHEETS = 300 };
+    static texture_t sheets[SHEETS];
+    static int *x, *y;
+
+    // init
+    if( !sheets[0].id ) {
+        uint32_t *pixels = REALLOC(0, 64 * 64 * 4);
+        for( int i = 0; i < SHEETS; ++i ) {
+            int size = 16 << (i % 3); // 16, 32 and 64px sheets
+            uint32_t color = rgba(randi(64,256), randi(64,256), randi(64,256), 255);
+            for( int py = 0; py < size; ++py ) for( int px = 0; px < size; ++px ) {
+                int dx = px * 2 - size, dy = py * 2 - size;
+                pixels[px + py * size] = dx * dx + dy * dy < size * size ? color : 0;
+            }
+            sheets[i] = texture_create(size, size, 4, pixels, TEXTURE_NEAREST);
+        }
+        FREE(pixels);
+    }
+    if( NUMSPRITES_CHANGED ) {
+        NUMSPRITES_CHANGED = 0;
+
+        x = (int*)REALLOC(x, NUMSPRITES * sizeof(int) );
+        y = (int*)REALLOC(y, NUMSPRITES * sizeof(int) );
+        for( int i = 0; i < NUMSPRITES; ++i ) {
+            randset(i);
+            x[i] = randi(0, window_width());
+            y[i] = randi(0, window_height());
+        }
+    }
+
+    // render
+    for( int i = 0; i < NUMSPRITES; ++i ) {
+        sprite(sheets[i % SHEETS], x[i],y[i],y[i], 0);
+    }
+}
+
 int main(int argc, char **argv) {
     window_create(75.f, 0);
     window_title("FWK - Sprite");
@@ -158,11 +196,11 @@ int main(int argc, char **argv) {
         glClearColor(0.4,0.4,0.4,1);
 
         profile(sprite batching) {
-            if(option_cats) demo_cats(); else demo_kids();
+            if(option_cats == 2) demo_sheets(); else if(option_cats) demo_cats(); else demo_kids();
         }
 
         if( ui_begin("Sprite", 0) ) {
-            const char *labels[] = {"Kids","Cats"};
+            const char *labels[] = {"Kids","Cats","Sheets"};
             if( ui_list("Sprite type", labels, countof(labels), &option_cats) ) NUMSPRITES_CHANGED = 1;
             if( ui_int("Number of Sprites", &NUMSPRITES) ) NUMSPRITES_CHANGED = 1;
             ui_end();
@@ -0,0 +1,601 @@
+// virtual filesystem benchmark. headless, no window or gpu required.
+// - rlyeh, public domain
+
+#define FWK_C
+#include "fwk.h"
+#include <utime.h>
+
+static int failures;
+
+// reference: linear scan that vfs_resolve() used before the index
+static int resolve_linear(const char *id) {
+    for( int i = array_count(vfs_entries); --i >= 0; ) {
+        if( strbegini(vfs_entries[i].id, id) ) return i;
+    }
+    return -1;
+}
+
+// mounts zips until vfs holds `total` entries. names look like cooked assets: art/level07/prop_01234.png
+static void mount_entries(int total) {
+    static int mounted = 0, zips = 0;
+    for( ; mounted < total; ) {
+        char name[64]; snprintf(name, 64, ".vfs[%d].zip", zips++);
+        zip *z = zip_open(name, "wb");
+        for( int n = 0; mounted < total && n < 32768; ++mounted, ++n ) { // zip (no zip64) entry count is 16-bit
+            char *entry = stringf("art/level%02d/prop_%05d.png", mounted % 32, mounted / 3); // 3 levels share each prop name
+            FILE *in = fmemopen(entry, strlen(entry), "rb");
+            zip_append_file(z, entry, "", in, 0);
+            fclose(in);
+        }
+        zip_close(z);
+        vfs_mount(name);
+    }
+}
+
+static void bench_resolve() {
+    enum { QUERIES = 4096 };
+    int sizes[] = { 1000, 10000, 100000 };
+
+    printf("%-8s %14s %14s %14s %10s\n", "entries", "file_id/s", "index/s", "linear/s", "mismatches");
+    for( int s = 0; s < countof(sizes); ++s ) {
+        mount_entries(sizes[s]);
+
+        // requests: exact paths, fuzzy names (begins with), and misses
+        static char *requests[QUERIES], *ids[QUERIES];
+        for( int i = 0; i < QUERIES; ++i ) {
+            int e = (int)(randf() * sizes[s]);
+            requests[i] = STRDUP( i % 3 == 0 ? stringf("art/level%02d/prop_%05d.png", e % 32, e / 3) :
+                                  i % 3 == 1 ? stringf("prop_%05d", e / 3) : stringf("missing_%05d.png", e) );
+        }
+
+        uint64_t t0 = time_ns();
+        for( int i = 0; i < QUERIES; ++i ) ids[i] = STRDUP(file_id(requests[i]));
+        uint64_t t1 = time_ns();
+        volatile int sink = 0; int reps = 64;
+        for( int r = 0; r < reps; ++r ) for( int i = 0; i < QUERIES; ++i ) sink += vfs_index_find(ids[i]);
+        uint64_t t2 = time_ns();
+        int linear_queries = sizes[s] >= 100000 ? QUERIES / 16 : QUERIES;
+        for( int i = 0; i < linear_queries; ++i ) sink += resolve_linear(ids[i]);
+        uint64_t t3 = time_ns();
+
+        int mismatches = 0;
+        for( int i = 0; i < linear_queries; ++i ) mismatches += vfs_index_find(ids[i]) != resolve_linear(ids[i]);
+        failures += !!mismatches;
+
+        printf("%-8d %14.0f %14.0f %14.0f %10d%s\n", array_count(vfs_entries),
+            QUERIES * 1e9 / (t1 - t0), reps * QUERIES * 1e9 / (t2 - t1), linear_queries * 1e9 / (t3 - t2),
+            mismatches, mismatches ? "  FAIL" : "");
+
+        for( int i = 0; i < QUERIES; ++i ) FREE(requests[i]), FREE(ids[i]);
+    }
+}
+
+// reference: per-call path resolution that vfs_load() did before the resolved path cache
+static const char *load_uncached(const char *pathfile) {
+    char *base = file_name(pathfile); if(strchr(base,'+')) base = strchr(base, '+')+1;
+    char *folder = file_path(pathfile);
+    pathfile = stringf("%s%s", folder, base);
+    pathfile = stringf("%s", vfs_resolve(pathfile));
+    base = file_name(pathfile);
+    folder = file_path(pathfile);
+    return pathfile;
+}
+
+static void bench_load() {
+    enum { ASSETS = 64, REPS = 256 };
+
+    // every asset holds its own name, so loads can be checked against resolves
+    char *requests[ASSETS];
+    for( int i = 0; i < ASSETS; ++i ) {
+        int e = (i * 1543) % 100000;
+        requests[i] = STRDUP(i & 1 ? stringf("prop_%05d.png", e / 3) : stringf("art/level%02d/prop_%05d.png", e % 32, e / 3));
+    }
+
+    int mismatches = 0;
+    for( int i = 0; i < ASSETS; ++i ) {
+        int size; char *data = vfs_load(requests[i], &size);
+        const char *expected = vfs_resolve(requests[i]);
+        mismatches += !data || size != strlen(expected) || memcmp(data, expected, size);
+    }
+    failures += !!mismatches;
+
+    volatile int sink = 0;
+    uint64_t t0 = time_ns();
+    for( int r = 0; r < REPS; ++r ) for( int i = 0; i < ASSETS; ++i ) sink += !!load_uncached(requests[i]);
+    uint64_t t1 = time_ns();
+    for( int r = 0; r < REPS; ++r ) for( int i = 0; i < ASSETS; ++i ) sink += !!vfs_path(requests[i])->name;
+    uint64_t t2 = time_ns();
+
+    printf("\n%-8s %14s %14s %10s\n", "assets", "resolve ns", "cached ns", "mismatches");
+    printf("%-8d %14.1f %14.1f %10d%s\n", ASSETS, (t1 - t0) / (double)(REPS * ASSETS), (t2 - t1) / (double)(REPS * ASSETS),
+        mismatches, mismatches ? "  FAIL" : "");
+
+    for( int i = 0; i < ASSETS; ++i ) FREE(requests[i]);
+}
+
+static char *cache_asset(int i) { // 256 bytes: its own name, repeated. compressible, so it is deflated
+    static char buf[257];
+    for( int n = 0; n < 256; ) n += snprintf(buf + n, 257 - n, "cache/prop_%05d.png ", i);
+    return buf;
+}
+static int cache_broken(const char *data, int size, int i) {
+    return !data || size != 256 || memcmp(data, cache_asset(i), 256);
+}
+
+static void bench_cache() {
+    enum { ASSETS = 1024, HOT = 8, REPS = 4096, BUDGET = 4096 };
+
+    // deflated entries: every load is inflated into a cached blob
+    zip *z = zip_open(".vfs[cache].zip", "wb");
+    for( int i = 0; i < ASSETS; ++i ) {
+        FILE *in = fmemopen(cache_asset(i), 256, "rb");
+        zip_append_file(z, stringf("cache/prop_%05d.png", i), "", in, 6);
+        fclose(in);
+    }
+    zip_close(z);
+    vfs_mount(".vfs[cache].zip");
+    cache_budget(BUDGET);
+
+    char *requests[ASSETS];
+    for( int i = 0; i < ASSETS; ++i ) requests[i] = STRDUP(stringf("cache/prop_%05d.png", i));
+
+    // stream through more assets than budget allows, keeping first one acquired, second one pinned, third one loaded
+    int broken = 0, size;
+    char *acquired = vfs_acquire(requests[0], &size);
+    char *pinned = vfs_acquire(requests[1], &size); cache_pin(pinned, 1), vfs_release(pinned);
+    char *loaded = vfs_load(requests[2], &size); // vfs_load() pointers stay valid regardless of budget
+    for( int i = 3; i < ASSETS; ++i ) {
+        char *data = vfs_acquire(requests[i], &size);
+        broken += cache_broken(data, size, i);
+        vfs_release(data);
+        broken += cache_bytes > BUDGET + 64;
+    }
+    broken += vfs_acquire(requests[0], &size) != acquired || cache_broken(acquired, size, 0);
+    broken += vfs_acquire(requests[1], &size) != pinned || cache_broken(pinned, size, 1);
+    broken += vfs_acquire(requests[2], &size) != loaded || cache_broken(loaded, size, 2);
+    vfs_release(acquired), vfs_release(acquired), vfs_release(pinned), vfs_release(loaded);
+    cache_pin(pinned, 0), cache_pin(loaded, 0);
+    failures += !!broken;
+
+    // hot set that fits in budget
+    uint64_t hits = cache_hits, misses = cache_misses, evictions = cache_evictions;
+    volatile int sink = 0;
+    uint64_t t0 = time_ns();
+    for( int r = 0; r < REPS; ++r ) for( int i = 0; i < HOT; ++i ) {
+        char *data = vfs_acquire(requests[i], 0);
+        sink += !!data;
+        vfs_release(data);
+    }
+    uint64_t t1 = time_ns();
+
+    printf("\n%-8s %8s %8s %10s %10s %10s %8s\n", "budget", "bytes", "blobs", "hits", "misses", "evictions", "ns/hit");
+    printf("%-8d %8d %8d %10d %10d %10d %8.1f%s\n", BUDGET, (int)cache_bytes, array_count(cache_blobs) - array_count(cache_slots),
+        (int)(cache_hits - hits), (int)(cache_misses - misses), (int)(cache_evictions - evictions),
+        (t1 - t0) / (double)(REPS * HOT), broken ? "  FAIL" : "");
+
+    cache_budget(CACHE_BUDGET);
+    for( int i = 0; i < ASSETS; ++i ) FREE(requests[i]);
+}
+
+static void bench_mmap() {
+    enum { ENTRIES = 16, STORED = 4 << 20, PACKED = 1 << 20 };
+
+    // media-like stored entries, and compressible text entries
+    zip *z = zip_open(".vfs[mmap].zip", "wb");
+    char *buf = REALLOC(0, STORED);
+    for( int i = 0; i < ENTRIES * 2; ++i ) {
+        int stored = i < ENTRIES, len = stored ? STORED : PACKED;
+        for( int j = 0; j < len; ++j ) buf[j] = stored ? (char)((j * 2654435761u) >> 24) : "lorem ipsum dolor sit amet "[j % 27];
+        FILE *in = fmemopen(buf, len, "rb");
+        zip_append_file(z, stringf("mmap/%s_%02d.bin", stored ? "stored" : "packed", i), "", in, stored ? 0 : 6);
+        fclose(in);
+    }
+    zip_close(z);
+    FREE(buf);
+    vfs_mount(".vfs[mmap].zip");
+    archive_dir *dir = dir_mount;
+
+    // stored: view into mapping vs fread into heap. packed: decode from mapping vs fread + decode
+    int mismatches = 0;
+    double ms[4] = {0};
+    for( int i = 0; i < ENTRIES * 2; ++i ) {
+        int stored = i < ENTRIES, index = zip_find(dir->archive, stringf("mmap/%s_%02d.bin", stored ? "stored" : "packed", i)), size;
+        uint64_t t0 = time_ns();
+        char *fresh = zip_extract(dir->archive, index);
+        uint64_t t1 = time_ns();
+        char *mapped = stored ? vfs_load(zip_name(dir->archive, index), &size) : zip_extract_mem(dir->archive, index, dir->map);
+        uint64_t t2 = time_ns();
+        ms[stored * 2 + 0] += (t1 - t0) / 1e6, ms[stored * 2 + 1] += (t2 - t1) / 1e6;
+        mismatches += !fresh || !mapped || memcmp(fresh, mapped, zip_size(dir->archive, index));
+        mismatches += stored && (mapped < dir->map || mapped >= dir->map + dir->map_size);
+        FREE(fresh);
+        if( !stored ) FREE(mapped);
+    }
+    failures += !!mismatches;
+
+    printf("\n%-8s %12s %12s %10s\n", "entries", "fread ms", "mmap ms", "mismatches");
+    printf("stored   %12.3f %12.3f %10d (%d x %d KiB)\n", ms[2], ms[3], mismatches, ENTRIES, STORED >> 10);
+    printf("packed   %12.3f %12.3f %10d (%d x %d KiB)\n", ms[0], ms[1], mismatches, ENTRIES, PACKED >> 10);
+}
+
+// streams the entries written by bench_mmap(), from the mapping and from the archive file
+static void bench_stream() {
+    enum { ENTRIES = 16, CHUNK = 4096 };
+    archive_dir *dir = dir_mount;
+    char *buf = REALLOC(0, CHUNK);
+
+    int mismatches = 0;
+    double ms[2][2] = {0}, mb[2] = {0};
+    for( int mapped = 1; mapped >= 0; --mapped ) {
+        char *map = dir->map;
+        if( !mapped ) dir->map = 0;
+        for( int i = 0; i < ENTRIES * 2; ++i ) {
+            int stored = i < ENTRIES, index = zip_find(dir->archive, stringf("mmap/%s_%02d.bin", stored ? "stored" : "packed", i));
+            char *expected = zip_extract(dir->archive, index);
+            int size = zip_size(dir->archive, index);
+
+            // sequential
+            uint64_t t0 = time_ns();
+            vfs_file *fp = vfs_open(zip_name(dir->archive, index));
+            int total = 0;
+            for( int len; fp && (len = vfs_fread(fp, buf, CHUNK)) > 0; total += len ) {
+                mismatches += memcmp(buf, expected + total, len) != 0;
+            }
+            ms[mapped][stored] += (time_ns() - t0) / 1e6, mb[stored] += mapped * size / 1048576.0;
+            mismatches += !fp || total != size || vfs_fsize(fp) != size;
+
+            // random seeks, backwards ones restart packed entries
+            for( int s = 0; fp && s < 4; ++s ) {
+                int at = (int)(randf() * (size - CHUNK));
+                mismatches += vfs_seek(fp, at, SEEK_SET) || vfs_tell(fp) != at;
+                mismatches += vfs_fread(fp, buf, CHUNK) != CHUNK || memcmp(buf, expected + at, CHUNK);
+            }
+
+            // as a plm_buffer, the way video() streams mpegs: size, seeks & tells work like a file's
+            plm_buffer_t *pb = fp ? plm_buffer_create_with_callbacks(mpeg_read_callback, mpeg_seek_callback, size, fp) : 0;
+            for( int s = 0; pb && s < 4; ++s ) {
+                int at = (int)(randf() * (size - 1));
+                plm_buffer_seek(pb, at);
+                mismatches += plm_buffer_tell(pb) != at || plm_buffer_read(pb, 8) != (uint8_t)expected[at] || plm_buffer_tell(pb) != at + 1;
+            }
+            mismatches += pb && plm_buffer_get_size(pb) != size;
+            if( pb ) plm_buffer_destroy(pb);
+            vfs_close(fp);
+            FREE(expected);
+        }
+        dir->map = map;
+    }
+    failures += !!mismatches;
+    FREE(buf);
+
+    printf("\n%-8s %12s %12s %12s %10s\n", "stream", "mapped MB/s", "file MB/s", "bytes/file", "mismatches");
+    for( int stored = 1; stored >= 0; --stored ) {
+        printf("%-8s %12.0f %12.0f %12d %10d%s\n", stored ? "stored" : "packed", mb[stored] * 1e3 / ms[1][stored], mb[stored] * 1e3 / ms[0][stored],
+            (int)sizeof(vfs_file), mismatches, mismatches ? "  FAIL" : "");
+    }
+}
+
+// async loads from a slow mount: main thread stalls, total time, priority bumps and cancels
+static int async_fired, async_order[64], async_rank[64];
+static void async_done(const char *pathfile, char *data, int size, void *user) {
+    int i = (int)(intptr_t)user;
+    async_rank[i] = async_fired, async_order[async_fired++] = i;
+    failures += !data || size != 64 * 1024 || data[0] != (char)i; // first byte tags the asset
+}
+
+static int async_chained;
+static void async_chain(const char *pathfile, char *data, int size, void *user) {
+    async_chained = vfs_load_async("slow/asset_02.txt", 0, NULL, 0); // takes the slot just retired
+}
+
+static void bench_async() {
+    enum { ASSETS = 64, SIZE = 64 * 1024, LATENCY = 10, HALF = ASSETS / 2 };
+
+    zip *z = zip_open(".vfs[slow].zip", "wb");
+    char *buf = REALLOC(0, SIZE);
+    for( int i = 0; i < ASSETS; ++i ) {
+        for( int j = 0; j < SIZE; ++j ) buf[j] = j ? "lorem ipsum dolor sit amet "[j % 27] : (char)i;
+        FILE *in = fmemopen(buf, SIZE, "rb");
+        zip_append_file(z, stringf("slow/asset_%02d.txt", i), "", in, 6);
+        fclose(in);
+    }
+    zip_close(z);
+    FREE(buf);
+    vfs_mount(".vfs[slow].zip");
+    dir_mount->latency = LATENCY;
+
+    // sync: first half
+    int broken = 0;
+    uint64_t t0 = time_ns();
+    for( int i = 0; i < HALF; ++i ) {
+        int size; char *data = vfs_load(stringf("slow/asset_%02d.txt", i), &size);
+        broken += !data || size != SIZE || data[0] != (char)i;
+    }
+    uint64_t t1 = time_ns();
+
+    // async: second half, plus a late request bumped for this frame, plus cancels
+    int handles[ASSETS];
+    int fired = async_fired;
+    for( int i = HALF; i < ASSETS - 1; ++i ) handles[i] = vfs_load_async(stringf("slow/asset_%02d.txt", i), 0, async_done, (void*)(intptr_t)i);
+    handles[ASSETS-1] = vfs_load_async(stringf("slow/asset_%02d.txt", ASSETS-1), 0, async_done, (void*)(intptr_t)(ASSETS-1));
+    vfs_async_priority(handles[ASSETS-1], 100);
+    int cached = vfs_load_async("slow/asset_00.txt", -1, NULL, 0); // completes without i/o
+    int dropped = vfs_load_async(stringf("slow/asset_%02d.txt", HALF), -1, async_done, 0); // queued behind everything
+    broken += !vfs_async_cancel(dropped) || vfs_async_cancel(cached);
+    int size; char *data = vfs_async_wait(cached, &size);
+    broken += !data || size != SIZE || data[0] != 0;
+    uint64_t t2 = time_ns();
+    while( async_fired - fired < HALF ) vfs_async_update(), sleep_ms(1);
+    uint64_t t3 = time_ns();
+
+    // waiting on a request whose callback queues another: each wait still returns its own data
+    data = vfs_async_wait(vfs_load_async("slow/asset_01.txt", 0, async_chain, 0), &size);
+    broken += !data || size != SIZE || data[0] != 1;
+    data = vfs_async_wait(async_chained, &size);
+    broken += !data || size != SIZE || data[0] != 2;
+
+    broken += async_fired - fired != HALF || vfs_async_poll(dropped) != -1 || vfs_async_poll(handles[HALF]) != -1;
+    broken += async_rank[ASSETS-1] - fired >= 2 * VFS_IO_THREADS; // bumped past queued requests, in next batch at worst
+    failures += !!broken;
+
+    printf("\n%-8s %10s %12s %12s %10s %8s\n", "latency", "assets", "sync ms", "async ms", "stall ms", "bumped");
+    printf("%-8d %10d %12.1f %12.1f %10.3f %8d%s\n", LATENCY, HALF, (t1 - t0) / 1e6, (t3 - t2) / 1e6, (t2 - t1) / 1e6,
+        async_rank[ASSETS-1] - fired + 1, broken ? "  FAIL" : "");
+}
+
+// archive lookups: misses and hits that walk every mounted archive through zip_find()
+static int find_linear(zip *z, const char *name) { // reference: scan zip_find() used before its table
+    for( int i = zip_count(z); --i >= 0; ) if( !strcmp(zip_name(z, i), name) ) return i;
+    return -1;
+}
+
+static void bench_lookup() {
+    enum { ARCHIVES = 64, ENTRIES = 1024, QUERIES = 256 };
+
+    for( int a = 0; a < ARCHIVES; ++a ) {
+        zip *z = zip_open(stringf(".vfs[lut%02d].zip", a), "wb");
+        for( int n = 0; n <= ENTRIES; ++n ) { // last one duplicates first entry: most recent copy wins
+            char *entry = stringf("pack%02d/item_%04d.txt", a, n % ENTRIES), *body = n < ENTRIES ? "old" : "new";
+            FILE *in = fmemopen(body, 3, "rb");
+            zip_append_file(z, entry, "", in, 0);
+            fclose(in);
+        }
+        zip_close(z);
+        vfs_mount(stringf(".vfs[lut%02d].zip", a));
+    }
+
+    // per archive: table vs linear scan, both hits and misses
+    int mismatches = 0;
+    double lut = 0, linear = 0;
+    for( archive_dir *dir = dir_mount; dir; dir = dir->next ) {
+        if( dir->type != is_zip || !strstr(dir->filename, "lut") ) continue;
+        zip_find(dir->zip_archive, ""); // builds table
+        for( int q = 0; q < QUERIES; ++q ) {
+            char *name = stringf("pack%02d/item_%04d.txt", atoi(strstr(dir->filename, "lut") + 3), !q ? 0 : q % 3 ? q * 3 : ENTRIES + q);
+            uint64_t t0 = time_ns();
+            int found = zip_find(dir->zip_archive, name);
+            uint64_t t1 = time_ns();
+            int expected = find_linear(dir->zip_archive, name);
+            uint64_t t2 = time_ns();
+            lut += t1 - t0, linear += t2 - t1;
+            mismatches += found != expected || (q == 0 && found != ENTRIES);
+        }
+    }
+
+    // vfs: misses walk all archives. hits in the oldest archive too, as unresolved paths do
+    uint64_t t0 = time_ns();
+    for( int q = 0; q < QUERIES; ++q ) mismatches += !!vfs_load(stringf("pack%02d/missing_%04d.txt", q % ARCHIVES, q), 0);
+    uint64_t t1 = time_ns();
+    for( int q = 0; q < QUERIES; ++q ) {
+        int size; char *data = vfs_unpack(stringf("pack00/item_%04d.txt", q), &size);
+        mismatches += !data || size != 3 || memcmp(data, q ? "old" : "new", 3);
+        FREE(data);
+    }
+    uint64_t t2 = time_ns();
+
+    // appends drop the table: finds in between see every entry, and the most recent copy of a name
+    zip *z = zip_open(".vfs[append].zip", "wb");
+    pak *p = pak_open(".vfs[append].pak", "wb");
+    for( int n = 0; n < 8; ++n ) {
+        char *entry = stringf("append/item_%d.txt", n % 6);
+        FILE *in = fmemopen("abc", 3, "rb");
+        zip_append_file(z, entry, "", in, 0);
+        fclose(in);
+        pak_append_data(p, entry, "abc", 3);
+        mismatches += zip_find(z, entry) != n || pak_find(p, entry) != n || zip_find(z, "append/item_0.txt") != (n < 6 ? 0 : 6);
+    }
+    zip_close(z), pak_close(p);
+    unlink(".vfs[append].zip"), unlink(".vfs[append].pak");
+    failures += !!mismatches;
+
+    printf("\n%-8s %10s %12s %12s %12s %12s %10s\n", "archives", "entries", "find ns", "linear ns", "miss us", "hit us", "mismatches");
+    printf("%-8d %10d %12.1f %12.1f %12.2f %12.2f %10d%s\n", ARCHIVES, ENTRIES + 1, lut / (ARCHIVES * QUERIES), linear / (ARCHIVES * QUERIES),
+        (t1 - t0) / 1e3 / QUERIES, (t2 - t1) / 1e3 / QUERIES, mismatches, mismatches ? "  FAIL" : "");
+}
+
+// directory walks: native file_scan() vs find piped through sort, as file_list() did before
+static array(char*) list_popen(const char *folder, const char *pattern) {
+    array(char*) list = 0;
+    for( FILE *in = popen(stringf("find ./%s -type f -iname '%s' | LC_ALL=C sort", folder, pattern), "r"); in; pclose(in), in = 0 ) {
+        char buf[1024];
+        while( fgets(buf, sizeof(buf), in) ) {
+            int len = strlen(buf); while( len > 0 && buf[len-1] < 32 ) buf[--len] = 0;
+            array_push(list, STRDUP(buf + 2 * !memcmp(buf, "./", 2)));
+        }
+    }
+    return list;
+}
+
+static void bench_scan() {
+    enum { FOLDERS = 100, SUBFOLDERS = 10, FILES = 100 }; // 100K files
+
+    mkdir(".scan", 0777);
+    for( int a = 0, n = 0; a < FOLDERS; ++a ) {
+        mkdir(stringf(".scan/d%02d", a), 0777);
+        for( int b = 0; b < SUBFOLDERS; ++b ) {
+            mkdir(stringf(".scan/d%02d/s%d", a, b), 0777);
+            for( int f = 0; f < FILES; ++f, ++n ) {
+                FILE *fp = fopen(stringf(".scan/d%02d/s%d/f%05d.%s", a, b, n, f % 4 ? "png" : "txt"), "wb");
+                if( fp ) fwrite("0123456", 1, n % 7, fp), fclose(fp);
+            }
+        }
+    }
+
+    // names: file_list() vs find. names & stats: file_scan() vs find plus a stat per file, as the cooker did
+    int mismatches = 0, scanned = 0, piped = 0, listed = 0;
+    uint64_t t0 = time_ns();
+    const char **list = file_list(".scan/**.PNG"); // case insensitive, as find -iname
+    uint64_t t1 = time_ns();
+    array(char*) pipe = list_popen(".scan", "*.png");
+    uint64_t t2 = time_ns();
+    const file_info *scan = file_scan(".scan/**.png");
+    uint64_t t3 = time_ns();
+    uint64_t sizes = 0;
+    for( int i = 0; i < array_count(pipe); ++i ) sizes += file_size(pipe[i]) + !file_stamp(pipe[i]);
+    uint64_t t4 = time_ns();
+
+    while( list[listed] ) ++listed;
+    while( scan[scanned].name ) ++scanned;
+    piped = array_count(pipe);
+    for( int i = 0; i < scanned && i < piped && i < listed; ++i ) {
+        int n = atoi(strrchr(scan[i].name, 'f') + 1);
+        mismatches += strcmp(scan[i].name, pipe[i]) || strcmp(list[i], pipe[i]);
+        mismatches += scan[i].size != n % 7 || scan[i].stamp != file_stamp(scan[i].name);
+        sizes -= scan[i].size;
+    }
+    mismatches += listed != piped || scanned != piped || piped != FOLDERS * SUBFOLDERS * FILES * 3 / 4 || sizes;
+
+    // non recursive: only files right in the folder
+    const file_info *flat = file_scan(".scan/d00/s0/*.txt");
+    int flats = 0; while( flat[flats].name ) ++flats;
+    mismatches += flats != FILES / 4;
+    const file_info *none = file_scan(".scan/*.png");
+    mismatches += !!none[0].name;
+
+    // "**" as a folder recurses from the one above. absolute masks list absolute names
+    const file_info *nested = file_scan(".scan/**/*.txt");
+    int nesteds = 0; while( nested[nesteds].name ) ++nesteds;
+    mismatches += nesteds != FOLDERS * SUBFOLDERS * FILES / 4;
+    char cwd[512] = {0}; getcwd(cwd, sizeof(cwd));
+    const file_info *absolute = file_scan(stringf("%s/.scan/d00/s0/*.txt", cwd));
+    int absolutes = 0; while( absolute[absolutes].name ) mismatches += absolute[absolutes++].name[0] != '/';
+    mismatches += absolutes != FILES / 4;
+    failures += !!mismatches;
+
+    printf("\n%-8s %10s %10s %10s %10s %12s %10s\n", "files", "matched", "list ms", "popen ms", "scan ms", "popen+stat", "mismatches");
+    printf("%-8d %10d %10.1f %10.1f %10.1f %12.1f %10d%s\n", FOLDERS * SUBFOLDERS * FILES, scanned, (t1 - t0) / 1e6, (t2 - t1) / 1e6,
+        (t3 - t2) / 1e6, (t2 - t1 + t4 - t3) / 1e6, mismatches, mismatches ? "  FAIL" : "");
+
+    for( int i = 0; i < array_count(pipe); ++i ) FREE(pipe[i]);
+    array_free(pipe);
+    for( const file_info *all = file_scan(".scan/**"); all->name; ++all ) unlink(all->name);
+    for( int a = 0; a < FOLDERS; ++a ) {
+        for( int b = 0; b < SUBFOLDERS; ++b ) rmdir(stringf(".scan/d%02d/s%d", a, b));
+        rmdir(stringf(".scan/d%02d", a));
+    }
+    rmdir(".scan");
+}
+
+// boot index snapshot: every run is a fresh process, as a boot would be
+static const char *snapshot_archives[] = { ".vfs[0].zip", ".vfs[1].zip", ".vfs[2].zip", ".vfs[3].zip", ".vfs[4].zip", ".vfs[mmap].zip", ".vfs[none].zip", ".vfs[order].zip", ".vfs[slow].zip" };
+
+static void snapshot_child() {
+    uint64_t t0 = time_ns();
+    int mounted = vfs_mount_snapshot(".vfs.idx", snapshot_archives, countof(snapshot_archives), 1);
+    double ms = (time_ns() - t0) / 1e6;
+
+    unsigned hash = 0, found = 0;
+    for( int i = 0; i < array_count(vfs_entries); i += 7 ) {
+        const char *id = vfs_entries[i].id;
+        hash = hash * 31 + i + vfs_entries[i].size + vfs_entries[i].offset;
+        found += vfs_index_find(id) == resolve_linear(id);
+    }
+    int size = 0; char *data = array_count(vfs_entries) ? vfs_load(vfs_entries[array_count(vfs_entries) - 1].name, &size) : 0;
+    int ordered = 0; char *a = vfs_load("order/a.txt", &ordered);
+    ordered = a && ordered == 4 && !memcmp(a, "aaaa", 4);
+    printf("snapshot %d %d %u %u %d %d %f\n", mounted, array_count(vfs_entries), hash, found, data ? size : -1, ordered, ms);
+}
+
+static void snapshot_order(const char *first, const char *second) { // stored entries: same archive size in either order
+    zip *z = zip_open(".vfs[order].zip", "wb");
+    const char *names[] = { first, second };
+    for( int i = 0; i < 2; ++i ) {
+        const char *data = strstr(names[i], "a.txt") ? "aaaa" : "bb";
+        FILE *in = fmemopen((void*)data, strlen(data), "rb");
+        zip_append_file(z, names[i], "", in, 0);
+        fclose(in);
+    }
+    zip_close(z);
+}
+
+static void bench_snapshot(const char *self) {
+    struct { const char *title; int mounted, entries, size, ordered; unsigned hash, found; double ms; } runs[5] = { {"rebuild"}, {"mapped"}, {"corrupt"}, {"reorder"}, {"touched"} };
+
+    unlink(".vfs.idx");
+    snapshot_order("order/a.txt", "order/b.txt");
+    printf("\n%-8s %10s %10s %12s\n", "snapshot", "archives", "entries", "mount ms");
+    for( int r = 0; r < 5; ++r ) {
+        if( r == 2 ) { // point an entry past the archive list
+            FILE *fp = fopen(".vfs.idx", "r+b");
+            uint32_t bogus = 99;
+            fseek(fp, sizeof(struct vfs_snapshot_header) + countof(snapshot_archives) * sizeof(struct vfs_snapshot_archive) + offsetof(struct vfs_snapshot_entry, archive), SEEK_SET);
+            fwrite(&bogus, sizeof(bogus), 1, fp);
+            fclose(fp);
+        }
+        if( r == 3 ) { // rewrite an archive: same size, same second. entries move
+            struct stat st; stat(".vfs[order].zip", &st);
+            snapshot_order("order/b.txt", "order/a.txt");
+            struct utimbuf t = { st.st_atime, st.st_mtime };
+            utime(".vfs[order].zip", &t);
+        }
+        if( r == 4 ) { // rewrite an archive: new stamp & size
+            zip *z = zip_open(".vfs[slow].zip", "a");
+            FILE *in = fmemopen("touched", 7, "rb");
+            zip_append_file(z, "art/touched.txt", "", in, 0);
+            fclose(in);
+            zip_close(z);
+        }
+        FILE *fp = popen(stringf("%s --snapshot", self), "r");
+        char line[256];
+        while( fp && fgets(line, 256, fp) ) {
+            char *out = strstr(line, "snapshot "); // logger may prefix color codes
+            if( out ) sscanf(out, "snapshot %d %d %u %u %d %d %lf", &runs[r].mounted, &runs[r].entries, &runs[r].hash, &runs[r].found, &runs[r].size, &runs[r].ordered, &runs[r].ms);
+        }
+        if( fp ) pclose(fp);
+        printf("%-8s %10d %10d %12.3f\n", runs[r].title, runs[r].mounted, runs[r].entries, runs[r].ms);
+    }
+
+    int broken = runs[0].mounted != 8 || runs[0].found != (runs[0].entries + 6) / 7 || runs[0].size <= 0;
+    for( int r = 1; r <= 2; ++r ) { // mapped, then rebuilt past the corrupt one: same index
+        broken += runs[r].mounted != runs[0].mounted || runs[r].entries != runs[0].entries || runs[r].hash != runs[0].hash;
+        broken += runs[r].found != runs[0].found || runs[r].size != runs[0].size;
+    }
+    for( int r = 0; r < 5; ++r ) broken += !runs[r].ordered;
+    broken += runs[4].entries != runs[0].entries + 1 || runs[4].size != 7; // rebuilt: touched entry seen, loaded last
+    failures += !!broken;
+    if( broken ) printf("snapshot FAIL\n");
+    unlink(".vfs.idx");
+}
+
+int main(int argc, char **argv) {
+    if( argc > 1 && !strcmp(argv[1], "--snapshot") ) return snapshot_child(), 0;
+
+    bench_resolve();
+    bench_load();
+    bench_cache();
+    bench_mmap();
+    bench_stream();
+    bench_async();
+    bench_lookup();
+    bench_scan();
+    bench_snapshot(argv[0]);
+
+    for( int i = 0; i < 16; ++i ) unlink(stringf(".vfs[%d].zip", i));
+    unlink(".vfs[mmap].zip");
+    unlink(".vfs[cache].zip");
+    unlink(".vfs[slow].zip");
+    unlink(".vfs[order].zip");
+    for( int i = 0; i < 64; ++i ) unlink(stringf(".vfs[lut%02d].zip", i));
+    printf("\n%d failed\n", failures);
+    return failures;
+}